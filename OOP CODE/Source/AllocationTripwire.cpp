@@ -0,0 +1,143 @@
+#include "AllocationTripwire.h"
+
+#if OTODECKS_ALLOCATION_TRIPWIRE
+ #include <new>
+ #include <cstdlib>
+
+namespace
+{
+    //How many real-time sections the current thread is inside
+    thread_local int realtimeDepth = 0;
+    //Set while an assertion is being raised, so the assertion's own allocations are not counted
+    thread_local bool reportingViolation = false;
+
+    std::atomic<int> numViolations { 0 };
+    std::atomic<bool> assertOnAllocation { true };
+
+    //Called on every allocation and free
+    inline void checkHeapAccess() noexcept
+    {
+        if (realtimeDepth > 0 && ! reportingViolation)
+        {
+            ++numViolations;
+
+            if (assertOnAllocation.load(std::memory_order_relaxed))
+            {
+                reportingViolation = true;
+                //Something on the audio thread touched the heap, look at the call stack
+                jassertfalse;
+                reportingViolation = false;
+            }
+        }
+    }
+}
+
+ #if defined (__GLIBC__)
+//On glibc malloc itself can be replaced, so C allocations made by libraries are caught too
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void  __libc_free (void*);
+
+    void* malloc (size_t size)                 { checkHeapAccess(); return __libc_malloc (size); }
+    void* calloc (size_t count, size_t size)   { checkHeapAccess(); return __libc_calloc (count, size); }
+    void* realloc (void* ptr, size_t size)     { checkHeapAccess(); return __libc_realloc (ptr, size); }
+    void  free (void* ptr)                     { if (ptr != nullptr) checkHeapAccess(); __libc_free (ptr); }
+}
+
+static void* rawAllocate (size_t size)                      { return __libc_malloc (size); }
+static void* rawAllocateAligned (size_t size, size_t align) { return __libc_memalign (align, size); }
+static void  rawFree (void* ptr)                            { __libc_free (ptr); }
+static void  rawFreeAligned (void* ptr)                     { __libc_free (ptr); }
+ #elif JUCE_WINDOWS
+static void* rawAllocate (size_t size)                      { return std::malloc (size); }
+static void* rawAllocateAligned (size_t size, size_t align) { return _aligned_malloc (size, align); }
+static void  rawFree (void* ptr)                            { std::free (ptr); }
+static void  rawFreeAligned (void* ptr)                     { _aligned_free (ptr); }
+ #else
+static void* rawAllocate (size_t size)                      { return std::malloc (size); }
+static void* rawAllocateAligned (size_t size, size_t align)
+{
+    void* ptr = nullptr;
+    return posix_memalign (&ptr, jmax (align, sizeof (void*)), size) == 0 ? ptr : nullptr;
+}
+static void  rawFree (void* ptr)                            { std::free (ptr); }
+static void  rawFreeAligned (void* ptr)                     { std::free (ptr); }
+ #endif
+
+//Replacement global allocation functions
+static void* checkedAllocate (size_t size)
+{
+    checkHeapAccess();
+
+    if (auto* ptr = rawAllocate (size > 0 ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+static void* checkedAllocateAligned (size_t size, std::align_val_t align)
+{
+    checkHeapAccess();
+
+    if (auto* ptr = rawAllocateAligned (size > 0 ? size : 1, static_cast<size_t> (align)))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+static void checkedFree (void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        checkHeapAccess();
+
+    rawFree (ptr);
+}
+
+static void checkedFreeAligned (void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        checkHeapAccess();
+
+    rawFreeAligned (ptr);
+}
+
+void* operator new (size_t size)                                          { return checkedAllocate (size); }
+void* operator new[] (size_t size)                                        { return checkedAllocate (size); }
+void* operator new (size_t size, const std::nothrow_t&) noexcept          { checkHeapAccess(); return rawAllocate (size > 0 ? size : 1); }
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept        { checkHeapAccess(); return rawAllocate (size > 0 ? size : 1); }
+void* operator new (size_t size, std::align_val_t align)                  { return checkedAllocateAligned (size, align); }
+void* operator new[] (size_t size, std::align_val_t align)                { return checkedAllocateAligned (size, align); }
+
+void operator delete (void* ptr) noexcept                                 { checkedFree (ptr); }
+void operator delete[] (void* ptr) noexcept                               { checkedFree (ptr); }
+void operator delete (void* ptr, size_t) noexcept                         { checkedFree (ptr); }
+void operator delete[] (void* ptr, size_t) noexcept                       { checkedFree (ptr); }
+void operator delete (void* ptr, const std::nothrow_t&) noexcept          { checkedFree (ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept        { checkedFree (ptr); }
+void operator delete (void* ptr, std::align_val_t) noexcept               { checkedFreeAligned (ptr); }
+void operator delete[] (void* ptr, std::align_val_t) noexcept             { checkedFreeAligned (ptr); }
+void operator delete (void* ptr, size_t, std::align_val_t) noexcept       { checkedFreeAligned (ptr); }
+void operator delete[] (void* ptr, size_t, std::align_val_t) noexcept     { checkedFreeAligned (ptr); }
+
+bool AllocationTripwire::isEnabled() noexcept                      { return true; }
+int  AllocationTripwire::getNumViolations() noexcept               { return numViolations.load(); }
+void AllocationTripwire::resetViolations() noexcept                { numViolations = 0; }
+void AllocationTripwire::setAssertOnAllocation(bool shouldAssert) noexcept { assertOnAllocation = shouldAssert; }
+void AllocationTripwire::enterRealtimeSection() noexcept           { ++realtimeDepth; }
+void AllocationTripwire::exitRealtimeSection() noexcept            { --realtimeDepth; }
+
+#else
+
+//Tripwire compiled out: nothing is counted
+bool AllocationTripwire::isEnabled() noexcept                      { return false; }
+int  AllocationTripwire::getNumViolations() noexcept               { return 0; }
+void AllocationTripwire::resetViolations() noexcept                {}
+void AllocationTripwire::setAssertOnAllocation(bool) noexcept      {}
+void AllocationTripwire::enterRealtimeSection() noexcept           {}
+void AllocationTripwire::exitRealtimeSection() noexcept            {}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Turned on for Debug builds in OtoDecks.jucer
+#ifndef OTODECKS_ALLOCATION_TRIPWIRE
+ #define OTODECKS_ALLOCATION_TRIPWIRE 0
+#endif
+
+//Debug tool that catches heap use from inside the audio callback. When OTODECKS_ALLOCATION_TRIPWIRE is on,
+//the global operator new/delete (and malloc/free on glibc) are replaced by versions that count, and by default
+//assert on, every allocation or free made while a ScopedRealtimeSection is alive on the calling thread.
+//When it is off, ScopedRealtimeSection compiles to nothing.
+class AllocationTripwire
+{
+public:
+    //Marks the calling thread as real-time for as long as the object exists
+    class ScopedRealtimeSection
+    {
+    public:
+       #if OTODECKS_ALLOCATION_TRIPWIRE
+        ScopedRealtimeSection() noexcept   { AllocationTripwire::enterRealtimeSection(); }
+        ~ScopedRealtimeSection() noexcept  { AllocationTripwire::exitRealtimeSection(); }
+       #else
+        ScopedRealtimeSection() noexcept   {}
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtimeSection)
+    };
+
+    //Lets known non-real-time work run inside a real-time section without tripping, e.g. shutdown paths
+    class ScopedAllowAllocation
+    {
+    public:
+       #if OTODECKS_ALLOCATION_TRIPWIRE
+        ScopedAllowAllocation() noexcept   { AllocationTripwire::exitRealtimeSection(); }
+        ~ScopedAllowAllocation() noexcept  { AllocationTripwire::enterRealtimeSection(); }
+       #else
+        ScopedAllowAllocation() noexcept   {}
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedAllowAllocation)
+    };
+
+    //Check if the tripwire was compiled in
+    static bool isEnabled() noexcept;
+    //Number of allocations and frees seen inside real-time sections
+    static int getNumViolations() noexcept;
+    static void resetViolations() noexcept;
+    //Choose between asserting on every violation (the default) or only counting them
+    static void setAssertOnAllocation(bool shouldAssert) noexcept;
+
+    //Used by the scoped classes
+    static void enterRealtimeSection() noexcept;
+    static void exitRealtimeSection() noexcept;
+};
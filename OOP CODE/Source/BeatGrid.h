@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Tempo and first downbeat of a track, found by the TrackAnalyzer
+struct BeatGrid
+{
+    //Beats per minute, 0 while the track hasn't been analysed and negative if no tempo was found
+    double bpm = 0.0;
+    //Where the first bar starts, in seconds from the start of the track
+    double firstDownbeatSeconds = 0.0;
+
+    bool isAnalysed() const { return bpm != 0.0; }
+    bool hasTempo() const { return bpm > 0.0; }
+
+    //Beats since the first downbeat at a time in the track, negative before it
+    double getBeatAt(double seconds) const { return (seconds - firstDownbeatSeconds) * bpm / 60.0; }
+};
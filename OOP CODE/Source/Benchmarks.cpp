@@ -0,0 +1,2082 @@
+#include "Benchmarks.h"
+#include "StereoBiquadCascade.h"
+#include "TimeStretchSource.h"
+#include "DeckMixer.h"
+#include "MasterLimiter.h"
+#include "ConvolutionReverb.h"
+#include "DeckFxRack.h"
+#include "DJAudioplayer.h"
+#include "TrackLibrary.h"
+#include "TrackAnalyzer.h"
+#include "CallbackProfiler.h"
+#include <numeric>
+
+namespace
+{
+    //One recorded figure
+    struct Figure
+    {
+        String name;
+        double value;
+        String unit;
+        bool higherIsBetter;
+    };
+
+    //Figures recorded so far in this run
+    std::vector<Figure>& getFigures()
+    {
+        static std::vector<Figure> figures;
+        return figures;
+    }
+}
+
+//Function to pick the benchmarks to run and the output options from the command line
+int Benchmarks::run(const String& commandLine)
+{
+    StringArray tokens;
+    tokens.addTokens(commandLine, true);
+    tokens.removeEmptyStrings();
+
+    StringArray names;
+    String jsonPath, baselinePath;
+    double thresholdPercent = 10.0;
+
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        auto token = tokens[i].unquoted();
+        bool hasValue = i + 1 < tokens.size();
+
+        if (token == "--json" && hasValue)
+            jsonPath = tokens[++i].unquoted();
+        else if (token == "--baseline" && hasValue)
+            baselinePath = tokens[++i].unquoted();
+        else if (token == "--threshold" && hasValue)
+            thresholdPercent = tokens[++i].getDoubleValue();
+        else if (! token.startsWith("--"))
+            names.add(token);
+    }
+
+    //Run a benchmark if it was named or nothing was named
+    auto wants = [&names] (const String& name) { return names.isEmpty() || names.contains(name); };
+
+    if (wants("eq"))
+        runEqCascadeBenchmark();
+
+    if (wants("timestretch"))
+        runTimeStretchBenchmark();
+
+    if (wants("resampler"))
+        runResamplerBenchmark();
+
+    if (wants("renderpool"))
+        runRenderPoolBenchmark();
+
+    if (wants("limiter"))
+        runLimiterBenchmark();
+
+    if (wants("convolution"))
+        runConvolutionBenchmark();
+
+    if (wants("fx"))
+        runFxRackBenchmark();
+
+    if (wants("player"))
+        runPlayerBenchmark();
+
+    if (wants("mixer"))
+        runMixerBenchmark();
+
+    if (wants("thumbnail"))
+        runThumbnailBenchmark();
+
+    if (wants("library"))
+        runLibraryBenchmark();
+
+    if (wants("analysis"))
+        runAnalysisBenchmark();
+
+    if (wants("sync"))
+        runSyncBenchmark();
+
+    if (wants("hotcue"))
+        runHotCueBenchmark();
+
+    if (wants("scratch"))
+        runScratchBenchmark();
+
+    if (wants("reverse"))
+        runReverseBenchmark();
+
+    if (wants("latency"))
+        runLatencyBenchmark();
+
+    int exitCode = 0;
+    auto workingDirectory = File::getCurrentWorkingDirectory();
+
+    if (jsonPath.isNotEmpty())
+    {
+        auto jsonFile = workingDirectory.getChildFile(jsonPath);
+        if (writeJson(jsonFile))
+        {
+            std::cout << "Results written to " << jsonFile.getFullPathName() << std::endl;
+        }
+        else
+        {
+            std::cout << "Can't write " << jsonFile.getFullPathName() << std::endl;
+            exitCode = 1;
+        }
+    }
+
+    if (baselinePath.isNotEmpty() && compareWithBaseline(workingDirectory.getChildFile(baselinePath), thresholdPercent) > 0)
+        exitCode = 1;
+
+    return exitCode;
+}
+
+//Function to keep a figure for the JSON output and the baseline check
+void Benchmarks::record(const String& name, double value, const String& unit, bool higherIsBetter)
+{
+    getFigures().push_back({ name, value, unit, higherIsBetter });
+}
+
+//Function to write every recorded figure, with the machine they came from, as JSON
+bool Benchmarks::writeJson(const File& file)
+{
+    auto* root = new DynamicObject();
+    root->setProperty("date", Time::getCurrentTime().toISO8601(true));
+    root->setProperty("cpu", SystemStats::getCpuModel());
+    root->setProperty("cores", SystemStats::getNumCpus());
+    root->setProperty("os", SystemStats::getOperatingSystemName());
+
+    Array<var> results;
+    for (auto& figure : getFigures())
+    {
+        auto* entry = new DynamicObject();
+        entry->setProperty("name", figure.name);
+        entry->setProperty("value", figure.value);
+        entry->setProperty("unit", figure.unit);
+        entry->setProperty("higherIsBetter", figure.higherIsBetter);
+        results.add(var(entry));
+    }
+    root->setProperty("results", results);
+
+    return file.replaceWithText(JSON::toString(var(root)));
+}
+
+//Function to compare every recorded figure with the same figure in a baseline file
+int Benchmarks::compareWithBaseline(const File& file, double thresholdPercent)
+{
+    auto baseline = JSON::parse(file);
+    auto* entries = baseline["results"].getArray();
+
+    if (entries == nullptr)
+    {
+        std::cout << "Can't read a baseline from " << file.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::cout << "baseline: " << file.getFileName() << " from " << baseline["date"].toString() << " on "
+              << baseline["cpu"].toString() << ", regression threshold " << thresholdPercent << "%" << std::endl;
+
+    int numRegressions = 0;
+
+    for (auto& figure : getFigures())
+    {
+        const var* match = nullptr;
+        for (auto& entry : *entries)
+            if (entry["name"].toString() == figure.name)
+                match = &entry;
+
+        if (match == nullptr)
+        {
+            std::cout << "  " << figure.name << ": " << figure.value << " " << figure.unit << ", not in the baseline" << std::endl;
+            continue;
+        }
+
+        double base = (*match)["value"];
+        double threshold = match->hasProperty("threshold") ? (double) (*match)["threshold"] : thresholdPercent;
+        double change = base != 0.0 ? (figure.value - base) / std::abs(base) * 100.0 : 0.0;
+        bool regressed = (figure.higherIsBetter ? -change : change) > threshold;
+
+        if (regressed)
+            ++numRegressions;
+
+        std::cout << "  " << figure.name << ": " << base << " -> " << figure.value << " " << figure.unit << " ("
+                  << (change >= 0.0 ? "+" : "") << String(change, 1) << "%)" << (regressed ? "  REGRESSION" : "") << std::endl;
+    }
+
+    std::cout << "  " << numRegressions << (numRegressions == 1 ? " regression" : " regressions") << std::endl;
+    return numRegressions;
+}
+
+//Function to time the deck EQ: three IIRFilter passes per channel plus the mid gain pass, against the fused cascade
+void Benchmarks::runEqCascadeBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 512;
+    const int numBlocks = 20000;
+
+    //Same filter shapes the deck uses with the knobs a little off centre
+    auto bassCoeffs = IIRCoefficients::makeLowPass(sampleRate, 8000.0);
+    auto midCoeffs = IIRCoefficients::makeBandPass(sampleRate, 1000.0, 0.707);
+    auto trebleCoeffs = IIRCoefficients::makeHighShelf(sampleRate, 3000.0, 0.707, 1.5f);
+    const float midGain = 1.2f;
+
+    //Noise input, refilled from a copy every block so both chains see the same signal
+    AudioBuffer<float> input(2, blockSize), work(2, blockSize);
+    Random random(1234);
+    for (int channel = 0; channel < 2; ++channel)
+        for (int i = 0; i < blockSize; ++i)
+            input.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+    //Previous chain: separate filters per channel and a separate gain pass
+    IIRFilter filters[2][3];
+    for (auto& channelFilters : filters)
+    {
+        channelFilters[0].setCoefficients(bassCoeffs);
+        channelFilters[1].setCoefficients(midCoeffs);
+        channelFilters[2].setCoefficients(trebleCoeffs);
+    }
+
+    auto start = Time::getHighResolutionTicks();
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        work.makeCopyOf(input, true);
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            float* data = work.getWritePointer(channel);
+            filters[channel][0].processSamples(data, blockSize);
+            filters[channel][1].processSamples(data, blockSize);
+            FloatVectorOperations::multiply(data, midGain, blockSize);
+            filters[channel][2].processSamples(data, blockSize);
+        }
+    }
+    double separateSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+    //Fused chain: all stages for both channels in one pass, mid gain folded into the band-pass
+    StereoBiquadCascade cascade(3);
+    cascade.setCoefficients(0, bassCoeffs);
+    cascade.setCoefficients(1, midCoeffs, midGain);
+    cascade.setCoefficients(2, trebleCoeffs);
+
+    start = Time::getHighResolutionTicks();
+    for (int block = 0; block < numBlocks; ++block)
+    {
+        work.makeCopyOf(input, true);
+        cascade.process(work.getWritePointer(0), work.getWritePointer(1), blockSize);
+    }
+    double fusedSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+    //Report throughput in stereo samples per second and as a multiple of real time
+    double audioSeconds = (double) numBlocks * blockSize / sampleRate;
+    auto report = [audioSeconds, sampleRate] (const char* name, double seconds)
+    {
+        std::cout << "  " << name << ": " << (seconds * 1.0e9 / (audioSeconds * sampleRate)) << " ns/frame, "
+                  << (audioSeconds / seconds) << "x real time" << std::endl;
+    };
+
+    std::cout << "eq: 3-stage stereo EQ, " << numBlocks << " blocks of " << blockSize
+              << (StereoBiquadCascade::isVectorised() ? " (SIMD)" : " (scalar)") << std::endl;
+    report("separate IIRFilter passes", separateSeconds);
+    report("fused cascade", fusedSeconds);
+    std::cout << "  speedup: " << (separateSeconds / fusedSeconds) << "x" << std::endl;
+
+    record("eq.separate.nsPerFrame", separateSeconds * 1.0e9 / (audioSeconds * sampleRate), "ns");
+    record("eq.fused.nsPerFrame", fusedSeconds * 1.0e9 / (audioSeconds * sampleRate), "ns");
+}
+
+//Function to time each key-lock tier on a tone at a typical beatmatching tempo
+void Benchmarks::runTimeStretchBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const double audioSeconds = 30.0;
+    const int numBlocks = roundToInt(audioSeconds * sampleRate / blockSize);
+    const char* tierNames[] = { "wsolaFast", "wsolaHigh", "phaseVocoder" };
+
+    std::cout << "timestretch: stereo, " << sampleRate << " Hz, " << blockSize << "-sample blocks, tempo 1.06" << std::endl;
+
+    for (int tier = 0; tier < 3; ++tier)
+    {
+        ToneGeneratorAudioSource tone;
+        tone.setFrequency(440.0);
+        tone.setAmplitude(0.5f);
+
+        TimeStretchSource stretcher(&tone, false, 2);
+        stretcher.setQuality((TimeStretchSource::Quality) tier);
+        stretcher.setEnabled(true);
+        stretcher.setTempo(1.06);
+        stretcher.prepareToPlay(blockSize, sampleRate);
+
+        AudioBuffer<float> buffer(2, blockSize);
+        AudioSourceChannelInfo info(&buffer, 0, blockSize);
+
+        //The first blocks fill the engine's buffers, don't count them
+        for (int block = 0; block < 64; ++block)
+            stretcher.getNextAudioBlock(info);
+
+        auto start = Time::getHighResolutionTicks();
+        for (int block = 0; block < numBlocks; ++block)
+            stretcher.getNextAudioBlock(info);
+        double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        //Share of one core a deck needs, and how many decks fit leaving 30% for the rest of the callback
+        double load = seconds / audioSeconds;
+        std::cout << "  " << tierNames[tier] << ": " << (load * 100.0) << "% of a core per deck, "
+                  << (int) (1.0 / load) << " decks per core at full load, "
+                  << (int) (0.7 / load) << " with 30% headroom" << std::endl;
+        record("timestretch." + String(tierNames[tier]) + ".corePercent", load * 100.0, "%");
+
+        stretcher.releaseResources();
+    }
+}
+
+//Function to time each resampler tier across the speed range and measure how much aliasing it lets through
+void Benchmarks::runResamplerBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const double audioSeconds = 30.0;
+    const int numBlocks = roundToInt(audioSeconds * sampleRate / blockSize);
+    const char* tierNames[] = { "linear", "lagrange", "polyphaseSinc" };
+    const double speeds[] = { 0.5, 0.75, 1.0, 1.25, 1.5, 2.0 };
+
+    std::cout << "resampler: stereo, " << sampleRate << " Hz, " << blockSize << "-sample blocks"
+              << (PolyphaseSincKernel::isVectorised() ? " (SIMD sinc)" : " (scalar sinc)") << std::endl;
+    std::cout << "  residual: all output that isn't a tone landing at 0.2 fs, relative to it" << std::endl;
+    std::cout << "  leakage: output left from a 0.45 fs tone pushed above Nyquist, relative to the input" << std::endl;
+
+    //Noise looped from memory, so the timing is the resampler and not the source
+    AudioBuffer<float> noise(2, 65536);
+    Random random(1234);
+    for (int channel = 0; channel < 2; ++channel)
+        for (int i = 0; i < noise.getNumSamples(); ++i)
+            noise.setSample(channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+    for (int tier = 0; tier < 3; ++tier)
+    {
+        auto quality = (DeckResamplerSource::Quality) tier;
+
+        for (auto speed : speeds)
+        {
+            MemoryAudioSource source(noise, false, true);
+            DeckResamplerSource resampler(&source, false, 4.0, 2);
+            resampler.setQuality(quality);
+            resampler.setResamplingRatio(speed);
+            resampler.prepareToPlay(blockSize, sampleRate);
+
+            AudioBuffer<float> buffer(2, blockSize);
+            AudioSourceChannelInfo info(&buffer, 0, blockSize);
+
+            auto start = Time::getHighResolutionTicks();
+            for (int block = 0; block < numBlocks; ++block)
+                resampler.getNextAudioBlock(info);
+            double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+            resampler.releaseResources();
+
+            //Only speeds that push the tone past Nyquist have anything to leak
+            String leakage = speed * 0.45 > 0.5 ? String(measureResamplerLeakage(quality, speed, sampleRate), 1) + " dB"
+                                                : String("n/a");
+
+            std::cout << "  " << String(tierNames[tier]).paddedRight(' ', 14) << String(speed, 2) << "x: "
+                      << String(seconds / audioSeconds * 100.0, 3) << "% of a core per deck, residual "
+                      << String(measureResamplerResidual(quality, speed, sampleRate), 1) << " dB, leakage "
+                      << leakage << std::endl;
+            record("resampler." + String(tierNames[tier]) + "." + String(speed, 2) + "x.corePercent", seconds / audioSeconds * 100.0, "%");
+        }
+    }
+}
+
+//Function to resample a tone that should come out at a fifth of the sample rate and measure what else comes out
+double Benchmarks::measureResamplerResidual(DeckResamplerSource::Quality quality, double speed, double sampleRate)
+{
+    const int blockSize = 256;
+    const int numSamples = (int) sampleRate;
+    const double outputFrequency = sampleRate * 0.2;
+
+    ToneGeneratorAudioSource tone;
+    tone.setFrequency(outputFrequency / speed);
+    tone.setAmplitude(0.5f);
+
+    DeckResamplerSource resampler(&tone, false, 4.0, 1);
+    resampler.setQuality(quality);
+    resampler.setResamplingRatio(speed);
+    resampler.prepareToPlay(blockSize, sampleRate);
+
+    AudioBuffer<float> output(1, numSamples + blockSize);
+    AudioBuffer<float> block(1, blockSize);
+    AudioSourceChannelInfo info(&block, 0, blockSize);
+
+    //Let the kernel's history fill with the tone first
+    for (int i = 0; i < 16; ++i)
+        resampler.getNextAudioBlock(info);
+
+    for (int position = 0; position < numSamples; position += blockSize)
+    {
+        resampler.getNextAudioBlock(info);
+        output.copyFrom(0, position, block, 0, 0, blockSize);
+    }
+
+    //Fit the expected tone, a whole number of cycles fits in the window so sine and cosine are orthogonal
+    const float* y = output.getReadPointer(0);
+    double w = MathConstants<double>::twoPi * outputFrequency / sampleRate;
+    double sinPart = 0.0, cosPart = 0.0;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        sinPart += y[i] * std::sin(w * i);
+        cosPart += y[i] * std::cos(w * i);
+    }
+    sinPart *= 2.0 / numSamples;
+    cosPart *= 2.0 / numSamples;
+
+    double residualEnergy = 0.0, toneEnergy = 0.0;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        double fitted = sinPart * std::sin(w * i) + cosPart * std::cos(w * i);
+        residualEnergy += (y[i] - fitted) * (y[i] - fitted);
+        toneEnergy += fitted * fitted;
+    }
+
+    return Decibels::gainToDecibels(std::sqrt(residualEnergy / jmax(1.0e-30, toneEnergy)), -200.0);
+}
+
+//Function to resample a tone at 0.45 fs fast enough that it belongs above Nyquist and measure how much of it folds back
+double Benchmarks::measureResamplerLeakage(DeckResamplerSource::Quality quality, double speed, double sampleRate)
+{
+    const int blockSize = 256;
+    const int numBlocks = 200;
+    const float amplitude = 0.5f;
+
+    ToneGeneratorAudioSource tone;
+    tone.setFrequency(sampleRate * 0.45);
+    tone.setAmplitude(amplitude);
+
+    DeckResamplerSource resampler(&tone, false, 4.0, 1);
+    resampler.setQuality(quality);
+    resampler.setResamplingRatio(speed);
+    resampler.prepareToPlay(blockSize, sampleRate);
+
+    AudioBuffer<float> block(1, blockSize);
+    AudioSourceChannelInfo info(&block, 0, blockSize);
+
+    for (int i = 0; i < 16; ++i)
+        resampler.getNextAudioBlock(info);
+
+    double energy = 0.0;
+    for (int i = 0; i < numBlocks; ++i)
+    {
+        resampler.getNextAudioBlock(info);
+        const float* y = block.getReadPointer(0);
+        for (int n = 0; n < blockSize; ++n)
+            energy += y[n] * y[n];
+    }
+
+    //The input tone's RMS is amplitude / sqrt 2
+    double rms = std::sqrt(energy / (numBlocks * blockSize));
+    return Decibels::gainToDecibels(rms / (amplitude / MathConstants<double>::sqrt2), -200.0);
+}
+
+namespace
+{
+    //A deck with everything heavy switched on: phase vocoder key lock, sinc resampling off unity speed and reverb,
+    //playing noise looped from memory so the disk plays no part
+    struct HeavyDeck
+    {
+        HeavyDeck(AudioBuffer<float>& noise)
+            : source(noise, false, true),
+              stretcher(&source, false, 2),
+              resampler(&stretcher, false, 4.0, 2),
+              reverb(&resampler, false)
+        {
+            stretcher.setQuality(TimeStretchSource::Quality::phaseVocoder);
+            stretcher.setEnabled(true);
+            stretcher.setTempo(1.06);
+            resampler.setResamplingRatio(1.06);
+
+            Reverb::Parameters params;
+            params.roomSize = 0.6f;
+            params.wetLevel = 0.3f;
+            reverb.setParameters(params);
+        }
+
+        MemoryAudioSource source;
+        TimeStretchSource stretcher;
+        DeckResamplerSource resampler;
+        ReverbAudioSource reverb;
+    };
+}
+
+//Function to find the smallest buffer four heavy decks play at without dropouts, serially and on the render pool
+void Benchmarks::runRenderPoolBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int numDecks = 4;
+    const double audioSeconds = 5.0;
+    const int blockSizes[] = { 32, 64, 128, 256, 512, 1024 };
+
+    //Leaves 30% of each period for the device, the OS and the mix-down, like the other benchmarks
+    const double maxLoad = 0.7;
+
+    DeckRenderPool pool(numDecks - 1);
+
+    std::cout << "renderpool: " << numDecks << " decks with phase vocoder key lock, sinc resampling at 1.06x and reverb, "
+              << sampleRate << " Hz, " << pool.getNumWorkers() << " workers" << std::endl;
+    std::cout << "  blocks are paced at the device period, a size is stable if 99.9% of blocks take under "
+              << roundToInt(maxLoad * 100.0) << "% of it" << std::endl;
+
+    AudioBuffer<float> noise(2, 65536);
+    Random random(1234);
+    for (int channel = 0; channel < 2; ++channel)
+        for (int i = 0; i < noise.getNumSamples(); ++i)
+            noise.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+
+    for (int parallel = 0; parallel < 2; ++parallel)
+    {
+        pool.setParallelEnabled(parallel == 1);
+        int minStableSize = 0;
+
+        for (auto blockSize : blockSizes)
+        {
+            OwnedArray<HeavyDeck> decks;
+            DeckMixer mixer(numDecks);
+            mixer.setRenderPool(&pool);
+
+            for (int deck = 0; deck < numDecks; ++deck)
+                mixer.setSource(deck, &decks.add(new HeavyDeck(noise))->reverb);
+
+            mixer.prepareToPlay(blockSize, sampleRate);
+
+            AudioBuffer<float> buffer(2, blockSize);
+            AudioSourceChannelInfo info(&buffer, 0, blockSize);
+
+            //The first blocks fill the engines' buffers, don't count them
+            for (int block = 0; block < 64; ++block)
+                mixer.getNextAudioBlock(info);
+
+            //Each block starts when the device would ask for it, so the workers idle between blocks as they would live
+            const int numBlocks = roundToInt(audioSeconds * sampleRate / blockSize);
+            const double period = blockSize / sampleRate;
+            const auto periodTicks = Time::secondsToHighResolutionTicks(period);
+            std::vector<double> times((size_t) numBlocks);
+
+            auto deadline = Time::getHighResolutionTicks();
+            for (auto& time : times)
+            {
+                deadline += periodTicks;
+                while (Time::getHighResolutionTicks() < deadline) {}
+
+                auto start = Time::getHighResolutionTicks();
+                mixer.getNextAudioBlock(info);
+                time = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+            }
+
+            mixer.releaseResources();
+
+            std::sort(times.begin(), times.end());
+            double mean = std::accumulate(times.begin(), times.end(), 0.0) / numBlocks;
+            double worst = times[(size_t) jmin(numBlocks - 1, (int) (numBlocks * 0.999))];
+            bool stable = worst < period * maxLoad;
+
+            if (stable && minStableSize == 0)
+                minStableSize = blockSize;
+
+            std::cout << "  " << (parallel == 1 ? "parallel " : "serial   ") << String(blockSize).paddedLeft(' ', 4)
+                      << ": mean " << String(mean / period * 100.0, 1) << "%, 99.9th percentile "
+                      << String(worst / period * 100.0, 1) << "% of the period" << (stable ? "" : ", unstable") << std::endl;
+        }
+
+        std::cout << "  minimum stable buffer " << (parallel == 1 ? "on the pool: " : "serially: ")
+                  << (minStableSize > 0 ? String(minStableSize) + " samples ("
+                                              + String(minStableSize / sampleRate * 1000.0, 2) + " ms)"
+                                        : String("none up to 1024 samples")) << std::endl;
+        //A size that never becomes stable counts as twice the largest size tried
+        record(String("renderpool.") + (parallel == 1 ? "parallel" : "serial") + ".minStableBlock",
+               minStableSize > 0 ? minStableSize : 2048, "samples");
+    }
+}
+
+//Function to time the master limiter on a hot and a quiet mix and check how far over the ceiling the output gets
+void Benchmarks::runLimiterBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const double audioSeconds = 30.0;
+    const float ceilingDecibels = -1.0f;
+
+    std::cout << "limiter: stereo, " << sampleRate << " Hz, " << blockSize << "-sample blocks, ceiling "
+              << ceilingDecibels << " dBTP" << (MasterLimiter::isVectorised() ? " (SIMD detector)" : " (scalar detector)") << std::endl;
+
+    //A hot mix: a bright tone whose peaks fall between samples, a bass line and noise, pushed 8 dB into the ceiling in
+    //alternate tenths of a second; the quiet mix is the same 20 dB down
+    const int length = 65536;
+    AudioBuffer<float> hot(2, length), quiet(2, length);
+    Random random(1234);
+    for (int i = 0; i < length; ++i)
+    {
+        double level = (i / 4800) % 2 == 0 ? 2.5 : 0.5;
+        double t = i / sampleRate;
+        hot.setSample(0, i, (float) (level * (0.5 * std::sin(MathConstants<double>::twoPi * 11025.0 * t + 0.785)
+                                              + 0.1 * (random.nextFloat() * 2.0f - 1.0f))));
+        hot.setSample(1, i, (float) (level * (0.6 * std::sin(MathConstants<double>::twoPi * 55.0 * t)
+                                              + 0.3 * std::sin(MathConstants<double>::twoPi * 9000.0 * t))));
+    }
+    for (int channel = 0; channel < 2; ++channel)
+        quiet.copyFrom(channel, 0, hot, channel, 0, length);
+    quiet.applyGain(0.1f);
+
+    for (auto* mix : { &hot, &quiet })
+    {
+        MemoryAudioSource source(*mix, false, true);
+        MasterLimiter limiter(&source, false);
+        limiter.setCeilingDecibels(ceilingDecibels);
+        limiter.prepareToPlay(blockSize, sampleRate);
+
+        AudioBuffer<float> buffer(2, blockSize);
+        AudioSourceChannelInfo info(&buffer, 0, blockSize);
+
+        //The same source on its own, so its cost can be taken off
+        MemoryAudioSource sourceOnly(*mix, false, true);
+        sourceOnly.prepareToPlay(blockSize, sampleRate);
+        const int numBlocks = roundToInt(audioSeconds * sampleRate / blockSize);
+
+        auto start = Time::getHighResolutionTicks();
+        for (int block = 0; block < numBlocks; ++block)
+            sourceOnly.getNextAudioBlock(info);
+        double sourceSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        //Keep one pass of the output to measure
+        AudioBuffer<float> output(2, length);
+
+        start = Time::getHighResolutionTicks();
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            limiter.getNextAudioBlock(info);
+
+            int position = block * blockSize;
+            if (position + blockSize <= length)
+                for (int channel = 0; channel < 2; ++channel)
+                    output.copyFrom(channel, position, buffer, channel, 0, blockSize);
+        }
+        double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) - sourceSeconds;
+        float deepest = limiter.getGainReductionDecibels();
+
+        std::cout << "  " << (mix == &hot ? "hot:   " : "quiet: ") << String(seconds / audioSeconds * 100.0, 3)
+                  << "% of a core, sample peak " << String(Decibels::gainToDecibels(output.getMagnitude(0, length)), 2)
+                  << " dBFS, true peak " << String(Decibels::gainToDecibels(measureTruePeak(output)), 2)
+                  << " dBTP, deepest reduction " << String(deepest, 1) << " dB" << std::endl;
+        record(String("limiter.") + (mix == &hot ? "hot" : "quiet") + ".corePercent", seconds / audioSeconds * 100.0, "%");
+
+        limiter.releaseResources();
+    }
+
+    std::cout << "  latency: " << roundToInt(MasterLimiter::lookAheadMs * sampleRate / 1000.0) + MasterLimiter::detectorDelay
+              << " samples at " << sampleRate << " Hz" << std::endl;
+}
+
+//Function to find the highest level between samples with a long windowed-sinc interpolator at 32x, independent of the
+//limiter's own detector
+float Benchmarks::measureTruePeak(const AudioBuffer<float>& buffer)
+{
+    const int halfLength = 64;
+    const int oversampling = 32;
+
+    //Hann-windowed sinc weights for every phase, tap k of a phase multiplies sample i + k - halfLength + 1
+    std::vector<double> weights((size_t) (oversampling * 2 * halfLength));
+    for (int phase = 0; phase < oversampling; ++phase)
+    {
+        for (int tap = 0; tap < 2 * halfLength; ++tap)
+        {
+            double distance = (double) phase / oversampling - (tap - halfLength + 1);
+            double sinc = distance == 0.0 ? 1.0 : std::sin(MathConstants<double>::pi * distance) / (MathConstants<double>::pi * distance);
+            double window = 0.5 + 0.5 * std::cos(MathConstants<double>::pi * distance / (halfLength + 0.5));
+            weights[(size_t) (phase * 2 * halfLength + tap)] = sinc * window;
+        }
+    }
+
+    float loudest = 0.0f;
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    {
+        const float* x = buffer.getReadPointer(channel);
+
+        for (int i = halfLength; i < buffer.getNumSamples() - halfLength; ++i)
+        {
+            for (int phase = 0; phase < oversampling; ++phase)
+            {
+                const double* w = weights.data() + phase * 2 * halfLength;
+                const float* input = x + i - halfLength + 1;
+                double sum = 0.0;
+
+                for (int tap = 0; tap < 2 * halfLength; ++tap)
+                    sum += input[tap] * w[tap];
+
+                loudest = jmax(loudest, (float) std::abs(sum));
+            }
+        }
+    }
+
+    return loudest;
+}
+
+namespace
+{
+    //Writes a stereo WAV of tones under noise for the deck to play
+    bool writeTestTrack(const File& file, double seconds, double sampleRate)
+    {
+        file.deleteFile();
+        std::unique_ptr<FileOutputStream> stream(file.createOutputStream());
+        if (stream == nullptr)
+            return false;
+
+        WavAudioFormat wav;
+        std::unique_ptr<AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0));
+        if (writer == nullptr)
+            return false;
+
+        //The writer owns the stream now
+        stream.release();
+
+        const int blockSize = 4096;
+        AudioBuffer<float> block(2, blockSize);
+        Random random(99);
+        int64 total = (int64) (seconds * sampleRate);
+
+        for (int64 position = 0; position < total; position += blockSize)
+        {
+            int numSamples = (int) jmin((int64) blockSize, total - position);
+            for (int i = 0; i < numSamples; ++i)
+            {
+                double t = (double) (position + i) / sampleRate;
+                float noise = 0.05f * (random.nextFloat() * 2.0f - 1.0f);
+                block.setSample(0, i, (float) (0.4 * std::sin(MathConstants<double>::twoPi * 55.0 * t)
+                                               + 0.2 * std::sin(MathConstants<double>::twoPi * 1760.0 * t)) + noise);
+                block.setSample(1, i, (float) (0.4 * std::sin(MathConstants<double>::twoPi * 110.0 * t)
+                                               + 0.2 * std::sin(MathConstants<double>::twoPi * 3520.0 * t)) - noise);
+            }
+
+            if (! writer->writeFromAudioSampleBuffer(block, 0, numSamples))
+                return false;
+        }
+
+        return true;
+    }
+
+    //A reader that makes up a track of any length from hashed noise under a slow envelope, so building a thumbnail
+    //is timed without the cost of decoding a file
+    class SyntheticTrackReader : public AudioFormatReader
+    {
+    public:
+        SyntheticTrackReader(double seconds, double rate = 44100.0) : AudioFormatReader(nullptr, "Synthetic")
+        {
+            sampleRate = rate;
+            bitsPerSample = 32;
+            usesFloatingPointData = true;
+            numChannels = 2;
+            lengthInSamples = (int64) (seconds * sampleRate);
+        }
+
+        bool readSamples(int* const* destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                         int64 startSampleInFile, int numSamples) override
+        {
+            for (int channel = 0; channel < numDestChannels; ++channel)
+            {
+                if (destSamples[channel] == nullptr)
+                    continue;
+
+                auto* dest = reinterpret_cast<float*>(destSamples[channel]) + startOffsetInDestBuffer;
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    auto sample = (uint64) (startSampleInFile + i);
+                    uint64 hash = (sample * 2 + (uint64) channel) * 0x9e3779b97f4a7c15ull;
+                    hash ^= hash >> 29;
+                    float noise = (float) (hash & 0xffff) / 32768.0f - 1.0f;
+                    float envelope = 0.5f + 0.5f * (float) std::sin((double) sample / sampleRate * 0.7);
+                    dest[i] = noise * envelope;
+                }
+            }
+
+            return true;
+        }
+    };
+
+    //A reader that makes up a four-to-the-floor drum track over a pad, at a known tempo and with its first downbeat a
+    //known time in, so the tempo analysis can be checked against the right answer
+    class SyntheticBeatReader : public AudioFormatReader
+    {
+    public:
+        SyntheticBeatReader(double seconds, double _bpm, double _firstDownbeatSeconds)
+            : AudioFormatReader(nullptr, "Synthetic beat"),
+              bpm(_bpm),
+              firstDownbeatSeconds(_firstDownbeatSeconds)
+        {
+            sampleRate = 44100.0;
+            bitsPerSample = 32;
+            usesFloatingPointData = true;
+            numChannels = 2;
+            lengthInSamples = (int64) (seconds * sampleRate);
+        }
+
+        bool readSamples(int* const* destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                         int64 startSampleInFile, int numSamples) override
+        {
+            double beatSeconds = 60.0 / bpm;
+
+            for (int channel = 0; channel < numDestChannels; ++channel)
+            {
+                if (destSamples[channel] == nullptr)
+                    continue;
+
+                auto* dest = reinterpret_cast<float*>(destSamples[channel]) + startOffsetInDestBuffer;
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    auto sample = (uint64) (startSampleInFile + i);
+                    uint64 hash = sample * 0x9e3779b97f4a7c15ull;
+                    hash ^= hash >> 29;
+                    double noise = (double) (hash & 0xffff) / 32768.0 - 1.0;
+                    double t = (double) sample / sampleRate;
+                    double value = 0.1 * std::sin(MathConstants<double>::twoPi * 220.0 * t) + 0.02 * noise;
+
+                    double sinceFirstDownbeat = t - firstDownbeatSeconds;
+                    if (sinceFirstDownbeat >= 0.0)
+                    {
+                        //A falling kick on every beat, louder on the first of the bar, and a hi-hat between beats
+                        double beat = std::floor(sinceFirstDownbeat / beatSeconds);
+                        double sinceBeat = sinceFirstDownbeat - beat * beatSeconds;
+                        double accent = std::fmod(beat, 4.0) == 0.0 ? 1.0 : 0.6;
+                        value += accent * std::exp(-25.0 * sinceBeat)
+                                     * std::sin(MathConstants<double>::twoPi * (50.0 + 100.0 * std::exp(-30.0 * sinceBeat)) * sinceBeat);
+
+                        double sinceOffbeat = sinceBeat - 0.5 * beatSeconds;
+                        if (sinceOffbeat >= 0.0)
+                            value += 0.25 * std::exp(-80.0 * sinceOffbeat) * noise;
+                    }
+
+                    dest[i] = (float) value;
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        double bpm;
+        double firstDownbeatSeconds;
+    };
+
+    //Writes a reader out as a 16-bit stereo WAV
+    bool writeReaderToWav(AudioFormatReader& reader, const File& file)
+    {
+        file.deleteFile();
+        std::unique_ptr<FileOutputStream> stream(file.createOutputStream());
+        if (stream == nullptr)
+            return false;
+
+        WavAudioFormat wav;
+        std::unique_ptr<AudioFormatWriter> writer(wav.createWriterFor(stream.get(), reader.sampleRate, 2, 16, {}, 0));
+        if (writer == nullptr)
+            return false;
+
+        //The writer owns the stream now
+        stream.release();
+        return writer->writeFromAudioReader(reader, 0, reader.lengthInSamples);
+    }
+
+    //What a benchmark needs to load tracks the way the app does: the formats, a read-ahead thread at the priority the
+    //app runs it at and a loader, with a RAM cache of cacheBytes unless that is 0. The thread is stopped on the way
+    //out of whichever return the benchmark takes, after the decks declared later have gone
+    struct LoaderFixture
+    {
+        explicit LoaderFixture(size_t cacheBytes = 256 * 1024 * 1024)
+            : readAheadThread("Benchmark read-ahead"),
+              trackCache(cacheBytes),
+              trackLoader(formatManager, readAheadThread)
+        {
+            formatManager.registerBasicFormats();
+            readAheadThread.startThread(Thread::Priority::high);
+
+            if (cacheBytes > 0)
+                trackLoader.setTrackCache(&trackCache);
+        }
+
+        ~LoaderFixture()
+        {
+            readAheadThread.stopThread(1000);
+        }
+
+        AudioFormatManager formatManager;
+        TimeSliceThread readAheadThread;
+        TrackCache trackCache;
+        TrackLoader trackLoader;
+    };
+
+    //Passes a deck on unchanged and keeps the left channel of the block it last played, so decks that are mixed
+    //together can still be heard one at a time
+    class CapturingSource : public AudioSource
+    {
+    public:
+        explicit CapturingSource(AudioSource& _source) : source(_source) {}
+
+        void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override
+        {
+            source.prepareToPlay(samplesPerBlockExpected, sampleRate);
+            lastBlock.reserve((size_t) samplesPerBlockExpected);
+        }
+
+        void releaseResources() override { source.releaseResources(); }
+
+        void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override
+        {
+            source.getNextAudioBlock(bufferToFill);
+            auto* left = bufferToFill.buffer->getReadPointer(0, bufferToFill.startSample);
+            lastBlock.assign(left, left + bufferToFill.numSamples);
+        }
+
+        const std::vector<float>& getLastBlock() const { return lastBlock; }
+
+    private:
+        AudioSource& source;
+        std::vector<float> lastBlock;
+    };
+
+    //Finds where in a mono reference a captured window starts, when the window plays the reference at rate reference
+    //samples per captured sample: the offset within searchRange of the guess with the highest normalised
+    //cross-correlation, refined between samples with a parabola through the peak and its neighbours
+    double findInReference(const float* captured, int numSamples, const AudioBuffer<float>& reference, double rate,
+                           double guess, int searchRange)
+    {
+        const float* data = reference.getReadPointer(0);
+        const int64 length = reference.getNumSamples();
+        std::vector<double> scores((size_t) (2 * searchRange + 1), 0.0);
+
+        for (int offset = -searchRange; offset <= searchRange; ++offset)
+        {
+            double start = std::floor(guess) + offset;
+            double correlation = 0.0, energy = 0.0;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                double position = start + rate * i;
+                auto index = (int64) std::floor(position);
+                if (index < 0 || index + 1 >= length)
+                    continue;
+
+                auto fraction = (float) (position - (double) index);
+                float value = data[index] + (data[index + 1] - data[index]) * fraction;
+                correlation += captured[i] * value;
+                energy += value * value;
+            }
+
+            scores[(size_t) (offset + searchRange)] = correlation / std::sqrt(energy + 1.0e-12);
+        }
+
+        auto peak = (int) (std::max_element(scores.begin(), scores.end()) - scores.begin());
+        double refinement = 0.0;
+        if (peak > 0 && peak < (int) scores.size() - 1)
+        {
+            double before = scores[(size_t) peak - 1], at = scores[(size_t) peak], after = scores[(size_t) peak + 1];
+            double curvature = before - 2.0 * at + after;
+            if (curvature < 0.0)
+                refinement = 0.5 * (before - after) / curvature;
+        }
+
+        return std::floor(guess) + peak - searchRange + refinement;
+    }
+}
+
+//Function to time the built-in reverb and the convolution reverb on the same stereo input
+void Benchmarks::runConvolutionBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const double audioSeconds = 20.0;
+
+    std::cout << "convolution: stereo, " << sampleRate << " Hz, partitions of " << ImpulseResponse::defaultPartitionSize
+              << " samples, no added latency" << std::endl;
+
+    const int length = 65536;
+    AudioBuffer<float> input(2, length);
+    Random random(777);
+    for (int channel = 0; channel < 2; ++channel)
+        for (int i = 0; i < length; ++i)
+            input.setSample(channel, i, 0.25f * (random.nextFloat() * 2.0f - 1.0f));
+
+    //Time one processor over the input in blocks, returning the share of a core it takes
+    auto timeBlocks = [&] (int blockSize, const std::function<void(const float* const*, float* const*, int)>& process)
+    {
+        AudioBuffer<float> output(2, blockSize);
+        const int numBlocks = roundToInt(audioSeconds * sampleRate / blockSize);
+
+        auto start = Time::getHighResolutionTicks();
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            int position = (block * blockSize) % (length - blockSize);
+            const float* in[2] = { input.getReadPointer(0, position), input.getReadPointer(1, position) };
+            process(in, output.getArrayOfWritePointers(), blockSize);
+        }
+        return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) / audioSeconds * 100.0;
+    };
+
+    for (int blockSize : { 64, 256 })
+    {
+        //The deck's built-in reverb works in place, so each block is copied first as the deck does
+        Reverb reverb;
+        Reverb::Parameters params;
+        params.wetLevel = 1.0f;
+        params.dryLevel = 0.0f;
+        reverb.setParameters(params);
+        reverb.setSampleRate(sampleRate);
+
+        double builtIn = timeBlocks(blockSize, [&] (const float* const* in, float* const* out, int numSamples)
+        {
+            for (int channel = 0; channel < 2; ++channel)
+                FloatVectorOperations::copy(out[channel], in[channel], numSamples);
+            reverb.processStereo(out[0], out[1], numSamples);
+        });
+
+        std::cout << "  " << blockSize << "-sample blocks, built-in reverb: " << String(builtIn, 3) << "% of a core" << std::endl;
+        record("convolution.builtIn." + String(blockSize) + ".corePercent", builtIn, "%");
+
+        for (double irSeconds : { 0.5, 2.0, 5.0 })
+        {
+            //A stereo response of decaying noise, like a hall
+            int irLength = (int) (irSeconds * sampleRate);
+            AudioBuffer<float> irAudio(2, irLength);
+            for (int channel = 0; channel < 2; ++channel)
+                for (int i = 0; i < irLength; ++i)
+                    irAudio.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * std::exp(-6.9f * (float) i / (float) irLength));
+
+            ConvolutionReverb convolution;
+            convolution.setImpulseResponse(ImpulseResponseLibrary::createFromAudio(irAudio, sampleRate, sampleRate, "hall"));
+            convolution.update();
+
+            double convolved = timeBlocks(blockSize, [&] (const float* const* in, float* const* out, int numSamples)
+            {
+                convolution.process(in, out, 2, numSamples);
+            });
+
+            std::cout << "  " << blockSize << "-sample blocks, " << String(irSeconds, 1) << " s response: "
+                      << String(convolved, 3) << "% of a core (" << String(convolved / builtIn, 2) << "x built-in)" << std::endl;
+            record("convolution." + String(irSeconds, 1) + "s." + String(blockSize) + ".corePercent", convolved, "%");
+        }
+    }
+}
+
+//Function to time the FX rack with different effects switched on, including none
+void Benchmarks::runFxRackBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const double audioSeconds = 20.0;
+
+    std::cout << "fx: DeckFxRack::process, stereo " << sampleRate << " Hz, " << blockSize << "-sample blocks" << std::endl;
+
+    AudioBuffer<float> noise(2, blockSize), buffer(2, blockSize);
+    Random random(2468);
+    for (int channel = 0; channel < 2; ++channel)
+        for (int i = 0; i < blockSize; ++i)
+            noise.setSample(channel, i, 0.25f * (random.nextFloat() * 2.0f - 1.0f));
+    const int numBlocks = roundToInt(audioSeconds * sampleRate / blockSize);
+
+    //-1 is every effect off, numSlots is every effect on
+    for (int configuration = -1; configuration <= DeckFxRack::numSlots; ++configuration)
+    {
+        DeckFxRack rack;
+        for (int type = 0; type < DeckFxRack::numSlots; ++type)
+            rack.setEnabled((DeckFxRack::EffectType) type, configuration == type || configuration == DeckFxRack::numSlots);
+        rack.prepareToPlay(blockSize, sampleRate);
+
+        //Takes the graph
+        buffer.makeCopyOf(noise, true);
+        rack.process(buffer, 0, blockSize);
+
+        //Fresh input every block, the same for every configuration, so feedback can't build up
+        auto start = Time::getHighResolutionTicks();
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            buffer.makeCopyOf(noise, true);
+            rack.process(buffer, 0, blockSize);
+        }
+        double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        String name = configuration < 0 ? String("off")
+                    : configuration == DeckFxRack::numSlots ? String("all")
+                    : String(DeckFxRack::getEffectName((DeckFxRack::EffectType) configuration)).toLowerCase();
+        double perBlock = seconds / numBlocks * 1.0e6;
+        std::cout << "  " << name.paddedRight(' ', 11) << String(perBlock, 3) << " us per block, "
+                  << String(seconds / audioSeconds * 100.0, 3) << "% of a core" << std::endl;
+        record("fx." + name + ".usPerBlock", perBlock, "us");
+    }
+}
+
+//Function to time a whole deck with each combination of effects
+void Benchmarks::runPlayerBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const double audioSeconds = 20.0;
+
+    std::cout << "player: DJAudioplayer::getNextAudioBlock, stereo " << sampleRate << " Hz, " << blockSize
+              << "-sample blocks, track held in the cache" << std::endl;
+
+    TemporaryFile track(".wav");
+    if (! writeTestTrack(track.getFile(), 30.0, sampleRate))
+    {
+        std::cout << "  can't write a test track to " << track.getFile().getFullPathName() << std::endl;
+        return;
+    }
+
+    LoaderFixture fixture;
+
+    //Every on/off combination of the five stages, each bit of the mask turns one on
+    enum Stage { bass = 1, treble = 2, reverb = 4, speed = 8, keyLock = 16 };
+    const char* stageNames[] = { "bass", "treble", "reverb", "speed", "keyLock" };
+    const int numStages = 5;
+
+    AudioBuffer<float> buffer(2, blockSize);
+    AudioSourceChannelInfo info(&buffer, 0, blockSize);
+    const int numBlocks = roundToInt(audioSeconds * sampleRate / blockSize);
+
+    for (int mask = 0; mask < (1 << numStages); ++mask)
+    {
+        //Named after the stages that are on, "dry" for none
+        StringArray stagesOn;
+        for (int stage = 0; stage < numStages; ++stage)
+            if ((mask & (1 << stage)) != 0)
+                stagesOn.add(stageNames[stage]);
+
+        String name = stagesOn.isEmpty() ? String("dry") : stagesOn.joinIntoString("+");
+
+        DJAudioplayer player(fixture.trackLoader);
+        player.setUseTrackCache(true);
+        player.prepareToPlay(blockSize, sampleRate);
+        player.loadURL(URL(track.getFile()));
+
+        //The loaded track goes live on the first block
+        player.getNextAudioBlock(info);
+
+        //Loop the whole track so a fast deck never runs off the end
+        player.setLooping(true);
+        player.setBass((mask & bass) != 0 ? -0.5 : 0.0);
+        player.setTrebleGain((mask & treble) != 0 ? 0.5 : 0.0);
+        player.setWetDry((mask & reverb) != 0 ? 0.3 : 0.0);
+        player.setSpeed((mask & speed) != 0 ? 1.06 : 1.0);
+        player.setKeyLock((mask & keyLock) != 0);
+        player.start();
+
+        for (int block = 0; block < 200; ++block)
+            player.getNextAudioBlock(info);
+
+        auto start = Time::getHighResolutionTicks();
+        for (int block = 0; block < numBlocks; ++block)
+            player.getNextAudioBlock(info);
+        double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        double perBlock = seconds / numBlocks * 1.0e6;
+        std::cout << "  " << name.paddedRight(' ', 30) << String(perBlock, 2) << " us per block, "
+                  << String(seconds / audioSeconds * 100.0, 3) << "% of a core" << std::endl;
+        record("player." + name + ".usPerBlock", perBlock, "us");
+
+        player.stop();
+        player.releaseResources();
+    }
+}
+
+//Function to time the mixer with the crossfader still and with a scratch-style stream of moves
+void Benchmarks::runMixerBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const double audioSeconds = 20.0;
+    const int movesPerBlock = 8;
+
+    std::cout << "mixer: DeckMixer::getNextAudioBlock, stereo " << sampleRate << " Hz, " << blockSize
+              << "-sample blocks, decks are noise from memory" << std::endl;
+
+    const int length = 65536;
+    AudioBuffer<float> noise(2, length);
+    Random random(4321);
+    for (int channel = 0; channel < 2; ++channel)
+        for (int i = 0; i < length; ++i)
+            noise.setSample(channel, i, 0.25f * (random.nextFloat() * 2.0f - 1.0f));
+
+    AudioBuffer<float> buffer(2, blockSize);
+    AudioSourceChannelInfo info(&buffer, 0, blockSize);
+    const int numBlocks = roundToInt(audioSeconds * sampleRate / blockSize);
+
+    for (int numDecks : { 2, 4, 8 })
+    {
+        for (bool scratching : { false, true })
+        {
+            OwnedArray<MemoryAudioSource> decks;
+            DeckMixer mixer(numDecks);
+            for (int deck = 0; deck < numDecks; ++deck)
+            {
+                decks.add(new MemoryAudioSource(noise, false, true));
+                mixer.setSource(deck, decks.getLast());
+                mixer.setCrossfaderAssign(deck, deck % 2 == 0 ? DeckMixer::CrossfaderAssign::a : DeckMixer::CrossfaderAssign::b);
+            }
+
+            mixer.getCrossfaderEngine().setCurve(scratching ? CrossfaderEngine::Curve::scratch : CrossfaderEngine::Curve::constantPower);
+            mixer.prepareToPlay(blockSize, sampleRate);
+            mixer.setCrossfader(0.5f);
+
+            double blockMs = blockSize / sampleRate * 1000.0;
+            auto start = Time::getHighResolutionTicks();
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                //A full cut and back every block, spread across it as a controller would send them
+                if (scratching)
+                {
+                    double now = Time::getMillisecondCounterHiRes();
+                    for (int move = 0; move < movesPerBlock; ++move)
+                        mixer.moveCrossfader(move % 2 == 0 ? 0.0f : 1.0f, now + move * blockMs / movesPerBlock);
+                }
+
+                mixer.getNextAudioBlock(info);
+            }
+            double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+            double perBlock = seconds / numBlocks * 1.0e6;
+            String name = String(numDecks) + "decks." + (scratching ? "scratch" : "still");
+            std::cout << "  " << numDecks << " decks, crossfader " << (scratching ? "scratched: " : "still:     ")
+                      << String(perBlock, 2) << " us per block" << std::endl;
+            record("mixer." + name + ".usPerBlock", perBlock, "us");
+
+            mixer.releaseResources();
+        }
+    }
+}
+
+//Function to time building waveform thumbnails for long tracks and drawing them at the deck's size
+void Benchmarks::runThumbnailBenchmark()
+{
+    std::cout << "thumbnail: AudioThumbnail with 1000 samples per point, synthetic 44.1 kHz stereo source" << std::endl;
+
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    AudioThumbnailCache cache(4);
+    Image image(Image::RGB, 480, 120, true);
+    const int numDraws = 100;
+
+    for (int minutes : { 3, 10, 60 })
+    {
+        AudioThumbnail thumbnail(1000, formatManager, cache);
+        auto start = Time::getHighResolutionTicks();
+        thumbnail.setReader(new SyntheticTrackReader(minutes * 60.0), Random::getSystemRandom().nextInt64());
+
+        //The thumbnail is built on the cache's thread
+        auto timeout = Time::getMillisecondCounter() + 120000;
+        while (! thumbnail.isFullyLoaded() && Time::getMillisecondCounter() < timeout)
+            Thread::sleep(1);
+        double buildSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        if (! thumbnail.isFullyLoaded())
+        {
+            std::cout << "  " << minutes << " minutes: not built after two minutes" << std::endl;
+            continue;
+        }
+
+        Graphics g(image);
+        start = Time::getHighResolutionTicks();
+        for (int draw = 0; draw < numDraws; ++draw)
+        {
+            g.fillAll(Colour(31, 31, 31));
+            g.setColour(Colours::orange);
+            thumbnail.drawChannel(g, image.getBounds(), 0.0, thumbnail.getTotalLength(), 0, 1.0f);
+        }
+        double drawSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) / numDraws;
+
+        std::cout << "  " << String(minutes).paddedLeft(' ', 2) << " minutes: built in " << String(buildSeconds * 1000.0, 1)
+                  << " ms, drawn at 480x120 in " << String(drawSeconds * 1.0e6, 1) << " us" << std::endl;
+        record("thumbnail." + String(minutes) + "min.buildMs", buildSeconds * 1000.0, "ms");
+        record("thumbnail." + String(minutes) + "min.drawUs", drawSeconds * 1.0e6, "us");
+    }
+}
+
+//Function to time the library with a growing number of tracks
+void Benchmarks::runLibraryBenchmark()
+{
+    std::cout << "library: TrackLibrary import, search, save and load; track lengths aren't read"
+             #if JUCE_DEBUG
+              << " (Debug build, TrackPad logs every track)"
+             #endif
+              << std::endl;
+
+    auto musicFolder = File::getSpecialLocation(File::userMusicDirectory);
+
+    for (int numTracks : { 100, 10000, 100000 })
+    {
+        Array<File> files;
+        files.ensureStorageAllocated(numTracks);
+        for (int i = 0; i < numTracks; ++i)
+            files.add(musicFolder.getChildFile("Artist " + String(i % 500) + "/Track " + String(i) + ".mp3"));
+
+        TrackLibrary library;
+
+        //Import the way the playlist does: skip duplicates, then add
+        auto start = Time::getHighResolutionTicks();
+        for (auto& file : files)
+        {
+            TrackPad newTrack(file);
+            if (! library.contains(newTrack.title))
+                library.add(newTrack);
+        }
+        double importSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        //A search that matches only the last track and one that matches nothing
+        const int numSearches = 20;
+        String lastTitle = files.getLast().getFileNameWithoutExtension();
+        start = Time::getHighResolutionTicks();
+        int found = 0;
+        for (int search = 0; search < numSearches; ++search)
+            found += (library.find(search % 2 == 0 ? lastTitle : String("no such track")) >= 0) ? 1 : 0;
+        double searchSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) / numSearches;
+
+        TemporaryFile csv(".csv");
+        start = Time::getHighResolutionTicks();
+        library.save(csv.getFile());
+        double saveSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        TrackLibrary reloaded;
+        start = Time::getHighResolutionTicks();
+        reloaded.load(csv.getFile());
+        double loadSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+        std::cout << "  " << String(numTracks).paddedLeft(' ', 6) << " tracks: import " << String(importSeconds * 1000.0, 2)
+                  << " ms, search " << String(searchSeconds * 1000.0, 3) << " ms, save " << String(saveSeconds * 1000.0, 2)
+                  << " ms, load " << String(loadSeconds * 1000.0, 2) << " ms"
+                  << (reloaded.size() == library.size() && found == numSearches / 2 ? "" : "  (round trip FAILED)")
+                  << std::endl;
+
+        String prefix = "library." + String(numTracks) + ".";
+        record(prefix + "importMs", importSeconds * 1000.0, "ms");
+        record(prefix + "searchMs", searchSeconds * 1000.0, "ms");
+        record(prefix + "saveMs", saveSeconds * 1000.0, "ms");
+        record(prefix + "loadMs", loadSeconds * 1000.0, "ms");
+    }
+
+    //Tempo, downbeat and cues have to load back exactly, a cue that moves drifts off the beat it was set on
+    TrackPad cueTrack(musicFolder.getChildFile("Round trip.mp3"));
+    cueTrack.beatGrid.bpm = 127.98765432;
+    cueTrack.beatGrid.firstDownbeatSeconds = 0.123456789;
+    cueTrack.hotCues.set(0, 245.6789);
+    cueTrack.hotCues.set(1, 1234.5678901234);
+    cueTrack.hotCues.set(2, 3600.0 - 1.0 / 44100.0);
+
+    TrackLibrary cueLibrary;
+    cueLibrary.add(cueTrack);
+    TemporaryFile cueCsv(".csv");
+    cueLibrary.save(cueCsv.getFile());
+
+    TrackLibrary cueReloaded;
+    cueReloaded.load(cueCsv.getFile());
+
+    bool exact = cueReloaded.size() == 1;
+    double worstErrorMs = exact ? 0.0 : 1000.0;
+
+    if (cueReloaded.size() == 1)
+    {
+        auto& loaded = cueReloaded[0];
+        exact = loaded.beatGrid.bpm == cueTrack.beatGrid.bpm;
+        worstErrorMs = std::abs(loaded.beatGrid.firstDownbeatSeconds - cueTrack.beatGrid.firstDownbeatSeconds) * 1000.0;
+
+        for (int index = 0; index < HotCues::numCues; ++index)
+            worstErrorMs = jmax(worstErrorMs, std::abs(loaded.hotCues.get(index) - cueTrack.hotCues.get(index)) * 1000.0);
+
+        exact = exact && worstErrorMs == 0.0;
+    }
+
+    std::cout << "  round trip of tempo, downbeat and cues: "
+              << (exact ? String("exact") : "worst error " + String(worstErrorMs, 4) + " ms  (round trip FAILED)")
+              << std::endl;
+
+    record("library.roundTripErrorMs", worstErrorMs, "ms");
+}
+
+//Function to check the analysed tempo and downbeat of drum tracks against the tempo they were made at, then time an
+//import's worth of files through the worker pool
+void Benchmarks::runAnalysisBenchmark()
+{
+    std::cout << "analysis: TrackAnalyzer on synthetic drum tracks of known tempo" << std::endl;
+
+    const double trackSeconds = TrackAnalyzer::maxAnalysisSeconds;
+    double worstBpmError = 0.0, worstDownbeatErrorMs = 0.0, totalSeconds = 0.0;
+    int numTempos = 0;
+
+    for (double bpm : { 86.0, 100.5, 122.0, 128.0, 140.0, 174.0 })
+    {
+        double firstDownbeat = 0.1 + bpm / 1000.0;
+        SyntheticBeatReader reader(trackSeconds, bpm, firstDownbeat);
+
+        auto start = Time::getHighResolutionTicks();
+        auto grid = TrackAnalyzer::analyseReader(reader);
+        double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+        totalSeconds += seconds;
+        ++numTempos;
+
+        //Half or double the tempo is a matter of taste rather than a mistake, but the downbeat only means
+        //something at the tempo the track was made at
+        double octave = grid.hasTempo() ? std::exp2(std::round(std::log2(bpm / grid.bpm))) : 1.0;
+        double bpmError = grid.hasTempo() ? std::abs(grid.bpm * octave - bpm) : bpm;
+        worstBpmError = jmax(worstBpmError, bpmError);
+
+        String downbeatText = "n/a";
+        if (grid.hasTempo() && octave == 1.0)
+        {
+            double barSeconds = 240.0 / bpm;
+            double error = grid.firstDownbeatSeconds - firstDownbeat;
+            error -= barSeconds * std::round(error / barSeconds);
+            worstDownbeatErrorMs = jmax(worstDownbeatErrorMs, std::abs(error) * 1000.0);
+            downbeatText = String(error * 1000.0, 1) + " ms";
+        }
+
+        std::cout << "  " << String(bpm, 1).paddedLeft(' ', 5) << " BPM: found " << String(grid.bpm, 2)
+                  << (octave == 1.0 ? "" : octave > 1.0 ? " (half tempo)" : " (double tempo)")
+                  << ", downbeat error " << downbeatText << ", " << String(seconds * 1000.0, 1) << " ms" << std::endl;
+    }
+
+    double msPerTrack = totalSeconds * 1000.0 / numTempos;
+    std::cout << "  " << String(msPerTrack, 1) << " ms per " << (int) trackSeconds << " s track on one core, decoding excluded"
+              << std::endl;
+
+    record("analysis.msPerTrack", msPerTrack, "ms");
+    record("analysis.worstBpmError", worstBpmError, "bpm");
+    record("analysis.worstDownbeatErrorMs", worstDownbeatErrorMs, "ms");
+
+    //Files through the pool, the way an import runs, decoding included
+    auto folder = File::getSpecialLocation(File::tempDirectory).getNonexistentChildFile("OtoDecksAnalysis", "", false);
+    folder.createDirectory();
+
+    const double fileSeconds = 60.0;
+    int numWorkers = TrackAnalyzer::getDefaultNumWorkers();
+    int numFiles = numWorkers * 4;
+    Array<File> files;
+
+    for (int i = 0; i < numFiles; ++i)
+    {
+        SyntheticBeatReader reader(fileSeconds, 120.0 + i, 0.2);
+        auto file = folder.getChildFile("Track " + String(i) + ".wav");
+        if (writeReaderToWav(reader, file))
+            files.add(file);
+    }
+
+    TrackAnalyzer analyzer(numWorkers);
+    auto start = Time::getHighResolutionTicks();
+    for (auto& file : files)
+        analyzer.analyse(file);
+
+    while (analyzer.getNumPending() > 0)
+        Thread::sleep(5);
+
+    double poolSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+    auto results = analyzer.takeResults();
+    int numRight = 0;
+    for (auto& result : results)
+        numRight += std::abs(result.beatGrid.bpm - (120.0 + result.file.getFileNameWithoutExtension().getTrailingIntValue())) < 0.1 ? 1 : 0;
+
+    folder.deleteRecursively();
+
+    //Tracks are analysed for up to three minutes, so a full-length track takes that much longer than these files
+    double tracksPerSecond = poolSeconds > 0.0 ? (double) results.size() / poolSeconds : 0.0;
+    double thousandTrackSeconds = tracksPerSecond > 0.0 ? 1000.0 * (trackSeconds / fileSeconds) / tracksPerSecond : 0.0;
+
+    std::cout << "  " << results.size() << " WAV files of " << (int) fileSeconds << " s on " << numWorkers << " workers: "
+              << String(tracksPerSecond, 1) << " tracks/s, " << numRight << " tempos right; 1,000 full tracks in about "
+              << String(thousandTrackSeconds / 60.0, 1) << " min (WAV decoding, compressed files take longer)" << std::endl;
+
+    record("analysis.pool.tracksPerSecond", tracksPerSecond, "tracks/s", true);
+    record("analysis.pool.thousandTracksSeconds", thousandTrackSeconds, "s");
+}
+
+//Function to play a track with a synced deck following another at a different tempo through the mixer, and measure
+//from what both decks actually put out how far apart their beats are once the follower has slid into phase
+void Benchmarks::runSyncBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const double trackSeconds = 240.0;
+    const double leaderBpm = 128.0, followerBpm = 124.0;
+    //Where each track's first downbeat is, in seconds
+    const double leaderDownbeat = 0.25, followerDownbeat = 0.6;
+
+    std::cout << "sync: a " << followerBpm << " BPM deck synced to a " << leaderBpm << " BPM deck for "
+              << (int) trackSeconds << " s, stereo " << sampleRate << " Hz, " << blockSize << "-sample blocks" << std::endl;
+
+    TemporaryFile leaderTrack(".wav"), followerTrack(".wav");
+    SyntheticBeatReader leaderReader(trackSeconds + 10.0, leaderBpm, leaderDownbeat);
+    SyntheticBeatReader followerReader(trackSeconds + 10.0, followerBpm, followerDownbeat);
+    if (! writeReaderToWav(leaderReader, leaderTrack.getFile()) || ! writeReaderToWav(followerReader, followerTrack.getFile()))
+    {
+        std::cout << "  can't write the test tracks" << std::endl;
+        return;
+    }
+
+    LoaderFixture fixture(512 * 1024 * 1024);
+
+    //The left channel of each track as written, to find in what each deck puts out
+    AudioBuffer<float> references[2];
+    for (int index = 0; index < 2; ++index)
+    {
+        std::unique_ptr<AudioFormatReader> reader(fixture.formatManager.createReaderFor(index == 0 ? leaderTrack.getFile() : followerTrack.getFile()));
+        if (reader == nullptr)
+        {
+            std::cout << "  can't read the test tracks back" << std::endl;
+            return;
+        }
+
+        references[index].setSize(1, (int) reader->lengthInSamples);
+        reader->read(&references[index], 0, (int) reader->lengthInSamples, 0, true, false);
+    }
+
+    //The phase is measured four times a second from the decks' output: a window of each is found in its track by
+    //cross-correlation, searching around the position the deck reports, and the two track positions are put on
+    //their grids
+    const int window = 1024;
+    const int searchRange = 1024;
+    const int blocksBetweenMeasurements = roundToInt(0.25 * sampleRate / blockSize);
+    const double trackRate = 44100.0;
+
+    AudioBuffer<float> buffer(2, blockSize);
+    AudioSourceChannelInfo info(&buffer, 0, blockSize);
+    const int numBlocks = roundToInt(trackSeconds * sampleRate / blockSize);
+    std::vector<float> capturedLeader((size_t) window), capturedFollower((size_t) window);
+
+    for (bool keyLock : { false, true })
+    {
+        String name = keyLock ? "keyLock" : "resampler";
+        DJAudioplayer leader(fixture.trackLoader), follower(fixture.trackLoader);
+        CapturingSource leaderOutput(leader), followerOutput(follower);
+        MasterClock clock;
+        DeckMixer mixer(2);
+        mixer.setSource(0, &leaderOutput);
+        mixer.setSource(1, &followerOutput);
+        mixer.setMasterClock(&clock);
+        leader.setMasterClock(&clock, 0);
+        follower.setMasterClock(&clock, 1);
+        mixer.prepareToPlay(blockSize, sampleRate);
+
+        //The grids are the ones the tracks were made with, so any error left is the sync's own
+        leader.loadURL(URL(leaderTrack.getFile()), { leaderBpm, leaderDownbeat });
+        follower.loadURL(URL(followerTrack.getFile()), { followerBpm, followerDownbeat });
+        follower.setKeyLock(keyLock);
+        follower.setSync(true);
+        leader.start();
+        follower.start();
+
+        //Track samples per output sample: the synced follower plays at the leader's tempo, but with key lock its
+        //output is stretched from frames played at the track's own rate
+        double leaderRate = trackRate / sampleRate;
+        double followerRate = keyLock ? trackRate / sampleRate : leaderBpm / followerBpm * trackRate / sampleRate;
+
+        //Worst measured error after the deck has come into phase, and when it last was more than a millisecond out;
+        //the controller's own estimate alongside, to see how far it can be trusted
+        double worstErrorMs = 0.0, lockSeconds = 0.0, worstEstimateMs = 0.0;
+        const int settleBlocks = roundToInt(15.0 * sampleRate / blockSize);
+        double leaderGuess = 0.0, followerGuess = 0.0;
+        int captured = -1;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            //What the decks say is heard as the next block starts, only where to search from
+            if (block % blocksBetweenMeasurements == 0 && captured < 0)
+            {
+                leaderGuess = leader.getPositionRelative() * references[0].getNumSamples();
+                followerGuess = follower.getPositionRelative() * references[1].getNumSamples();
+                captured = 0;
+            }
+
+            mixer.getNextAudioBlock(info);
+
+            if (block >= settleBlocks)
+                worstEstimateMs = jmax(worstEstimateMs, std::abs(follower.getSyncErrorMs()));
+
+            if (captured < 0)
+                continue;
+
+            int numToCopy = jmin(blockSize, window - captured);
+            std::copy(leaderOutput.getLastBlock().begin(), leaderOutput.getLastBlock().begin() + numToCopy, capturedLeader.begin() + captured);
+            std::copy(followerOutput.getLastBlock().begin(), followerOutput.getLastBlock().begin() + numToCopy, capturedFollower.begin() + captured);
+            captured += numToCopy;
+
+            if (captured < window)
+                continue;
+
+            captured = -1;
+            double leaderPosition = findInReference(capturedLeader.data(), window, references[0], leaderRate, leaderGuess, searchRange);
+            double followerPosition = findInReference(capturedFollower.data(), window, references[1], followerRate, followerGuess, searchRange);
+
+            //Beats since each track's first downbeat at the same output sample, any whole number apart is in phase
+            double leaderBeat = (leaderPosition / trackRate - leaderDownbeat) * leaderBpm / 60.0;
+            double followerBeat = (followerPosition / trackRate - followerDownbeat) * followerBpm / 60.0;
+            double phase = leaderBeat - followerBeat;
+            double errorMs = std::abs(phase - std::round(phase)) * 60000.0 / leaderBpm;
+
+            if (errorMs > 1.0)
+                lockSeconds = (block + 1) * blockSize / sampleRate;
+            if (block >= settleBlocks)
+                worstErrorMs = jmax(worstErrorMs, errorMs);
+        }
+
+        std::cout << "  " << name.paddedRight(' ', 10) << "in phase after " << String(lockSeconds, 1)
+                  << " s, worst measured error after that " << String(worstErrorMs, 3) << " ms (controller's estimate "
+                  << String(worstEstimateMs, 3) << " ms), clock at " << String(clock.getTempo(), 2) << " BPM after "
+                  << clock.getSamplePosition() << " samples" << std::endl;
+        record("sync." + name + ".worstErrorMs", worstErrorMs, "ms");
+        record("sync." + name + ".lockSeconds", lockSeconds, "s");
+
+        leader.stop();
+        follower.stop();
+        mixer.releaseResources();
+    }
+}
+
+//Function to jump around a track streamed from disk, once with hot cues and once by seeking to the same places, and
+//count the blocks each jump leaves silent while the read-ahead catches up. Blocks after a jump are paced like a
+//device's, so the read-ahead thread gets the time it would have
+void Benchmarks::runHotCueBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const int numJumps = 40;
+    const int blocksPerJump = 20;
+
+    std::cout << "hotcue: " << numJumps << " jumps between " << HotCues::numCues << " cues on a streamed track, stereo "
+              << sampleRate << " Hz, " << blockSize << "-sample blocks" << std::endl;
+
+    TemporaryFile track(".wav");
+    if (! writeTestTrack(track.getFile(), 120.0, sampleRate))
+    {
+        std::cout << "  can't write a test track to " << track.getFile().getFullPathName() << std::endl;
+        return;
+    }
+
+    LoaderFixture fixture(0);
+
+    HotCues cues;
+    for (int index = 0; index < HotCues::numCues; ++index)
+        cues.set(index, 7.0 + 13.0 * index);
+
+    AudioBuffer<float> buffer(2, blockSize);
+    AudioSourceChannelInfo info(&buffer, 0, blockSize);
+    const int blockMs = roundToInt(blockSize * 1000.0 / sampleRate);
+
+    for (bool useCues : { true, false })
+    {
+        String name = useCues ? "cue" : "seek";
+        DJAudioplayer player(fixture.trackLoader);
+        player.setUseTrackCache(false);
+        player.prepareToPlay(blockSize, sampleRate);
+        player.loadURL(URL(track.getFile()), {}, cues);
+        player.getNextAudioBlock(info);
+        player.start();
+
+        for (int block = 0; block < blocksPerJump; ++block)
+        {
+            player.getNextAudioBlock(info);
+            Thread::sleep(blockMs);
+        }
+
+        int silentBlocks = 0, cuesFromDisk = CallbackProfiler::getNumHotCuesFromDisk();
+        double worstLatencyMs = 0.0, worstJumpBlockUs = 0.0;
+
+        for (int jump = 0; jump < numJumps; ++jump)
+        {
+            //Cues far apart in turn, so no jump lands in audio the read-ahead already holds
+            int index = (jump * 3) % HotCues::numCues;
+            if (useCues)
+                player.triggerHotCue(index);
+            else
+                player.setPosition(cues.get(index));
+
+            for (int block = 0; block < blocksPerJump; ++block)
+            {
+                int underruns = player.getNumBufferUnderruns();
+                auto start = Time::getHighResolutionTicks();
+                player.getNextAudioBlock(info);
+
+                if (block == 0)
+                    worstJumpBlockUs = jmax(worstJumpBlockUs, Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1.0e6);
+                if (player.getNumBufferUnderruns() > underruns)
+                    ++silentBlocks;
+
+                Thread::sleep(blockMs);
+            }
+
+            if (useCues)
+                worstLatencyMs = jmax(worstLatencyMs, CallbackProfiler::getLastHotCueLatencyMs());
+        }
+
+        std::cout << "  " << name.paddedRight(' ', 6) << silentBlocks << " silent blocks in " << numJumps
+                  << " jumps, worst jump block " << String(worstJumpBlockUs, 1) << " us";
+        record("hotcue." + name + ".silentBlocks", silentBlocks, "blocks");
+        record("hotcue." + name + ".jumpBlockUs", worstJumpBlockUs, "us");
+
+        if (useCues)
+        {
+            cuesFromDisk = CallbackProfiler::getNumHotCuesFromDisk() - cuesFromDisk;
+            std::cout << ", worst latency " << String(worstLatencyMs, 2) << " ms, " << cuesFromDisk << " from disk";
+            record("hotcue.cue.worstLatencyMs", worstLatencyMs, "ms");
+            record("hotcue.cue.fromDisk", cuesFromDisk, "cues");
+        }
+
+        std::cout << std::endl;
+        player.stop();
+        player.releaseResources();
+    }
+}
+
+//Function to scratch a track the way a controller would: the platter speed swings forwards and backwards and a move is
+//sent about every millisecond between blocks, stamped with the time it was made. Blocks are paced like a device's,
+//so the latency measured is what a jog would see, and compared with one block period, the most it should be
+void Benchmarks::runScratchBenchmark()
+{
+    const double sampleRate = 48000.0;
+    const int blockSize = 256;
+    const double scratchSeconds = 4.0;
+    const double swingSeconds = 0.5;
+    const double swingSpeed = 2.0;
+
+    std::cout << "scratch: " << scratchSeconds << " s of +/-" << swingSpeed << "x swings every " << swingSeconds
+              << " s, stereo " << sampleRate << " Hz, " << blockSize << "-sample blocks" << std::endl;
+
+    TemporaryFile track(".wav");
+    if (! writeTestTrack(track.getFile(), 60.0, sampleRate))
+    {
+        std::cout << "  can't write a test track to " << track.getFile().getFullPathName() << std::endl;
+        return;
+    }
+
+    LoaderFixture fixture;
+
+    AudioBuffer<float> buffer(2, blockSize);
+    AudioSourceChannelInfo info(&buffer, 0, blockSize);
+    const double blockMs = blockSize * 1000.0 / sampleRate;
+    const int numScratchBlocks = roundToInt(scratchSeconds * 1000.0 / blockMs);
+
+    for (bool cached : { true, false })
+    {
+        String name = cached ? "cached" : "streamed";
+        DJAudioplayer player(fixture.trackLoader);
+        player.setUseTrackCache(cached);
+        player.prepareToPlay(blockSize, sampleRate);
+        player.loadURL(URL(track.getFile()));
+        player.getNextAudioBlock(info);
+        player.start();
+
+        //Play in for a few seconds, so there is history to scratch back over
+        double normalSeconds = 0.0;
+        int numNormalBlocks = 0;
+        for (int block = 0; block < roundToInt(5000.0 / blockMs); ++block)
+        {
+            auto start = Time::getHighResolutionTicks();
+            player.getNextAudioBlock(info);
+            normalSeconds += Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+            ++numNormalBlocks;
+            Thread::sleep(roundToInt(blockMs));
+        }
+
+        int underruns = player.getNumBufferUnderruns();
+        int silentBlocks = 0, numMoves = 0;
+        double scratchedSeconds = 0.0;
+        auto scratchStartMs = Time::getMillisecondCounterHiRes();
+        player.touchPlatter(scratchStartMs);
+
+        for (int block = 0; block < numScratchBlocks; ++block)
+        {
+            //The hand moves between blocks, about once a millisecond
+            auto blockDueMs = scratchStartMs + (block + 1) * blockMs;
+            while (Time::getMillisecondCounterHiRes() < blockDueMs)
+            {
+                auto now = Time::getMillisecondCounterHiRes();
+                double phase = (now - scratchStartMs) / (swingSeconds * 1000.0);
+                player.movePlatter(swingSpeed * std::sin(MathConstants<double>::twoPi * phase), now);
+                ++numMoves;
+                Thread::sleep(1);
+            }
+
+            auto start = Time::getHighResolutionTicks();
+            player.getNextAudioBlock(info);
+            scratchedSeconds += Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+
+            if (buffer.getMagnitude(0, blockSize) == 0.0f)
+                ++silentBlocks;
+        }
+
+        player.releasePlatter(Time::getMillisecondCounterHiRes());
+        for (int block = 0; block < roundToInt(500.0 / blockMs); ++block)
+        {
+            player.getNextAudioBlock(info);
+            Thread::sleep(roundToInt(blockMs));
+        }
+
+        underruns = player.getNumBufferUnderruns() - underruns;
+        double normalUs = normalSeconds * 1.0e6 / numNormalBlocks;
+        double scratchUs = scratchedSeconds * 1.0e6 / numScratchBlocks;
+        double worstLatencyMs = player.getWorstScratchLatencyMs();
+
+        std::cout << "  " << name.paddedRight(' ', 9) << numMoves << " moves, worst latency " << String(worstLatencyMs, 2)
+                  << " ms (block " << String(blockMs, 2) << " ms), " << String(scratchUs, 1) << " us per scratched block ("
+                  << String(normalUs, 1) << " playing), " << silentBlocks << " silent blocks, " << underruns << " underruns"
+                  << (player.isScratching() ? ", still scratching after the release!" : "") << std::endl;
+
+        record("scratch." + name + ".worstLatencyMs", worstLatencyMs, "ms");
+        record("scratch." + name + ".usPerBlock", scratchUs, "us");
+        record("scratch." + name + ".silentBlocks", silentBlocks, "blocks");
+        record("scratch." + name + ".underruns", underruns, "blocks");
+
+        player.stop();
+        player.releaseResources();
+    }
+}
+
+//Function to play a FLAC track streamed from disk backwards, brake it and spin it back, counting the blocks that
+//found nothing decoded. Reversing by seeking back every block, all a forward-only reader allows, is the baseline.
+//Blocks are paced like a device's, so the read-ahead thread only gets the time it would have
+void Benchmarks::runReverseBenchmark()
+{
+    const double sampleRate = 44100.0;
+    const int blockSize = 256;
+    const double modeSeconds = 3.0;
+
+    std::cout << "reverse: " << modeSeconds << " s of each mode on a streamed FLAC track, stereo " << sampleRate
+              << " Hz, " << blockSize << "-sample blocks" << std::endl;
+
+    TemporaryFile wavTrack(".wav");
+    TemporaryFile flacTrack(".flac");
+    LoaderFixture fixture(0);
+
+    bool written = false;
+    if (writeTestTrack(wavTrack.getFile(), 60.0, sampleRate))
+    {
+        std::unique_ptr<AudioFormatReader> reader(fixture.formatManager.createReaderFor(wavTrack.getFile()));
+        std::unique_ptr<FileOutputStream> stream(flacTrack.getFile().createOutputStream());
+
+        if (reader != nullptr && stream != nullptr)
+        {
+            FlacAudioFormat flac;
+            std::unique_ptr<AudioFormatWriter> writer(flac.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0));
+
+            if (writer != nullptr)
+            {
+                //The writer owns the stream now
+                stream.release();
+                written = writer->writeFromAudioReader(*reader, 0, reader->lengthInSamples);
+            }
+        }
+    }
+
+    if (! written)
+    {
+        std::cout << "  can't write a FLAC test track to " << flacTrack.getFile().getFullPathName() << std::endl;
+        return;
+    }
+
+
+    AudioBuffer<float> buffer(2, blockSize);
+    AudioSourceChannelInfo info(&buffer, 0, blockSize);
+    const int blockMs = roundToInt(blockSize * 1000.0 / sampleRate);
+    const int numBlocks = roundToInt(modeSeconds * sampleRate / blockSize);
+
+    for (String mode : { "reverse", "brake", "spinback", "seekback" })
+    {
+        DJAudioplayer player(fixture.trackLoader);
+        player.setUseTrackCache(false);
+        player.prepareToPlay(blockSize, sampleRate);
+        player.loadURL(URL(flacTrack.getFile()));
+        player.getNextAudioBlock(info);
+        player.setPosition(20.0);
+        player.start();
+
+        //Play in so the read-ahead has settled
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            player.getNextAudioBlock(info);
+            Thread::sleep(blockMs);
+        }
+
+        if (mode == "reverse")
+            player.setReverse(true);
+        else if (mode == "brake")
+            player.brake();
+        else if (mode == "spinback")
+            player.spinBack();
+
+        int underruns = player.getNumBufferUnderruns();
+        double seconds = 0.0;
+        double position = 20.0 + modeSeconds;
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            //Back by two blocks' worth, so each block plays the one before the last forwards
+            if (mode == "seekback")
+            {
+                position -= 2.0 * blockSize / sampleRate;
+                player.setPosition(position);
+            }
+
+            auto start = Time::getHighResolutionTicks();
+            player.getNextAudioBlock(info);
+            seconds += Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start);
+            Thread::sleep(blockMs);
+        }
+
+        underruns = player.getNumBufferUnderruns() - underruns;
+        double usPerBlock = seconds * 1.0e6 / numBlocks;
+        bool parked = (mode == "brake" || mode == "spinback") && buffer.getMagnitude(0, blockSize) == 0.0f;
+
+        std::cout << "  " << mode.paddedRight(' ', 9) << underruns << " blocks with missing samples in " << numBlocks
+                  << ", " << String(usPerBlock, 1) << " us per block" << (parked ? ", parked in silence" : "") << std::endl;
+
+        record("reverse." + mode + ".underruns", underruns, "blocks");
+        record("reverse." + mode + ".usPerBlock", usPerBlock, "us");
+
+        player.stop();
+        player.releaseResources();
+    }
+}
+
+//Function to render decks offline and find, by cross-correlating the output with the track, which track sample is
+//actually heard when the deck reports a position; the difference is what its latency compensation gets wrong. Each
+//path a deck can take is measured, and the spread between their mean errors is how far apart two decks showing the
+//same position would really be
+void Benchmarks::runLatencyBenchmark()
+{
+    const double sampleRate = 44100.0;
+    const int blockSize = 256;
+    //Output samples correlated per measurement, and how far either side of the reported position is searched
+    const int window = 2048;
+    const int searchRange = 4096;
+    const int numMeasurements = 8;
+    const int blocksBetweenMeasurements = 60;
+
+    std::cout << "latency: reported position against the sample heard, " << window << "-sample cross-correlations, stereo "
+              << sampleRate << " Hz, " << blockSize << "-sample blocks" << std::endl;
+
+    //Noise correlates sharply at one offset only; one track at the device rate and one that has to be resampled
+    TemporaryFile track(".wav"), highRateTrack(".wav");
+    SyntheticTrackReader trackReader(30.0, sampleRate), highRateReader(30.0, 48000.0);
+    if (! writeReaderToWav(trackReader, track.getFile()) || ! writeReaderToWav(highRateReader, highRateTrack.getFile()))
+    {
+        std::cout << "  can't write the test tracks" << std::endl;
+        return;
+    }
+
+    LoaderFixture fixture;
+
+    //The left channel of each file as written, what the deck should be heard playing
+    AudioBuffer<float> references[2];
+    for (int index = 0; index < 2; ++index)
+    {
+        std::unique_ptr<AudioFormatReader> reader(fixture.formatManager.createReaderFor(index == 0 ? track.getFile() : highRateTrack.getFile()));
+        if (reader == nullptr)
+        {
+            std::cout << "  can't read the test tracks back" << std::endl;
+            return;
+        }
+
+        references[index].setSize(1, (int) reader->lengthInSamples);
+        reader->read(&references[index], 0, (int) reader->lengthInSamples, 0, true, false);
+    }
+
+    //Every stage that buffers audio, alone and together, straight out of the deck and through the mixer and limiter
+    struct Path
+    {
+        const char* name;
+        bool highRate;
+        double speed;
+        bool keyLock;
+        bool throughMaster;
+    };
+
+    const Path paths[] = {
+        { "plain",         false, 1.0,  false, false },
+        { "speed",         false, 1.08, false, false },
+        { "trackRate",     true,  1.0,  false, false },
+        { "keyLock",       false, 1.0,  true,  false },
+        { "keyLockRate",   true,  1.0,  true,  false },
+        { "master",        false, 1.08, false, true },
+        { "masterKeyLock", true,  1.0,  true,  true }
+    };
+
+    AudioBuffer<float> buffer(2, blockSize);
+    AudioSourceChannelInfo info(&buffer, 0, blockSize);
+    std::vector<float> captured((size_t) window);
+    double lowestMeanMs = std::numeric_limits<double>::max(), highestMeanMs = std::numeric_limits<double>::lowest();
+
+    for (auto& path : paths)
+    {
+        auto& reference = references[path.highRate ? 1 : 0];
+        double trackRate = path.highRate ? 48000.0 : sampleRate;
+        double rate = path.speed * trackRate / sampleRate;
+
+        DJAudioplayer player(fixture.trackLoader);
+        DeckMixer mixer(DeckMixer::minDecks);
+        MasterLimiter limiter(&mixer, false);
+        AudioSource* output = &player;
+
+        if (path.throughMaster)
+        {
+            mixer.setSource(0, &player);
+            limiter.prepareToPlay(blockSize, sampleRate);
+            player.setOutputLatency(mixer.getLatencyInSamples() + limiter.getLatencyInSamples());
+            output = &limiter;
+        }
+        else
+        {
+            player.prepareToPlay(blockSize, sampleRate);
+        }
+
+        player.loadURL(URL(path.highRate ? highRateTrack.getFile() : track.getFile()));
+        //Quiet enough that the limiter never touches it
+        player.setGain(0.25);
+        player.setKeyLock(path.keyLock);
+        player.setSpeed(path.speed);
+        player.setPosition(2.0);
+        player.start();
+
+        for (int block = 0; block < blocksBetweenMeasurements; ++block)
+            output->getNextAudioBlock(info);
+
+        double declaredMs = player.getLatencyReport().getTotalMs() + player.getOutputLatency() * 1000.0 / sampleRate;
+        double meanErrorMs = 0.0, worstErrorMs = 0.0;
+
+        for (int measurement = 0; measurement < numMeasurements; ++measurement)
+        {
+            for (int block = 0; block < blocksBetweenMeasurements; ++block)
+                output->getNextAudioBlock(info);
+
+            //What the deck says is heard as the next block starts, then what actually comes out
+            double reported = player.getPositionRelative() * reference.getNumSamples();
+
+            for (int done = 0; done < window; done += blockSize)
+            {
+                output->getNextAudioBlock(info);
+                std::copy(buffer.getReadPointer(0), buffer.getReadPointer(0) + jmin(blockSize, window - done), captured.begin() + done);
+            }
+
+            double actual = findInReference(captured.data(), window, reference, rate, reported, searchRange);
+            double errorMs = (reported - actual) / rate * 1000.0 / sampleRate;
+            meanErrorMs += errorMs / numMeasurements;
+            worstErrorMs = jmax(worstErrorMs, std::abs(errorMs));
+        }
+
+        lowestMeanMs = jmin(lowestMeanMs, meanErrorMs);
+        highestMeanMs = jmax(highestMeanMs, meanErrorMs);
+
+        std::cout << "  " << String(path.name).paddedRight(' ', 14) << "declared " << String(declaredMs, 2)
+                  << " ms (" << player.getLatencyReport().toString() << "), reported position off by "
+                  << String(meanErrorMs, 3) << " ms on average, worst " << String(worstErrorMs, 3) << " ms" << std::endl;
+        record("latency." + String(path.name) + ".worstErrorMs", worstErrorMs, "ms");
+
+        player.stop();
+        if (path.throughMaster)
+            limiter.releaseResources();
+        else
+            player.releaseResources();
+    }
+
+    double spreadMs = highestMeanMs - lowestMeanMs;
+    std::cout << "  decks on different paths showing the same position are " << String(spreadMs, 3)
+              << " ms apart" << std::endl;
+    record("latency.alignment.spreadMs", spreadMs, "ms");
+}
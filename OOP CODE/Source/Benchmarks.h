@@ -0,0 +1,69 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DeckResamplerSource.h"
+
+//Command-line benchmarks for the audio engine, the waveform and the library, started with:
+//  OtoDecks --benchmark [names...] [--json results.json] [--baseline baseline.json] [--threshold percent]
+//The app runs them headless and quits without opening a window or an audio device, so they can run on a build machine.
+//
+//Besides the report on stdout, every benchmark records its key figures by name (e.g. "player.all.usPerBlock").
+//--json writes them with the machine they were measured on. --baseline compares them with an earlier JSON file and
+//flags every figure that got worse by more than the threshold (10% unless --threshold or the baseline entry's own
+//"threshold" says otherwise); the exit code is 1 if any did, so a regression fails the build step that ran it
+class Benchmarks
+{
+public:
+    //Runs the benchmarks named on the command line, or all of them if none are named; returns the exit code
+    static int run(const String& commandLine);
+
+    //Keeps a figure for the JSON output and the baseline check; time-like figures are better lower
+    static void record(const String& name, double value, const String& unit, bool higherIsBetter = false);
+
+private:
+    //Writes the recorded figures as JSON, returns false if the file can't be written
+    static bool writeJson(const File& file);
+    //Prints every recorded figure against the baseline and returns how many regressed past their threshold
+    static int compareWithBaseline(const File& file, double thresholdPercent);
+
+    //Fused stereo EQ cascade against the separate IIRFilter passes and gain pass it replaced
+    static void runEqCascadeBenchmark();
+    //Cost of each key-lock quality tier and how many key-locked decks fit on one core at 256-sample blocks
+    static void runTimeStretchBenchmark();
+    //Cost per deck and aliasing of each resampler tier across the deck's speed range
+    static void runResamplerBenchmark();
+    //Resamples a tone and returns everything in the output that isn't the expected tone, in dB relative to it
+    static double measureResamplerResidual(DeckResamplerSource::Quality quality, double speed, double sampleRate);
+    //Resamples a tone that should end up above the output Nyquist and returns what is left, in dB relative to the input
+    static double measureResamplerLeakage(DeckResamplerSource::Quality quality, double speed, double sampleRate);
+    //Smallest buffer size four heavy decks render at within the period, serially and on the DeckRenderPool
+    static void runRenderPoolBenchmark();
+    //Cost of the master limiter on a hot and a quiet mix, and the sample and true peaks it lets out
+    static void runLimiterBenchmark();
+    //Highest level between the samples of a buffer, found with a 32x oversampled interpolator
+    static float measureTruePeak(const AudioBuffer<float>& buffer);
+    //Built-in reverb against the convolution reverb with impulse responses of several lengths and block sizes
+    static void runConvolutionBenchmark();
+    //The FX rack with every effect off, each one on its own, and all of them on
+    static void runFxRackBenchmark();
+    //A whole deck, DJAudioplayer::getNextAudioBlock, with each combination of EQ, reverb, speed and key lock
+    static void runPlayerBenchmark();
+    //The mixer and crossfader path for 2, 4 and 8 decks, with the crossfader still and being scratched
+    static void runMixerBenchmark();
+    //Waveform thumbnails built from 3, 10 and 60 minute tracks, and drawn at the deck's size
+    static void runThumbnailBenchmark();
+    //Library import, search, save and load with 100, 10k and 100k tracks
+    static void runLibraryBenchmark();
+    //Tempo analysis accuracy on drum tracks of known tempo, its cost per track, and import throughput on the pool
+    static void runAnalysisBenchmark();
+    //Beat sync: how far a synced deck's beat is from the leader's in their output over a whole track, with and without key lock
+    static void runSyncBenchmark();
+    //Hot cues on a track streamed from disk: latency from pad to audio and blocks lost, against seeking there instead
+    static void runHotCueBenchmark();
+    //Scratching a cached and a streamed track forwards and backwards from a 1 kHz jog: latency, cost and dropouts
+    static void runScratchBenchmark();
+    //Reverse, brake and spin-back on a FLAC track streamed from disk, against reversing by seeking back every block
+    static void runReverseBenchmark();
+    //How far the position a deck reports is from the sample heard, found offline by cross-correlation, on every path
+    static void runLatencyBenchmark();
+};
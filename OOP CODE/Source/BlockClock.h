@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Smoothed estimate of when each audio block starts on the Time::getMillisecondCounterHiRes clock, so controls
+//timestamped on the message thread can be placed at the matching sample of the next block. An event made t ms after
+//the previous block started lands t ms into the current one: exactly one block of latency, and the spacing between
+//events survives to the sample whatever the message thread's or the callback's jitter
+class BlockClock
+{
+public:
+    //Starts again from the next block, call from prepareToPlay
+    void reset(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        blockStartMs = -1.0;
+        previousBlockStartMs = -1.0;
+        previousBlockSamples = 0;
+    }
+
+    //Audio thread: call at the start of every block. Device callbacks jitter by a fraction of a block, following the
+    //ideal period and only nudging it towards each callback keeps that jitter out of the offsets
+    void update(int numSamples) noexcept
+    {
+        auto now = Time::getMillisecondCounterHiRes();
+        previousBlockStartMs = blockStartMs;
+
+        if (blockStartMs < 0.0)
+        {
+            blockStartMs = now;
+        }
+        else
+        {
+            double period = previousBlockSamples * 1000.0 / sampleRate;
+            double predicted = blockStartMs + period;
+            double error = now - predicted;
+
+            //After a stall start from this block rather than creeping back over many blocks
+            blockStartMs = std::abs(error) > 2.0 * period ? now : predicted + error * 0.05;
+        }
+
+        previousBlockSamples = numSamples;
+    }
+
+    //Audio thread: sample of the current block an event made at timeMs lands on, before clamping to the block;
+    //0 until the clock has seen two blocks
+    int getOffset(double timeMs) const noexcept
+    {
+        if (previousBlockStartMs < 0.0)
+            return 0;
+
+        return roundToInt((timeMs - previousBlockStartMs) * sampleRate / 1000.0);
+    }
+
+    //Audio thread: how long after timeMs a sample of the current block is rendered, -1 until there is a previous block
+    double getDelayMs(double timeMs, int sample) const noexcept
+    {
+        if (previousBlockStartMs < 0.0)
+            return -1.0;
+
+        return blockStartMs + sample * 1000.0 / sampleRate - timeMs;
+    }
+
+private:
+    double sampleRate = 44100.0;
+    //Estimated start of the current and previous blocks
+    double blockStartMs = -1.0;
+    double previousBlockStartMs = -1.0;
+    int previousBlockSamples = 0;
+};
@@ -0,0 +1,95 @@
+#include "CachedTrackSource.h"
+
+//Constructor: Stores the shared samples
+CachedTrackSource::CachedTrackSource(std::shared_ptr<const CachedTrackData> trackData)
+    : data(std::move(trackData))
+{
+    jassert(data != nullptr);
+}
+
+//Nothing to prepare, the samples are already decoded
+void CachedTrackSource::prepareToPlay(int, double)
+{
+}
+
+//Nothing to release, the cache owns the samples
+void CachedTrackSource::releaseResources()
+{
+}
+
+//Function to copy the next block out of the cached samples
+void CachedTrackSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    readSamples(*bufferToFill.buffer, bufferToFill.startSample, position, bufferToFill.numSamples);
+    position += bufferToFill.numSamples;
+}
+
+//Function to copy part of the cached samples, silence past either end of the track
+void CachedTrackSource::readSamples(AudioBuffer<float>& dest, int destStartSample, int64 start, int numSamples) const
+{
+    auto length = data->lengthInSamples;
+
+    //Part of the range that lies inside the track
+    auto validStart = static_cast<int>(jlimit((int64) 0, (int64) numSamples, -start));
+    auto validEnd = static_cast<int>(jlimit((int64) 0, (int64) numSamples, length - start));
+
+    if (validStart >= validEnd)
+    {
+        dest.clear(destStartSample, numSamples);
+        return;
+    }
+
+    if (validStart > 0)
+        dest.clear(destStartSample, validStart);
+
+    if (validEnd < numSamples)
+        dest.clear(destStartSample + validEnd, numSamples - validEnd);
+
+    auto readStart = static_cast<int>(start + validStart);
+    auto numToCopy = validEnd - validStart;
+
+    for (int channel = 0; channel < dest.getNumChannels(); ++channel)
+    {
+        //Mono tracks feed every output channel
+        auto sourceChannel = jmin(channel, data->numChannels - 1);
+        auto* destData = dest.getWritePointer(channel, destStartSample + validStart);
+
+        if (data->isCompact)
+        {
+            //Expand the 16-bit samples back to floats
+            auto* source = data->compactSamples.get() + (size_t) sourceChannel * (size_t) length + (size_t) readStart;
+            const float scale = 1.0f / 32767.0f;
+
+            for (int i = 0; i < numToCopy; ++i)
+                destData[i] = source[i] * scale;
+        }
+        else
+        {
+            FloatVectorOperations::copy(destData, data->floatSamples.getReadPointer(sourceChannel, readStart), numToCopy);
+        }
+    }
+}
+
+//Function to move the playhead, instant because everything is in memory
+void CachedTrackSource::setNextReadPosition(int64 newPosition)
+{
+    position = newPosition;
+}
+
+//Function to get the position the next block will be read from
+int64 CachedTrackSource::getNextReadPosition() const
+{
+    return position;
+}
+
+//Function to get the length of the cached track
+int64 CachedTrackSource::getTotalLength() const
+{
+    return data->lengthInSamples;
+}
+
+//Looping is handled by the player
+bool CachedTrackSource::isLooping() const
+{
+    return false;
+}
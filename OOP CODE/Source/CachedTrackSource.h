@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TrackCache.h"
+
+//Plays a track straight out of the RAM cache, so seeking is just moving an index
+class CachedTrackSource : public PositionableAudioSource
+{
+public:
+    //Constructor: Keeps the cached samples alive for as long as this source exists
+    CachedTrackSource(std::shared_ptr<const CachedTrackData> trackData);
+
+    //AudioSource overrides
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    //PositionableAudioSource overrides
+    void setNextReadPosition(int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    //Any thread: copies numSamples from position start into dest without moving the playhead,
+    //silence outside the track
+    void readSamples(AudioBuffer<float>& dest, int destStartSample, int64 start, int numSamples) const;
+
+    //The cached samples, for anything that has to read them after this source may have gone
+    std::shared_ptr<const CachedTrackData> getData() const { return data; }
+
+private:
+    std::shared_ptr<const CachedTrackData> data;
+    int64 position = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CachedTrackSource)
+};
@@ -0,0 +1,210 @@
+#include "CallbackProfiler.h"
+
+std::atomic<uint64> CallbackProfiler::stageCounters[CallbackProfiler::numStages] {};
+std::atomic<double> CallbackProfiler::lastHotCueLatencyMs { 0.0 };
+std::atomic<double> CallbackProfiler::worstHotCueLatencyMs { 0.0 };
+std::atomic<int> CallbackProfiler::numHotCues { 0 };
+std::atomic<int> CallbackProfiler::numHotCuesFromDisk { 0 };
+
+//Constructor: Calibrates the counter and allocates the FIFO's records up front
+CallbackProfiler::CallbackProfiler()
+    : ticksPerSecond(measureTicksPerSecond()),
+      records((size_t) fifoSize)
+{
+    for (auto& bin : histogram)
+        bin = 0;
+
+    history.reserve((size_t) historySize);
+}
+
+//Destructor
+CallbackProfiler::~CallbackProfiler()
+{
+}
+
+//Function to count a hot cue and its latency; only one deck at a time can raise the worst, which is all the
+//decks need
+void CallbackProfiler::recordHotCue(double latencyMs, bool fromMemory) noexcept
+{
+    lastHotCueLatencyMs = latencyMs;
+    if (latencyMs > worstHotCueLatencyMs.load())
+        worstHotCueLatencyMs = latencyMs;
+
+    ++numHotCues;
+    if (! fromMemory)
+        ++numHotCuesFromDisk;
+}
+
+//Function to work out the cycle counter's rate by reading it alongside the hi-res timer
+double CallbackProfiler::measureTicksPerSecond()
+{
+   #if OTODECKS_PROFILER_TSC
+    //The TSC runs at a fixed rate on any CPU from the last fifteen years, but that rate isn't published anywhere
+    auto startTicks = readCycleCounter();
+    auto startTime = Time::getHighResolutionTicks();
+    Thread::sleep(20);
+    auto endTicks = readCycleCounter();
+    auto endTime = Time::getHighResolutionTicks();
+
+    double seconds = Time::highResolutionTicksToSeconds(endTime - startTime);
+    if (seconds > 0.0 && endTicks > startTicks)
+        return (double) (endTicks - startTicks) / seconds;
+   #elif OTODECKS_CALLBACK_PROFILER && defined(__aarch64__)
+    //ARM publishes the virtual counter's rate
+    uint64 frequency;
+    __asm__ __volatile__ ("mrs %0, cntfrq_el0" : "=r" (frequency));
+    if (frequency > 0)
+        return (double) frequency;
+   #endif
+
+    return (double) Time::getHighResolutionTicksPerSecond();
+}
+
+//Function to start timing a callback, picking up any reset the message thread asked for
+void CallbackProfiler::beginCallback(int numSamples, double sampleRate) noexcept
+{
+    auto now = readCycleCounter();
+
+    if (resetRequested.exchange(false))
+    {
+        for (auto& bin : histogram)
+            bin = 0;
+        numXruns = 0;
+        numCallbacks = 0;
+        numDropped = 0;
+        previousStartTicks = 0;
+        lastHotCueLatencyMs = 0.0;
+        worstHotCueLatencyMs = 0.0;
+        numHotCues = 0;
+        numHotCuesFromDisk = 0;
+    }
+
+    //Anything counted outside a callback, e.g. while the device was being set up, isn't this callback's
+    for (auto& counter : stageCounters)
+        counter.store(0, std::memory_order_relaxed);
+
+    current.startTicks = now;
+    current.numSamples = numSamples;
+    current.deadlineTicks = sampleRate > 0.0 ? (uint64) ((double) numSamples * ticksPerSecond / sampleRate) : 0;
+
+    //The device skipped a block if this callback started well over a period after the last one
+    current.xrun = previousStartTicks != 0
+                && now - previousStartTicks > previousDeadlineTicks + previousDeadlineTicks / 2;
+
+    previousStartTicks = now;
+    previousDeadlineTicks = current.deadlineTicks;
+}
+
+//Function to finish timing a callback and hand its record to the message thread
+void CallbackProfiler::endCallback() noexcept
+{
+    current.durationTicks = readCycleCounter() - current.startTicks;
+
+    //Every deck has finished by now, including those rendered on the pool's workers
+    for (int stage = 0; stage < numStages; ++stage)
+        current.stageTicks[stage] = stageCounters[stage].load(std::memory_order_relaxed);
+
+    if (current.durationTicks > current.deadlineTicks)
+        current.xrun = true;
+
+    if (current.deadlineTicks > 0)
+    {
+        auto load = (double) current.durationTicks / (double) current.deadlineTicks;
+        int bin = jmin(numHistogramBins - 1, (int) (load / histogramBinWidth));
+        histogram[bin].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ++numCallbacks;
+    if (current.xrun)
+        ++numXruns;
+
+    const auto scope = fifo.write(1);
+    if (scope.blockSize1 > 0)
+        records[(size_t) scope.startIndex1] = current;
+    else
+        ++numDropped;
+}
+
+//Function to move every waiting record into the history, keeping only the newest
+int CallbackProfiler::collect()
+{
+    const auto scope = fifo.read(fifo.getNumReady());
+
+    auto append = [this] (int start, int size)
+    {
+        for (int i = 0; i < size; ++i)
+            history.push_back(records[(size_t) (start + i)]);
+    };
+
+    append(scope.startIndex1, scope.blockSize1);
+    append(scope.startIndex2, scope.blockSize2);
+
+    //Drop the oldest quarter at a time so the history isn't shuffled on every collect
+    if ((int) history.size() > historySize)
+        history.erase(history.begin(), history.begin() + (history.size() - (size_t) historySize * 3 / 4));
+
+    return scope.blockSize1 + scope.blockSize2;
+}
+
+//Function to copy the histogram
+void CallbackProfiler::getHistogram(uint32* counts) const
+{
+    for (int bin = 0; bin < numHistogramBins; ++bin)
+        counts[bin] = histogram[bin].load(std::memory_order_relaxed);
+}
+
+//Function to start the measurements again
+void CallbackProfiler::reset()
+{
+    history.clear();
+    resetRequested = true;
+}
+
+//Function to name each stage
+const char* CallbackProfiler::getStageName(Stage stage)
+{
+    const char* names[] = { "decode", "resample", "stretch", "reverb", "eq", "fx", "mixer", "limiter" };
+    return isPositiveAndBelow((int) stage, (int) numStages) ? names[stage] : "";
+}
+
+//Function to write the history as CSV, one callback per line
+bool CallbackProfiler::writeCsv(const File& file) const
+{
+    FileOutputStream stream(file);
+    if (! stream.openedOk())
+        return false;
+
+    stream.setPosition(0);
+    stream.truncate();
+
+    String header = "callback,time_ms,samples,deadline_us,duration_us,load_percent,xrun";
+    for (int stage = 0; stage < numStages; ++stage)
+        header << "," << getStageName((Stage) stage) << "_us";
+    stream << header << "\n";
+
+    uint64 firstTicks = history.empty() ? 0 : history.front().startTicks;
+
+    for (size_t i = 0; i < history.size(); ++i)
+    {
+        auto& record = history[i];
+        double duration = ticksToMicroseconds(record.durationTicks);
+        double deadline = ticksToMicroseconds(record.deadlineTicks);
+
+        String line;
+        line << (int) i << ","
+             << String(ticksToMicroseconds(record.startTicks - firstTicks) / 1000.0, 3) << ","
+             << record.numSamples << ","
+             << String(deadline, 1) << ","
+             << String(duration, 1) << ","
+             << String(deadline > 0.0 ? 100.0 * duration / deadline : 0.0, 1) << ","
+             << (record.xrun ? 1 : 0);
+
+        for (int stage = 0; stage < numStages; ++stage)
+            line << "," << String(ticksToMicroseconds(record.stageTicks[stage]), 1);
+
+        stream << line << "\n";
+    }
+
+    stream.flush();
+    return stream.getStatus().wasOk();
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <vector>
+
+//Always on unless turned off here or in OtoDecks.jucer
+#ifndef OTODECKS_CALLBACK_PROFILER
+ #define OTODECKS_CALLBACK_PROFILER 1
+#endif
+
+#if OTODECKS_CALLBACK_PROFILER && (defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64))
+ #define OTODECKS_PROFILER_TSC 1
+ #if defined(_MSC_VER)
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#else
+ #define OTODECKS_PROFILER_TSC 0
+#endif
+
+//Measures where the audio callback spends its time. Every stage of the deck and master paths is timed with the
+//CPU's cycle counter (the TSC on x86, the virtual counter on 64-bit ARM, the hi-res timer elsewhere) and each
+//callback's duration is compared with its deadline, the time the device takes to play one block.
+//
+//Stages are timed with a ScopedStage wherever the work happens. A stage's time excludes the stages nested inside
+//it, so the reverb isn't counted again as part of the deck and the resampler doesn't include the track read it
+//asks for. Stages add their cycles to shared counters, which also works for decks rendered on the DeckRenderPool
+//workers; with a pool the stage times are CPU time summed over every thread and can add up to more than the
+//callback's own duration, and the mixer includes the time the device thread spends waiting for the workers.
+//
+//At the end of each callback the audio thread pushes one Record through a lock-free FIFO, counts it into a
+//histogram of duration against deadline and checks it for an xrun: a callback that ran past its deadline, or one
+//that started more than one and a half periods after the previous one because the device skipped a block.
+//The message thread drains the FIFO into a history that the ProfilerOverlay shows and writeCsv dumps.
+//
+//Overhead is two counter reads and one relaxed atomic add per stage, well under a microsecond per callback for
+//two decks. Setting OTODECKS_CALLBACK_PROFILER to 0 compiles every ScopedStage to nothing
+class CallbackProfiler
+{
+public:
+    //Timed stages, in the order a block goes through them
+    enum Stage
+    {
+        decode = 0,     //Reading the track from the RAM cache or the read-ahead buffer; decoding runs on its own thread
+        resample,       //Speed change and sample rate correction
+        stretch,        //Key lock time stretching
+        reverb,         //Built-in or convolution reverb and the wet/dry mix
+        eq,             //Bass, mid and treble IIR stages and deck gain, run as one fused cascade
+        fx,             //Effects switched on in the deck's FX rack
+        mixer,          //Crossfader, channel strips and the mix-down
+        limiter,        //Master true-peak limiter
+        numStages
+    };
+
+    //What one callback measured
+    struct Record
+    {
+        //Cycle counter at the start of the callback
+        uint64 startTicks = 0;
+        uint64 durationTicks = 0;
+        //How long the device takes to play the block
+        uint64 deadlineTicks = 0;
+        uint64 stageTicks[numStages] = {};
+        int numSamples = 0;
+        bool xrun = false;
+    };
+
+    //Buckets of the histogram, callback duration as a share of the deadline
+    static constexpr int numHistogramBins = 20;
+    static constexpr double histogramBinWidth = 0.1;
+
+    //Callbacks the FIFO holds between drains, about five seconds at 256 samples and 48 kHz
+    static constexpr int fifoSize = 1024;
+    //Callbacks the message thread keeps for the overlay and the CSV dump
+    static constexpr int historySize = 16384;
+
+    //Times the work between its construction and destruction as one stage, for any thread
+    class ScopedStage
+    {
+    public:
+       #if OTODECKS_CALLBACK_PROFILER
+        ScopedStage(Stage stageToTime) noexcept
+            : stage(stageToTime), parent(innermost), startTicks(readCycleCounter())
+        {
+            innermost = this;
+        }
+
+        ~ScopedStage() noexcept
+        {
+            auto elapsed = readCycleCounter() - startTicks;
+            innermost = parent;
+
+            //Only the time outside nested stages is this stage's own
+            stageCounters[stage].fetch_add(elapsed - nestedTicks, std::memory_order_relaxed);
+
+            if (parent != nullptr)
+                parent->nestedTicks += elapsed;
+        }
+
+    private:
+        Stage stage;
+        ScopedStage* parent;
+        uint64 startTicks;
+        uint64 nestedTicks = 0;
+       #else
+        ScopedStage(Stage) noexcept {}
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedStage)
+    };
+
+    //Constructor: Measures the cycle counter's rate, which takes about 20 ms
+    CallbackProfiler();
+    //Destructor
+    ~CallbackProfiler();
+
+    //Audio thread: call at the start and end of the device callback
+    void beginCallback(int numSamples, double sampleRate) noexcept;
+    void endCallback() noexcept;
+
+    //Message thread: moves new records from the FIFO into the history, returns how many arrived
+    int collect();
+    //Message thread: the collected callbacks, oldest first
+    const std::vector<Record>& getHistory() const { return history; }
+
+    //Any thread: callbacks counted in each histogram bin, the last bin holds everything beyond it
+    void getHistogram(uint32* counts) const;
+    //Any thread: xruns and callbacks since the last reset
+    int getNumXruns() const { return numXruns.load(); }
+    int getNumCallbacks() const { return numCallbacks.load(); }
+    //Any thread: records lost because the FIFO was full
+    int getNumDropped() const { return numDropped.load(); }
+
+    //Audio thread, any deck: a hot cue was heard this long after its pad was pressed, counting the block it starts in;
+    //fromMemory is false if the cue's audio wasn't decoded and the jump had to wait for the disk
+    static void recordHotCue(double latencyMs, bool fromMemory) noexcept;
+    //Any thread: hot cue latency, the last one and the worst since the last reset, and how many cues were played
+    //and how many of them came from the disk
+    static double getLastHotCueLatencyMs() { return lastHotCueLatencyMs.load(); }
+    static double getWorstHotCueLatencyMs() { return worstHotCueLatencyMs.load(); }
+    static int getNumHotCues() { return numHotCues.load(); }
+    static int getNumHotCuesFromDisk() { return numHotCuesFromDisk.load(); }
+
+    //Message thread: clears the history, and the counters from the next callback
+    void reset();
+
+    //Message thread: writes one line per collected callback with times in microseconds, returns false on failure
+    bool writeCsv(const File& file) const;
+
+    //Converts cycle counter ticks to microseconds
+    double ticksToMicroseconds(uint64 ticks) const { return (double) ticks * 1.0e6 / ticksPerSecond; }
+    //Short name of a stage, for the overlay and the CSV header
+    static const char* getStageName(Stage stage);
+
+    //Reads the cycle counter used for every measurement
+    static uint64 readCycleCounter() noexcept
+    {
+       #if OTODECKS_PROFILER_TSC
+        return (uint64) __rdtsc();
+       #elif OTODECKS_CALLBACK_PROFILER && defined(__aarch64__)
+        uint64 value;
+        __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (value));
+        return value;
+       #else
+        return (uint64) Time::getHighResolutionTicks();
+       #endif
+    }
+
+private:
+    //Measures how fast the cycle counter runs against the hi-res timer
+    static double measureTicksPerSecond();
+
+    //Cycles each stage has used since the current callback started, shared by every thread
+    static std::atomic<uint64> stageCounters[numStages];
+    //Stage being timed on each thread, so nested stages can hand their time to it
+    static inline thread_local ScopedStage* innermost = nullptr;
+
+    //Hot cue latency, shared by every deck
+    static std::atomic<double> lastHotCueLatencyMs;
+    static std::atomic<double> worstHotCueLatencyMs;
+    static std::atomic<int> numHotCues;
+    static std::atomic<int> numHotCuesFromDisk;
+
+    const double ticksPerSecond;
+
+    AbstractFifo fifo{fifoSize};
+    std::vector<Record> records;
+
+    std::atomic<uint32> histogram[numHistogramBins];
+    std::atomic<int> numXruns { 0 };
+    std::atomic<int> numCallbacks { 0 };
+    std::atomic<int> numDropped { 0 };
+    std::atomic<bool> resetRequested { false };
+
+    //Audio thread state for the callback in progress
+    Record current;
+    uint64 previousStartTicks = 0;
+    uint64 previousDeadlineTicks = 0;
+
+    //Message thread: the last historySize callbacks
+    std::vector<Record> history;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackProfiler)
+};
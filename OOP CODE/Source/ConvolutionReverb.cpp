@@ -0,0 +1,205 @@
+#include "ConvolutionReverb.h"
+
+//Constructor: Sizes every buffer for the response so the audio thread only reads and writes them
+ConvolutionReverb::State::State(ImpulseResponse::Ptr impulseResponseToUse) : impulseResponse(impulseResponseToUse)
+{
+    if (impulseResponse == nullptr)
+        return;
+
+    int fftSize = 1 << impulseResponse->getFftOrder();
+    fft.reset(new dsp::FFT(impulseResponse->getFftOrder()));
+    work.resize((size_t) (2 * fftSize));
+
+    for (auto& channel : channels)
+    {
+        channel.segment.resize((size_t) fftSize);
+        channel.delayLine.resize((size_t) (impulseResponse->getNumPartitions() * impulseResponse->getSpectrumSize()));
+        channel.tail.resize((size_t) impulseResponse->getSpectrumSize());
+    }
+}
+
+//Constructor: Deletes retired states ten times a second
+ConvolutionReverb::ConvolutionReverb()
+{
+    startTimer(100);
+}
+
+//Destructor: Deletes every state
+ConvolutionReverb::~ConvolutionReverb()
+{
+    stopTimer();
+    delete queuedState.exchange(nullptr);
+    delete retiredState.exchange(nullptr);
+    delete liveState;
+}
+
+//Function to build the state for a new response and queue it for the audio thread
+void ConvolutionReverb::setImpulseResponse(ImpulseResponse::Ptr newImpulseResponse)
+{
+    impulseResponse = newImpulseResponse;
+
+    //A state the audio thread never took is replaced here
+    delete queuedState.exchange(new State(newImpulseResponse));
+}
+
+//Function to take a newly queued state once the last one has been collected
+bool ConvolutionReverb::update() noexcept
+{
+    if (queuedState.load() != nullptr && retiredState.load() == nullptr)
+    {
+        retiredState = liveState;
+        liveState = queuedState.exchange(nullptr);
+    }
+
+    return liveState != nullptr && liveState->impulseResponse != nullptr;
+}
+
+//Function to report how long the reverb rings after the input stops
+int ConvolutionReverb::getTailLengthSamples() const noexcept
+{
+    if (liveState == nullptr || liveState->impulseResponse == nullptr)
+        return 0;
+
+    return liveState->impulseResponse->getLengthInSamples() + liveState->impulseResponse->getPartitionSize();
+}
+
+//Function to clear the input history
+void ConvolutionReverb::reset() noexcept
+{
+    if (liveState == nullptr)
+        return;
+
+    for (auto& channel : liveState->channels)
+    {
+        std::fill(channel.segment.begin(), channel.segment.end(), 0.0f);
+        std::fill(channel.delayLine.begin(), channel.delayLine.end(), 0.0f);
+        std::fill(channel.tail.begin(), channel.tail.end(), 0.0f);
+    }
+
+    liveState->filled = 0;
+    liveState->delayPosition = 0;
+}
+
+//Function to convolve a block, split where it crosses from one partition into the next
+void ConvolutionReverb::process(const float* const* input, float* const* output, int numChannels, int numSamples) noexcept
+{
+    numChannels = jmin(numChannels, maxChannels);
+
+    if (liveState == nullptr || liveState->impulseResponse == nullptr)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            FloatVectorOperations::clear(output[channel], numSamples);
+        return;
+    }
+
+    auto& state = *liveState;
+    int partitionSize = state.impulseResponse->getPartitionSize();
+
+    for (int offset = 0; offset < numSamples;)
+    {
+        int numToDo = jmin(partitionSize - state.filled, numSamples - offset);
+        processPartial(state, input, output, numChannels, offset, numToDo);
+
+        state.filled += numToDo;
+        offset += numToDo;
+
+        if (state.filled == partitionSize)
+            advancePartition(state);
+    }
+}
+
+//Function to transform the partition so far, multiply it by the response's first partition and add the later ones
+void ConvolutionReverb::processPartial(State& state, const float* const* input, float* const* output, int numChannels,
+                                       int offset, int numSamples) noexcept
+{
+    auto& impulseResponse = *state.impulseResponse;
+    int partitionSize = impulseResponse.getPartitionSize();
+    int fftSize = 2 * partitionSize;
+    int numBins = fftSize / 2 + 1;
+    int spectrumSize = impulseResponse.getSpectrumSize();
+    float* work = state.work.data();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto& history = state.channels[channel];
+        float* segment = history.segment.data();
+        FloatVectorOperations::copy(segment + partitionSize + state.filled, input[channel] + offset, numSamples);
+
+        //The previous partition and the current one so far, anything not yet received is still zero
+        FloatVectorOperations::copy(work, segment, fftSize);
+        FloatVectorOperations::clear(work + fftSize, fftSize);
+        state.fft->performRealOnlyForwardTransform(work, true);
+
+        //Kept in the delay line; the last transform of a partition is the one the later partitions use
+        float* spectrum = history.delayLine.data() + state.delayPosition * spectrumSize;
+        FloatVectorOperations::copy(spectrum, work, spectrumSize);
+
+        const float* response = impulseResponse.getPartition(channel, 0);
+        const float* tail = history.tail.data();
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            float re = spectrum[2 * bin], im = spectrum[2 * bin + 1];
+            float responseRe = response[2 * bin], responseIm = response[2 * bin + 1];
+            work[2 * bin] = tail[2 * bin] + re * responseRe - im * responseIm;
+            work[2 * bin + 1] = tail[2 * bin + 1] + re * responseIm + im * responseRe;
+        }
+
+        //The inverse transform wants the negative frequencies too, they mirror the positive ones
+        for (int bin = numBins; bin < fftSize; ++bin)
+        {
+            work[2 * bin] = work[2 * (fftSize - bin)];
+            work[2 * bin + 1] = -work[2 * (fftSize - bin) + 1];
+        }
+
+        state.fft->performRealOnlyInverseTransform(work);
+
+        //Overlap-save: only the second half is free of wrap-around
+        FloatVectorOperations::copy(output[channel] + offset, work + partitionSize + state.filled, numSamples);
+    }
+}
+
+//Function to start the next partition and sum what the earlier ones contribute to it
+void ConvolutionReverb::advancePartition(State& state) noexcept
+{
+    auto& impulseResponse = *state.impulseResponse;
+    int partitionSize = impulseResponse.getPartitionSize();
+    int numPartitions = impulseResponse.getNumPartitions();
+    int spectrumSize = impulseResponse.getSpectrumSize();
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+    {
+        auto& history = state.channels[channel];
+
+        //The partition just finished becomes the previous one
+        float* segment = history.segment.data();
+        FloatVectorOperations::copy(segment, segment + partitionSize, partitionSize);
+        FloatVectorOperations::clear(segment + partitionSize, partitionSize);
+
+        //Response partition p meets the input from p partitions before the next one
+        float* tail = history.tail.data();
+        FloatVectorOperations::clear(tail, spectrumSize);
+
+        for (int partition = 1; partition < numPartitions; ++partition)
+        {
+            int slot = (state.delayPosition - (partition - 1) + numPartitions) % numPartitions;
+            const float* spectrum = history.delayLine.data() + slot * spectrumSize;
+            const float* response = impulseResponse.getPartition(channel, partition);
+
+            for (int i = 0; i < spectrumSize; i += 2)
+            {
+                tail[i] += spectrum[i] * response[i] - spectrum[i + 1] * response[i + 1];
+                tail[i + 1] += spectrum[i] * response[i + 1] + spectrum[i + 1] * response[i];
+            }
+        }
+    }
+
+    state.filled = 0;
+    state.delayPosition = (state.delayPosition + 1) % numPartitions;
+}
+
+//Function to delete retired states on the message thread
+void ConvolutionReverb::timerCallback()
+{
+    delete retiredState.exchange(nullptr);
+}
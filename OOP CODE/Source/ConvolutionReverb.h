@@ -0,0 +1,88 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "ImpulseResponseLibrary.h"
+
+//A deck's convolution reverb: uniformly partitioned overlap-save convolution with a shared ImpulseResponse.
+//The input spectra of past partitions are kept in a frequency-domain delay line; when a partition fills, their
+//products with the response's later partitions are summed once and reused for every block of the next partition.
+//Blocks shorter than a partition are transformed as they arrive, partition filled so far, so the wet signal comes
+//out with no added latency whatever the device's block size.
+//
+//Responses are swapped from the message thread with a state built up front, the audio thread takes it at the next
+//block and the old one is deleted by a timer, so processing never allocates or locks
+class ConvolutionReverb : private Timer
+{
+public:
+    //Channels convolved, a mono response is used for both
+    static constexpr int maxChannels = 2;
+
+    //Constructor: Starts collecting retired states
+    ConvolutionReverb();
+    //Destructor: Deletes every state, the audio thread must have stopped using this
+    ~ConvolutionReverb() override;
+
+    //Message thread: convolves with this response from the next block, null turns the convolution off
+    void setImpulseResponse(ImpulseResponse::Ptr newImpulseResponse);
+    //Message thread: the response last set
+    ImpulseResponse::Ptr getImpulseResponse() const { return impulseResponse; }
+
+    //Audio thread: takes any new response and returns true if there is one to convolve with; call at the start of a block
+    bool update() noexcept;
+    //Audio thread: samples of wet signal still to come after the input goes silent
+    int getTailLengthSamples() const noexcept;
+    //Audio thread: forgets the input so far, so a tail doesn't play again when the reverb comes back
+    void reset() noexcept;
+    //Audio thread: writes the convolved input to the output, they must not overlap
+    void process(const float* const* input, float* const* output, int numChannels, int numSamples) noexcept;
+    //Partial partitions are convolved as they arrive, see above, so the wet signal is never late
+    int getLatencyInSamples() const noexcept { return 0; }
+
+private:
+    //Everything the audio thread needs to convolve with one response, allocated on the message thread
+    struct State
+    {
+        //Constructor: Sizes the buffers for the response, or leaves them empty for none
+        State(ImpulseResponse::Ptr impulseResponseToUse);
+
+        //One channel's input history
+        struct Channel
+        {
+            //Previous full partition, then the current one so far
+            std::vector<float> segment;
+            //Spectra of the most recent partitions, a ring of one per partition of the response
+            std::vector<float> delayLine;
+            //Later partitions' contribution to the current one, summed when the last partition filled
+            std::vector<float> tail;
+        };
+
+        ImpulseResponse::Ptr impulseResponse;
+        std::unique_ptr<dsp::FFT> fft;
+        Channel channels[maxChannels];
+        //Transform buffer, twice the FFT size
+        std::vector<float> work;
+        //Samples of the current partition received so far
+        int filled = 0;
+        //Slot in the delay line the current partition's spectrum goes in
+        int delayPosition = 0;
+    };
+
+    //Audio thread: convolves the part of a block that fits in the current partition
+    void processPartial(State& state, const float* const* input, float* const* output, int numChannels,
+                        int offset, int numSamples) noexcept;
+    //Audio thread: moves on to the next partition, summing the delay line for it
+    void advancePartition(State& state) noexcept;
+    //Deletes retired states away from the audio thread
+    void timerCallback() override;
+
+    //Response last set from the message thread
+    ImpulseResponse::Ptr impulseResponse;
+
+    //Handover between the message thread and the audio thread
+    std::atomic<State*> queuedState { nullptr };
+    std::atomic<State*> retiredState { nullptr };
+    //Audio thread state
+    State* liveState = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionReverb)
+};
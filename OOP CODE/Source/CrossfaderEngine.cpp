@@ -0,0 +1,318 @@
+#include "CrossfaderEngine.h"
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    //Share of the travel over which the scratch curve cuts a side, the rest of the way it stays at full level
+    constexpr float scratchCutWidth = 0.03f;
+}
+
+//Constructor: Builds the curve tables up front and allocates everything the audio thread writes to
+CrossfaderEngine::CrossfaderEngine()
+    : events((size_t) fifo.getTotalSize()),
+      overflowPosition(std::numeric_limits<float>::quiet_NaN()),
+      recordedMoves((size_t) maxRecordedMoves),
+      replayMoves((size_t) maxRecordedMoves)
+{
+    getTables();
+    getGains(Curve::constantPower, appliedPosition, ramp.gainA, ramp.gainB);
+    ramp.targetA = ramp.gainA;
+    ramp.targetB = ramp.gainB;
+}
+
+//Function to fill the curve tables once, the first time any engine needs them
+const std::array<CrossfaderEngine::CurveTable, (size_t) CrossfaderEngine::Curve::numCurves>& CrossfaderEngine::getTables() noexcept
+{
+    static const auto tables = []
+    {
+        std::array<CurveTable, (size_t) Curve::numCurves> t;
+
+        for (int i = 0; i <= tableSize; ++i)
+        {
+            float x = (float) i / (float) tableSize;
+
+            t[(size_t) Curve::constantPower][(size_t) i] = std::cos(x * MathConstants<float>::halfPi);
+            t[(size_t) Curve::linear][(size_t) i] = 1.0f - x;
+
+            float cut = (x - (1.0f - scratchCutWidth)) / scratchCutWidth;
+            t[(size_t) Curve::scratch][(size_t) i] = cut <= 0.0f ? 1.0f : std::cos(jmin(1.0f, cut) * MathConstants<float>::halfPi);
+        }
+
+        return t;
+    }();
+
+    return tables;
+}
+
+//Function to read both sides' gains from a curve table, interpolating between entries
+void CrossfaderEngine::getGains(Curve curve, float position, float& gainA, float& gainB) noexcept
+{
+    auto& table = getTables()[(size_t) jlimit(0, (int) Curve::numCurves - 1, (int) curve)];
+
+    auto lookup = [&table] (float x)
+    {
+        float index = jlimit(0.0f, 1.0f, x) * (float) tableSize;
+        int i = jmin(tableSize - 1, (int) index);
+        float frac = index - (float) i;
+        return table[(size_t) i] + (table[(size_t) i + 1] - table[(size_t) i]) * frac;
+    };
+
+    //The curves are symmetric, side B is side A seen from the other end
+    gainA = lookup(position);
+    gainB = lookup(1.0f - position);
+}
+
+//Function to queue a timestamped move
+void CrossfaderEngine::moveTo(float position, double timeMs)
+{
+    push(jlimit(0.0f, 1.0f, position), timeMs);
+}
+
+//Function to queue a move for the start of the next block
+void CrossfaderEngine::setPosition(float position)
+{
+    push(jlimit(0.0f, 1.0f, position), -1.0);
+}
+
+//Function to put a move on the FIFO
+void CrossfaderEngine::push(float position, double timeMs)
+{
+    latestPosition = position;
+
+    const auto scope = fifo.write(1);
+    if (scope.blockSize1 > 0)
+        events[(size_t) scope.startIndex1] = { position, timeMs };
+    else
+        //The audio thread has stalled; keep the newest move so the crossfader still ends up in the right place
+        overflowPosition = position;
+}
+
+//Function to switch curves
+void CrossfaderEngine::setCurve(Curve newCurve)
+{
+    curve = jlimit(0, (int) Curve::numCurves - 1, (int) newCurve);
+}
+
+//Function to ask the audio thread to start a recording
+void CrossfaderEngine::startRecording()
+{
+    command = startRecord;
+}
+
+//Function to ask the audio thread to stop recording
+void CrossfaderEngine::stopRecording()
+{
+    command = stopRecord;
+}
+
+//Function to copy the finished recording
+Array<CrossfaderEngine::Move> CrossfaderEngine::getRecording() const
+{
+    Array<Move> moves;
+
+    if (! recording.load())
+        moves.addArray(recordedMoves.getData(), numRecordedMoves.load());
+
+    return moves;
+}
+
+//Function to hand a recording to the audio thread to play back
+bool CrossfaderEngine::startReplay(const Array<Move>& moves)
+{
+    //The audio thread reads the replay buffer while a replay runs or is about to start
+    if (replaying.load() || command.load() != none || moves.isEmpty())
+        return false;
+
+    numReplayMoves = jmin(moves.size(), maxRecordedMoves);
+    std::copy(moves.begin(), moves.begin() + numReplayMoves, replayMoves.getData());
+
+    command = startReplaying;
+    return true;
+}
+
+//Function to ask the audio thread to stop a replay
+void CrossfaderEngine::stopReplay()
+{
+    command = stopReplaying;
+}
+
+//Function to reset the audio thread state for a new stream
+void CrossfaderEngine::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    rampSamples = jmax(1, roundToInt(rampMs * sampleRate / 1000.0));
+
+    appliedPosition = latestPosition.load();
+    appliedCurve = curve.load();
+    getGains((Curve) appliedCurve, appliedPosition, ramp.gainA, ramp.gainB);
+    ramp.targetA = ramp.gainA;
+    ramp.targetB = ramp.gainB;
+    ramp.remaining = 0;
+
+    blockClock.reset(sampleRate);
+}
+
+//Function to act on the last record or replay request
+void CrossfaderEngine::handleCommand() noexcept
+{
+    switch (command.exchange(none))
+    {
+        case startRecord:
+            //Every recording starts with where the crossfader is, so a replay begins from the same place
+            recordedMoves[0] = { 0, appliedPosition };
+            numRecordedMoves = 1;
+            recordClock = 0;
+            recording = true;
+            break;
+
+        case stopRecord:
+            recording = false;
+            break;
+
+        case startReplaying:
+            nextReplayMove = 0;
+            replayClock = 0;
+            replaying = true;
+            break;
+
+        case stopReplaying:
+            replaying = false;
+            break;
+
+        default:
+            break;
+    }
+}
+
+//Function to carry the current ramp forward to a sample
+void CrossfaderEngine::advanceTo(int sample, int& position, Breakpoint* breakpoints, int& numBreakpoints) noexcept
+{
+    if (ramp.remaining > 0 && sample > position)
+    {
+        int end = position + ramp.remaining;
+
+        if (end <= sample)
+        {
+            //The ramp ends inside the stretch, the gains hold after it
+            ramp.gainA = ramp.targetA;
+            ramp.gainB = ramp.targetB;
+            ramp.remaining = 0;
+
+            if (numBreakpoints < maxBreakpoints)
+                breakpoints[numBreakpoints++] = { end, ramp.gainA, ramp.gainB };
+        }
+        else
+        {
+            float progress = (float) (sample - position) / (float) ramp.remaining;
+            ramp.gainA += (ramp.targetA - ramp.gainA) * progress;
+            ramp.gainB += (ramp.targetB - ramp.gainB) * progress;
+            ramp.remaining -= sample - position;
+        }
+    }
+
+    position = jmax(position, sample);
+}
+
+//Function to start ramping from wherever the gains are to a new position
+void CrossfaderEngine::startMove(float position, int sample, int& currentSample, Breakpoint* breakpoints, int& numBreakpoints) noexcept
+{
+    advanceTo(sample, currentSample, breakpoints, numBreakpoints);
+
+    //The ramp starts here, replacing a breakpoint already at this sample
+    Breakpoint start { currentSample, ramp.gainA, ramp.gainB };
+    if (breakpoints[numBreakpoints - 1].sample == currentSample)
+        breakpoints[numBreakpoints - 1] = start;
+    else if (numBreakpoints < maxBreakpoints)
+        breakpoints[numBreakpoints++] = start;
+
+    appliedPosition = position;
+    getGains((Curve) appliedCurve, position, ramp.targetA, ramp.targetB);
+    ramp.remaining = rampSamples;
+
+    if (recording.load())
+    {
+        int index = numRecordedMoves.load();
+        if (index < maxRecordedMoves)
+        {
+            recordedMoves[index] = { recordClock + currentSample, position };
+            numRecordedMoves = index + 1;
+        }
+    }
+}
+
+//Function to place this block's moves at their samples and describe the gains across the block
+int CrossfaderEngine::getBreakpoints(int numSamples, Breakpoint* breakpoints) noexcept
+{
+    handleCommand();
+    blockClock.update(numSamples);
+
+    int numBreakpoints = 0;
+    int currentSample = 0;
+    breakpoints[numBreakpoints++] = { 0, ramp.gainA, ramp.gainB };
+
+    //A new curve ramps to its gains for the same position
+    int newCurve = curve.load();
+    if (newCurve != appliedCurve)
+    {
+        appliedCurve = newCurve;
+        startMove(appliedPosition, 0, currentSample, breakpoints, numBreakpoints);
+    }
+
+    int numMoves = 0;
+    const auto numReady = jmin(fifo.getNumReady(), maxMovesPerBlock);
+    const auto scope = fifo.read(numReady);
+    auto overflow = overflowPosition.exchange(std::numeric_limits<float>::quiet_NaN());
+
+    if (replaying.load())
+    {
+        //Live moves are dropped while a replay runs
+        while (nextReplayMove < numReplayMoves && numMoves < maxMovesPerBlock
+               && replayMoves[nextReplayMove].sample < replayClock + numSamples)
+        {
+            auto& move = replayMoves[nextReplayMove++];
+            startMove(move.position, (int) jmax((int64) 0, move.sample - replayClock), currentSample, breakpoints, numBreakpoints);
+            ++numMoves;
+        }
+
+        replayClock += numSamples;
+
+        if (nextReplayMove >= numReplayMoves)
+            replaying = false;
+    }
+    else
+    {
+        auto applyEvent = [&] (int index)
+        {
+            auto& event = events[(size_t) index];
+            //A move made some time after the previous block started lands the same time into this one
+            int offset = event.timeMs >= 0.0 ? blockClock.getOffset(event.timeMs) : 0;
+
+            startMove(event.position, jlimit(currentSample, numSamples - 1, offset), currentSample, breakpoints, numBreakpoints);
+        };
+
+        for (int i = 0; i < scope.blockSize1; ++i)
+            applyEvent(scope.startIndex1 + i);
+        for (int i = 0; i < scope.blockSize2; ++i)
+            applyEvent(scope.startIndex2 + i);
+
+        if (! std::isnan(overflow))
+            startMove(overflow, currentSample, currentSample, breakpoints, numBreakpoints);
+    }
+
+    advanceTo(numSamples, currentSample, breakpoints, numBreakpoints);
+
+    if (breakpoints[numBreakpoints - 1].sample != numSamples)
+    {
+        Breakpoint end { numSamples, ramp.gainA, ramp.gainB };
+        if (numBreakpoints < maxBreakpoints)
+            breakpoints[numBreakpoints++] = end;
+        else
+            breakpoints[numBreakpoints - 1] = end;
+    }
+
+    if (recording.load())
+        recordClock += numSamples;
+
+    return numBreakpoints;
+}
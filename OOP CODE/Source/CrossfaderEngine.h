@@ -0,0 +1,164 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <array>
+#include "BlockClock.h"
+
+//Crossfader for the mixer. Gains come from precomputed curve tables, and every move is timestamped on the message
+//thread and applied at the matching sample of the next audio block instead of whenever the block happens to start.
+//
+//Moves are queued in a lock-free FIFO. The audio thread places each one with a BlockClock, so a move made t ms after
+//the previous block started lands t ms into the current one. That adds exactly one block of latency, and the spacing
+//between moves survives to the sample, so a fast scratch cut isn't smeared by message-thread or callback jitter.
+//Each move ramps the gains over rampMs to avoid a click, which keeps cuts well under a millisecond.
+//
+//Moves can be recorded as sample offsets from the start of the recording and replayed sample-exactly
+class CrossfaderEngine
+{
+public:
+    //Shape of the crossfade
+    enum class Curve
+    {
+        constantPower = 0,  //Equal loudness all the way across, for blends
+        scratch,            //Both sides at full level until the last few percent, for cuts
+        linear,             //Gains fall in a straight line, dips in the middle
+        numCurves
+    };
+
+    //One recorded move: where the crossfader went and how many samples after the recording started
+    struct Move
+    {
+        int64 sample = 0;
+        float position = 0.0f;
+    };
+
+    //A point the gains pass through in a block, they change linearly between consecutive breakpoints
+    struct Breakpoint
+    {
+        int sample = 0;
+        float gainA = 1.0f;
+        float gainB = 1.0f;
+    };
+
+    //Most moves taken from the FIFO in one block, later ones wait for the next block
+    static constexpr int maxMovesPerBlock = 32;
+    //Most breakpoints getBreakpoints writes
+    static constexpr int maxBreakpoints = 2 * (maxMovesPerBlock + 2) + 2;
+    //How long a move takes to reach its gains
+    static constexpr double rampMs = 0.25;
+    //Longest recording, at a 1 kHz controller rate roughly four minutes
+    static constexpr int maxRecordedMoves = 1 << 18;
+
+    //Constructor: Builds the curve tables and the record and replay buffers
+    CrossfaderEngine();
+
+    //Message thread: moves the crossfader, made at timeMs on the Time::getMillisecondCounterHiRes clock
+    void moveTo(float position, double timeMs);
+    //Message thread: moves the crossfader at the start of the next block, for callers that have no timestamps
+    void setPosition(float position);
+    //Any thread: position of the last move
+    float getPosition() const { return latestPosition.load(); }
+
+    //Any thread: changes the curve, the gains follow from the next block with the usual ramp
+    void setCurve(Curve newCurve);
+    Curve getCurve() const { return (Curve) curve.load(); }
+
+    //Message thread: starts recording moves from the next block, clearing the last recording
+    void startRecording();
+    //Message thread: stops recording after the current block
+    void stopRecording();
+    //Any thread: true once the audio thread has started recording and until it has stopped
+    bool isRecording() const { return recording.load(); }
+    //Message thread: copies out the last recording, empty while still recording
+    Array<Move> getRecording() const;
+
+    //Message thread: plays a recording back from the next block, live moves are ignored until it ends
+    bool startReplay(const Array<Move>& moves);
+    //Message thread: stops a replay where it is
+    void stopReplay();
+    //Any thread: true while a replay is running
+    bool isReplaying() const { return replaying.load(); }
+
+    //Resets the block clock and jumps to the current position, call from prepareToPlay
+    void prepare(double sampleRate);
+
+    //Audio thread: takes this block's moves and writes breakpoints from sample 0 to numSamples, returns how many
+    int getBreakpoints(int numSamples, Breakpoint* breakpoints) noexcept;
+
+    //Gains for both sides at a crossfader position, read from the curve's table
+    static void getGains(Curve curve, float position, float& gainA, float& gainB) noexcept;
+
+private:
+    //A move waiting in the FIFO
+    struct Event
+    {
+        float position;
+        //Time the move was made, negative to apply at the start of the next block
+        double timeMs;
+    };
+
+    //Requests the message thread leaves for the audio thread
+    enum Command
+    {
+        none = 0,
+        startRecord,
+        stopRecord,
+        startReplaying,
+        stopReplaying
+    };
+
+    //Pushes a move onto the FIFO, or keeps it as the overflow move if the FIFO is full
+    void push(float position, double timeMs);
+    //Audio thread: handles record and replay requests at the start of a block
+    void handleCommand() noexcept;
+
+    //Audio thread: gains walk from one breakpoint to the next while a move ramps
+    struct RampState
+    {
+        float gainA = 1.0f, gainB = 1.0f;
+        float targetA = 1.0f, targetB = 1.0f;
+        int remaining = 0;
+    };
+    //Audio thread: moves through the ramp up to a sample, adding a breakpoint where it finishes
+    void advanceTo(int sample, int& position, Breakpoint* breakpoints, int& numBreakpoints) noexcept;
+    //Audio thread: starts ramping to a position at a sample in the block and records the move
+    void startMove(float position, int sample, int& currentSample, Breakpoint* breakpoints, int& numBreakpoints) noexcept;
+
+    //Number of steps each table has across the crossfader's travel
+    static constexpr int tableSize = 1024;
+    using CurveTable = std::array<float, tableSize + 1>;
+    //Side A's gain for each curve across the travel, side B reads it backwards
+    static const std::array<CurveTable, (size_t) Curve::numCurves>& getTables() noexcept;
+
+    AbstractFifo fifo{512};
+    std::vector<Event> events;
+    //Last move that didn't fit in the FIFO, NaN if there isn't one
+    std::atomic<float> overflowPosition;
+
+    std::atomic<float> latestPosition { 0.5f };
+    std::atomic<int> curve { (int) Curve::constantPower };
+    std::atomic<int> command { none };
+
+    std::atomic<bool> recording { false };
+    std::atomic<bool> replaying { false };
+    //Written by the audio thread while recording, read by the message thread once it has stopped
+    HeapBlock<Move> recordedMoves;
+    std::atomic<int> numRecordedMoves { 0 };
+    //Written by the message thread while no replay runs
+    HeapBlock<Move> replayMoves;
+    int numReplayMoves = 0;
+
+    //Audio thread state
+    double sampleRate = 44100.0;
+    int rampSamples = 11;
+    float appliedPosition = 0.5f;
+    int appliedCurve = (int) Curve::constantPower;
+    RampState ramp;
+    int64 recordClock = 0;
+    int64 replayClock = 0;
+    int nextReplayMove = 0;
+    //When blocks start on the hi-res millisecond clock
+    BlockClock blockClock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CrossfaderEngine)
+};
@@ -1,26 +1,55 @@
 #include "DJAudioplayer.h"
+#include "AllocationTripwire.h"
+#include "CallbackProfiler.h"
 
-//Constructor: Initializes the audio player with the format manager
-DJAudioplayer::DJAudioplayer(AudioFormatManager& _formatManager)
-: formatManager(_formatManager)
+//Constructor: Initializes the audio player with the shared track loader
+DJAudioplayer::DJAudioplayer(TrackLoader& _trackLoader)
+: trackLoader(_trackLoader)
 {
-   
+    //The transport always plays from the slot, tracks are swapped inside it
+    transportSource.setSource(&trackSlot);
 }
 
 //Destructor: Cleans up any allocated resources
 DJAudioplayer::~DJAudioplayer() {
-    
+    //Detach the slot before it is deleted
+    transportSource.setSource(nullptr);
 }
 
 //Prepsared the audio player to start playing
 void DJAudioplayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
     transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    resampleSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    //Prepares the resampler behind it as well
+    timeStretchSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
     lastSampleRate = sampleRate;
+    //The rate correction changes with the device rate, the first block sets it
+    ratioDirty = true;
+
+    //Room for the larger blocks some devices give now and then, as in the slot's crossfade buffer
+    scratchRates.assign((size_t) jmax(samplesPerBlockExpected, 512) * 4, 0.0f);
+    scratchEngine.prepare(sampleRate);
     
-    setTrebleGain(trebleGain);
-    setBass(bassValue);
+    //Jump the smoothers to the current knob positions
+    parameters.prepare(sampleRate);
+
+    //Precompute the EQ coefficients across each knob's range so the audio thread only looks them up
+    bassTable.build([sampleRate] (double value) { return makeBassCoefficients(sampleRate, value); }, -1.0, 1.0);
+    trebleTable.build([sampleRate] (double value) { return makeTrebleCoefficients(sampleRate, value); }, -1.0, 1.0);
+    //Band-pass for mid frequencies (~1000 Hz), the mid knob scales its output
+    midCoefficients = juce::IIRCoefficients::makeBandPass(sampleRate, 1000.0, 0.707);
+
+    //Load the EQ cascade: low-pass bass, band-pass mid carrying the mid gain, high shelf treble carrying the deck gain
+    appliedBass = parameters.getCurrentValue(DeckParameters::bass);
+    appliedTreble = parameters.getCurrentValue(DeckParameters::treble);
+    appliedMid = parameters.getCurrentValue(DeckParameters::mid);
+    appliedGain = parameters.getCurrentValue(DeckParameters::gain);
+    trebleCoefficients = trebleTable.lookup(appliedTreble);
+    eqCascade.setNumStages(numEqStages);
+    eqCascade.setCoefficients(bassStage, bassTable.lookup(appliedBass));
+    eqCascade.setCoefficients(midStage, midCoefficients, appliedMid);
+    eqCascade.setCoefficients(trebleStage, trebleCoefficients, appliedGain);
+    eqCascade.reset();
 
     // Set up default reverb parameters
     juce::Reverb::Parameters params;
@@ -31,97 +60,326 @@ void DJAudioplayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate
     params.width      = 1.0f;
     params.freezeMode = 0.0f;
     reverb.setParameters(params);   
+    reverb.setSampleRate(sampleRate);
+
+    //The impulse response has to match the new rate, the library shares it with any other deck at this rate. One
+    //still being built is checked against the rate when it arrives
+    if (impulseResponseLibrary != nullptr && impulseResponseFile != File() && ! impulseResponsePending)
+        requestImpulseResponse(impulseResponseFile, *impulseResponseLibrary, nullptr);
+
+    //Allocate the reverb scratch buffer once, blocks larger than this are processed in pieces
+    wetBuffer.setSize(2, samplesPerBlockExpected);
+
+    //Every effect gets its delay lines now, so switching one on while playing doesn't allocate
+    fxRack.prepareToPlay(samplesPerBlockExpected, sampleRate);
 }
 
 //Function to retrieves the next block of audio data, applies reverb and EQ effects
 void DJAudioplayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    //Ensure looping works correctly: if track is at the end, restart from the beginning
-    if (looping)
+    //Nothing in here may allocate, Debug builds assert if it does
+    AllocationTripwire::ScopedRealtimeSection realtimeSection;
+
+    //Swap in a newly loaded track at the block boundary, crossfading if this deck is playing
+    bool trackChanged = trackSlot.swapInQueuedTrack(transportSource.isPlaying());
+
+    //Speed and key lock from the message thread, a new track's sample rate changes the correction too
+    if (ratioDirty.exchange(false) || trackChanged)
     {
-        double trackLength = transportSource.getLengthInSeconds();
-        if (trackLength > 0 && transportSource.getCurrentPosition() >= trackLength - 0.1)
-        {
-            //Restart track
-            transportSource.setPosition(0.0);
-            //Start playing from the beginning
-            transportSource.start();
-        }
+        timeStretchSource.setEnabled(keyLockWanted.load());
+        updateResamplingRatio(playbackSpeed.load());
     }
 
-    //Get the next block of audio from the resample source
-    resampleSource.getNextAudioBlock(bufferToFill);
+    //A hot cue jumps before this block is read, so its first sample is the first one out
+    auto hotCue = pendingHotCue.exchange(-1);
+    if (hotCue >= 0)
+        jumpToHotCue(hotCue);
+
+    if (unheardHotCueTriggerMs >= 0.0 && transportSource.isPlaying())
+        reportHotCueLatency(bufferToFill.numSamples);
+
+    //A synced deck sets this block's speed from the clock before it renders
+    if (masterClock != nullptr)
+        followMasterClock();
+
+    //Get the next block of audio from the resample source, tempo-stretched when key lock is on, unless it is scratched
+    bool scratched = renderScratch(bufferToFill);
+    if (! scratched)
+        timeStretchSource.getNextAudioBlock(bufferToFill);
+
+    //A deck playing to its own tempo offers to lead, with its beat where the next block starts
+    if (masterClock != nullptr && ! synced.load() && ! scratched)
+        offerLead();
 
-    //Apply reverb if wet/dry mix ratio is greater than 0 (reverb effect is active)
-    if (wetDry > 0.0)
+    //Pick up the latest knob positions published by the UI
+    parameters.updateSmoothingTargets();
+
+    //Convolve when an impulse response is set, otherwise use the built-in reverb
+    bool useConvolution = convolution.update();
+
+    //Apply reverb if the wet/dry mix is above 0 or still fading out
+    bool reverbActive = parameters.getTarget(DeckParameters::wetDry) > 0.0f || parameters.isSmoothing(DeckParameters::wetDry);
+
+    //Coming back from a bypass, the tail from before it must not play again
+    if (reverbActive && ! reverbWasActive)
     {
-        juce::AudioBuffer<float> wetBuffer;
-        //Copy current audio buffer to apply reverb
-        wetBuffer.makeCopyOf(*bufferToFill.buffer);
+        reverb.reset();
+        convolution.reset();
+        reverbTailRemaining = 0;
+    }
+    reverbWasActive = reverbActive;
 
-        //Process reverb
-        if (wetBuffer.getNumChannels() >= 2)
-            reverb.processStereo(wetBuffer.getWritePointer(0), wetBuffer.getWritePointer(1), bufferToFill.numSamples);
+    //Once the input has been silent for longer than the tail, wet and dry are both silent and the reverb can rest
+    if (reverbActive)
+    {
+        bool silent = true;
+        for (int channel = 0; channel < bufferToFill.buffer->getNumChannels() && silent; ++channel)
+            silent = bufferToFill.buffer->getMagnitude(channel, bufferToFill.startSample, bufferToFill.numSamples) == 0.0f;
+
+        if (! silent)
+            reverbTailRemaining = useConvolution ? convolution.getTailLengthSamples()
+                                                 : roundToInt(builtInReverbTailSeconds * lastSampleRate);
         else
-            reverb.processMono(wetBuffer.getWritePointer(0), bufferToFill.numSamples);
+            reverbTailRemaining = jmax(0, reverbTailRemaining - bufferToFill.numSamples);
 
-        //Mix the wet and dry signals based on the wetDry ratio
-        for (int channel = 0; channel < wetBuffer.getNumChannels(); ++channel)
+        reverbActive = ! silent || reverbTailRemaining > 0;
+    }
+
+    if (reverbActive && wetBuffer.getNumSamples() > 0)
+    {
+        CallbackProfiler::ScopedStage profilerStage(CallbackProfiler::reverb);
+        int numWetChannels = jmin(bufferToFill.buffer->getNumChannels(), wetBuffer.getNumChannels());
+
+        //Work through the block in pieces that fit the preallocated scratch buffer
+        for (int offset = 0; offset < bufferToFill.numSamples; offset += wetBuffer.getNumSamples())
         {
-            float* dryData = bufferToFill.buffer->getWritePointer(channel);
-            const float* wetData = wetBuffer.getReadPointer(channel);
-            for (int i = 0; i < bufferToFill.numSamples; ++i)
-                dryData[i] = dryData[i] * (1.0f - wetDry) + wetData[i] * wetDry;
+            int numSamples = jmin(wetBuffer.getNumSamples(), bufferToFill.numSamples - offset);
+            int startSample = bufferToFill.startSample + offset;
+
+            if (useConvolution)
+            {
+                //The convolution reads the block where it is and writes the wet signal to the scratch buffer
+                const float* input[2] = { bufferToFill.buffer->getReadPointer(0, startSample),
+                                          bufferToFill.buffer->getReadPointer(numWetChannels - 1, startSample) };
+                float* output[2] = { wetBuffer.getWritePointer(0), wetBuffer.getWritePointer(numWetChannels - 1) };
+                convolution.process(input, output, numWetChannels, numSamples);
+            }
+            else
+            {
+                //Copy current audio into the scratch buffer to apply reverb
+                for (int channel = 0; channel < numWetChannels; ++channel)
+                    wetBuffer.copyFrom(channel, 0, *bufferToFill.buffer, channel, startSample, numSamples);
+
+                //Process reverb
+                if (numWetChannels >= 2)
+                    reverb.processStereo(wetBuffer.getWritePointer(0), wetBuffer.getWritePointer(1), numSamples);
+                else
+                    reverb.processMono(wetBuffer.getWritePointer(0), numSamples);
+            }
+
+            //Mix the wet and dry signals with the smoothed wetDry ratio
+            float* dryData[2] = { bufferToFill.buffer->getWritePointer(0, startSample),
+                                  bufferToFill.buffer->getWritePointer(numWetChannels - 1, startSample) };
+            const float* wetData[2] = { wetBuffer.getReadPointer(0), wetBuffer.getReadPointer(numWetChannels - 1) };
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                float wetDry = parameters.getNextValue(DeckParameters::wetDry);
+                for (int channel = 0; channel < numWetChannels; ++channel)
+                    dryData[channel][i] = dryData[channel][i] * (1.0f - wetDry) + wetData[channel][i] * wetDry;
+            }
         }
     }
+    else
+    {
+        parameters.skip(DeckParameters::wetDry, bufferToFill.numSamples);
+    }
 
-    //Apply bass, mid, and treble EQ filters to each channel in the buffer
-    int numChannels = bufferToFill.buffer->getNumChannels();
-    for (int channel = 0; channel < numChannels; ++channel)
+    //Apply the bass, mid and treble EQ and the deck gain in one fused pass over the stereo pair.
+    //While a knob is moving the block is cut into short sub-blocks so the coefficients follow it
+    bool eqSmoothing = parameters.isSmoothing(DeckParameters::bass) || parameters.isSmoothing(DeckParameters::mid)
+                    || parameters.isSmoothing(DeckParameters::treble) || parameters.isSmoothing(DeckParameters::gain);
+    int subBlockSize = eqSmoothing ? eqSubBlockSize : bufferToFill.numSamples;
+    CallbackProfiler::ScopedStage profilerStage(CallbackProfiler::eq);
+
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += subBlockSize)
     {
-        float* channelData = bufferToFill.buffer->getWritePointer(channel);
+        int numSamples = jmin(subBlockSize, bufferToFill.numSamples - offset);
+        int startSample = bufferToFill.startSample + offset;
 
-        //Apply bass filter
-        if (channel == 0)
-            bassFilterLeft.processSamples(channelData, bufferToFill.numSamples);
-        else
-            bassFilterRight.processSamples(channelData, bufferToFill.numSamples);
+        //Move the filters along with the smoothed knobs
+        updateEqCoefficients(numSamples);
 
-        //Apply mid EQ filter
-        if (channel == 0)
-            midFilterLeft.processSamples(channelData, bufferToFill.numSamples);
+        float* left = bufferToFill.buffer->getWritePointer(0, startSample);
+        if (bufferToFill.buffer->getNumChannels() > 1)
+            eqCascade.process(left, bufferToFill.buffer->getWritePointer(1, startSample), numSamples);
         else
-            midFilterRight.processSamples(channelData, bufferToFill.numSamples);
+            eqCascade.processMono(left, numSamples);
+    }
 
-        //Apply the manually adjusted mid EQ gain
-        for (int i = 0; i < bufferToFill.numSamples; ++i)
-            channelData[i] *= midGainFactor;
+    //Effects the rack has switched on, in its order, in place on the block
+    CallbackProfiler::ScopedStage fxStage(CallbackProfiler::fx);
+    fxRack.process(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+}
 
-        //Apply treble filter
-        if (channel == 0)
-            highShelfFilterLeft.processSamples(channelData, bufferToFill.numSamples);
-        else
-            highShelfFilterRight.processSamples(channelData, bufferToFill.numSamples);
+//Function to update the EQ cascade from the coefficient tables and smoothed gains after numSamples of smoothing
+void DJAudioplayer::updateEqCoefficients(int numSamples) noexcept
+{
+    float bassValue = parameters.skip(DeckParameters::bass, numSamples);
+    if (bassValue != appliedBass)
+    {
+        eqCascade.setCoefficients(bassStage, bassTable.lookup(bassValue));
+        appliedBass = bassValue;
     }
+
+    //Mid gain is folded into the band-pass stage
+    float midValue = parameters.skip(DeckParameters::mid, numSamples);
+    if (midValue != appliedMid)
+    {
+        eqCascade.setCoefficients(midStage, midCoefficients, midValue);
+        appliedMid = midValue;
+    }
+
+    //Deck gain is folded into the last stage, so it costs nothing extra per sample
+    float trebleValue = parameters.skip(DeckParameters::treble, numSamples);
+    float gainValue = parameters.skip(DeckParameters::gain, numSamples);
+    if (trebleValue != appliedTreble || gainValue != appliedGain)
+    {
+        if (trebleValue != appliedTreble)
+            trebleCoefficients = trebleTable.lookup(trebleValue);
+
+        eqCascade.setCoefficients(trebleStage, trebleCoefficients, gainValue);
+        appliedTreble = trebleValue;
+        appliedGain = gainValue;
+    }
+}
+
+//Function to map the bass knob to the low-pass filter it controls
+IIRCoefficients DJAudioplayer::makeBassCoefficients(double sampleRate, double bassValue)
+{
+    //Map slider value to cutoff frequency for bass filter
+    double cutoffFrequency = 200.0 + ((bassValue + 1.0) / 2.0) * (19800.0);
+    //Keep the cutoff below Nyquist at low device sample rates
+    return juce::IIRCoefficients::makeLowPass(sampleRate, jmin(cutoffFrequency, sampleRate * 0.45));
+}
+
+//Function to map the treble knob to the high-shelf filter it controls
+IIRCoefficients DJAudioplayer::makeTrebleCoefficients(double sampleRate, double trebleValue)
+{
+    //Convert slider value to decibels and then to a gain factor
+    double dB = trebleValue * 12.0;
+    double gainFactor = std::pow(10.0, dB / 20.0);
+    return juce::IIRCoefficients::makeHighShelf(sampleRate, 3000.0, 0.707, (float) gainFactor);
 }
 
 //Function to release all audio resources when playback stops
 void DJAudioplayer::releaseResources() {
     
     transportSource.releaseResources();
-    resampleSource.releaseResources();
+    timeStretchSource.releaseResources();
 }
  
 //Function to load an audio file from a URL into the player
-void DJAudioplayer::loadURL(URL audioURL) {
-    auto* reader = formatManager.createReaderFor(audioURL.createInputStream(false));
-    if (reader != nullptr) {
-        std::unique_ptr<AudioFormatReaderSource> newSource (new AudioFormatReaderSource (reader, true));
-        transportSource.setSource (newSource.get(), 0, nullptr, reader->sampleRate);
-        readerSource.reset (newSource.release());
+void DJAudioplayer::loadURL(URL audioURL, const BeatGrid& beatGrid, const HotCues& cues) {
+    //Any asynchronous load still running is now out of date
+    ++latestLoadId;
+    loading = false;
+    hotCues = cues;
+
+    auto track = trackLoader.loadNow(audioURL, getLoadSettings(false, cues));
+    if (track != nullptr) {
+        queueLoadedTrack(std::move(track), beatGrid);
     }
 }
 
+//Function to load an audio file on a worker thread without blocking the UI
+void DJAudioplayer::loadURLAsync(URL audioURL, std::function<void(std::unique_ptr<AudioFormatReader>)> onLoaded,
+                                 const BeatGrid& beatGrid, const HotCues& cues) {
+    auto loadId = ++latestLoadId;
+    loading = true;
+    loadProgress = 0.0f;
+    hotCues = cues;
+
+    WeakReference<DJAudioplayer> safeThis(this);
+
+    trackLoader.loadAsync(audioURL, getLoadSettings(onLoaded != nullptr, cues),
+        [safeThis, loadId] (float progress)
+        {
+            //Ignore progress from loads that have been replaced by a newer one
+            if (safeThis != nullptr && safeThis->latestLoadId == loadId)
+                safeThis->loadProgress = progress;
+        },
+        [safeThis, loadId, onLoaded, beatGrid] (std::unique_ptr<LoadedTrack> track, std::unique_ptr<AudioFormatReader> thumbnailReader)
+        {
+            //The deck was deleted or another track was requested in the meantime
+            if (safeThis == nullptr || safeThis->latestLoadId != loadId)
+                return;
+
+            safeThis->loading = false;
+            safeThis->loadProgress = 1.0f;
+
+            if (track != nullptr)
+                safeThis->queueLoadedTrack(std::move(track), beatGrid);
+            else
+                thumbnailReader.reset();
+
+            if (onLoaded != nullptr)
+                onLoaded(std::move(thumbnailReader));
+        });
+}
+
+//Function to build the settings tracks are loaded with for this deck
+TrackLoader::LoadSettings DJAudioplayer::getLoadSettings(bool wantsThumbnailReader, const HotCues& cues) const {
+    TrackLoader::LoadSettings settings;
+    settings.readAheadSamples = readAheadSamples;
+    settings.preDecodeSeconds = preDecodeSeconds;
+    settings.blockSize = trackSlot.getPreparedBlockSize();
+    settings.deviceSampleRate = trackSlot.getPreparedSampleRate();
+    settings.wantsThumbnailReader = wantsThumbnailReader;
+    settings.useCache = useTrackCache;
+    settings.hotCues = cues;
+    settings.hotCuePreDecodeSeconds = hotCuePreDecodeSeconds;
+    return settings;
+}
+
+//Function to pass a loaded track over to the audio thread
+void DJAudioplayer::queueLoadedTrack(std::unique_ptr<LoadedTrack> track, const BeatGrid& beatGrid) {
+    lastLoadTimeMs = track->loadTimeMs;
+    //The grid travels with the track, so the audio thread never pairs it with the one before
+    track->beatGrid = beatGrid;
+    loadedLengthInSeconds = track->sampleRate > 0 ? (double) track->lengthInSamples / track->sampleRate : 0.0;
+
+    std::cout << "Loaded " << track->url.getFileName() << " in " << track->loadTimeMs << " ms" << std::endl;
+
+    //Loops belong to the track they were set on
+    exitLoop();
+
+    //Cues decoded with the track replace the last track's, pads without one are cleared
+    for (int index = 0; index < HotCues::numCues; ++index)
+    {
+        ++hotCueDecodeIds[(size_t) index];
+        trackSlot.setHotCue(index, std::move(track->hotCues[(size_t) index]));
+    }
+
+    //The swap happens in getNextAudioBlock at the start of the next block
+    trackSlot.queueTrack(std::move(track));
+}
+
+//Function to check if an asynchronous load is in progress
+bool DJAudioplayer::isLoading() const {
+    return loading.load();
+}
+
+//Function to get the progress of the current asynchronous load
+float DJAudioplayer::getLoadProgress() const {
+    return loadProgress.load();
+}
+
+//Function to get how long the last load took
+double DJAudioplayer::getLastLoadTimeMs() const {
+    return lastLoadTimeMs.load();
+}
+
 //Function to set the audio playback volume
 void DJAudioplayer::setGain(double gain) {
     //Ensure the gain value is within the valid range
@@ -131,8 +389,8 @@ void DJAudioplayer::setGain(double gain) {
         std::cout << "DJAudioplayer::setGain gain should be between 0 and 1" << std::endl;
     }
     else {
-        //Set the gain for the audio transport source
-        transportSource.setGain(gain);
+        //Publish the deck gain, the audio thread ramps to it
+        parameters.setTarget(DeckParameters::gain, (float) gain);
     }
 }
 
@@ -144,7 +402,9 @@ void DJAudioplayer::setSpeed(double ratio) {
         std::cout << "Speed must be between 0.5x and 2.0x" << std::endl;
     } else {
         //Set the resampling ratio to adjust playback speed
-        resampleSource.setResamplingRatio(ratio);
+        playbackSpeed = ratio;
+        //Applied at the next block; a synced deck keeps the clock's speed, it goes back to this one when sync is switched off
+        ratioDirty = true;
         //Print the newly set speed ratio
         std::cout << "Speed set to: " << ratio << "x" << std::endl;
     }
@@ -152,7 +412,11 @@ void DJAudioplayer::setSpeed(double ratio) {
 
 //Function to set playback position in seconds
 void DJAudioplayer::setPosition(double posInsecs){
-    transportSource.setPosition(posInsecs);
+    //Positions are counted at the track's own sample rate
+    transportSource.setNextReadPosition((int64) (posInsecs * trackSlot.getTrackSampleRate()));
+    //Don't play out audio the resampler and time-stretcher buffered from before the jump
+    resampleSource.requestReset();
+    timeStretchSource.requestReset();
 }
 
 //Function to set playback position relative to track length
@@ -163,9 +427,9 @@ void DJAudioplayer::setPositionRelative(double pos){
         std::cout << "DJAudioplayer::setGain pos should be between 0 and 1" << std::endl;
     }
     else {
-        std::cout << "Setting Position: " << pos << " (Seconds: " << transportSource.getLengthInSeconds() * pos << ")" << std::endl;
+        std::cout << "Setting Position: " << pos << " (Seconds: " << getLengthInSeconds() * pos << ")" << std::endl;
         //Calculate the actual position in seconds based on track length
-        double posInSecs = transportSource.getLengthInSeconds() * pos;
+        double posInSecs = getLengthInSeconds() * pos;
         //Set the playback position using the time
         setPosition(posInSecs);
     }
@@ -173,21 +437,29 @@ void DJAudioplayer::setPositionRelative(double pos){
 
 //Function to start audio playback
 void DJAudioplayer::start() {
+    //Drop the silence buffered while stopped so the track starts on the very next sample
+    if (! transportSource.isPlaying()) {
+        resampleSource.requestReset();
+        timeStretchSource.requestReset();
+    }
     transportSource.start();
+    //A braked platter spins up again
+    scratchEngine.resume(Time::getMillisecondCounterHiRes());
 }
 
 //Function to stop audio playback
 void DJAudioplayer::stop() {
     transportSource.stop();
+    scratchEngine.resume(Time::getMillisecondCounterHiRes());
 }
 
-//Function to get the current playback position relative to track length
+//Function to get the playback position being heard relative to track length
 double DJAudioplayer::getPositionRelative() {
-    //Get the total length of the track in seconds
-    double length = transportSource.getLengthInSeconds();
+    //Get the total length of the track in samples
+    double length = (double) trackSlot.getTotalLength();
     //Calculate the relative position as a fraction of the totaol length
     if (length > 0) {
-        double pos = transportSource.getCurrentPosition() / length;
+        double pos = (double) getAudiblePosition() / length;
         //Ensure the returned value is clamped between 0 and 1
         return jlimit(0.0, 1.0, pos);
     }
@@ -195,89 +467,631 @@ double DJAudioplayer::getPositionRelative() {
     return 0.0;
 }
 
-//Function to apply pitch bending using the jog wheel
-void DJAudioplayer::pitchBend(double jogAmount)
+//Function to set a pad's cue where the deck is playing now and decode the audio after it
+void DJAudioplayer::setHotCue(int index) {
+    auto* track = trackSlot.getLiveTrack();
+    //While a track is loading the live one is about to go, so its positions mean nothing
+    if (track == nullptr || isLoading() || ! isPositiveAndBelow(index, HotCues::numCues))
+        return;
+
+    double seconds = (double) getAudiblePosition() / track->sampleRate;
+    hotCues.set(index, seconds);
+    auto decodeId = ++hotCueDecodeIds[(size_t) index];
+
+    //The cue works straight away by seeking the read-ahead, and plays from memory once the audio after it is decoded
+    auto cue = std::make_unique<HotCue>();
+    cue->track = track;
+    cue->position = TrackLoader::getCuePosition(*track, seconds);
+    trackSlot.setHotCue(index, std::move(cue));
+
+    WeakReference<DJAudioplayer> safeThis(this);
+
+    trackLoader.decodeHotCueAsync(*track, seconds, hotCuePreDecodeSeconds,
+        [safeThis, index, decodeId] (std::unique_ptr<HotCue> cue)
+        {
+            //The deck was deleted, or the pad was set again or cleared since, which loading a new track always does
+            if (safeThis == nullptr || safeThis->hotCueDecodeIds[(size_t) index] != decodeId)
+                return;
+
+            safeThis->trackSlot.setHotCue(index, std::move(cue));
+        });
+    std::cout << "Hot cue " << index + 1 << " set at " << seconds << " s" << std::endl;
+}
+
+//Function to clear a pad's cue
+void DJAudioplayer::clearHotCue(int index) {
+    hotCues.clear(index);
+    ++hotCueDecodeIds[(size_t) index];
+    trackSlot.setHotCue(index, nullptr);
+}
+
+//Function to jump to a pad's cue at the next block, starting the deck if it is stopped
+void DJAudioplayer::triggerHotCue(int index) {
+    if (! hotCues.isSet(index))
+        return;
+
+    hotCueTriggerMs = Time::getMillisecondCounterHiRes();
+    pendingHotCue = index;
+
+    if (! transportSource.isPlaying())
+        start();
+}
+
+//Function to get the cues of the track loaded last
+const HotCues& DJAudioplayer::getHotCues() const {
+    return hotCues;
+}
+
+//Function to jump to a cue on the audio thread. The resampler and time-stretcher drop what they buffered from before
+//the jump, so the cue isn't heard late; the deck's read-ahead seeks past the cue's decoded audio while it plays
+void DJAudioplayer::jumpToHotCue(int index) noexcept {
+    bool fromMemory = false;
+    if (! trackSlot.jumpToHotCue(index, fromMemory))
+        return;
+
+    resampleSource.requestReset();
+    timeStretchSource.requestReset();
+
+    unheardHotCueTriggerMs = hotCueTriggerMs.load();
+    unheardHotCueFromMemory = fromMemory;
+}
+
+//Function to report a cue's latency: the wait for this block, then the block itself and, with key lock, the
+//time-stretcher's delay before the cue's first sample comes out
+void DJAudioplayer::reportHotCueLatency(int numSamples) noexcept {
+    double pipelineSamples = numSamples + (timeStretchSource.isEnabled() ? timeStretchSource.getLatencyInSamples() : 0);
+    double latencyMs = Time::getMillisecondCounterHiRes() - unheardHotCueTriggerMs + pipelineSamples * 1000.0 / lastSampleRate;
+
+    CallbackProfiler::recordHotCue(latencyMs, unheardHotCueFromMemory);
+    unheardHotCueTriggerMs = -1.0;
+}
+
+//Function to put a hand on the platter
+void DJAudioplayer::touchPlatter(double timeMs)
+{
+    scratchEngine.touch(timeMs);
+}
+
+//Function to move the platter at a speed
+void DJAudioplayer::movePlatter(double speed, double timeMs)
+{
+    scratchEngine.move(speed, timeMs);
+}
+
+//Function to let go of the platter
+void DJAudioplayer::releasePlatter(double timeMs)
+{
+    scratchEngine.release(timeMs);
+}
+
+//Function to play the deck backwards or forwards again
+void DJAudioplayer::setReverse(bool shouldReverse)
+{
+    reversed = shouldReverse;
+    scratchEngine.setReverse(shouldReverse, Time::getMillisecondCounterHiRes());
+}
+
+//Function to check if the deck plays backwards
+bool DJAudioplayer::isReversed() const
+{
+    return reversed.load();
+}
+
+//Function to stop the platter like a turntable switched off
+void DJAudioplayer::brake()
+{
+    scratchEngine.brake(Time::getMillisecondCounterHiRes());
+}
+
+//Function to flick the platter backwards and let it run down
+void DJAudioplayer::spinBack()
+{
+    scratchEngine.spinBack(Time::getMillisecondCounterHiRes());
+}
+
+//Function to check if the platter is being scratched
+bool DJAudioplayer::isScratching() const
+{
+    return scratchEngine.isActive();
+}
+
+//Functions to get how long platter moves took to be heard
+double DJAudioplayer::getScratchLatencyMs() const
+{
+    return scratchEngine.getLastLatencyMs();
+}
+
+double DJAudioplayer::getWorstScratchLatencyMs() const
+{
+    return scratchEngine.getWorstLatencyMs();
+}
+
+//Function to render a scratched, reversed or braked block straight from the slot at the platter's speed for each
+//sample. The resampler, time-stretcher and transport are bypassed, so the platter plays even with the deck stopped
+//and key lock doesn't hold the pitch; they start again from where the platter left the track once it has eased back
+bool DJAudioplayer::renderScratch(const AudioSourceChannelInfo& bufferToFill) noexcept
 {
-    //Adjusting speed dynamically based on jog wheel movement
-    double newSpeed = 1.0 + (jogAmount * 0.5);
-    //Ensure speed stays within the allowed range
-    resampleSource.setResamplingRatio(jlimit(0.5, 2.0, newSpeed));
+    if (bufferToFill.numSamples > (int) scratchRates.size())
+        return false;
+
+    double trackRate = trackSlot.getTrackSampleRate();
+    double rateCorrection = (trackRate > 0 && lastSampleRate > 0) ? trackRate / lastSampleRate : 1.0;
+
+    //The speed the deck plays at by itself, from the slider or the clock; a released platter eases back to it
+    double deckSpeed = transportSource.isPlaying()
+                         ? timeStretchSource.getTempo() * resampleSource.getResamplingRatio() / rateCorrection
+                         : 0.0;
+
+    if (! scratchEngine.getSpeeds(bufferToFill.numSamples, deckSpeed, scratchRates.data()))
+    {
+        if (trackSlot.isVarispeed())
+        {
+            //Drop what the resampler and time-stretcher held from before the platter was touched
+            trackSlot.stopVarispeed();
+            resampleSource.requestReset();
+            timeStretchSource.requestReset();
+        }
+
+        return false;
+    }
+
+    //Start from the sample coming out next, not the one the read-ahead has got to
+    if (! trackSlot.isVarispeed())
+        trackSlot.startVarispeed(getOutputPosition());
+
+    FloatVectorOperations::multiply(scratchRates.data(), (float) rateCorrection, bufferToFill.numSamples);
+    trackSlot.readVarispeed(bufferToFill, scratchRates.data());
+    scratchRate = scratchRates[(size_t) bufferToFill.numSamples - 1];
+    return true;
 }
 
 //Function for the wet/dry mix ratio for the reverb effect
 void DJAudioplayer::setWetDry(double ratio)
 {
-    //If ratio is out of valid range or hasn't changed, return early to avoid redundant updates
-    if (ratio < 0.0 || ratio > 1.0 || ratio == wetDry)
+    //If ratio is out of valid range, ignore it
+    if (ratio < 0.0 || ratio > 1.0)
         return;
 
-    //Update the wet/dry mix ratio for reverb effect
-    wetDry = ratio;
+    //Publish the wet/dry mix ratio, the audio thread smooths towards it
+    parameters.setTarget(DeckParameters::wetDry, (float) ratio);
 }
 
-//Function to adjusts the treble EQ gain and updates the high shelf filters
-void DJAudioplayer::setTrebleGain(double newTrebleGain)
+//Function to load an impulse response for the current sample rate and convolve with it once it is built
+void DJAudioplayer::setImpulseResponse(const File& file, ImpulseResponseLibrary& library, std::function<void(bool)> onLoaded)
+{
+    requestImpulseResponse(file, library, std::move(onLoaded));
+}
+
+//Function to build a response on the library's worker, the reverb keeps the one it has until the new one is ready
+void DJAudioplayer::requestImpulseResponse(const File& file, ImpulseResponseLibrary& library, std::function<void(bool)> onLoaded)
 {
-    //If the value hasn't changed, return to avoid unnecessary recalculations
-    if (newTrebleGain == trebleGain) return;
+    auto requestId = ++impulseResponseRequestId;
+    impulseResponsePending = true;
 
-    //Convert slider value to decibels and then to a gain factor
-    trebleGain = newTrebleGain;
-    double dB = trebleGain * 12.0;
-    double gainFactor = std::pow(10.0, dB / 20.0);
+    WeakReference<DJAudioplayer> safeThis(this);
+    auto* libraryToUse = &library;
 
-    //Update high-shelf filter coefficients for treble adjustment
-    auto coeffs = juce::IIRCoefficients::makeHighShelf(lastSampleRate, 3000.0, 0.707, gainFactor);
-    highShelfFilterLeft.setCoefficients(coeffs);
-    highShelfFilterRight.setCoefficients(coeffs);
+    library.getAsync(file, lastSampleRate, [safeThis, requestId, file, libraryToUse, onLoaded] (ImpulseResponse::Ptr impulseResponse)
+    {
+        //The deck was deleted, or another response or the built-in reverb was asked for since
+        if (safeThis == nullptr || safeThis->impulseResponseRequestId != requestId)
+            return;
+
+        safeThis->impulseResponsePending = false;
+
+        if (impulseResponse != nullptr)
+        {
+            //The device changed rate while it was being built, build it again for the new one
+            if (impulseResponse->getSampleRate() != safeThis->lastSampleRate)
+            {
+                safeThis->requestImpulseResponse(file, *libraryToUse, onLoaded);
+                return;
+            }
+
+            safeThis->impulseResponseLibrary = libraryToUse;
+            safeThis->impulseResponseFile = file;
+            safeThis->convolution.setImpulseResponse(impulseResponse);
+        }
+
+        if (onLoaded != nullptr)
+            onLoaded(impulseResponse != nullptr);
+    });
 }
 
-//Function to adjust the bass effect and updates the low pass filters
-void DJAudioplayer::setBass(double newBass)
+//Function to go back to the built-in reverb
+void DJAudioplayer::clearImpulseResponse()
 {
-    //If the bass value hasn't changed, avoid recalculating
-    if (newBass == bassValue) return;
+    //A response still being built is no longer wanted
+    ++impulseResponseRequestId;
+    impulseResponsePending = false;
+    impulseResponseLibrary = nullptr;
+    impulseResponseFile = File();
+    convolution.setImpulseResponse(nullptr);
+}
 
-    //Map slider value to cutoff frequency for bass filter
-    bassValue = newBass;
-    double cutoffFrequency = 200.0 + ((bassValue + 1.0) / 2.0) * (19800.0);
+//Function to name the impulse response in use
+String DJAudioplayer::getImpulseResponseName() const
+{
+    auto impulseResponse = convolution.getImpulseResponse();
+    return impulseResponse != nullptr ? impulseResponse->getName() : String();
+}
 
-    //Set the low-pass filter coefficients based on the cutoff frequency
-    auto coeffs = juce::IIRCoefficients::makeLowPass(lastSampleRate, cutoffFrequency);
-    bassFilterLeft.setCoefficients(coeffs);
-    bassFilterRight.setCoefficients(coeffs);
+//Function to adjusts the treble EQ gain, the high shelf filters follow it on the audio thread
+void DJAudioplayer::setTrebleGain(double newTrebleGain)
+{
+    //Only the knob position is published, coefficients come from the precomputed table
+    parameters.setTarget(DeckParameters::treble, (float) newTrebleGain);
 }
 
-//Function to adjusts the mid EQ gain updates the band-pass filters for left and right channels.
-void DJAudioplayer::setMid(double midGain)
+//Function to adjust the bass effect, the low pass filters follow it on the audio thread
+void DJAudioplayer::setBass(double newBass)
 {
-    //If the mid EQ gain hasn't changed, return early
-    if (midGain == midGainFactor) return;
+    //Only the knob position is published, coefficients come from the precomputed table
+    parameters.setTarget(DeckParameters::bass, (float) newBass);
+}
 
+//Function to adjusts the mid EQ gain applied by the band-pass stage
+void DJAudioplayer::setMid(double midGain)
+{
     //Convert mid gain from slider value to dB and then to linear gain factor
-    midGainFactor = static_cast<float>(std::pow(10.0, (midGain * 12.0) / 20.0));
-
-    // Set bandpass filter for mid frequencies (~1000 Hz) and apply the gain
-    auto coeffs = juce::IIRCoefficients::makeBandPass(lastSampleRate, 1000.0, 0.707);
-    midFilterLeft.setCoefficients(coeffs);
-    midFilterRight.setCoefficients(coeffs);
+    parameters.setTarget(DeckParameters::mid, (float) std::pow(10.0, (midGain * 12.0) / 20.0));
 }
 
 //Function to get the total length of the track in seconds
 double DJAudioplayer::getLengthInSeconds() const {
-    //Return the total duration of the track
-    return transportSource.getLengthInSeconds();
+    //Return the total duration of the most recently loaded track
+    return loadedLengthInSeconds.load();
 }
 
-//Function to enable and diaable looping
+//Function to enable and diaable looping of the whole track, through the loop engine so the wrap is sample accurate
 void DJAudioplayer::setLooping(bool shouldLoop) {
-    //Set the looping state based on the boolean
-    looping = shouldLoop;
-    std::cout << "Looping is now: " << (looping ? "Enabled" : "Disabled") << std::endl;
+    if (shouldLoop)
+        setLoop(0.0, getLengthInSeconds());
+    else
+        exitLoop();
+
+    std::cout << "Looping is now: " << (shouldLoop ? "Enabled" : "Disabled") << std::endl;
 }
 
 //Function to check if looping is enabled
 bool DJAudioplayer::isLooping() const {
     //Return the current looping state
-    return looping;
+    return isLoopActive();
+}
+
+//Function to mark the loop-in point at the position that is playing now
+void DJAudioplayer::setLoopIn() {
+    loopInPosition = getAudiblePosition();
+}
+
+//Function to close the loop at the position that is playing now and start looping
+void DJAudioplayer::setLoopOut() {
+    if (loopInPosition < 0)
+        return;
+
+    auto loopOut = getAudiblePosition();
+
+    //Loop out before loop in just swaps them round
+    if (loopOut < loopInPosition)
+        std::swap(loopOut, loopInPosition);
+
+    makeLoop(loopInPosition, loopOut);
+    loopInPosition = -1;
+}
+
+//Function to loop between two points given in seconds
+void DJAudioplayer::setLoop(double startSeconds, double endSeconds) {
+    double trackRate = trackSlot.getTrackSampleRate();
+    if (trackRate <= 0)
+        return;
+
+    makeLoop((int64) (startSeconds * trackRate), (int64) (endSeconds * trackRate));
+}
+
+//Function to loop a number of beats from the position that is playing now
+void DJAudioplayer::setBeatLoop(double numBeats, double beatsPerMinute) {
+    double trackRate = trackSlot.getTrackSampleRate();
+    if (trackRate <= 0 || numBeats <= 0 || beatsPerMinute <= 0)
+        return;
+
+    auto start = getAudiblePosition();
+    makeLoop(start, start + (int64) (numBeats * 60.0 / beatsPerMinute * trackRate));
+}
+
+//Function to stop looping, playback carries on through the loop end
+void DJAudioplayer::exitLoop() {
+    loopInPosition = -1;
+    loopStart = -1;
+    loopEnd = -1;
+    ++loopDecodeId;
+    trackSlot.setLoop(nullptr);
+}
+
+//Function to halve the loop, keeping its start
+void DJAudioplayer::halveLoop() {
+    if (! isLoopActive())
+        return;
+
+    makeLoop(loopStart, loopStart + jmax(minLoopLength, (loopEnd - loopStart) / 2));
+}
+
+//Function to double the loop, keeping its start
+void DJAudioplayer::doubleLoop() {
+    if (! isLoopActive())
+        return;
+
+    makeLoop(loopStart, loopStart + (loopEnd - loopStart) * 2);
+}
+
+//Function to check if a loop is playing
+bool DJAudioplayer::isLoopActive() const {
+    return loopStart >= 0 && loopEnd > loopStart;
+}
+
+//Function to check if a loop-in point is waiting for its loop-out
+bool DJAudioplayer::isLoopInSet() const {
+    return loopInPosition >= 0;
+}
+
+//Function to get the loop start in seconds, -1 if not looping
+double DJAudioplayer::getLoopStartSeconds() const {
+    double trackRate = trackSlot.getTrackSampleRate();
+    return isLoopActive() && trackRate > 0 ? (double) loopStart / trackRate : -1.0;
+}
+
+//Function to get the loop end in seconds, -1 if not looping
+double DJAudioplayer::getLoopEndSeconds() const {
+    double trackRate = trackSlot.getTrackSampleRate();
+    return isLoopActive() && trackRate > 0 ? (double) loopEnd / trackRate : -1.0;
+}
+
+//Function to build a loop for the live track, decoding its start on the loader's worker so the audio thread can wrap
+//without the disk once it arrives
+void DJAudioplayer::makeLoop(int64 start, int64 end) {
+    auto* track = trackSlot.getLiveTrack();
+    if (track == nullptr)
+        return;
+
+    end = jmin(end, track->lengthInSamples);
+    start = jlimit((int64) 0, jmax((int64) 0, end - minLoopLength), start);
+    if (end - start < minLoopLength)
+        return;
+
+    loopStart = start;
+    loopEnd = end;
+    auto decodeId = ++loopDecodeId;
+
+    //The loop wraps straight away by seeking the read-ahead, until the one with its start decoded replaces it
+    auto loop = std::make_unique<DeckTrackSlot::LoopRegion>();
+    loop->track = track;
+    loop->start = start;
+    loop->end = end;
+    trackSlot.setLoop(std::move(loop));
+
+    //Short loops are held in memory completely, long ones just long enough for the read-ahead to catch up
+    auto preBufferLength = (int) jmin(end - start, (int64) (loopPreBufferSeconds * track->sampleRate));
+
+    WeakReference<DJAudioplayer> safeThis(this);
+
+    trackLoader.decodeRangeAsync(*track, start, preBufferLength,
+        [safeThis, decodeId, track, start, end] (AudioBuffer<float>& audio)
+        {
+            //The deck was deleted, or the loop was changed or exited since, which loading a new track always does
+            if (safeThis == nullptr || safeThis->loopDecodeId != decodeId)
+                return;
+
+            auto decodedLoop = std::make_unique<DeckTrackSlot::LoopRegion>();
+            decodedLoop->track = track;
+            decodedLoop->start = start;
+            decodedLoop->end = end;
+            decodedLoop->startAudio = std::move(audio);
+            safeThis->trackSlot.setLoop(std::move(decodedLoop));
+        });
+}
+
+//Function to get the track position of the next sample out, allowing for the audio buffered in the resampler and
+//the time-stretcher. The stretcher's input comes from the resampler, so its latency is in the resampler's output
+//samples and is scaled to track samples by the resampling ratio
+int64 DJAudioplayer::getOutputPosition() const {
+    //Scratched blocks come straight from the slot
+    if (trackSlot.isVarispeed())
+        return trackSlot.getNextReadPosition();
+
+    auto latency = (int64) (timeStretchSource.getLatencyInSamples() * resampleSource.getResamplingRatio())
+                 + resampleSource.getLatencyInSamples();
+
+    return jmax((int64) 0, trackSlot.getNextReadPosition() - latency);
+}
+
+//Function to get the track position being heard: the next sample out goes through the mixer, the limiter and the
+//device before it is heard, and the deck moves on by the speed it plays at in the meantime
+int64 DJAudioplayer::getAudiblePosition() const {
+    auto downstream = (int64) std::round(outputLatency.load() * getTrackSamplesPerOutputSample());
+    return jlimit((int64) 0, jmax((int64) 0, trackSlot.getTotalLength()), getOutputPosition() - downstream);
+}
+
+//Function to get how fast the deck moves through the track, from the platter while scratched
+double DJAudioplayer::getTrackSamplesPerOutputSample() const {
+    if (trackSlot.isVarispeed())
+        return scratchRate.load();
+
+    if (! transportSource.isPlaying())
+        return 0.0;
+
+    return resampleSource.getResamplingRatio() * (timeStretchSource.isEnabled() ? timeStretchSource.getTempo() : 1.0);
+}
+
+//Function to set the latency after the deck
+void DJAudioplayer::setOutputLatency(int numSamples) {
+    outputLatency = jmax(0, numSamples);
+}
+
+//Function to get the latency after the deck
+int DJAudioplayer::getOutputLatency() const {
+    return outputLatency.load();
+}
+
+//Function to list the deck's stages and their latency in samples at the device rate. The resampler and the
+//time-stretcher hold input samples, which play out faster or slower than the device rate with the speed
+PipelineLatency DJAudioplayer::getLatencyReport() const {
+    PipelineLatency report(lastSampleRate);
+    bool scratched = trackSlot.isVarispeed();
+    double tempo = timeStretchSource.isEnabled() ? timeStretchSource.getTempo() : 1.0;
+    double ratio = resampleSource.getResamplingRatio();
+
+    report.add("resampler", scratched ? 0.0 : resampleSource.getLatencyInSamples() / ratio / tempo);
+    report.add("time-stretch", scratched ? 0.0 : timeStretchSource.getLatencyInSamples() / tempo);
+    report.add("reverb", convolution.getLatencyInSamples());
+    report.add("EQ", eqCascade.getLatencyInSamples());
+    report.add("effects", fxRack.getLatencyInSamples());
+    return report;
+}
+
+//Function to set how many samples are decoded ahead of the playhead
+void DJAudioplayer::setReadAheadSize(int numSamples) {
+    //Keep at least a few device blocks of read-ahead
+    readAheadSamples = jmax(1024, numSamples);
+}
+
+//Function to set how much of a track is decoded before it goes live
+void DJAudioplayer::setPreDecodeSeconds(double seconds) {
+    preDecodeSeconds = jmax(0.0, seconds);
+}
+
+//Function to get the read-ahead size used for newly loaded tracks
+int DJAudioplayer::getReadAheadSize() const {
+    return readAheadSamples;
+}
+
+//Function to choose whether new tracks are decoded into the shared RAM cache or streamed from disk
+void DJAudioplayer::setUseTrackCache(bool shouldUseCache) {
+    useTrackCache = shouldUseCache;
+}
+
+//Function to check if new tracks go through the RAM cache
+bool DJAudioplayer::isUsingTrackCache() const {
+    return useTrackCache;
+}
+
+//Function to get the number of underruns of the current track's read-ahead buffer
+int DJAudioplayer::getNumBufferUnderruns() const {
+    return trackSlot.getNumBufferUnderruns();
+}
+
+//Function to set the resampling ratio, tracks at a different sample rate to the device are corrected here.
+//With key lock on the speed goes to the time-stretcher instead so the pitch stays the same
+void DJAudioplayer::updateResamplingRatio(double speed) {
+    double trackRate = trackSlot.getTrackSampleRate();
+    double rateCorrection = (trackRate > 0 && lastSampleRate > 0) ? trackRate / lastSampleRate : 1.0;
+
+    if (timeStretchSource.isEnabled()) {
+        resampleSource.setResamplingRatio(rateCorrection);
+        timeStretchSource.setTempo(speed);
+    } else {
+        resampleSource.setResamplingRatio(speed * rateCorrection);
+        timeStretchSource.setTempo(1.0);
+    }
+}
+
+//Function to turn key lock on or off, the audio thread moves the speed between the resampler and the time-stretcher
+//at the next block
+void DJAudioplayer::setKeyLock(bool shouldLockKey) {
+    keyLockWanted = shouldLockKey;
+    ratioDirty = true;
+    std::cout << (shouldLockKey ? "Key lock enabled" : "Key lock disabled") << std::endl;
+}
+
+//Function to check if key lock is on
+bool DJAudioplayer::isKeyLocked() const {
+    return keyLockWanted.load();
+}
+
+//Function to choose the time-stretch algorithm used while key lock is on
+void DJAudioplayer::setKeyLockQuality(TimeStretchSource::Quality quality) {
+    timeStretchSource.setQuality(quality);
+}
+
+//Function to get the time-stretch algorithm
+TimeStretchSource::Quality DJAudioplayer::getKeyLockQuality() const {
+    return timeStretchSource.getQuality();
+}
+
+//Function to choose the interpolator used by the resampler, switching is click-free while playing
+void DJAudioplayer::setResamplerQuality(DeckResamplerSource::Quality quality) {
+    resampleSource.setQuality(quality);
+}
+
+//Function to get the interpolator used by the resampler
+DeckResamplerSource::Quality DJAudioplayer::getResamplerQuality() const {
+    return resampleSource.getQuality();
+}
+
+//Function to connect the deck to the clock the mixer moves on
+void DJAudioplayer::setMasterClock(MasterClock* clockToUse, int deckNumber) {
+    masterClock = clockToUse;
+    masterClockDeck = deckNumber;
+}
+
+//Function to follow the clock or go back to the speed slider
+void DJAudioplayer::setSync(bool shouldSync) {
+    synced = shouldSync;
+    std::cout << (shouldSync ? "Sync enabled" : "Sync disabled") << std::endl;
+}
+
+//Function to check if the deck follows the clock
+bool DJAudioplayer::isSynced() const {
+    return synced.load();
+}
+
+//Function to get the last beat error against the clock
+double DJAudioplayer::getSyncErrorMs() const {
+    return syncErrorMs.load();
+}
+
+//Function to find the beat being heard from the live track's grid
+bool DJAudioplayer::getAudibleBeat(double& beat, double& trackBpm) const noexcept {
+    auto* track = trackSlot.getLiveTrack();
+    if (track == nullptr || ! track->beatGrid.hasTempo() || track->sampleRate <= 0)
+        return false;
+
+    trackBpm = track->beatGrid.bpm;
+    beat = track->beatGrid.getBeatAt((double) getAudiblePosition() / track->sampleRate);
+    return true;
+}
+
+//Function to run the deck at the clock's tempo, sped up or slowed down in proportion to how far its beat is out.
+//The correction is small and continuous, so the deck slides into phase instead of jumping
+void DJAudioplayer::followMasterClock() noexcept {
+    double clockBpm = masterClock->getBpm();
+    double beat = 0.0, trackBpm = 0.0;
+
+    if (! synced.load() || ! transportSource.isPlaying() || clockBpm <= 0.0 || ! getAudibleBeat(beat, trackBpm)) {
+        if (wasFollowing)
+            updateResamplingRatio(playbackSpeed.load());
+
+        wasFollowing = false;
+        syncErrorMs = 0.0;
+        return;
+    }
+
+    //A track at half or double the clock's tempo plays two beats to its one, or one to its two
+    double tempoRatio = clockBpm / trackBpm;
+    double beatsPerClockBeat = std::exp2(-std::round(std::log2(tempoRatio)));
+
+    //Only the phase within a beat matters, so the deck is never more than half a beat out
+    double error = masterClock->getBeat() * beatsPerClockBeat - beat;
+    error -= std::round(error);
+    double errorSeconds = error * 60.0 / (trackBpm * tempoRatio * beatsPerClockBeat);
+    syncErrorMs = errorSeconds * 1000.0;
+
+    double correction = jlimit(-maxSyncCorrection, maxSyncCorrection, errorSeconds / syncResponseSeconds);
+    updateResamplingRatio(tempoRatio * beatsPerClockBeat * (1.0 + correction));
+    wasFollowing = true;
+}
+
+//Function to offer the clock this deck's beat and tempo while it plays a track with a grid
+void DJAudioplayer::offerLead() noexcept {
+    double beat = 0.0, trackBpm = 0.0;
+    if (transportSource.isPlaying() && getAudibleBeat(beat, trackBpm))
+        masterClock->offerLead(masterClockDeck, beat, trackBpm * playbackSpeed.load());
 }
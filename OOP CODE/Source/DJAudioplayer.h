@@ -1,13 +1,24 @@
 #pragma once
 
 #include "../JuceLibraryCode/JuceHeader.h"
+#include "TrackLoader.h"
+#include "DeckTrackSlot.h"
+#include "DeckParameters.h"
+#include "StereoBiquadCascade.h"
+#include "TimeStretchSource.h"
+#include "DeckResamplerSource.h"
+#include "ConvolutionReverb.h"
+#include "DeckFxRack.h"
+#include "MasterClock.h"
+#include "ScratchEngine.h"
+#include "PipelineLatency.h"
 
 //DJAudioplayer class that handles audio playback, effects, and control
 class DJAudioplayer : public AudioSource{
     
 public:
-    //Constructor: Takes an AudioFormatManager reference for handling file formats
-    DJAudioplayer(AudioFormatManager& _formatManager);
+    //Constructor: Takes the loader shared by all decks for opening and pre-decoding tracks
+    DJAudioplayer(TrackLoader& _trackLoader);
     //Destructor: Cleans up resources
     ~DJAudioplayer();
     
@@ -18,8 +29,18 @@ public:
     //Releases resources when playback stops
     void releaseResources() override;
     
-    //Load an audio file from a given URL
-    void loadURL(URL audioURL);
+    //Load an audio file from a given URL, blocking until it is ready; the beat grid and hot cues go live with the track
+    void loadURL(URL audioURL, const BeatGrid& beatGrid = {}, const HotCues& cues = {});
+    //Load an audio file on a worker thread; the track goes live at the next audio block and
+    //onLoaded is called on the message thread with a reader for the waveform (null if loading failed)
+    void loadURLAsync(URL audioURL, std::function<void(std::unique_ptr<AudioFormatReader>)> onLoaded = nullptr,
+                      const BeatGrid& beatGrid = {}, const HotCues& cues = {});
+    //Check if an asynchronous load is still running
+    bool isLoading() const;
+    //Get the progress of the current asynchronous load from 0 to 1
+    float getLoadProgress() const;
+    //Get how long the last load took in milliseconds
+    double getLastLoadTimeMs() const;
     
     //Audio control functions
     //Set the volume level
@@ -36,16 +57,78 @@ public:
     //Stop playback
     void stop();
     
-    //Get the current position relative to track length
+    //Get the position being heard relative to track length, allowing for the latency of the whole path
     double getPositionRelative();
+
+    //Latency: every stage of the deck declares how far its output lags behind what it has read, and the deck is told
+    //the latency of what comes after it, the mixer, the master limiter and the device, in samples at the device rate.
+    //The position reported, the beat synced on and the cues and loops set are then all the ones being heard
+    void setOutputLatency(int numSamples);
+    int getOutputLatency() const;
+    //Any thread: the deck's own stages in signal order, in samples at the device rate at the current speed
+    PipelineLatency getLatencyReport() const;
+
+    //Hot cues: the audio after each cue is decoded and kept in memory, so a jump never waits for the disk
+    //Set a pad's cue at the position playing now, or clear it
+    void setHotCue(int index);
+    void clearHotCue(int index);
+    //Jump to a pad's cue, starting playback if stopped; the cue's first sample is the first of the next block
+    void triggerHotCue(int index);
+    //The cues of the track loaded last, for the pads and the library
+    const HotCues& getHotCues() const;
     
-    //void jogScrub(double jogAmount);
-    //Temporarily change pitch for pitch bending effect
-    void pitchBend(double jogAmount);
+    //Scratching: the jog wheel's platter is touched, moved at a speed (1 is normal speed forwards, negative plays
+    //backwards) and let go, each at a time on the Time::getMillisecondCounterHiRes clock. The audio thread follows
+    //the platter sample by sample one block later, and eases back to the deck's speed after the release
+    void touchPlatter(double timeMs);
+    void movePlatter(double speed, double timeMs);
+    void releasePlatter(double timeMs);
+    //Platter modes, heard one block later and read from memory either way, so they don't drop out on compressed files.
+    //Reverse plays the deck backwards at its speed until it is switched off. Brake slows the platter to a stop and
+    //spin-back flicks it backwards and lets it run down; both leave it parked until the deck is started or stopped
+    void setReverse(bool shouldReverse);
+    bool isReversed() const;
+    void brake();
+    void spinBack();
+    //Whether the platter is held, easing back, reversed or braked
+    bool isScratching() const;
+    //How long after the hand moved the last platter move was heard, and the slowest since the device started
+    double getScratchLatencyMs() const;
+    double getWorstScratchLatencyMs() const;
+
+    //Keep the pitch when the speed changes (key lock)
+    void setKeyLock(bool shouldLockKey);
+    bool isKeyLocked() const;
+    //Choose the time-stretch quality used by key lock, see TimeStretchSource for the cost of each
+    void setKeyLockQuality(TimeStretchSource::Quality quality);
+    TimeStretchSource::Quality getKeyLockQuality() const;
+    //Choose the interpolator used for speed changes, see DeckResamplerSource for the cost of each
+    void setResamplerQuality(DeckResamplerSource::Quality quality);
+    DeckResamplerSource::Quality getResamplerQuality() const;
+
+    //Beat sync: connects the deck to the clock the mixer moves on, under its mixer deck number; call before the device starts
+    void setMasterClock(MasterClock* clockToUse, int deckNumber);
+    //A synced deck matches the clock's tempo and beat by steering its speed inside the audio callback, the speed slider
+    //takes over again when sync is switched off. A deck that isn't synced offers to lead the clock while it plays
+    void setSync(bool shouldSync);
+    bool isSynced() const;
+    //How far the deck's beat was behind the clock's at the last block, in milliseconds, 0 while it isn't following
+    double getSyncErrorMs() const;
     
     
     //Sets the wet/dry mix ratio for the reverb effect
     void setWetDry(double ratio);
+    //Switch the reverb to convolution with an impulse response from a file, shared through the library. The response
+    //is built on the library's worker and swapped in when it is ready; onLoaded is told on the message thread whether
+    //the file opened, and isn't called if another response was asked for first
+    void setImpulseResponse(const File& file, ImpulseResponseLibrary& library,
+                            std::function<void(bool loaded)> onLoaded = nullptr);
+    //Go back to the built-in reverb
+    void clearImpulseResponse();
+    //Name of the impulse response in use, empty for the built-in reverb
+    String getImpulseResponseName() const;
+    //Effects after the EQ, switched, ordered and set from the message thread while the deck plays
+    DeckFxRack& getFxRack() { return fxRack; }
     //Adjusts the treble EQ gain
     void setTrebleGain(double newTrebleGain);
     //setBass: Adjusts the bass effect
@@ -56,40 +139,200 @@ public:
     //Get the total length of the track in seconds
     double getLengthInSeconds() const;
 
-    //Enable or disable track looping
+    //Enable or disable looping of the whole track
     void setLooping(bool shouldLoop);
     bool isLooping() const;            
 
+    //Loop engine: loops wrap at the exact sample and the loop start is decoded in advance
+    //Mark the loop-in point at the current position
+    void setLoopIn();
+    //Mark the loop-out point at the current position and start looping
+    void setLoopOut();
+    //Loop between two points in seconds
+    void setLoop(double startSeconds, double endSeconds);
+    //Loop a number of beats from the current position
+    void setBeatLoop(double numBeats, double beatsPerMinute);
+    //Stop looping
+    void exitLoop();
+    //Halve or double the loop length while it plays, keeping the loop start
+    void halveLoop();
+    void doubleLoop();
+    //Loop state for the UI
+    bool isLoopActive() const;
+    bool isLoopInSet() const;
+    double getLoopStartSeconds() const;
+    double getLoopEndSeconds() const;
+
+    //Set how many seconds at the start of a track are decoded before it goes live
+    void setPreDecodeSeconds(double seconds);
+    //Set how many samples are decoded ahead of the playhead (takes effect on the next load)
+    void setReadAheadSize(int numSamples);
+    int getReadAheadSize() const;
+    //Decode new tracks fully into the shared RAM cache so seeks are instant (falls back to streaming if it has no room)
+    void setUseTrackCache(bool shouldUseCache);
+    bool isUsingTrackCache() const;
+    //Get how many audio blocks found the read-ahead buffer empty since the track was loaded
+    int getNumBufferUnderruns() const;
+
 private:
-    AudioFormatManager& formatManager;
-    //Pointer to an audio file reader source
-    std::unique_ptr<AudioFormatReaderSource> readerSource;
+    //Builds the load settings for this deck
+    TrackLoader::LoadSettings getLoadSettings(bool wantsThumbnailReader, const HotCues& cues) const;
+    //Hands a loaded track to the audio thread
+    void queueLoadedTrack(std::unique_ptr<LoadedTrack> track, const BeatGrid& beatGrid);
+    //Applies the playback speed corrected for the difference between the track and device sample rates
+    void updateResamplingRatio(double speed);
+    //Builds a loop for the live track and hands it to the audio thread
+    void makeLoop(int64 start, int64 end);
+    //Asks the library for a response at the current rate and convolves with it once it is built
+    void requestImpulseResponse(const File& file, ImpulseResponseLibrary& library, std::function<void(bool)> onLoaded);
+    //Track position of the next sample the deck puts out, allowing for what the resampler and time-stretcher hold
+    int64 getOutputPosition() const;
+    //Track position being heard right now, in samples: the next sample out less the output latency
+    int64 getAudiblePosition() const;
+    //Track samples the deck moves on per output sample, negative while a scratch plays backwards
+    double getTrackSamplesPerOutputSample() const;
+    //Audio thread: beat of the live track's grid at the audible position and the grid's tempo, false without a grid
+    bool getAudibleBeat(double& beat, double& trackBpm) const noexcept;
+    //Audio thread: sets this block's speed so the deck's beat closes on the clock's
+    void followMasterClock() noexcept;
+    //Audio thread: offers the clock the deck's beat at the start of the next block
+    void offerLead() noexcept;
+    //Audio thread: moves the playhead to a hot cue before the block is read and drops audio buffered from before it
+    void jumpToHotCue(int index) noexcept;
+    //Audio thread: reports how long a cue took to be heard once the first block from it plays
+    void reportHotCueLatency(int numSamples) noexcept;
+    //Audio thread: renders the block from the platter while it is scratched, false to play normally
+    bool renderScratch(const AudioSourceChannelInfo& bufferToFill) noexcept;
+    //Audio thread: moves the EQ cascade along with the smoothed knobs
+    void updateEqCoefficients(int numSamples) noexcept;
+    //Coefficient designers used to fill the EQ tables
+    static IIRCoefficients makeBassCoefficients(double sampleRate, double bassValue);
+    static IIRCoefficients makeTrebleCoefficients(double sampleRate, double trebleValue);
+
+    //Shared loader that opens and pre-decodes tracks
+    TrackLoader& trackLoader;
+    //Highest resampling ratio the deck can ask for: 2x speed on a track at twice the device sample rate
+    static constexpr double maxResamplingRatio = 4.0;
+
+    //Slot the transport plays from, new tracks are swapped into it at block boundaries
+    DeckTrackSlot trackSlot;
+    //Number of samples decoded ahead of the playhead
+    int readAheadSamples = 32768;
+    //Load new tracks through the RAM cache
+    bool useTrackCache = true;
+    //Seconds decoded at the start of a track before it goes live
+    double preDecodeSeconds = 3.0;
+    //Length of the most recently loaded track, valid before it goes live
+    std::atomic<double> loadedLengthInSeconds { 0.0 };
+    //Playback speed chosen by the user, before sample rate correction
+    std::atomic<double> playbackSpeed { 1.0 };
+    //Key lock as last set from the message thread, and whether the speed or key lock changed since the last block.
+    //Only the audio thread sets the resampler and the stretcher, so sync and the controls never leave them half set
+    std::atomic<bool> keyLockWanted { false };
+    std::atomic<bool> ratioDirty { false };
+
+    //Clock synced to or led, and the deck number it knows this deck by
+    MasterClock* masterClock = nullptr;
+    int masterClockDeck = -1;
+    std::atomic<bool> synced { false };
+    //Audio thread: whether the last block was steered by the clock, so the slider's speed can be put back
+    bool wasFollowing = false;
+    //Last beat error measured against the clock
+    std::atomic<double> syncErrorMs { 0.0 };
+    //Most a synced deck speeds up or slows down to catch the clock, and the time it takes to close most of a gap
+    static constexpr double maxSyncCorrection = 0.04;
+    static constexpr double syncResponseSeconds = 0.5;
+
+    //Hot cues of the track loaded last, set from the message thread
+    HotCues hotCues;
+    //How much audio after each cue is held in memory
+    static constexpr double hotCuePreDecodeSeconds = 1.0;
+    //Pad pressed on the message thread for the audio thread to jump to, -1 if none, and when it was pressed
+    std::atomic<int> pendingHotCue { -1 };
+    std::atomic<double> hotCueTriggerMs { 0.0 };
+    //Audio thread: a cue that has been jumped to but not heard yet, because the deck hadn't started
+    double unheardHotCueTriggerMs = -1.0;
+    bool unheardHotCueFromMemory = false;
+
+    //Turns the platter's moves into a speed for every sample, and the rates read at, sized in prepareToPlay
+    ScratchEngine scratchEngine;
+    std::vector<float> scratchRates;
+    //Reverse as last set from the message thread
+    std::atomic<bool> reversed { false };
+    //Track samples per output sample at the end of the last scratched block
+    std::atomic<double> scratchRate { 0.0 };
+
+    //Latency after the deck, of the mixer, the master limiter and the device
+    std::atomic<int> outputLatency { 0 };
+
+    //State of asynchronous loads, only the newest request is allowed to finish
+    int latestLoadId = 0;
+    std::atomic<bool> loading { false };
+    std::atomic<float> loadProgress { 0.0f };
+    std::atomic<double> lastLoadTimeMs { 0.0 };
+
     //Handles audio playback transport
     AudioTransportSource transportSource;
     //Handles speed adjustments
-    ResamplingAudioSource resampleSource{&transportSource, false, 2};
+    DeckResamplerSource resampleSource{&transportSource, false, maxResamplingRatio, 2};
+    //Changes tempo without changing pitch while key lock is on
+    TimeStretchSource timeStretchSource{&resampleSource, false, 2};
     
     //Stores the last used sample rate
-    double lastSampleRate;
+    double lastSampleRate = 44100.0;
     
-    //Indicates whether looping is enabled
-    bool looping = false;
+    //Loop points in track samples as last set from the message thread, -1 when not looping
+    int64 loopInPosition = -1;
+    int64 loopStart = -1;
+    int64 loopEnd = -1;
+    //Shortest loop allowed, about 1 ms at 44.1 kHz
+    static constexpr int64 minLoopLength = 64;
+    //How much of a loop's start is decoded in advance
+    static constexpr double loopPreBufferSeconds = 1.0;
+    //Counts loop changes, so a loop's start that finishes decoding after the loop changed is dropped
+    int loopDecodeId = 0;
+    //Counts changes to each pad's cue the same way
+    std::array<int, HotCues::numCues> hotCueDecodeIds {};
     
-    //Wet/dry mix ratio for reverb
-    double wetDry { 0.0 };
+    //Knob targets published by the UI and smoothed on the audio thread
+    DeckParameters parameters;
     // Reverb processor
     juce::Reverb reverb;
-    //Treble gain value
-    double trebleGain { 0.0 };
-    //Bass slider value
-    double bassValue { 0.0 };
-    float midGainFactor = 1.0f;
-    
-    // EQ filter components for left and right channels
-    juce::IIRFilter highShelfFilterLeft;
-    juce::IIRFilter highShelfFilterRight;
-    juce::IIRFilter bassFilterLeft;
-    juce::IIRFilter bassFilterRight;
-    juce::IIRFilter midFilterLeft;
-    juce::IIRFilter midFilterRight;
+    //Effects rack run after the EQ
+    DeckFxRack fxRack;
+    //Convolution reverb, used instead while an impulse response is set
+    ConvolutionReverb convolution;
+    //Where the impulse response came from, so it can be fetched again for a new sample rate
+    ImpulseResponseLibrary* impulseResponseLibrary = nullptr;
+    File impulseResponseFile;
+    //Counts requests for a response, only the newest is swapped in; pending until it arrives
+    int impulseResponseRequestId = 0;
+    bool impulseResponsePending = false;
+    //Audio thread: whether the wet path ran last block, and how long its tail rings after the input went silent
+    bool reverbWasActive = false;
+    int reverbTailRemaining = 0;
+    //How long the built-in reverb rings at its room size
+    static constexpr double builtInReverbTailSeconds = 3.0;
+    //Scratch buffer for the reverb's wet signal, sized in prepareToPlay so the audio thread never allocates
+    juce::AudioBuffer<float> wetBuffer;
+    //Bass and treble coefficients precomputed across the knob range in prepareToPlay
+    CoefficientTable bassTable;
+    CoefficientTable trebleTable;
+    //Constant mid band-pass and the current treble shelf, kept so a gain change doesn't need a table lookup
+    IIRCoefficients midCoefficients;
+    IIRCoefficients trebleCoefficients;
+    //Smoothed values the cascade was last set for
+    float appliedBass = 0.0f;
+    float appliedTreble = 0.0f;
+    float appliedMid = 1.0f;
+    float appliedGain = 1.0f;
+    //Samples between EQ coefficient updates while a knob is moving
+    static constexpr int eqSubBlockSize = 32;
+
+    //Stages of the EQ cascade, in processing order
+    enum EqStage { bassStage = 0, midStage, trebleStage, numEqStages };
+    //Bass, mid and treble filters for both channels, run in a single pass
+    StereoBiquadCascade eqCascade { numEqStages };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (DJAudioplayer)
 };
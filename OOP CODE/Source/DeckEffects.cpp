@@ -0,0 +1,304 @@
+#include "DeckEffects.h"
+
+//Constructor: Copies the knob table and starts every knob at its default
+DeckEffect::DeckEffect(std::initializer_list<ParameterInfo> parameterInfos)
+{
+    for (auto& info : parameterInfos)
+    {
+        jassert(numParameters < maxParameters);
+        infos[numParameters] = info;
+        parameters[numParameters] = info.defaultValue;
+        ++numParameters;
+    }
+}
+
+DeckEffect::~DeckEffect()
+{
+}
+
+//Function to set a knob within its range
+void DeckEffect::setParameter(int index, float value)
+{
+    if (isPositiveAndBelow(index, numParameters))
+        parameters[index] = jlimit(infos[index].minimum, infos[index].maximum, value);
+}
+
+//==============================================================================
+//Constructor: Cutoff from -1 (low-pass) through 0 (flat) to 1 (high-pass), and how much the cutoff rings
+FilterEffect::FilterEffect() : DeckEffect({ { "Cutoff", -1.0f, 1.0f, 0.0f }, { "Resonance", 0.0f, 1.0f, 0.3f } })
+{
+}
+
+//Function to make the filter sweep smoothly at this rate
+void FilterEffect::prepare(double sampleRate, int /*maximumBlockSize*/)
+{
+    currentSampleRate = sampleRate;
+    position.reset(sampleRate, 0.05);
+    position.setCurrentAndTargetValue(getParameter(cutoff));
+    appliedResonance = -1.0f;
+    reset();
+}
+
+//Function to clear the filter history
+void FilterEffect::reset() noexcept
+{
+    filter.reset();
+}
+
+//Function to design the filter for a knob position; the cutoff moves exponentially so the sweep sounds even
+IIRCoefficients FilterEffect::makeCoefficients(float knob, float resonanceAmount) const
+{
+    double q = 0.707 + 4.0 * resonanceAmount;
+    double nyquistLimit = currentSampleRate * 0.45;
+
+    //A small dead zone in the middle is truly flat
+    if (std::abs(knob) < 0.02f)
+        return IIRCoefficients(1.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+
+    if (knob < 0.0f)
+        return IIRCoefficients::makeLowPass(currentSampleRate, jmin(nyquistLimit, 20000.0 * std::pow(100.0 / 20000.0, (double) -knob)), q);
+
+    return IIRCoefficients::makeHighPass(currentSampleRate, jmin(nyquistLimit, 20.0 * std::pow(8000.0 / 20.0, (double) knob)), q);
+}
+
+//Function to filter in place, in short sub-blocks while the knob moves
+void FilterEffect::process(float* const* channels, int numChannels, int numSamples) noexcept
+{
+    position.setTargetValue(getParameter(cutoff));
+    float resonanceAmount = getParameter(resonance);
+    int step = position.isSmoothing() ? subBlockSize : numSamples;
+
+    for (int offset = 0; offset < numSamples; offset += step)
+    {
+        int numToDo = jmin(step, numSamples - offset);
+        float knob = position.skip(numToDo);
+
+        if (knob != appliedPosition || resonanceAmount != appliedResonance)
+        {
+            filter.setCoefficients(0, makeCoefficients(knob, resonanceAmount));
+            appliedPosition = knob;
+            appliedResonance = resonanceAmount;
+        }
+
+        if (numChannels > 1)
+            filter.process(channels[0] + offset, channels[1] + offset, numToDo);
+        else
+            filter.processMono(channels[0] + offset, numToDo);
+    }
+}
+
+//==============================================================================
+//Constructor: Delay time, how much of the echo comes back, and how loud the echoes are
+EchoEffect::EchoEffect() : DeckEffect({ { "Time", 10.0f, 2000.0f, 375.0f }, { "Feedback", 0.0f, 0.95f, 0.45f },
+                                        { "Mix", 0.0f, 1.0f, 0.5f } })
+{
+}
+
+//Function to make the delay line for the longest delay at this rate
+void EchoEffect::prepare(double sampleRate, int /*maximumBlockSize*/)
+{
+    currentSampleRate = sampleRate;
+    delayLine.setSize(2, (int) (maxDelaySeconds * sampleRate) + 4);
+    delaySamples.reset(sampleRate, 0.1);
+    delaySamples.setCurrentAndTargetValue((float) (getParameter(time) / 1000.0 * sampleRate));
+    reset();
+}
+
+//Function to silence the echoes
+void EchoEffect::reset() noexcept
+{
+    delayLine.clear();
+    writePosition = 0;
+}
+
+//Function to add the echoes to the deck, reading between samples while the delay time glides
+void EchoEffect::process(float* const* channels, int numChannels, int numSamples) noexcept
+{
+    int length = delayLine.getNumSamples();
+    if (length == 0)
+        return;
+
+    delaySamples.setTargetValue((float) (getParameter(time) / 1000.0 * currentSampleRate));
+    float feedbackGain = getParameter(feedback);
+    float mixGain = getParameter(mix);
+    float* lines[2] = { delayLine.getWritePointer(0), delayLine.getWritePointer(1) };
+    numChannels = jmin(numChannels, 2);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float delay = jlimit(1.0f, (float) (length - 3), delaySamples.getNextValue());
+        float readPosition = (float) writePosition - delay;
+        if (readPosition < 0.0f)
+            readPosition += (float) length;
+
+        int index = (int) readPosition;
+        float fraction = readPosition - (float) index;
+        int next = index + 1 < length ? index + 1 : 0;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float delayed = lines[channel][index] + fraction * (lines[channel][next] - lines[channel][index]);
+            float input = channels[channel][i];
+            lines[channel][writePosition] = input + feedbackGain * delayed;
+            channels[channel][i] = input + mixGain * delayed;
+        }
+
+        if (++writePosition == length)
+            writePosition = 0;
+    }
+}
+
+//==============================================================================
+//Constructor: Sweep speed, how far it sweeps, and how much comes back round
+FlangerEffect::FlangerEffect() : DeckEffect({ { "Rate", 0.05f, 5.0f, 0.25f }, { "Depth", 0.0f, 1.0f, 0.7f },
+                                              { "Feedback", -0.9f, 0.9f, 0.5f } })
+{
+}
+
+//Function to make the delay line for the longest delay of the sweep
+void FlangerEffect::prepare(double sampleRate, int /*maximumBlockSize*/)
+{
+    currentSampleRate = sampleRate;
+    delayLine.setSize(2, (int) (maxDelayMs / 1000.0 * sampleRate) + 4);
+    reset();
+}
+
+//Function to clear the delay line and restart the sweep
+void FlangerEffect::reset() noexcept
+{
+    delayLine.clear();
+    writePosition = 0;
+    phase = 0.0;
+    lastDelayed[0] = lastDelayed[1] = 0.0f;
+}
+
+//Function to mix each channel with a copy of itself a swept few milliseconds late
+void FlangerEffect::process(float* const* channels, int numChannels, int numSamples) noexcept
+{
+    int length = delayLine.getNumSamples();
+    if (length == 0)
+        return;
+
+    double phaseStep = MathConstants<double>::twoPi * getParameter(rate) / currentSampleRate;
+    double sweep = getParameter(depth) * (maxDelayMs - minDelayMs) / 1000.0 * currentSampleRate;
+    double minimumDelay = minDelayMs / 1000.0 * currentSampleRate;
+    float feedbackGain = getParameter(feedback);
+    float* lines[2] = { delayLine.getWritePointer(0), delayLine.getWritePointer(1) };
+    numChannels = jmin(numChannels, 2);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            double channelPhase = phase + channel * MathConstants<double>::halfPi;
+            float delay = (float) (minimumDelay + sweep * (0.5 + 0.5 * std::sin(channelPhase)));
+            float readPosition = (float) writePosition - delay;
+            if (readPosition < 0.0f)
+                readPosition += (float) length;
+
+            int index = (int) readPosition;
+            float fraction = readPosition - (float) index;
+            int next = index + 1 < length ? index + 1 : 0;
+            float delayed = lines[channel][index] + fraction * (lines[channel][next] - lines[channel][index]);
+
+            float input = channels[channel][i];
+            lines[channel][writePosition] = input + feedbackGain * lastDelayed[channel];
+            lastDelayed[channel] = delayed;
+            //Two equal copies add up by 3 dB on average, so take that back off
+            channels[channel][i] = 0.7071f * (input + delayed);
+        }
+
+        if (++writePosition == length)
+            writePosition = 0;
+
+        phase += phaseStep;
+        if (phase >= MathConstants<double>::twoPi)
+            phase -= MathConstants<double>::twoPi;
+    }
+}
+
+//==============================================================================
+//Constructor: Bit depth, fractional for a smooth sweep, and how many samples each held sample lasts
+BitcrusherEffect::BitcrusherEffect() : DeckEffect({ { "Bits", 2.0f, 16.0f, 8.0f }, { "Downsample", 1.0f, 32.0f, 4.0f } })
+{
+}
+
+void BitcrusherEffect::prepare(double sampleRate, int /*maximumBlockSize*/)
+{
+    currentSampleRate = sampleRate;
+    reset();
+}
+
+//Function to drop the held sample
+void BitcrusherEffect::reset() noexcept
+{
+    held[0] = held[1] = 0.0f;
+    holdCounter = 0.0f;
+}
+
+//Function to hold every few samples and round them to fewer levels
+void BitcrusherEffect::process(float* const* channels, int numChannels, int numSamples) noexcept
+{
+    float levels = std::pow(2.0f, getParameter(bits) - 1.0f);
+    float holdLength = getParameter(downsample);
+    numChannels = jmin(numChannels, 2);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        //Both channels are held together so the stereo image doesn't smear
+        holdCounter -= 1.0f;
+        if (holdCounter <= 0.0f)
+        {
+            holdCounter += holdLength;
+            for (int channel = 0; channel < numChannels; ++channel)
+                held[channel] = std::round(channels[channel][i] * levels) / levels;
+        }
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel][i] = held[channel];
+    }
+}
+
+//==============================================================================
+//Constructor: Chops per second, how far the closed gate drops, and how much of each chop is open
+GateEffect::GateEffect() : DeckEffect({ { "Rate", 0.5f, 16.0f, 4.0f }, { "Depth", 0.0f, 1.0f, 1.0f },
+                                        { "Width", 0.1f, 0.9f, 0.5f } })
+{
+}
+
+//Function to set how fast the gain follows the edges at this rate
+void GateEffect::prepare(double sampleRate, int /*maximumBlockSize*/)
+{
+    currentSampleRate = sampleRate;
+    edgeCoefficient = (float) std::exp(-1.0 / (edgeMs / 1000.0 * sampleRate));
+    reset();
+}
+
+//Function to restart the chop with the gate open
+void GateEffect::reset() noexcept
+{
+    phase = 0.0;
+    gain = 1.0f;
+}
+
+//Function to scale the deck by the gate's smoothed gain
+void GateEffect::process(float* const* channels, int numChannels, int numSamples) noexcept
+{
+    double phaseStep = getParameter(rate) / currentSampleRate;
+    float closedGain = 1.0f - getParameter(depth);
+    double openWidth = getParameter(width);
+    numChannels = jmin(numChannels, 2);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float target = phase < openWidth ? 1.0f : closedGain;
+        gain = target + edgeCoefficient * (gain - target);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel][i] *= gain;
+
+        phase += phaseStep;
+        if (phase >= 1.0)
+            phase -= 1.0;
+    }
+}
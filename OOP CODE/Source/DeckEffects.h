@@ -0,0 +1,145 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "StereoBiquadCascade.h"
+
+//One effect in a deck's FX rack. Effects work in place on the deck's buffer; everything they need is allocated
+//in prepare, so process never allocates or locks. Knobs are atomics set from the message thread and read once a block
+class DeckEffect
+{
+public:
+    //Most knobs an effect has
+    static constexpr int maxParameters = 3;
+
+    //Name and range of one knob
+    struct ParameterInfo
+    {
+        const char* name;
+        float minimum;
+        float maximum;
+        float defaultValue;
+    };
+
+    //Constructor: Sets every knob to its default
+    DeckEffect(std::initializer_list<ParameterInfo> parameterInfos);
+    virtual ~DeckEffect();
+
+    //Message thread, with the device stopped: allocates for the rate and largest block
+    virtual void prepare(double sampleRate, int maximumBlockSize) = 0;
+    //Audio thread: forgets the audio so far, called before an effect comes back into the rack
+    virtual void reset() noexcept = 0;
+    //Audio thread: processes up to two channels in place
+    virtual void process(float* const* channels, int numChannels, int numSamples) noexcept = 0;
+
+    //Knobs, any thread; values are limited to the knob's range
+    int getNumParameters() const { return numParameters; }
+    const ParameterInfo& getParameterInfo(int index) const { return infos[index]; }
+    void setParameter(int index, float value);
+    float getParameter(int index) const { return parameters[index].load(); }
+
+protected:
+    ParameterInfo infos[maxParameters];
+    std::atomic<float> parameters[maxParameters];
+    int numParameters = 0;
+    double currentSampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckEffect)
+};
+
+//One-knob DJ filter: low-pass below the middle, high-pass above it, flat in the middle
+class FilterEffect : public DeckEffect
+{
+public:
+    enum { cutoff = 0, resonance };
+
+    FilterEffect();
+    void prepare(double sampleRate, int maximumBlockSize) override;
+    void reset() noexcept override;
+    void process(float* const* channels, int numChannels, int numSamples) noexcept override;
+
+private:
+    //Biquad for a knob position
+    IIRCoefficients makeCoefficients(float position, float resonanceAmount) const;
+
+    StereoBiquadCascade filter{1};
+    SmoothedValue<float> position;
+    float appliedPosition = 0.0f;
+    float appliedResonance = -1.0f;
+    //Samples between coefficient updates while the knob is moving
+    static constexpr int subBlockSize = 32;
+};
+
+//Feedback delay with a smoothed delay time, so moving the time knob bends the pitch like tape instead of clicking
+class EchoEffect : public DeckEffect
+{
+public:
+    enum { time = 0, feedback, mix };
+    //Longest delay the buffer is made for
+    static constexpr double maxDelaySeconds = 2.0;
+
+    EchoEffect();
+    void prepare(double sampleRate, int maximumBlockSize) override;
+    void reset() noexcept override;
+    void process(float* const* channels, int numChannels, int numSamples) noexcept override;
+
+private:
+    AudioBuffer<float> delayLine;
+    int writePosition = 0;
+    SmoothedValue<float> delaySamples;
+};
+
+//Short delay swept by a sine, mixed back with the input; the right channel's sweep is a quarter turn ahead
+class FlangerEffect : public DeckEffect
+{
+public:
+    enum { rate = 0, depth, feedback };
+    //Shortest and longest delays of the sweep
+    static constexpr double minDelayMs = 0.5;
+    static constexpr double maxDelayMs = 5.0;
+
+    FlangerEffect();
+    void prepare(double sampleRate, int maximumBlockSize) override;
+    void reset() noexcept override;
+    void process(float* const* channels, int numChannels, int numSamples) noexcept override;
+
+private:
+    AudioBuffer<float> delayLine;
+    int writePosition = 0;
+    double phase = 0.0;
+    float lastDelayed[2] = {};
+};
+
+//Fewer bits and a lower sample rate by sample-and-hold
+class BitcrusherEffect : public DeckEffect
+{
+public:
+    enum { bits = 0, downsample };
+
+    BitcrusherEffect();
+    void prepare(double sampleRate, int maximumBlockSize) override;
+    void reset() noexcept override;
+    void process(float* const* channels, int numChannels, int numSamples) noexcept override;
+
+private:
+    float held[2] = {};
+    float holdCounter = 0.0f;
+};
+
+//Rhythmic gate that chops the deck at a rate, with short ramps so the edges don't click
+class GateEffect : public DeckEffect
+{
+public:
+    enum { rate = 0, depth, width };
+    //Time the gain takes to follow each edge
+    static constexpr double edgeMs = 2.0;
+
+    GateEffect();
+    void prepare(double sampleRate, int maximumBlockSize) override;
+    void reset() noexcept override;
+    void process(float* const* channels, int numChannels, int numSamples) noexcept override;
+
+private:
+    double phase = 0.0;
+    float gain = 1.0f;
+    float edgeCoefficient = 0.0f;
+};
@@ -0,0 +1,194 @@
+#include "DeckFxRack.h"
+
+//Constructor: Makes every effect, in the default order, and starts collecting retired graphs
+DeckFxRack::DeckFxRack()
+{
+    slots[(int) EffectType::filter].effect.reset(new FilterEffect());
+    slots[(int) EffectType::echo].effect.reset(new EchoEffect());
+    slots[(int) EffectType::flanger].effect.reset(new FlangerEffect());
+    slots[(int) EffectType::bitcrusher].effect.reset(new BitcrusherEffect());
+    slots[(int) EffectType::gate].effect.reset(new GateEffect());
+
+    for (int index = 0; index < numSlots; ++index)
+        order[(size_t) index] = (EffectType) index;
+
+    startTimer(50);
+}
+
+//Destructor: Deletes every graph
+DeckFxRack::~DeckFxRack()
+{
+    stopTimer();
+    delete queuedGraph.exchange(nullptr);
+    delete retiredGraph.exchange(nullptr);
+    delete liveGraph;
+}
+
+//Function to name each effect
+const char* DeckFxRack::getEffectName(EffectType type)
+{
+    const char* names[] = { "FILTER", "ECHO", "FLANGER", "CRUSH", "GATE" };
+    return isPositiveAndBelow((int) type, numSlots) ? names[(int) type] : "";
+}
+
+//Function to switch an effect; switching it on puts it in the graph straight away, switching it off fades it first
+void DeckFxRack::setEnabled(EffectType type, bool shouldBeEnabled)
+{
+    auto& slot = slots[(int) type];
+    if (slot.enabled.load() == shouldBeEnabled)
+        return;
+
+    if (shouldBeEnabled)
+        slot.silent = false;
+
+    slot.enabled = shouldBeEnabled;
+    rebuildGraph();
+}
+
+//Function to move an effect to another slot
+void DeckFxRack::moveSlot(int fromIndex, int toIndex)
+{
+    if (! isPositiveAndBelow(fromIndex, numSlots) || ! isPositiveAndBelow(toIndex, numSlots) || fromIndex == toIndex)
+        return;
+
+    auto type = order[(size_t) fromIndex];
+    int step = toIndex > fromIndex ? 1 : -1;
+    for (int index = fromIndex; index != toIndex; index += step)
+        order[(size_t) index] = order[(size_t) (index + step)];
+    order[(size_t) toIndex] = type;
+
+    rebuildGraph();
+}
+
+//Function to prepare every effect so any of them can be switched on while playing
+void DeckFxRack::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    for (auto& slot : slots)
+    {
+        slot.effect->prepare(sampleRate, samplesPerBlockExpected);
+        slot.mix = slot.enabled.load() ? 1.0f : 0.0f;
+        slot.silent = ! slot.enabled.load();
+    }
+
+    dryBuffer.setSize(2, jmax(1, samplesPerBlockExpected));
+    fadeStep = (float) (1000.0 / (fadeMs * sampleRate));
+}
+
+//Function to check whether an effect still has to run
+bool DeckFxRack::belongsInGraph(EffectType type) const
+{
+    auto& slot = slots[(int) type];
+    return slot.enabled.load() || ! slot.silent.load();
+}
+
+//Function to list the effects to run in slot order and queue the list for the audio thread
+void DeckFxRack::rebuildGraph()
+{
+    auto* graph = new Graph();
+
+    for (auto type : order)
+    {
+        inGraph[(int) type] = belongsInGraph(type);
+        if (inGraph[(int) type])
+            graph->effects[graph->numEffects++] = type;
+    }
+
+    //A graph the audio thread never took is replaced here
+    delete queuedGraph.exchange(graph);
+}
+
+//Function to run the graph, taking a new one at the start of the block
+void DeckFxRack::process(AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+    if (queuedGraph.load() != nullptr && retiredGraph.load() == nullptr)
+    {
+        retiredGraph = liveGraph;
+        liveGraph = queuedGraph.exchange(nullptr);
+
+        //An effect coming back after fading out starts from silence, not from where it left off
+        for (int index = 0; index < liveGraph->numEffects; ++index)
+        {
+            auto& slot = slots[(int) liveGraph->effects[index]];
+            if (slot.mix == 0.0f)
+                slot.effect->reset();
+        }
+    }
+
+    if (liveGraph == nullptr || liveGraph->numEffects == 0)
+        return;
+
+    int numChannels = jmin(2, buffer.getNumChannels());
+    float* channels[2] = { buffer.getWritePointer(0, startSample), buffer.getWritePointer(numChannels - 1, startSample) };
+
+    for (int index = 0; index < liveGraph->numEffects; ++index)
+        processSlot(slots[(int) liveGraph->effects[index]], channels, numChannels, numSamples);
+}
+
+//Function to run one effect in place, or against a copy of the dry signal while it fades
+void DeckFxRack::processSlot(Slot& slot, float* const* channels, int numChannels, int numSamples) noexcept
+{
+    float target = slot.enabled.load() ? 1.0f : 0.0f;
+
+    if (slot.mix == target)
+    {
+        //Faded out and waiting for the timer to take it out of the graph
+        if (target == 0.0f)
+        {
+            slot.silent = true;
+            return;
+        }
+
+        slot.effect->process(channels, numChannels, numSamples);
+        return;
+    }
+
+    for (int offset = 0; offset < numSamples; offset += dryBuffer.getNumSamples())
+    {
+        int numToDo = jmin(dryBuffer.getNumSamples(), numSamples - offset);
+        float* pieces[2] = { channels[0] + offset, channels[1] + offset };
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            dryBuffer.copyFrom(channel, 0, pieces[channel], numToDo);
+
+        slot.effect->process(pieces, numChannels, numToDo);
+
+        //Crossfade from the dry signal to the effect's output, or back
+        float startMix = slot.mix;
+        float endMix = target > startMix ? jmin(target, startMix + fadeStep * numToDo)
+                                         : jmax(target, startMix - fadeStep * numToDo);
+        float mixStep = (endMix - startMix) / (float) numToDo;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const float* dry = dryBuffer.getReadPointer(channel);
+            float* wet = pieces[channel];
+            float mix = startMix;
+
+            for (int i = 0; i < numToDo; ++i)
+            {
+                mix += mixStep;
+                wet[i] = dry[i] + (wet[i] - dry[i]) * mix;
+            }
+        }
+
+        slot.mix = endMix;
+    }
+
+    if (slot.mix == 0.0f && target == 0.0f)
+        slot.silent = true;
+}
+
+//Function to delete retired graphs, and rebuild the graph once a switched-off effect has faded out
+void DeckFxRack::timerCallback()
+{
+    delete retiredGraph.exchange(nullptr);
+
+    for (int type = 0; type < numSlots; ++type)
+    {
+        if (inGraph[type] != belongsInGraph((EffectType) type))
+        {
+            rebuildGraph();
+            break;
+        }
+    }
+}
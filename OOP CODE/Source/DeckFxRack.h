@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DeckEffects.h"
+
+//A deck's FX rack: a slot for each effect, in an order the user can change, each switched on and off while the
+//deck plays. The message thread turns the order and the switches into a graph, the list of effects to run, and
+//hands it to the audio thread in one atomic swap; a timer deletes the graph it replaced. Switched-off effects are
+//left out of the graph, so they cost nothing.
+//
+//An effect switched on or off fades in or out over a few milliseconds. Only while it fades is the dry signal copied
+//aside to mix with; otherwise every effect works in place on the deck's buffer. An effect that has faded out stays
+//in the graph until the timer builds one without it
+class DeckFxRack : private Timer
+{
+public:
+    //Effects in the rack, one slot each
+    enum class EffectType
+    {
+        filter = 0,
+        echo,
+        flanger,
+        bitcrusher,
+        gate,
+        numTypes
+    };
+
+    static constexpr int numSlots = (int) EffectType::numTypes;
+    //Fade when an effect is switched on or off
+    static constexpr double fadeMs = 10.0;
+
+    //Constructor: Every effect in the default order, all off
+    DeckFxRack();
+    //Destructor: Deletes every graph, the audio thread must have stopped using the rack
+    ~DeckFxRack() override;
+
+    //Message thread: switches an effect on or off from the next block
+    void setEnabled(EffectType type, bool shouldBeEnabled);
+    bool isEnabled(EffectType type) const { return slots[(int) type].enabled.load(); }
+    //Message thread: the slot order, first processed first
+    EffectType getSlot(int index) const { return order[(size_t) index]; }
+    //Message thread: moves the effect at one slot to another, shifting the ones between
+    void moveSlot(int fromIndex, int toIndex);
+
+    //Any thread: an effect's knobs
+    DeckEffect& getEffect(EffectType type) { return *slots[(int) type].effect; }
+    static const char* getEffectName(EffectType type);
+
+    //Message thread, with the device stopped: prepares every effect, on or off
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    //Audio thread: runs the effects in the graph over part of a buffer in place
+    void process(AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+    //Every effect works sample by sample in place, the echo's and flanger's delays are what they sound like rather
+    //than latency, so the rack never delays the dry signal
+    int getLatencyInSamples() const noexcept { return 0; }
+
+private:
+    //The effects to run, in order
+    struct Graph
+    {
+        EffectType effects[numSlots];
+        int numEffects = 0;
+    };
+
+    //One effect and its switch
+    struct Slot
+    {
+        std::unique_ptr<DeckEffect> effect;
+        std::atomic<bool> enabled { false };
+        //Set by the audio thread once the effect has faded all the way out
+        std::atomic<bool> silent { true };
+        //Audio thread: how much of the effect is heard, 0 to 1
+        float mix = 0.0f;
+    };
+
+    //Message thread: builds a graph from the order and switches and queues it
+    void rebuildGraph();
+    //Message thread: whether an effect belongs in the graph, switched on or still fading out
+    bool belongsInGraph(EffectType type) const;
+    //Audio thread: runs one effect, fading it against a copy of the dry signal if it is switching
+    void processSlot(Slot& slot, float* const* channels, int numChannels, int numSamples) noexcept;
+    //Deletes retired graphs and drops effects that have faded out
+    void timerCallback() override;
+
+    Slot slots[numSlots];
+    std::array<EffectType, numSlots> order;
+    //Effects in the last graph built
+    bool inGraph[numSlots] = {};
+
+    //Handover between the message thread and the audio thread
+    std::atomic<Graph*> queuedGraph { nullptr };
+    std::atomic<Graph*> retiredGraph { nullptr };
+    //Audio thread state
+    Graph* liveGraph = nullptr;
+    //Dry signal kept while an effect fades, blocks longer than this are faded in pieces
+    AudioBuffer<float> dryBuffer;
+    //Change in mix per sample while fading
+    float fadeStep = 1.0f / 441.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckFxRack)
+};
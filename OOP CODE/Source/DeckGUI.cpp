@@ -6,6 +6,7 @@ DeckGUI::DeckGUI(DJAudioplayer* _player,
                  AudioThumbnailCache & cacheToUse, bool isLeftDeck) :
                  player(_player),  //Store a reference to the associated DJAudioplayer
                  waveformDisplay(formatManagerToUse, cacheToUse), //Initialize the waveform display
+                 fxPanel(_player->getFxRack()), //Initialize the FX rack controls
                  isLeftDeck(isLeftDeck) //Determine if this deck is the left or right deck
 {
     
@@ -17,6 +18,15 @@ DeckGUI::DeckGUI(DJAudioplayer* _player,
     addAndMakeVisible(loopButton);
     addAndMakeVisible(forwardButton);
     addAndMakeVisible(backwardButton);
+    addAndMakeVisible(keyLockButton);
+    addAndMakeVisible(syncButton);
+    addAndMakeVisible(halveLoopButton);
+    addAndMakeVisible(doubleLoopButton);
+    addAndMakeVisible(impulseResponseButton);
+    addAndMakeVisible(fxButton);
+    addAndMakeVisible(reverseButton);
+    addAndMakeVisible(brakeButton);
+    addAndMakeVisible(spinBackButton);
     
     //Add listeners for the button events
     playButton.addListener(this);
@@ -25,6 +35,15 @@ DeckGUI::DeckGUI(DJAudioplayer* _player,
     loopButton.addListener(this);
     forwardButton.addListener(this);
     backwardButton.addListener(this);
+    keyLockButton.addListener(this);
+    syncButton.addListener(this);
+    halveLoopButton.addListener(this);
+    doubleLoopButton.addListener(this);
+    impulseResponseButton.addListener(this);
+    fxButton.addListener(this);
+    reverseButton.addListener(this);
+    brakeButton.addListener(this);
+    spinBackButton.addListener(this);
     
     //Apply LookAndFeel to Play and Stop buttons
     playButton.setLookAndFeel(&buttonLookAndFeel);
@@ -33,9 +52,44 @@ DeckGUI::DeckGUI(DJAudioplayer* _player,
     forwardButton.setLookAndFeel(&buttonLookAndFeel);
     backwardButton.setLookAndFeel(&buttonLookAndFeel);
     loadButton.setLookAndFeel(&buttonLookAndFeel);
+    keyLockButton.setLookAndFeel(&buttonLookAndFeel);
+    syncButton.setLookAndFeel(&buttonLookAndFeel);
+    halveLoopButton.setLookAndFeel(&buttonLookAndFeel);
+    doubleLoopButton.setLookAndFeel(&buttonLookAndFeel);
+    impulseResponseButton.setLookAndFeel(&buttonLookAndFeel);
+    fxButton.setLookAndFeel(&buttonLookAndFeel);
+    reverseButton.setLookAndFeel(&buttonLookAndFeel);
+    brakeButton.setLookAndFeel(&buttonLookAndFeel);
+    spinBackButton.setLookAndFeel(&buttonLookAndFeel);
+    //FX stays lit while the rack is open
+    fxButton.setClickingTogglesState(true);
+    //Key lock stays lit while it is on
+    keyLockButton.setClickingTogglesState(true);
+    //Sync stays lit while the deck follows the master clock
+    syncButton.setClickingTogglesState(true);
+    //Reverse stays lit while the deck plays backwards
+    reverseButton.setClickingTogglesState(true);
+
+    //HOT CUES//
+    //Numbered pads, lit while they hold a cue
+    for (int index = 0; index < HotCues::numCues; ++index)
+    {
+        auto& pad = hotCueButtons[(size_t) index];
+        pad.setButtonText(String(index + 1));
+        pad.setColour(TextButton::buttonColourId, Colour(31, 31, 31));
+        pad.setColour(TextButton::buttonOnColourId, Colour(0, 90, 96));
+        pad.setColour(TextButton::textColourOffId, Colour(0, 240, 255));
+        pad.setColour(TextButton::textColourOnId, Colour(0, 240, 255));
+        pad.setTooltip("Click to set or play, shift-click to clear");
+        pad.addListener(this);
+        addAndMakeVisible(pad);
+    }
     
     //WAVEFORM//
     addAndMakeVisible(waveformDisplay);
+
+    //FX RACK//
+    addChildComponent(fxPanel);
     
     //SLIDER//
     //Configure speed slider
@@ -89,14 +143,13 @@ DeckGUI::DeckGUI(DJAudioplayer* _player,
 
     //JOGWHEEL//
     jogWheel.setLookAndFeel(&jogLookAndFeel);
-    //Enable velocity-based mode for smooth interaction
-    jogWheel.setVelocityBasedMode(true);
-    //Set jog wheel rotation parameters
-    jogWheel.setRotaryParameters(0.0f, juce::MathConstants<float>::twoPi, true);
+    //The wheel follows the mouse round and round, -1 to 1 is one turn
+    jogWheel.setVelocityBasedMode(false);
+    jogWheel.setRotaryParameters(0.0f, juce::MathConstants<float>::twoPi, false);
     //Configure jog wheel settings
     jogWheel.setSliderStyle(Slider::Rotary);
     jogWheel.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
-    jogWheel.setRange(-1.0, 1.0, 0.01);
+    jogWheel.setRange(-1.0, 1.0);
     jogWheel.setValue(0.0);
     jogWheel.addListener(this);
     addAndMakeVisible(jogWheel);
@@ -229,10 +282,20 @@ void DeckGUI::resized()
         loadButton.setBounds(415, 550, buttonSize, buttonSize);
         backwardButton.setBounds(110, 200, buttonSize - 20, buttonSize - 20);
         forwardButton.setBounds(410, 200, buttonSize - 20, buttonSize - 20);
+        keyLockButton.setBounds(545, 175, 50, 50);
+        syncButton.setBounds(25, 185, 50, 50);
+        halveLoopButton.setBounds(300, 510, 36, 36);
+        doubleLoopButton.setBounds(354, 510, 36, 36);
+        reverseButton.setBounds(146, 510, 44, 36);
+        brakeButton.setBounds(196, 510, 44, 36);
+        spinBackButton.setBounds(246, 510, 44, 36);
         
         //Positions for EQ
         midSlider.setBounds(620, 320, filterSliderWidth, filterSliderHeight);
         wetDrySlider.setBounds(620, 550, filterSliderWidth, filterSliderHeight);
+        impulseResponseButton.setBounds(632, 612, 36, 20);
+        fxButton.setBounds(545, 120, 50, 50);
+        fxPanel.setBounds(110, 215, 350, 228);
         bassSlider.setBounds(620, 205, filterSliderWidth, filterSliderHeight);
         highSlider.setBounds(620, 435, filterSliderWidth, filterSliderHeight);
     }else {
@@ -252,10 +315,20 @@ void DeckGUI::resized()
         loadButton.setBounds(495, 550, buttonSize, buttonSize);
         backwardButton.setBounds(190, 200, buttonSize - 20, buttonSize - 20);
         forwardButton.setBounds(490, 200, buttonSize - 20, buttonSize - 20);
+        keyLockButton.setBounds(625, 175, 50, 50);
+        syncButton.setBounds(105, 185, 50, 50);
+        halveLoopButton.setBounds(380, 510, 36, 36);
+        doubleLoopButton.setBounds(434, 510, 36, 36);
+        reverseButton.setBounds(226, 510, 44, 36);
+        brakeButton.setBounds(276, 510, 44, 36);
+        spinBackButton.setBounds(326, 510, 44, 36);
         
         //Positions for audio effects control
         midSlider.setBounds(20, 320, filterSliderWidth, filterSliderHeight);
         wetDrySlider.setBounds(20, 550, filterSliderWidth, filterSliderHeight);
+        impulseResponseButton.setBounds(32, 612, 36, 20);
+        fxButton.setBounds(625, 120, 50, 50);
+        fxPanel.setBounds(190, 215, 350, 228);
         bassSlider.setBounds(20, 205, filterSliderWidth, filterSliderHeight);
         highSlider.setBounds(20, 435, filterSliderWidth, filterSliderHeight);
         
@@ -263,6 +336,11 @@ void DeckGUI::resized()
    
     //Position the waveform Display in the center
     waveformDisplay.setBounds(0, 0, getWidth(), rowH * 2 - 20);
+
+    //Hot cue pads in a row between the waveform and the position slider, as wide as the slider
+    int padWidth = horizontalSliderWidth / HotCues::numCues;
+    for (int index = 0; index < HotCues::numCues; ++index)
+        hotCueButtons[(size_t) index].setBounds((isLeftDeck ? 147 : 227) + index * padWidth, rowH * 2 - 14, padWidth - 4, 26);
 }
 
 //Function for the button usage
@@ -291,21 +369,93 @@ void DeckGUI::buttonClicked(Button* button)
         if (chooser.browseForFileToOpen())
         {
             URL audioURL = URL{chooser.getResult()};
-            //Load selected file into the player
-            player->loadURL(audioURL);
-            //Update waveform display
-            waveformDisplay.loadURL(URL{chooser.getResult()});
+            //Load selected file into the player and waveform display
+            loadFile(audioURL);
         }
     }
-    //Music is looped when button is clicked
+    //LOOP sets the loop-in point, then the loop-out point, then leaves the loop
     if (button == &loopButton) {
-        //Toggle loop state
-        isLoopEnabled = !isLoopEnabled;
-        //Apply looping state to player
-        player->setLooping(isLoopEnabled);
-        //Update button appearance
-        loopButton.repaint();
-        std::cout << (isLoopEnabled ? "Loop enabled" : "Loop disabled") << std::endl;
+        if (player->isLoopActive())
+            player->exitLoop();
+        else if (player->isLoopInSet())
+            player->setLoopOut();
+        else
+            player->setLoopIn();
+
+        updateLoopButton();
+        std::cout << (player->isLoopActive() ? "Loop enabled" : player->isLoopInSet() ? "Loop in set" : "Loop disabled") << std::endl;
+    }
+    //The loop is halved or doubled while it plays
+    if (button == &halveLoopButton) {
+        player->halveLoop();
+    }
+    if (button == &doubleLoopButton) {
+        player->doubleLoop();
+    }
+    //IR switches the reverb to convolution with an impulse response file, and back to the built-in reverb
+    if (button == &impulseResponseButton && impulseResponseLibrary != nullptr) {
+        if (player->getImpulseResponseName().isNotEmpty())
+        {
+            player->clearImpulseResponse();
+        }
+        else
+        {
+            //The response is built in the background, the button lights once it is in use
+            FileChooser chooser ("Select an impulse response...", File(), "*.wav;*.aif;*.aiff;*.flac");
+            if (chooser.browseForFileToOpen())
+            {
+                Component::SafePointer<DeckGUI> safeThis(this);
+                player->setImpulseResponse(chooser.getResult(), *impulseResponseLibrary, [safeThis] (bool)
+                {
+                    if (safeThis != nullptr)
+                        safeThis->updateImpulseResponseButton();
+                });
+            }
+        }
+
+        updateImpulseResponseButton();
+    }
+    //FX opens and closes the rack over the jog wheel
+    if (button == &fxButton) {
+        fxPanel.setVisible(fxButton.getToggleState());
+        fxPanel.toFront(false);
+    }
+    //Speed changes keep the pitch while key lock is on
+    if (button == &keyLockButton) {
+        player->setKeyLock(keyLockButton.getToggleState());
+    }
+    //A synced deck follows the tempo and beat of the deck leading the master clock
+    if (button == &syncButton) {
+        player->setSync(syncButton.getToggleState());
+    }
+    //Platter modes: reverse until switched off, or stop the platter with a brake or a spin-back
+    if (button == &reverseButton) {
+        player->setReverse(reverseButton.getToggleState());
+    }
+    if (button == &brakeButton) {
+        player->brake();
+    }
+    if (button == &spinBackButton) {
+        player->spinBack();
+    }
+    //Hot cue pads set, play or clear their cue
+    for (int index = 0; index < HotCues::numCues; ++index) {
+        if (button != &hotCueButtons[(size_t) index])
+            continue;
+
+        bool wasSet = player->getHotCues().isSet(index);
+        if (ModifierKeys::getCurrentModifiers().isShiftDown())
+            player->clearHotCue(index);
+        else if (wasSet)
+            player->triggerHotCue(index);
+        else
+            player->setHotCue(index);
+
+        //Only a cue that was set or cleared needs storing
+        if (player->getHotCues().isSet(index) != wasSet && onHotCuesChanged != nullptr)
+            onHotCuesChanged(loadedURL, player->getHotCues());
+
+        updateHotCueButtons();
     }
     //Music moves by 5 seconds forward when button is pressed
     if (button == &forwardButton) {
@@ -321,24 +471,74 @@ void DeckGUI::buttonClicked(Button* button)
     }
 }
 
+//Function to light the LOOP button while a loop is being set or playing
+void DeckGUI::updateLoopButton()
+{
+    loopButton.setToggleState(player->isLoopActive() || player->isLoopInSet(), dontSendNotification);
+}
+
+//Function to light the IR button while an impulse response is in use
+void DeckGUI::updateImpulseResponseButton()
+{
+    auto name = player->getImpulseResponseName();
+    impulseResponseButton.setToggleState(name.isNotEmpty(), dontSendNotification);
+    impulseResponseButton.setTooltip(name.isNotEmpty() ? name : String("Built-in reverb"));
+    std::cout << "Reverb: " << (name.isNotEmpty() ? name : String("built-in")) << std::endl;
+}
+
+//Function to light the pads that hold a hot cue
+void DeckGUI::updateHotCueButtons()
+{
+    for (int index = 0; index < HotCues::numCues; ++index)
+        hotCueButtons[(size_t) index].setToggleState(player->getHotCues().isSet(index), dontSendNotification);
+}
+
+//Function to connect the volume slider to a mixer channel
+void DeckGUI::setMixerChannel(DeckMixer* mixerToUse, int channel)
+{
+    mixer = mixerToUse;
+    mixerChannel = channel;
+    mixer->setFader(mixerChannel, (float) volSlider.getValue());
+}
+
+//Function to let the IR button load impulse responses
+void DeckGUI::setImpulseResponseLibrary(ImpulseResponseLibrary* libraryToUse)
+{
+    impulseResponseLibrary = libraryToUse;
+}
+
 //Function to the slider value changes
 void DeckGUI::sliderValueChanged (Slider *slider)
 {
-    //Handling the jog wheel slider for pitch bending
+    //Handling the jog wheel as a platter, its speed goes to the audio thread with the time it was made
     if (slider == &jogWheel)
     {
-        double jogAmount = jogWheel.getValue();
-        if (jogAmount != 0)
+        double now = Time::getMillisecondCounterHiRes();
+        double turned = jogWheel.getValue() - lastJogValue;
+
+        //Going past the top of the wheel jumps the value by a whole turn
+        if (turned > 1.0)
+            turned -= 2.0;
+        else if (turned < -1.0)
+            turned += 2.0;
+
+        if (now > lastJogMs)
         {
-            //Apply pitch bending when jog wheel is moved
-            player->pitchBend(jogAmount);
+            double turnsPerSecond = (turned / 2.0) * 1000.0 / (now - lastJogMs);
+            player->movePlatter(turnsPerSecond * secondsPerJogTurn, now);
         }
+
+        lastJogValue = jogWheel.getValue();
+        lastJogMs = now;
     }
     //Handling the volume slider
     if (slider == &volSlider)
     {
-        //Set the player volume
-        player->setGain(slider->getValue());
+        //Move this deck's channel fader, the crossfader is applied separately by the mixer
+        if (mixer != nullptr)
+            mixer->setFader(mixerChannel, (float) slider->getValue());
+        else
+            player->setGain(slider->getValue());
         std::cout << "Volume changed: " << volSlider.getValue() << std::endl;
     }
     //Handling the speed slider
@@ -383,29 +583,57 @@ void DeckGUI::filesDropped (const StringArray &files, int x, int y){
     if(files.size() == 1)
     {
         //Load the audio file into the player
-        player->loadURL(URL{File{files[0]}});
+        loadFile(URL{File{files[0]}});
     }
 }
 
+//Function to touch the platter when the jog wheel is grabbed
+void DeckGUI::sliderDragStarted (Slider *slider)
+{
+    if (slider == &jogWheel)
+    {
+        lastJogValue = jogWheel.getValue();
+        lastJogMs = Time::getMillisecondCounterHiRes();
+        player->touchPlatter(lastJogMs);
+    }
+}
+
+//Function to let the platter go when the jog wheel is released
+void DeckGUI::sliderDragEnded (Slider *slider)
+{
+    if (slider == &jogWheel)
+        player->releasePlatter(Time::getMillisecondCounterHiRes());
+}
+
 //Function called periodically as part of a timer callback
 void DeckGUI::timerCallback(){
+    //Show the progress of a track that is still loading
+    waveformDisplay.setLoadProgress(player->isLoading() ? player->getLoadProgress() : -1.0);
+    
     //Update the waveform position
     waveformDisplay.setPositionRelative(player->getPositionRelative());
     
     // Update the position slider to move with the track
     posSlider.setValue(player->getPositionRelative(), juce::dontSendNotification);
     
-    //Apply jog wheel pitch bending if it's not at zero
-    if (jogWheel.getValue() != 0) {
-        player->pitchBend(jogWheel.getValue());
-    }
+    //Keep the LOOP light in step, loading a new track clears the loop
+    updateLoopButton();
+    updateHotCueButtons();
 }
  
 //Function to load a new audio file into the player
-void DeckGUI::loadFile(const juce::URL& audioURL) {
-    //Load the audio  into the pkayer
-    player->loadURL(audioURL);
-    //Update waveform display
-    waveformDisplay.loadURL(audioURL);
+void DeckGUI::loadFile(const juce::URL& audioURL, const BeatGrid& beatGrid, const HotCues& cues) {
+    waveformDisplay.setLoadProgress(0.0);
+    loadedURL = audioURL;
+    
+    //Load the audio into the player on a worker thread, the waveform gets its reader when it is done
+    Component::SafePointer<DeckGUI> safeThis(this);
+    player->loadURLAsync(audioURL, [safeThis, audioURL] (std::unique_ptr<AudioFormatReader> thumbnailReader)
+    {
+        //Update waveform display if the deck still exists
+        if (safeThis != nullptr)
+            safeThis->waveformDisplay.loadReader(std::move(thumbnailReader), audioURL);
+    }, beatGrid, cues);
+    updateHotCueButtons();
 }
 
@@ -3,6 +3,8 @@
 #include <JuceHeader.h>
 #include "DJAudioplayer.h"
 #include "WaveformDisplay.h"
+#include "DeckMixer.h"
+#include "FxRackPanel.h"
 
 //==============================================================================
 /*
@@ -56,6 +58,9 @@ public:
         //Define border thickness and button radius
         int borderThickness = 3;
         float radius = 60.0f;
+        //Smaller buttons for the key lock and loop size controls
+        if (button.getButtonText() == "KEY" || button.getButtonText() == "SYNC") radius = 40.0f;
+        if (button.getButtonText() == "HALF" || button.getButtonText() == "DOUBLE") radius = 34.0f;
         //Get the center position of the button
         auto centerX = bounds.getCentreX();
         auto centerY = bounds.getCentreY();
@@ -65,6 +70,8 @@ public:
         //Change brightness based on user interaction
         if (isMouseOverButton) fillColour = fillColour.brighter();
         if (isButtonDown) fillColour = fillColour.darker();
+        //Toggle buttons light up while they are on
+        if (button.getToggleState()) fillColour = Colour(0, 90, 96);
         g.setColour(fillColour);
         g.fillEllipse(centerX - radius / 2, centerY - radius / 2, radius, radius);
 
@@ -131,6 +138,27 @@ public:
             g.setFont(16.0f);
             g.drawFittedText("LOAD", bounds.toNearestInt(), juce::Justification::centred, 1);
         }
+        else if (button.getButtonText() == "HALF" || button.getButtonText() == "DOUBLE")
+        {
+            //Draws the loop halve and double buttons
+            g.setColour(Colour(0, 240, 255));
+            g.setFont(12.0f);
+            g.drawFittedText(button.getButtonText() == "HALF" ? "1/2" : "x2", bounds.toNearestInt(), juce::Justification::centred, 1);
+        }
+        else if (button.getButtonText() == "KEY")
+        {
+            //Draws the key lock button
+            g.setColour(Colour(0, 240, 255));
+            g.setFont(13.0f);
+            g.drawFittedText("KEY", bounds.toNearestInt(), juce::Justification::centred, 1);
+        }
+        else if (button.getButtonText() == "SYNC")
+        {
+            //Draws the beat sync button
+            g.setColour(Colour(0, 240, 255));
+            g.setFont(11.0f);
+            g.drawFittedText("SYNC", bounds.toNearestInt(), juce::Justification::centred, 1);
+        }
         //Fills the icon with colour
         g.fillPath(icon);
     }
@@ -314,6 +342,9 @@ public:
     //Event handlers for button and slider interactions
     void buttonClicked (Button *) override;
     void sliderValueChanged (Slider *slider) override;
+    //The jog wheel is a platter: grabbing it touches the record, letting go releases it
+    void sliderDragStarted (Slider *slider) override;
+    void sliderDragEnded (Slider *slider) override;
     
     //Drag and drop file handling
     bool isInterestedInFileDrag (const StringArray &files) override;
@@ -322,8 +353,16 @@ public:
     //Timer callback function
     void timerCallback() override;
     
-    //Loading audio file into the deck
-    void loadFile(const juce::URL& audioURL);
+    //Loading audio file into the deck, with its beat grid and hot cues if the library has them
+    void loadFile(const juce::URL& audioURL, const BeatGrid& beatGrid = {}, const HotCues& cues = {});
+
+    //Called when a pad sets or clears a hot cue, so the library can store the track's cues
+    std::function<void(const URL&, const HotCues&)> onHotCuesChanged;
+    
+    //Connects the volume slider to this deck's channel fader on the mixer
+    void setMixerChannel(DeckMixer* mixerToUse, int channel);
+    //Impulse responses the IR button loads through, shared by every deck
+    void setImpulseResponseLibrary(ImpulseResponseLibrary* libraryToUse);
     
     //Sets the waveform color deck
     void setWaveformColour(juce::Colour newColour)
@@ -344,6 +383,11 @@ private:
     
     //Sliders for jogwheel, volume, speed and position
     Slider jogWheel;
+    //Where the jog wheel was at its last move and when, to turn the drag into a platter speed
+    double lastJogValue = 0.0;
+    double lastJogMs = 0.0;
+    //One turn of the wheel at normal speed takes as long as a record at 33 1/3 rpm
+    static constexpr double secondsPerJogTurn = 1.8;
     juce::Slider volSlider;
     Slider speedSlider;
     Slider posSlider;
@@ -355,12 +399,32 @@ private:
     TextButton forwardButton{"FORWARD"};
     TextButton backwardButton{"BACKWARD"};
     TextButton loopButton{"LOOP"};
+    TextButton keyLockButton{"KEY"};
+    TextButton syncButton{"SYNC"};
+    TextButton halveLoopButton{"HALF"};
+    TextButton doubleLoopButton{"DOUBLE"};
+    TextButton impulseResponseButton{"IR"};
+    TextButton fxButton{"FX"};
+    TextButton reverseButton{"REV"};
+    TextButton brakeButton{"BRAKE"};
+    TextButton spinBackButton{"SPIN"};
+    //Hot cue pads: an empty pad sets a cue, a set pad jumps to it, shift-click clears it
+    std::array<TextButton, HotCues::numCues> hotCueButtons;
 
     //Pointer to the audio player object
     DJAudioplayer* player;
+    //Mixer channel the volume slider moves
+    DeckMixer* mixer = nullptr;
+    int mixerChannel = 0;
+    //Library the deck's impulse responses come from
+    ImpulseResponseLibrary* impulseResponseLibrary = nullptr;
+    //Track loaded last, its hot cues are stored against it
+    URL loadedURL;
     
     //Displays the waveform of the track
     WaveformDisplay waveformDisplay;
+    //The deck's FX rack, shown over the jog wheel by the FX button
+    FxRackPanel fxPanel;
     
     //Arrays to manage multiple sliders and labels
     juce::Array<juce::Slider*> sliders;
@@ -377,8 +441,12 @@ private:
     juce::Label bassLabel{"bassLabel", "Bass"};
     juce::Label trebleLabel{"trebleLabel", "Treble"};
     
-    //To enable toggling
-    bool isLoopEnabled = false;
+    //Lights the LOOP button while a loop-in point is set or a loop is playing
+    void updateLoopButton();
+    //Lights the pads that have a hot cue
+    void updateHotCueButtons();
+    //Lights the IR button and names the reverb in use in its tooltip
+    void updateImpulseResponseButton();
     
     //Sliders for sound effect
     juce::Slider bassSlider;
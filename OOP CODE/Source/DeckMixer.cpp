@@ -0,0 +1,316 @@
+#include "DeckMixer.h"
+#include "CallbackProfiler.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define OTODECKS_MIXER_SSE 1
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+ #include <arm_neon.h>
+ #define OTODECKS_MIXER_NEON 1
+#endif
+
+//Constructor: Clamps the deck count to what the mixer supports
+DeckMixer::DeckMixer(int numDecks)
+    : numberOfDecks(jlimit(minDecks, maxDecks, numDecks))
+{
+}
+
+//Destructor
+DeckMixer::~DeckMixer()
+{
+}
+
+//Function to plug a deck into a channel strip
+void DeckMixer::setSource(int deck, AudioSource* source)
+{
+    jassert(isPositiveAndBelow(deck, numberOfDecks));
+    //Sources are fixed once the audio is running
+    jassert(blockSize == 0);
+
+    if (isPositiveAndBelow(deck, numberOfDecks))
+        strips[(size_t) deck].source = source;
+}
+
+//Function to choose the pool the decks are rendered on, null renders them one after another
+void DeckMixer::setRenderPool(DeckRenderPool* poolToUse)
+{
+    jassert(blockSize == 0);
+    renderPool = poolToUse;
+}
+
+//Function to set the clock moved on before each piece
+void DeckMixer::setMasterClock(MasterClock* clockToUse)
+{
+    jassert(blockSize == 0);
+    masterClock = clockToUse;
+}
+
+//Function to set a channel's input trim in decibels
+void DeckMixer::setTrimDecibels(int deck, float decibels)
+{
+    if (isPositiveAndBelow(deck, numberOfDecks))
+        strips[(size_t) deck].trim = Decibels::decibelsToGain(jlimit(-24.0f, 12.0f, decibels));
+}
+
+//Function to set a channel's fader level from 0 to 1
+void DeckMixer::setFader(int deck, float level)
+{
+    if (isPositiveAndBelow(deck, numberOfDecks))
+        strips[(size_t) deck].fader = jlimit(0.0f, 1.0f, level);
+}
+
+//Function to put a channel on a side of the crossfader
+void DeckMixer::setCrossfaderAssign(int deck, CrossfaderAssign assign)
+{
+    if (isPositiveAndBelow(deck, numberOfDecks))
+        strips[(size_t) deck].assign = (int) assign;
+}
+
+//Function to move the crossfader at the start of the next block
+void DeckMixer::setCrossfader(float position)
+{
+    crossfaderEngine.setPosition(position);
+}
+
+//Function to move the crossfader at the sample a timestamped move was made
+void DeckMixer::moveCrossfader(float position, double timeMs)
+{
+    crossfaderEngine.moveTo(position, timeMs);
+}
+
+//Function to prepare every deck and give each strip a buffer for one block
+void DeckMixer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    blockSize = jmax(1, samplesPerBlockExpected);
+    crossfaderEngine.prepare(sampleRate);
+
+    if (masterClock != nullptr)
+        masterClock->prepare(sampleRate);
+
+    for (int deck = 0; deck < numberOfDecks; ++deck)
+    {
+        auto& strip = strips[(size_t) deck];
+        strip.buffer.setSize(2, blockSize);
+        //Start at the current settings rather than ramping up from silence
+        strip.appliedGain = getChannelGain(strip);
+
+        if (strip.source != nullptr)
+            strip.source->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    }
+}
+
+//Function to release every deck and the strip buffers
+void DeckMixer::releaseResources()
+{
+    for (int deck = 0; deck < numberOfDecks; ++deck)
+    {
+        auto& strip = strips[(size_t) deck];
+        strip.buffer.setSize(2, 0);
+
+        if (strip.source != nullptr)
+            strip.source->releaseResources();
+    }
+
+    blockSize = 0;
+}
+
+//Function to render every deck into its strip and sum them in one pass per crossfader segment, ramping each strip to its new gain
+void DeckMixer::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    //Decks rendered on this thread are timed as their own stages, waiting for the pool's workers counts as mixing
+    CallbackProfiler::ScopedStage profilerStage(CallbackProfiler::mixer);
+
+    if (blockSize == 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    //Trim and fader ramp from where they were to their new gains across the whole block
+    float targetGains[maxDecks], gainSteps[maxDecks];
+    for (int deck = 0; deck < numberOfDecks; ++deck)
+    {
+        auto& strip = strips[(size_t) deck];
+        targetGains[deck] = getChannelGain(strip);
+        gainSteps[deck] = (targetGains[deck] - strip.appliedGain) / (float) jmax(1, bufferToFill.numSamples);
+    }
+
+    //The crossfader gains are linear between breakpoints, with one wherever a move starts or finishes
+    CrossfaderEngine::Breakpoint breakpoints[CrossfaderEngine::maxBreakpoints];
+    int numBreakpoints = crossfaderEngine.getBreakpoints(bufferToFill.numSamples, breakpoints);
+
+    //A side that is silent for the whole block isn't mixed at all
+    bool sideAudible[3] = { true, false, false };
+    for (int i = 0; i < numBreakpoints; ++i)
+    {
+        sideAudible[(int) CrossfaderAssign::a] |= breakpoints[i].gainA != 0.0f;
+        sideAudible[(int) CrossfaderAssign::b] |= breakpoints[i].gainB != 0.0f;
+    }
+
+    //Serve the block in pieces no bigger than the strip buffers
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += blockSize)
+    {
+        int numSamples = jmin(blockSize, bufferToFill.numSamples - offset);
+
+        //Every deck keeps playing even when it can't be heard, so its position moves on
+        pieceSize = numSamples;
+        //Synced decks read the clock while they render, so it moves on first
+        if (masterClock != nullptr)
+            masterClock->advance(numSamples);
+
+        if (renderPool != nullptr)
+            renderPool->render(*this, numberOfDecks);
+        else
+            for (int deck = 0; deck < numberOfDecks; ++deck)
+                renderDeck(deck);
+
+        int audibleDecks[maxDecks];
+        int numStrips = 0;
+
+        for (int deck = 0; deck < numberOfDecks; ++deck)
+        {
+            auto& strip = strips[(size_t) deck];
+            if (strip.source == nullptr || ! sideAudible[strip.assign.load()])
+                continue;
+
+            float startGain = strip.appliedGain + gainSteps[deck] * (float) offset;
+            if (startGain == 0.0f && gainSteps[deck] == 0.0f)
+                continue;
+
+            audibleDecks[numStrips++] = deck;
+        }
+
+        //Mix each stretch between breakpoints that falls in this piece
+        for (int b = 0; b + 1 < numBreakpoints; ++b)
+        {
+            auto& from = breakpoints[b];
+            auto& to = breakpoints[b + 1];
+            int start = jmax(from.sample, offset);
+            int end = jmin(to.sample, offset + numSamples);
+
+            if (end <= start)
+                continue;
+
+            //Crossfader gains at both ends of the stretch
+            auto crossfaderGain = [&from, &to] (int assign, int sample)
+            {
+                if (assign == (int) CrossfaderAssign::thru)
+                    return 1.0f;
+
+                float progress = (float) (sample - from.sample) / (float) jmax(1, to.sample - from.sample);
+                return assign == (int) CrossfaderAssign::a ? from.gainA + (to.gainA - from.gainA) * progress
+                                                           : from.gainB + (to.gainB - from.gainB) * progress;
+            };
+
+            const float* inputs[2][maxDecks];
+            float startGains[maxDecks], steps[maxDecks];
+
+            for (int s = 0; s < numStrips; ++s)
+            {
+                int deck = audibleDecks[s];
+                auto& strip = strips[(size_t) deck];
+                int assign = strip.assign.load();
+
+                float startGain = (strip.appliedGain + gainSteps[deck] * (float) start) * crossfaderGain(assign, start);
+                float endGain = (strip.appliedGain + gainSteps[deck] * (float) end) * crossfaderGain(assign, end);
+
+                inputs[0][s] = strip.buffer.getReadPointer(0, start - offset);
+                inputs[1][s] = strip.buffer.getReadPointer(1, start - offset);
+                startGains[s] = startGain;
+                steps[s] = (endGain - startGain) / (float) (end - start);
+            }
+
+            for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+                mixStrips(bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + start),
+                          inputs[jmin(channel, 1)], startGains, steps, numStrips, end - start);
+        }
+    }
+
+    for (int deck = 0; deck < numberOfDecks; ++deck)
+        strips[(size_t) deck].appliedGain = targetGains[deck];
+}
+
+//Function to render one deck into its strip buffer
+void DeckMixer::renderDeck(int deck) noexcept
+{
+    auto& strip = strips[(size_t) deck];
+
+    if (strip.source != nullptr)
+    {
+        AudioSourceChannelInfo info(&strip.buffer, 0, pieceSize);
+        strip.source->getNextAudioBlock(info);
+    }
+}
+
+//Function to multiply a strip's trim and fader gains together
+float DeckMixer::getChannelGain(const Strip& strip) noexcept
+{
+    return strip.trim.load() * strip.fader.load();
+}
+
+//Function to report which kernel this build uses
+bool DeckMixer::isVectorised()
+{
+   #if OTODECKS_MIXER_SSE || OTODECKS_MIXER_NEON
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+//Function to write the ramped sum of every input to the output, each output sample is written once
+void DeckMixer::mixStrips(float* output, const float* const* inputs, const float* startGains,
+                          const float* gainSteps, int numStrips, int numSamples) noexcept
+{
+    int i = 0;
+
+   #if OTODECKS_MIXER_SSE
+    __m128 gains[maxDecks], steps[maxDecks];
+    for (int s = 0; s < numStrips; ++s)
+    {
+        //Lanes hold the gains of four consecutive samples
+        gains[s] = _mm_add_ps(_mm_set1_ps(startGains[s]),
+                              _mm_mul_ps(_mm_set1_ps(gainSteps[s]), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f)));
+        steps[s] = _mm_set1_ps(gainSteps[s] * 4.0f);
+    }
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        __m128 sum = _mm_setzero_ps();
+        for (int s = 0; s < numStrips; ++s)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(inputs[s] + i), gains[s]));
+            gains[s] = _mm_add_ps(gains[s], steps[s]);
+        }
+        _mm_storeu_ps(output + i, sum);
+    }
+   #elif OTODECKS_MIXER_NEON
+    float32x4_t gains[maxDecks], steps[maxDecks];
+    const float laneOffsets[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    for (int s = 0; s < numStrips; ++s)
+    {
+        gains[s] = vmlaq_n_f32(vdupq_n_f32(startGains[s]), vld1q_f32(laneOffsets), gainSteps[s]);
+        steps[s] = vdupq_n_f32(gainSteps[s] * 4.0f);
+    }
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (int s = 0; s < numStrips; ++s)
+        {
+            sum = vmlaq_f32(sum, vld1q_f32(inputs[s] + i), gains[s]);
+            gains[s] = vaddq_f32(gains[s], steps[s]);
+        }
+        vst1q_f32(output + i, sum);
+    }
+   #endif
+
+    //Whatever is left after the vector loop, or everything on other machines
+    for (; i < numSamples; ++i)
+    {
+        float sum = 0.0f;
+        for (int s = 0; s < numStrips; ++s)
+            sum += inputs[s][i] * (startGains[s] + gainSteps[s] * (float) i);
+        output[i] = sum;
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DeckRenderPool.h"
+#include "CrossfaderEngine.h"
+#include "MasterClock.h"
+
+//Mixes between 2 and 8 decks into the master output. Each deck plays into its own channel strip buffer, then a
+//single pass adds every strip to the output with its trim, fader and crossfader gains multiplied together and
+//ramped sample by sample (SSE on x86, NEON on 64-bit ARM, plain loop otherwise). Trim and fader ramp across the
+//block; the crossfader comes from a CrossfaderEngine, which places each move at its own sample in the block.
+//Gains are set from the message thread through atomics and a FIFO, the audio thread never locks. With a
+//DeckRenderPool the decks are rendered in parallel and only the mix-down runs on the device thread alone
+class DeckMixer : public AudioSource,
+                  private DeckRenderPool::Job
+{
+public:
+    //Which side of the crossfader a channel is on, thru channels ignore it
+    enum class CrossfaderAssign
+    {
+        thru = 0,
+        a,
+        b
+    };
+
+    //Range of deck counts the mixer supports
+    static constexpr int minDecks = 2;
+    static constexpr int maxDecks = 8;
+
+    //Constructor: Makes a channel strip for each deck, all at unity gain and thru
+    DeckMixer(int numDecks = 2);
+    //Destructor
+    ~DeckMixer() override;
+
+    //Number of channel strips
+    int getNumDecks() const { return numberOfDecks; }
+
+    //Plugs a deck into a strip, call before prepareToPlay; the mixer doesn't own it
+    void setSource(int deck, AudioSource* source);
+    //Renders the decks on a worker pool instead of one after another, call before prepareToPlay
+    void setRenderPool(DeckRenderPool* poolToUse);
+    //Moves a sync clock on before each piece the decks render, call before prepareToPlay; the mixer doesn't own it
+    void setMasterClock(MasterClock* clockToUse);
+
+    //Any thread: channel strip controls
+    void setTrimDecibels(int deck, float decibels);
+    void setFader(int deck, float level);
+    void setCrossfaderAssign(int deck, CrossfaderAssign assign);
+    //Message thread: 0 is all A, 1 is all B; applied at the start of the next block
+    void setCrossfader(float position);
+    //Message thread: moves the crossfader at the sample matching timeMs on the Time::getMillisecondCounterHiRes clock
+    void moveCrossfader(float position, double timeMs);
+    float getCrossfader() const { return crossfaderEngine.getPosition(); }
+    //Curve, recording and replay of the crossfader
+    CrossfaderEngine& getCrossfaderEngine() { return crossfaderEngine; }
+
+    //AudioSource overrides
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    //Adds numStrips inputs into output, each scaled by a gain that starts at startGains and grows by gainSteps per sample
+    static void mixStrips(float* output, const float* const* inputs, const float* startGains,
+                          const float* gainSteps, int numStrips, int numSamples) noexcept;
+
+    //Returns true if this build uses the SIMD summing kernel
+    static bool isVectorised();
+
+    //The strips are mixed in the block they are rendered in, on the pool or not, so the mixer adds no latency
+    int getLatencyInSamples() const noexcept { return 0; }
+
+private:
+    //One deck's path into the mix
+    struct Strip
+    {
+        AudioSource* source = nullptr;
+        std::atomic<float> trim { 1.0f };
+        std::atomic<float> fader { 1.0f };
+        std::atomic<int> assign { (int) CrossfaderAssign::thru };
+        //Audio thread: gain reached at the end of the last block
+        float appliedGain = 1.0f;
+        //Audio thread: the deck's output for the current block
+        AudioBuffer<float> buffer;
+    };
+
+    //Product of a strip's trim and fader gains
+    static float getChannelGain(const Strip& strip) noexcept;
+    //DeckRenderPool::Job override: renders one deck into its strip buffer for the current piece of the block
+    void renderDeck(int deck) noexcept override;
+
+    std::array<Strip, maxDecks> strips;
+    int numberOfDecks;
+    CrossfaderEngine crossfaderEngine;
+
+    //Largest block the strip buffers hold, longer blocks are mixed in pieces
+    int blockSize = 0;
+    //Length of the piece of the block being rendered
+    int pieceSize = 0;
+    //Optional pool the decks are rendered on
+    DeckRenderPool* renderPool = nullptr;
+    //Optional clock the decks sync to
+    MasterClock* masterClock = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckMixer)
+};
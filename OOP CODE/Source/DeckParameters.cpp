@@ -0,0 +1,78 @@
+#include "DeckParameters.h"
+
+//Constructor: Defaults match the deck's sliders at rest
+DeckParameters::DeckParameters()
+{
+    targets[gain] = 1.0f;
+    targets[wetDry] = 0.0f;
+    targets[bass] = 0.0f;
+    targets[mid] = 1.0f;
+    targets[treble] = 0.0f;
+
+    for (size_t i = 0; i < targets.size(); ++i)
+        smoothers[i].setCurrentAndTargetValue(targets[i].load());
+}
+
+//Function to publish a new target value from the UI
+void DeckParameters::setTarget(ParameterId parameter, float newTarget) noexcept
+{
+    targets[(size_t) parameter].store(newTarget, std::memory_order_relaxed);
+}
+
+//Function to read the last published target value
+float DeckParameters::getTarget(ParameterId parameter) const noexcept
+{
+    return targets[(size_t) parameter].load(std::memory_order_relaxed);
+}
+
+//Function to set the ramp length and jump every smoother to its target
+void DeckParameters::prepare(double sampleRate, double rampLengthSeconds)
+{
+    for (size_t i = 0; i < smoothers.size(); ++i)
+    {
+        smoothers[i].reset(sampleRate, rampLengthSeconds);
+        smoothers[i].setCurrentAndTargetValue(targets[i].load());
+    }
+}
+
+//Function to move every smoother towards the latest published target
+void DeckParameters::updateSmoothingTargets() noexcept
+{
+    for (size_t i = 0; i < smoothers.size(); ++i)
+        smoothers[i].setTargetValue(targets[i].load(std::memory_order_relaxed));
+}
+
+//Function to fill the coefficient table across the knob's range
+void CoefficientTable::build(const std::function<IIRCoefficients(double)>& makeCoefficients,
+                             double minValue, double maxValue, int numPoints)
+{
+    jassert(numPoints > 1 && maxValue > minValue);
+
+    minimum = minValue;
+    maximum = maxValue;
+
+    table.resize((size_t) numPoints);
+
+    for (int i = 0; i < numPoints; ++i)
+        table[(size_t) i] = makeCoefficients(minValue + (maxValue - minValue) * i / (numPoints - 1));
+}
+
+//Function to look up the coefficients for a knob position
+IIRCoefficients CoefficientTable::lookup(double value) const noexcept
+{
+    jassert(isBuilt());
+
+    //Position of the value in the table, between two entries
+    auto position = (jlimit(minimum, maximum, value) - minimum) / (maximum - minimum) * (double) (table.size() - 1);
+    auto index = jmin((int) position, (int) table.size() - 2);
+    auto fraction = (float) (position - index);
+
+    const auto& lower = table[(size_t) index];
+    const auto& upper = table[(size_t) index + 1];
+
+    IIRCoefficients result;
+    for (int i = 0; i < 5; ++i)
+        result.coefficients[i] = lower.coefficients[i] + fraction * (upper.coefficients[i] - lower.coefficients[i]);
+
+    return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <array>
+
+//Real-time safe parameter handoff for one deck. The UI (or a controller at up to ~1 kHz) stores targets
+//into atomics, and the audio thread picks them up once per block and smooths towards them
+class DeckParameters
+{
+public:
+    //Parameters a deck exposes to the UI
+    enum ParameterId
+    {
+        gain = 0,   //Linear deck gain, 0 to 1
+        wetDry,     //Reverb mix, 0 to 1
+        bass,       //Bass knob position, -1 to 1
+        mid,        //Linear mid gain factor
+        treble,     //Treble knob position, -1 to 1
+        numParameters
+    };
+
+    //Constructor: Sets every parameter to its default
+    DeckParameters();
+
+    //Any thread: publishes a new target, never blocks
+    void setTarget(ParameterId parameter, float newTarget) noexcept;
+    //Any thread: reads the last published target
+    float getTarget(ParameterId parameter) const noexcept;
+
+    //Resets the smoothers to the current targets, call from prepareToPlay
+    void prepare(double sampleRate, double rampLengthSeconds = 0.02);
+
+    //Audio thread: picks up the latest targets, call once at the start of each block
+    void updateSmoothingTargets() noexcept;
+    //Audio thread: advances one sample and returns the smoothed value
+    float getNextValue(ParameterId parameter) noexcept { return smoothers[(size_t) parameter].getNextValue(); }
+    //Audio thread: advances a whole sub-block and returns the value at its end
+    float skip(ParameterId parameter, int numSamples) noexcept { return smoothers[(size_t) parameter].skip(numSamples); }
+    //Audio thread: reads the current smoothed value without advancing
+    float getCurrentValue(ParameterId parameter) const noexcept { return smoothers[(size_t) parameter].getCurrentValue(); }
+    //Audio thread: checks if the parameter is still moving towards its target
+    bool isSmoothing(ParameterId parameter) const noexcept { return smoothers[(size_t) parameter].isSmoothing(); }
+
+private:
+    std::array<std::atomic<float>, numParameters> targets;
+    std::array<SmoothedValue<float>, numParameters> smoothers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckParameters)
+};
+
+//Filter coefficients precomputed across a knob's range when the deck is prepared, so the audio thread
+//only interpolates between table entries instead of calling the coefficient designers
+class CoefficientTable
+{
+public:
+    //Fills the table by calling makeCoefficients at numPoints evenly spaced knob positions
+    void build(const std::function<IIRCoefficients(double)>& makeCoefficients,
+               double minValue, double maxValue, int numPoints = 512);
+
+    //Audio thread: coefficients for a knob position, linearly interpolated between neighbouring entries
+    IIRCoefficients lookup(double value) const noexcept;
+
+    //Check if build has been called
+    bool isBuilt() const noexcept { return ! table.empty(); }
+
+private:
+    std::vector<IIRCoefficients> table;
+    double minimum = 0.0;
+    double maximum = 1.0;
+};
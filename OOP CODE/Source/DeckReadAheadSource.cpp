@@ -0,0 +1,412 @@
+#include "DeckReadAheadSource.h"
+
+//Constructor: Stores the wrapped source and the shared background thread
+DeckReadAheadSource::DeckReadAheadSource(PositionableAudioSource* sourceToBuffer,
+                                         TimeSliceThread& backgroundThreadToUse,
+                                         bool deleteSourceWhenDeleted,
+                                         int readAheadSamples,
+                                         int numChannels)
+    : source(sourceToBuffer, deleteSourceWhenDeleted),
+      backgroundThread(backgroundThreadToUse),
+      numberOfSamplesToBuffer(jmax(1024, readAheadSamples)),
+      numberOfSamplesToKeepBehind(numberOfSamplesToBuffer / 2),
+      numberOfChannels(numChannels)
+{
+    jassert(source != nullptr);
+}
+
+//Destructor: Stops the background thread from touching this source
+DeckReadAheadSource::~DeckReadAheadSource()
+{
+    releaseResources();
+}
+
+//Function to allocate the circular buffer and register with the background thread
+void DeckReadAheadSource::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
+{
+    //The buffer must always hold at least two device blocks ahead, and what is kept behind
+    auto bufferSizeNeeded = jmax(samplesPerBlockExpected * 2, numberOfSamplesToBuffer) + numberOfSamplesToKeepBehind;
+
+    if (newSampleRate != sampleRate || bufferSizeNeeded != buffer.getNumSamples() || ! isPrepared)
+    {
+        backgroundThread.removeTimeSliceClient(this);
+
+        isPrepared = true;
+        sampleRate = newSampleRate;
+
+        source->prepareToPlay(samplesPerBlockExpected, newSampleRate);
+
+        buffer.setSize(numberOfChannels, bufferSizeNeeded);
+        buffer.clear();
+
+        {
+            const ScopedLock sl(callbackLock);
+            setValidRange(0, 0);
+        }
+
+        backgroundThread.addTimeSliceClient(this);
+    }
+}
+
+//Function to free the buffer and detach from the background thread
+void DeckReadAheadSource::releaseResources()
+{
+    isPrepared = false;
+    backgroundThread.removeTimeSliceClient(this);
+
+    buffer.setSize(numberOfChannels, 0);
+
+    {
+        const ScopedLock sl(callbackLock);
+        setValidRange(0, 0);
+    }
+
+    source->releaseResources();
+}
+
+//Function to copy already decoded samples to the output, counting an underrun if some were missing
+void DeckReadAheadSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    readSamples(*bufferToFill.buffer, bufferToFill.startSample, nextPlayPos.load(), bufferToFill.numSamples);
+
+    nextPlayPos += bufferToFill.numSamples;
+    readingBackwards = false;
+    scrubbing = false;
+}
+
+//Function to copy decoded samples from anywhere in the window, silence where there are none. The range is read
+//without a lock, so a background thread stalled halfway through changing it can never hold up the device callback;
+//a copy the version says may have raced with a decode is made again, and given up on as an underrun
+void DeckReadAheadSource::readSamples(AudioBuffer<float>& dest, int destStartSample, int64 start, int numSamples)
+{
+    for (int attempt = 0; attempt < maxCopyAttempts; ++attempt)
+    {
+        auto version = validRangeVersion.load(std::memory_order_acquire);
+        if ((version & 1) != 0)
+            continue;
+
+        auto validFrom = bufferValidStart.load(std::memory_order_relaxed);
+        auto validTo = bufferValidEnd.load(std::memory_order_relaxed);
+        copyFromWindow(dest, destStartSample, start, numSamples, validFrom, validTo);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (validRangeVersion.load(std::memory_order_relaxed) != version)
+            continue;
+
+        auto validStart = static_cast<int>(jlimit(validFrom, jmax(validFrom, validTo), start) - start);
+        auto validEnd   = static_cast<int>(jlimit(validFrom, jmax(validFrom, validTo), start + numSamples) - start);
+
+        //Samples that actually exist in the track, so reading past either end is not reported as an underrun
+        auto trackStart = static_cast<int>(jlimit((int64) 0, (int64) numSamples, -start));
+        auto trackEnd = isLooping() ? numSamples
+                                    : static_cast<int>(jlimit((int64) 0, (int64) numSamples, getTotalLength() - start));
+
+        if (trackStart < trackEnd && (validStart > trackStart || validEnd < trackEnd))
+            ++numUnderruns;
+
+        return;
+    }
+
+    dest.clear(destStartSample, numSamples);
+    ++numUnderruns;
+}
+
+//Function to copy the part of a block inside a valid range from the circular buffer and silence the rest
+void DeckReadAheadSource::copyFromWindow(AudioBuffer<float>& dest, int destStartSample, int64 start, int numSamples,
+                                         int64 validFrom, int64 validTo) const noexcept
+{
+    validTo = jmax(validFrom, validTo);
+    auto validStart = static_cast<int>(jlimit(validFrom, validTo, start) - start);
+    auto validEnd   = static_cast<int>(jlimit(validFrom, validTo, start + numSamples) - start);
+
+    if (validStart == validEnd || buffer.getNumSamples() == 0)
+    {
+        //Nothing decoded for this block yet
+        dest.clear(destStartSample, numSamples);
+        return;
+    }
+
+    //Silence any part of the block that is outside the decoded range
+    if (validStart > 0)
+        dest.clear(destStartSample, validStart);
+
+    if (validEnd < numSamples)
+        dest.clear(destStartSample + validEnd, numSamples - validEnd);
+
+    for (int channel = 0; channel < dest.getNumChannels(); ++channel)
+    {
+        //Mono tracks feed every output channel
+        auto sourceChannel = jmin(channel, buffer.getNumChannels() - 1);
+
+        auto startBufferIndex = static_cast<int>((validStart + start) % buffer.getNumSamples());
+        auto endBufferIndex   = static_cast<int>((validEnd + start) % buffer.getNumSamples());
+
+        if (startBufferIndex < endBufferIndex)
+        {
+            dest.copyFrom(channel, destStartSample + validStart,
+                          buffer, sourceChannel, startBufferIndex,
+                          validEnd - validStart);
+        }
+        else
+        {
+            //The decoded range wraps around the end of the circular buffer
+            auto initialSize = buffer.getNumSamples() - startBufferIndex;
+
+            dest.copyFrom(channel, destStartSample + validStart,
+                          buffer, sourceChannel, startBufferIndex,
+                          initialSize);
+
+            dest.copyFrom(channel, destStartSample + validStart + initialSize,
+                          buffer, sourceChannel, 0,
+                          (validEnd - validStart) - initialSize);
+        }
+    }
+}
+
+//Function to publish a new valid range: the version goes odd, the range changes, and the version goes even again.
+//The release fence also keeps every sample decoded before the call ahead of the range that includes it
+void DeckReadAheadSource::setValidRange(int64 newValidStart, int64 newValidEnd) noexcept
+{
+    auto version = validRangeVersion.load(std::memory_order_relaxed);
+    validRangeVersion.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    bufferValidStart.store(newValidStart, std::memory_order_relaxed);
+    bufferValidEnd.store(newValidEnd, std::memory_order_relaxed);
+
+    validRangeVersion.store(version + 2, std::memory_order_release);
+}
+
+//Function to move the playhead from the message thread, the background thread is woken up to refill from there
+void DeckReadAheadSource::setNextReadPosition(int64 newPosition)
+{
+    nextPlayPos = newPosition;
+    readingBackwards = false;
+    scrubbing = false;
+    backgroundThread.moveToFrontOfQueue(this);
+}
+
+//Function to move the playhead from the audio thread, the background thread finds the seek at its next time slice
+void DeckReadAheadSource::jumpPlayhead(int64 newPosition) noexcept
+{
+    nextPlayPos = newPosition;
+    readingBackwards = false;
+    scrubbing = false;
+    seekPending = true;
+}
+
+//Function to move the playhead while reading at a varying speed, the background thread finds it when it next checks
+void DeckReadAheadSource::movePlayhead(int64 newPosition, bool backwards) noexcept
+{
+    nextPlayPos = newPosition;
+    readingBackwards = backwards;
+    scrubbing = true;
+}
+
+//Function to get the position the next block will be read from
+int64 DeckReadAheadSource::getNextReadPosition() const
+{
+    auto pos = nextPlayPos.load();
+    auto length = source->getTotalLength();
+
+    return (source->isLooping() && pos > 0 && length > 0) ? pos % length
+                                                          : pos;
+}
+
+//Function to get the length of the wrapped source in samples
+int64 DeckReadAheadSource::getTotalLength() const
+{
+    return source->getTotalLength();
+}
+
+//Function to check if the wrapped source loops
+bool DeckReadAheadSource::isLooping() const
+{
+    return source->isLooping();
+}
+
+//Function called by the background thread, returns how long to wait before the next call
+int DeckReadAheadSource::useTimeSlice()
+{
+    //While a loader is priming this source, let the shared thread serve the other decks
+    const ScopedTryLock rl(readLock);
+
+    if (! rl.isLocked())
+        return 10;
+
+    //A jump from the audio thread: decode from there and come straight back for the next chunk
+    if (seekPending.exchange(false))
+        return readNextBufferChunk() ? 0 : 1;
+
+    //A scrubbed playhead can move any distance either way between calls, so don't sleep long
+    if (readNextBufferChunk())
+        return 1;
+
+    return scrubbing.load() ? 5 : idleWaitMs;
+}
+
+//Function to fill the buffer ahead of the playhead straight away, used when a track is being loaded
+void DeckReadAheadSource::prime(int numSamples, std::function<void(float)> progressCallback)
+{
+    jassert(isPrepared);
+
+    //Never ask for more than the buffer holds ahead or the track has left
+    auto target = static_cast<int>(jmin((int64) numSamples,
+                                        (int64) buffer.getNumSamples() - 4 - numberOfSamplesToKeepBehind,
+                                        jmax((int64) 0, getTotalLength() - nextPlayPos.load())));
+
+    const ScopedLock rl(readLock);
+
+    while (getNumBufferedSamples() < target)
+    {
+        if (! readNextBufferChunk())
+            break;
+
+        if (progressCallback != nullptr)
+            progressCallback(static_cast<float>(getNumBufferedSamples()) / static_cast<float>(target));
+    }
+}
+
+//Function to get how many samples after the playhead have been decoded
+int DeckReadAheadSource::getNumBufferedSamples() const
+{
+    auto pos = nextPlayPos.load();
+    auto validStart = bufferValidStart.load();
+    auto validEnd = bufferValidEnd.load();
+
+    if (pos < validStart || pos >= validEnd)
+        return 0;
+
+    return static_cast<int>(validEnd - pos);
+}
+
+//Function to decode the next chunk of audio around the playhead
+bool DeckReadAheadSource::readNextBufferChunk()
+{
+    int64 sectionToReadStart, sectionToReadEnd, newBVS, newBVE;
+
+    if (! findNextSection(sectionToReadStart, sectionToReadEnd, newBVS, newBVE))
+        return false;
+
+    auto bufferIndexStart = static_cast<int>(sectionToReadStart % buffer.getNumSamples());
+    auto bufferIndexEnd   = static_cast<int>(sectionToReadEnd % buffer.getNumSamples());
+
+    if (bufferIndexStart < bufferIndexEnd)
+    {
+        readBufferSection(sectionToReadStart,
+                          static_cast<int>(sectionToReadEnd - sectionToReadStart),
+                          bufferIndexStart);
+    }
+    else
+    {
+        auto initialSize = buffer.getNumSamples() - bufferIndexStart;
+
+        readBufferSection(sectionToReadStart, initialSize, bufferIndexStart);
+        readBufferSection(sectionToReadStart + initialSize,
+                          static_cast<int>(sectionToReadEnd - sectionToReadStart) - initialSize,
+                          0);
+    }
+
+    {
+        const ScopedLock sl2(callbackLock);
+        setValidRange(newBVS, newBVE);
+    }
+
+    return true;
+}
+
+//Function to choose what to decode next: the side of the window the playhead is heading for first, then the other
+bool DeckReadAheadSource::findNextSection(int64& sectionStart, int64& sectionEnd, int64& newValidStart, int64& newValidEnd)
+{
+    //Largest amount decoded in one go so a seek is never stuck behind a long read
+    const int64 maxChunkSize = 2048;
+    //Going backwards every chunk starts with a seek, which on a compressed file has to decode from a frame before it;
+    //larger chunks spread that cost over more samples
+    const int64 maxBackwardChunkSize = 8192;
+    //Smallest top-up worth a read
+    const int64 minTopUp = 512;
+
+    const ScopedLock sl(callbackLock);
+
+    if (buffer.getNumSamples() == 0)
+        return false;
+
+    if (wasSourceLooping != isLooping())
+    {
+        wasSourceLooping = isLooping();
+        setValidRange(0, 0);
+    }
+
+    auto pos = jmax((int64) 0, nextPlayPos.load());
+    bool backwards = readingBackwards.load();
+    auto capacity = (int64) buffer.getNumSamples() - 4;
+    auto behind = (int64) numberOfSamplesToKeepBehind;
+    auto forwardChunk = jmin(maxChunkSize, capacity);
+    auto backwardChunk = jmin(maxBackwardChunkSize, capacity / 2);
+
+    //Window wanted around the playhead, the read-ahead size in the direction it is going
+    auto wantStart = jmax((int64) 0, pos - (backwards ? capacity - behind : behind));
+    auto wantEnd = pos + (backwards ? behind : capacity - behind);
+
+    if (bufferValidStart >= bufferValidEnd || pos >= bufferValidEnd || pos < bufferValidStart - backwardChunk)
+    {
+        //The playhead jumped away from the decoded range, start again from there
+        if (backwards)
+        {
+            sectionStart = jmax((int64) 0, pos - backwardChunk / 2);
+            sectionEnd = sectionStart + backwardChunk;
+        }
+        else
+        {
+            sectionStart = pos;
+            sectionEnd = pos + forwardChunk;
+        }
+
+        newValidStart = sectionStart;
+        newValidEnd = sectionEnd;
+        setValidRange(0, 0);
+        return true;
+    }
+
+    bool playheadMissing = pos < bufferValidStart;
+    bool forwardDue = wantEnd - bufferValidEnd >= minTopUp;
+    bool backwardDue = playheadMissing || bufferValidStart - wantStart >= minTopUp
+                         || (wantStart == 0 && bufferValidStart > 0);
+
+    if (forwardDue && ! playheadMissing && ! (backwards && backwardDue))
+    {
+        //Extend the decoded range ahead, the oldest samples behind make room
+        sectionStart = bufferValidEnd;
+        sectionEnd = jmin(wantEnd, bufferValidEnd + forwardChunk);
+        newValidEnd = sectionEnd;
+        newValidStart = jmax(bufferValidStart.load(), newValidEnd - capacity);
+
+        //The samples about to be overwritten stop being valid before the read
+        setValidRange(newValidStart, bufferValidEnd.load());
+        return true;
+    }
+
+    if (backwardDue)
+    {
+        //Extend the decoded range behind, dropping samples at the far end if the buffer is full
+        sectionEnd = bufferValidStart;
+        sectionStart = jmax(wantStart, bufferValidStart - backwardChunk);
+        newValidStart = sectionStart;
+        newValidEnd = jmin(bufferValidEnd.load(), newValidStart + capacity);
+
+        setValidRange(bufferValidStart.load(), newValidEnd);
+        return true;
+    }
+
+    return false;
+}
+
+//Function to decode part of the wrapped source straight into the circular buffer
+void DeckReadAheadSource::readBufferSection(int64 start, int length, int bufferOffset)
+{
+    if (source->getNextReadPosition() != start)
+        source->setNextReadPosition(start);
+
+    AudioSourceChannelInfo info(&buffer, bufferOffset, length);
+    source->getNextAudioBlock(info);
+}
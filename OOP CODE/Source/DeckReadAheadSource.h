@@ -0,0 +1,114 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Buffered streaming source that decodes a deck's track ahead of the playhead on a shared background thread,
+//so that disk reads and MP3/FLAC decoding never happen inside the audio device callback.
+//
+//The window reaches both ways from the playhead: the read-ahead size in the direction it is moving and half that
+//behind it. Playing forwards, what was just played stays behind the playhead; playing backwards the background thread
+//decodes the track in chunks going down, each one a seek and a forward decode, so reverse play and scratching read
+//from memory even on compressed formats
+class DeckReadAheadSource : public PositionableAudioSource,
+                            private TimeSliceClient
+{
+public:
+    //Constructor: Wraps a source and buffers readAheadSamples of it using the given background thread
+    DeckReadAheadSource(PositionableAudioSource* sourceToBuffer,
+                        TimeSliceThread& backgroundThreadToUse,
+                        bool deleteSourceWhenDeleted,
+                        int readAheadSamples,
+                        int numChannels = 2);
+    //Destructor: Detaches from the background thread
+    ~DeckReadAheadSource() override;
+
+    //AudioSource overrides
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    //PositionableAudioSource overrides
+    void setNextReadPosition(int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    //Returns how many samples are decoded ahead of the playhead
+    int getReadAheadSize() const { return numberOfSamplesToBuffer; }
+    //Returns how many samples are kept on the other side of the playhead
+    int getReadBehindSize() const { return numberOfSamplesToKeepBehind; }
+
+    //Audio thread: copies numSamples from position start into dest without moving the playhead, silence where nothing
+    //is decoded; a block missing samples inside the track counts as an underrun
+    void readSamples(AudioBuffer<float>& dest, int destStartSample, int64 start, int numSamples);
+    //Audio thread: moves the playhead for reading at a varying speed and says which way it is going. The background
+    //thread isn't woken, it checks every few milliseconds until normal playback or a seek takes over again
+    void movePlayhead(int64 newPosition, bool backwards) noexcept;
+    //Audio thread: moves the playhead for a jump such as a loop wrap or a hot cue. Waking the background thread would
+    //take its list lock, so a pending seek is flagged instead and picked up at its next time slice
+    void jumpPlayhead(int64 newPosition) noexcept;
+
+    //Decodes up to numSamples ahead of the playhead on the calling thread instead of waiting for
+    //the background thread, reporting the fraction done; call after prepareToPlay
+    void prime(int numSamples, std::function<void(float)> progressCallback = nullptr);
+    //Returns how many samples after the playhead are already decoded
+    int getNumBufferedSamples() const;
+
+    //Returns how many audio blocks asked for samples that had not been decoded yet
+    int getNumUnderruns() const { return numUnderruns.load(); }
+    //Resets the underrun counter back to zero
+    void resetUnderrunCount() { numUnderruns = 0; }
+
+private:
+    //TimeSliceClient override: decodes the next chunk on the background thread
+    int useTimeSlice() override;
+    //Tops up the circular buffer around the playhead, returns false if nothing needed reading
+    bool readNextBufferChunk();
+    //Works out the next section to decode and marks the part of the buffer it overwrites invalid, false if none
+    bool findNextSection(int64& sectionStart, int64& sectionEnd, int64& newValidStart, int64& newValidEnd);
+    //Reads a section of the wrapped source into the circular buffer
+    void readBufferSection(int64 start, int length, int bufferOffset);
+    //Publishes a new valid range to the audio thread, call with callbackLock held
+    void setValidRange(int64 newValidStart, int64 newValidEnd) noexcept;
+    //Audio thread: copies what lies inside a valid range from the circular buffer, silence elsewhere
+    void copyFromWindow(AudioBuffer<float>& dest, int destStartSample, int64 start, int numSamples,
+                        int64 validFrom, int64 validTo) const noexcept;
+
+    OptionalScopedPointer<PositionableAudioSource> source;
+    TimeSliceThread& backgroundThread;
+    int numberOfSamplesToBuffer;
+    int numberOfSamplesToKeepBehind;
+    int numberOfChannels;
+
+    //Circular buffer indexed by absolute sample position modulo its length
+    AudioBuffer<float> buffer;
+    //Serialises the threads that change the valid range; the audio thread never takes it
+    CriticalSection callbackLock;
+    //Stops the background thread and prime() from decoding at the same time
+    CriticalSection readLock;
+    //Range of decoded samples, read by the audio thread without a lock. The version is odd while the range changes
+    //and moves on every time it does, so the audio thread can tell whether samples it copied could have been
+    //overwritten while it copied them; a decode only ever overwrites samples after the range has been shrunk off them
+    std::atomic<int64> bufferValidStart { 0 };
+    std::atomic<int64> bufferValidEnd { 0 };
+    std::atomic<uint32> validRangeVersion { 0 };
+    //Times the audio thread copies a block before giving up on a range that keeps changing and playing silence
+    static constexpr int maxCopyAttempts = 8;
+    std::atomic<int64> nextPlayPos { 0 };
+    //Set by movePlayhead, cleared by normal playback and seeks
+    std::atomic<bool> readingBackwards { false };
+    std::atomic<bool> scrubbing { false };
+    //Set by jumpPlayhead, cleared by the background thread when it starts decoding from the new position
+    std::atomic<bool> seekPending { false };
+    //Longest the background thread sleeps with nothing to decode, so a seek from the audio thread is found this soon
+    static constexpr int idleWaitMs = 10;
+
+    double sampleRate = 0.0;
+    bool wasSourceLooping = false;
+    bool isPrepared = false;
+
+    //Number of blocks the audio thread had to fill with silence
+    std::atomic<int> numUnderruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckReadAheadSource)
+};
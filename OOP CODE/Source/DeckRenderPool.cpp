@@ -0,0 +1,194 @@
+#include "DeckRenderPool.h"
+#include "AllocationTripwire.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+#endif
+
+namespace
+{
+    //Tells the CPU the thread is busy-waiting, so it saves power and lets the other hyperthread run
+    inline void spinPause() noexcept
+    {
+       #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        _mm_pause();
+       #elif defined(__aarch64__)
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+
+    //Roughly 20-50 microseconds of pausing before a waiting worker starts yielding its core
+    constexpr int spinsBeforeYield = 2000;
+}
+
+//One pinned real-time thread that waits for blocks and helps render them
+class DeckRenderPool::Worker : public Thread
+{
+public:
+    //Constructor: Names the thread after its position in the pool
+    Worker(DeckRenderPool& owner, int index)
+        : Thread("Deck render " + String(index + 1)),
+          pool(owner),
+          core(index + 1)
+    {
+    }
+
+    //Function to start the thread at real-time priority on its own core, leaving core 0 for the device and UI
+    void launch()
+    {
+        //JUCE applies the mask when the thread starts
+        if (core < 32 && core < SystemStats::getNumCpus())
+            setAffinityMask((uint32) 1 << core);
+
+        if (! startRealtimeThread(RealtimeOptions().withPriority(9)))
+            startThread(Priority::highest);
+    }
+
+    //Function to stop the thread, waking it first if it is asleep
+    void halt()
+    {
+        signalThreadShouldExit();
+        wakeEvent.signal();
+        stopThread(1000);
+    }
+
+    //Function to wait for each new block and help render it
+    void run() override
+    {
+        ScopedNoDenormals noDenormals;
+
+        auto seenGeneration = (uint32) (pool.work.load() >> 32);
+        auto lastWorkTime = Time::getMillisecondCounter();
+        int spins = 0;
+
+        while (! threadShouldExit())
+        {
+            auto generation = (uint32) (pool.work.load() >> 32);
+
+            if (generation != seenGeneration)
+            {
+                seenGeneration = generation;
+                pool.helpWithJob(generation);
+                lastWorkTime = Time::getMillisecondCounter();
+                spins = 0;
+            }
+            else if (++spins < spinsBeforeYield)
+            {
+                spinPause();
+            }
+            else if (Time::getMillisecondCounter() - lastWorkTime < (uint32) idleTimeoutMs)
+            {
+                //Let other threads use the core until the next block arrives
+                Thread::yield();
+            }
+            else
+            {
+                //No blocks for a while, the audio has probably stopped; render() wakes us if one arrives.
+                //The flag is set before looking at the generation again, so a block can't slip through unseen
+                sleeping = true;
+                if ((uint32) (pool.work.load() >> 32) == seenGeneration)
+                    wakeEvent.wait(idleTimeoutMs);
+                sleeping = false;
+
+                lastWorkTime = Time::getMillisecondCounter();
+                spins = 0;
+            }
+        }
+    }
+
+    //Set while the worker is waiting on its event rather than spinning
+    std::atomic<bool> sleeping { false };
+    WaitableEvent wakeEvent;
+
+private:
+    DeckRenderPool& pool;
+    int core;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Worker)
+};
+
+//Constructor: Starts the workers straight away so no thread is ever created while audio is running
+DeckRenderPool::DeckRenderPool(int numWorkers, int minDecksForParallel)
+    : minDecks(jmax(2, minDecksForParallel))
+{
+    if (numWorkers < 0)
+        numWorkers = jmin(7, SystemStats::getNumCpus() - 1);
+
+    for (int i = 0; i < numWorkers; ++i)
+        workers.add(new Worker(*this, i))->launch();
+}
+
+//Destructor: Stops every worker
+DeckRenderPool::~DeckRenderPool()
+{
+    for (auto* worker : workers)
+        worker->halt();
+}
+
+//Function to turn parallel rendering on or off
+void DeckRenderPool::setParallelEnabled(bool shouldBeParallel)
+{
+    parallelEnabled = shouldBeParallel;
+}
+
+//Function to check if a block would be split across the workers
+bool DeckRenderPool::willRenderInParallel(int numDecks) const noexcept
+{
+    return parallelEnabled.load() && ! workers.isEmpty() && numDecks >= minDecks;
+}
+
+//Function to render a block of decks, in parallel when it is worth it
+void DeckRenderPool::render(Job& job, int numDecks) noexcept
+{
+    if (! willRenderInParallel(numDecks))
+    {
+        for (int deck = 0; deck < numDecks; ++deck)
+            job.renderDeck(deck);
+        return;
+    }
+
+    //Everything about the block is in place before the generation moves on
+    currentJob = &job;
+    jobSize = numDecks;
+    decksRemaining = numDecks;
+
+    auto generation = (uint32) (work.load() >> 32) + 1;
+    work = (uint64) generation << 32;
+
+    //Only workers that went idle need waking, running ones are already watching the generation
+    for (auto* worker : workers)
+        if (worker->sleeping.load())
+            worker->wakeEvent.signal();
+
+    //The device thread takes decks too, then waits for the ones still being rendered elsewhere
+    helpWithJob(generation);
+
+    while (decksRemaining.load() > 0)
+        spinPause();
+}
+
+//Function to claim decks one at a time, stopping when they are all taken or the block has moved on
+void DeckRenderPool::helpWithJob(uint32 generation) noexcept
+{
+    //Nothing in here may allocate, Debug builds assert if it does
+    AllocationTripwire::ScopedRealtimeSection realtimeSection;
+
+    //Read after the generation, so these belong to it if any deck can still be claimed
+    auto* job = currentJob.load();
+    auto size = jobSize.load();
+
+    for (;;)
+    {
+        auto current = work.load();
+
+        if ((uint32) (current >> 32) != generation || (int) (current & 0xffffffff) >= size)
+            return;
+
+        //A successful claim means the block is still open, so job and size really are this block's
+        if (work.compare_exchange_weak(current, current + 1))
+        {
+            job->renderDeck((int) (current & 0xffffffff));
+            --decksRemaining;
+        }
+    }
+}
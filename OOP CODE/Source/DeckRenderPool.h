@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Renders the decks of one audio block in parallel on worker threads that are started once, given real-time
+//priority and pinned to their own cores. The device thread publishes a block with a single atomic store; it and
+//the workers then claim decks one at a time from a shared counter, so a heavy deck never holds up the others,
+//and the device thread spins until the last deck is done before mixing down.
+//
+//Between blocks the workers spin and then yield, so in a running session handing over a block never makes a
+//system call. Once no block has arrived for idleTimeoutMs they sleep on an event, and the first block after that
+//wakes them. With fewer decks than minDecksForParallel, or no spare cores, decks are rendered serially on the
+//device thread, which costs less than the handoff for one or two light decks
+class DeckRenderPool
+{
+public:
+    //Work the pool is given once per audio block
+    class Job
+    {
+    public:
+        virtual ~Job() = default;
+        //Renders one deck; called on the device thread or a worker, never twice for the same deck in a block
+        virtual void renderDeck(int deck) noexcept = 0;
+    };
+
+    //Constructor: Starts the workers, -1 uses one per spare core up to seven
+    DeckRenderPool(int numWorkers = -1, int minDecksForParallel = 3);
+    //Destructor: Stops the workers
+    ~DeckRenderPool();
+
+    //Audio thread: renders decks 0 to numDecks - 1 and returns once they are all done
+    void render(Job& job, int numDecks) noexcept;
+
+    //Any thread: turns parallel rendering off and on, for measuring and as a safety switch
+    void setParallelEnabled(bool shouldBeParallel);
+    bool isParallelEnabled() const { return parallelEnabled.load(); }
+    //True if a block with this many decks would be spread over the workers
+    bool willRenderInParallel(int numDecks) const noexcept;
+
+    int getNumWorkers() const { return workers.size(); }
+
+    //How long the workers keep spinning and yielding after the last block before they go to sleep
+    static constexpr int idleTimeoutMs = 100;
+
+private:
+    class Worker;
+
+    //Claims and renders decks from the block with this generation until there are none left
+    void helpWithJob(uint32 generation) noexcept;
+
+    //Generation of the current block in the top 32 bits, next unclaimed deck in the bottom 32
+    std::atomic<uint64> work { 0 };
+    std::atomic<Job*> currentJob { nullptr };
+    std::atomic<int> jobSize { 0 };
+    std::atomic<int> decksRemaining { 0 };
+
+    std::atomic<bool> parallelEnabled { true };
+    int minDecks;
+
+    OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckRenderPool)
+};
@@ -0,0 +1,195 @@
+#include "DeckResamplerSource.h"
+#include "CallbackProfiler.h"
+
+//Constructor: Makes a kernel for every quality tier
+DeckResamplerSource::DeckResamplerSource(AudioSource* inputSource, bool deleteInputWhenDeleted,
+                                         double maxRatio, int numChannels)
+    : input(inputSource, deleteInputWhenDeleted),
+      maximumRatio(jmax(1.0, maxRatio)),
+      numberOfChannels(jmax(1, numChannels))
+{
+    jassert(input != nullptr);
+
+    for (int i = 0; i < 3; ++i)
+        kernels[i] = createKernel((Quality) i);
+}
+
+//Destructor: Lets the input go
+DeckResamplerSource::~DeckResamplerSource()
+{
+}
+
+//Function to make the kernel for a quality tier
+std::unique_ptr<ResamplerKernel> DeckResamplerSource::createKernel(Quality quality)
+{
+    switch (quality)
+    {
+        case Quality::linear:        return std::make_unique<LinearResamplerKernel>();
+        case Quality::lagrange:      return std::make_unique<LagrangeResamplerKernel>();
+        case Quality::polyphaseSinc:
+        default:                     return std::make_unique<PolyphaseSincKernel>();
+    }
+}
+
+//Function to prepare the input, build the kernels and size the buffer for the fastest ratio
+void DeckResamplerSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    inputBlockSize = jmax(1, samplesPerBlockExpected);
+
+    historySize = 0;
+    lookAhead = 0;
+    for (auto& kernel : kernels)
+    {
+        kernel->prepare(maximumRatio);
+        historySize = jmax(historySize, kernel->getNumSamplesBefore());
+        lookAhead = jmax(lookAhead, kernel->getNumSamplesAfter());
+    }
+
+    //History, one block at the fastest ratio, the kernel's look-ahead and the overshoot of one input read
+    int maxInputPerBlock = (int) std::ceil(inputBlockSize * maximumRatio) + 2;
+    inputBuffer.setSize(numberOfChannels, historySize + maxInputPerBlock + lookAhead + inputBlockSize);
+    positions.assign((size_t) inputBlockSize, 0.0);
+
+    currentRatio = ratio.load();
+    resetState();
+}
+
+//Function to release the buffer and the input
+void DeckResamplerSource::releaseResources()
+{
+    input->releaseResources();
+    inputBuffer.setSize(numberOfChannels, 0);
+    positions.clear();
+    positions.shrink_to_fit();
+}
+
+//Function to produce a block at the current ratio, the ratio is ramped across the block if it changed
+void DeckResamplerSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    //Reading the input is timed as its own stage
+    CallbackProfiler::ScopedStage profilerStage(CallbackProfiler::resample);
+
+    if (positions.empty() || inputBuffer.getNumSamples() == 0)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    //The next output sample then comes from exactly where the input was moved to
+    if (resetRequested.exchange(false))
+        resetState();
+
+    const ResamplerKernel& kernel = *kernels[jlimit(0, 2, quality.load())];
+    double targetRatio = ratio.load();
+    double ratioStep = (targetRatio - currentRatio) / jmax(1, bufferToFill.numSamples);
+
+    //Serve the block in pieces no bigger than the buffers were sized for
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += inputBlockSize)
+    {
+        int numSamples = jmin(inputBlockSize, bufferToFill.numSamples - offset);
+
+        //Work out where every output sample falls in the input
+        double largestStep = currentRatio;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            positions[(size_t) i] = readPosition;
+            currentRatio += ratioStep;
+            largestStep = jmax(largestStep, currentRatio);
+            readPosition += currentRatio;
+        }
+
+        pullInput((int) positions[(size_t) numSamples - 1] + lookAhead + 1);
+
+        for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+        {
+            //Mono sources feed every output channel
+            kernel.process(inputBuffer.getReadPointer(jmin(channel, numberOfChannels - 1)), positions.data(),
+                           bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + offset),
+                           numSamples, largestStep);
+        }
+
+        discardUsedInput();
+    }
+
+    currentRatio = targetRatio;
+    bufferedAhead = (int) (inputAvailable - readPosition);
+}
+
+//Function to set the resampling ratio
+void DeckResamplerSource::setResamplingRatio(double newRatio)
+{
+    jassert(newRatio > 0.0);
+    ratio = jlimit(0.01, maximumRatio, newRatio);
+}
+
+//Function to get the resampling ratio
+double DeckResamplerSource::getResamplingRatio() const
+{
+    return ratio.load();
+}
+
+//Function to choose the interpolator
+void DeckResamplerSource::setQuality(Quality newQuality)
+{
+    quality = (int) newQuality;
+}
+
+//Function to get the interpolator in use
+DeckResamplerSource::Quality DeckResamplerSource::getQuality() const
+{
+    return (Quality) quality.load();
+}
+
+//Function to ask the audio thread to drop the buffered input before the next block
+void DeckResamplerSource::requestReset()
+{
+    resetRequested = true;
+}
+
+//Function to get how far the input has been read ahead of what is being played
+int DeckResamplerSource::getLatencyInSamples() const
+{
+    return bufferedAhead.load();
+}
+
+//Function to read blocks from the input until enough is buffered
+void DeckResamplerSource::pullInput(int endIndex)
+{
+    jassert(endIndex <= inputBuffer.getNumSamples());
+
+    while (inputAvailable < endIndex)
+    {
+        int numSamples = jmin(inputBlockSize, inputBuffer.getNumSamples() - inputAvailable);
+        AudioSourceChannelInfo info(&inputBuffer, inputAvailable, numSamples);
+        input->getNextAudioBlock(info);
+        inputAvailable += numSamples;
+    }
+}
+
+//Function to move the input still needed to the front of the buffer
+void DeckResamplerSource::discardUsedInput()
+{
+    int numToDiscard = jmin(inputAvailable, (int) readPosition - historySize);
+
+    if (numToDiscard <= 0)
+        return;
+
+    inputAvailable -= numToDiscard;
+    readPosition -= numToDiscard;
+
+    for (int channel = 0; channel < numberOfChannels; ++channel)
+    {
+        float* data = inputBuffer.getWritePointer(channel);
+        std::memmove(data, data + numToDiscard, sizeof(float) * (size_t) inputAvailable);
+    }
+}
+
+//Function to start from silence, with the history filled with zeros
+void DeckResamplerSource::resetState()
+{
+    inputBuffer.clear();
+    inputAvailable = historySize;
+    readPosition = (double) historySize;
+    bufferedAhead = 0;
+}
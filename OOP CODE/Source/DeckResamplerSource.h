@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PolynomialResamplerKernels.h"
+#include "PolyphaseSincKernel.h"
+
+//Plays its input back at a variable rate for the deck's speed control and sample rate correction, replacing
+//JUCE's fixed ResamplingAudioSource with a choice of interpolators that can be switched while playing.
+//
+//Rough per-deck cost at 48 kHz stereo with 256-sample blocks on one desktop x86 core
+//(measure on the target machine with: OtoDecks --benchmark resampler):
+//  linear         about 0.03% of a core, no anti-aliasing
+//  lagrange       about 0.07% of a core, no anti-aliasing
+//  polyphaseSinc  about 0.16% of a core up to 1x, 0.3% at 2x as the filter is lengthened with the speed
+class DeckResamplerSource : public AudioSource
+{
+public:
+    //Quality tiers, from cheapest to cleanest
+    enum class Quality
+    {
+        linear = 0,
+        lagrange,
+        polyphaseSinc
+    };
+
+    //Constructor: Wraps the source to resample, buffers are sized for ratios up to maxRatio
+    DeckResamplerSource(AudioSource* inputSource, bool deleteInputWhenDeleted, double maxRatio, int numChannels = 2);
+    //Destructor: Releases the input
+    ~DeckResamplerSource() override;
+
+    //AudioSource overrides
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    //Any thread: input samples read per output sample, ramped to over the next block
+    void setResamplingRatio(double newRatio);
+    double getResamplingRatio() const;
+    //Any thread: picks the interpolator, takes effect at the next block without a click
+    void setQuality(Quality newQuality);
+    Quality getQuality() const;
+
+    //Any thread: throws away the buffered input at the next block, call after a seek
+    void requestReset();
+
+    //Input samples that have been read from the source but not played yet
+    int getLatencyInSamples() const;
+
+    //Gives the benchmark direct access to a kernel
+    static std::unique_ptr<ResamplerKernel> createKernel(Quality quality);
+
+private:
+    //Audio thread: reads more input until at least endIndex samples are buffered
+    void pullInput(int endIndex);
+    //Audio thread: drops input that no kernel can look back to any more
+    void discardUsedInput();
+    //Audio thread: empties the buffer and starts again from silence
+    void resetState();
+
+    OptionalScopedPointer<AudioSource> input;
+    double maximumRatio;
+    int numberOfChannels;
+
+    //Kernels for each tier, all prepared up front so switching never allocates
+    std::unique_ptr<ResamplerKernel> kernels[3];
+    std::atomic<double> ratio { 1.0 };
+    std::atomic<int> quality { (int) Quality::polyphaseSinc };
+    std::atomic<bool> resetRequested { false };
+
+    //Input from the source, with enough history before the read position for the widest kernel
+    AudioBuffer<float> inputBuffer;
+    int inputAvailable = 0;
+    int historySize = 0;
+    int lookAhead = 0;
+    //Fractional read position within inputBuffer and the ratio the last block finished on
+    double readPosition = 0.0;
+    double currentRatio = 1.0;
+    //Where each output sample of the current block falls in inputBuffer
+    std::vector<double> positions;
+
+    //Largest block the input source is asked for
+    int inputBlockSize = 512;
+    std::atomic<int> bufferedAhead { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckResamplerSource)
+};
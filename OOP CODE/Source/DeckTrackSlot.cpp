@@ -0,0 +1,501 @@
+#include "DeckTrackSlot.h"
+#include "CallbackProfiler.h"
+#include <cmath>
+
+//Constructor: Starts collecting retired tracks
+DeckTrackSlot::DeckTrackSlot()
+{
+    startTimer(100);
+}
+
+//Destructor: The audio device must already be stopped, so every track can be deleted here
+DeckTrackSlot::~DeckTrackSlot()
+{
+    stopTimer();
+
+    delete queuedTrack.exchange(nullptr);
+    delete fadingTrack;
+    delete liveTrack.exchange(nullptr);
+    delete retiredTrack.exchange(nullptr);
+
+    delete queuedLoop.exchange(nullptr);
+    delete liveLoop;
+    delete retiredLoop.exchange(nullptr);
+
+    for (int index = 0; index < HotCues::numCues; ++index)
+    {
+        delete queuedCues[(size_t) index].exchange(nullptr);
+        delete liveCues[(size_t) index];
+        delete retiredCues[(size_t) index].exchange(nullptr);
+    }
+}
+
+//Function to hand a loaded track to the audio thread
+void DeckTrackSlot::queueTrack(std::unique_ptr<LoadedTrack> track)
+{
+    //A track that was queued but never went live is still ours to delete
+    delete queuedTrack.exchange(track.release());
+}
+
+//Function called at the start of every audio block to pick up a newly loaded track
+bool DeckTrackSlot::swapInQueuedTrack(bool crossfadeFromCurrent)
+{
+    //Wait until the message thread has deleted the previous track
+    if (retiredTrack.load() != nullptr || fadingTrack != nullptr)
+        return false;
+
+    auto* next = queuedTrack.exchange(nullptr);
+    if (next == nullptr)
+        return false;
+
+    auto* previous = liveTrack.exchange(next);
+
+    //A seek aimed at the old track must not move the new one
+    pendingSeek = -1;
+    readPosition = next->getPlaybackSource()->getNextReadPosition();
+    preDecodedAudio = nullptr;
+    playPosition = readPosition;
+    totalLength = next->lengthInSamples;
+    varispeedPosition = (double) readPosition;
+    trackSampleRate = next->sampleRate;
+
+    if (previous != nullptr)
+    {
+        if (crossfadeFromCurrent)
+        {
+            fadingTrack = previous;
+        }
+        else
+        {
+            retiredTrack = previous;
+        }
+    }
+
+    return true;
+}
+
+//Function to prepare the live track and the crossfade buffer
+void DeckTrackSlot::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    preparedBlockSize = samplesPerBlockExpected;
+    preparedSampleRate = sampleRate;
+
+    //Leave room for the larger blocks the resampler asks for at high speeds
+    fadeBuffer.setSize(2, jmax(samplesPerBlockExpected, 512) * 4);
+
+    if (auto* track = liveTrack.load())
+        track->getPlaybackSource()->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+//Function to release the live track's buffers
+void DeckTrackSlot::releaseResources()
+{
+    if (auto* track = liveTrack.load())
+        track->getPlaybackSource()->releaseResources();
+
+    fadeBuffer.setSize(2, 0);
+}
+
+//Function to read the next block from the live track
+void DeckTrackSlot::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    CallbackProfiler::ScopedStage profilerStage(CallbackProfiler::decode);
+
+    auto* track = liveTrack.load();
+
+    if (track == nullptr)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    swapInQueuedLoop(*track);
+    swapInQueuedHotCues(*track);
+
+    auto* loop = getActiveLoop(track);
+
+    auto seek = pendingSeek.exchange(-1);
+    if (seek >= 0)
+        jumpTo(*track, loop, seek);
+
+    if (loop != nullptr)
+    {
+        readLooped(*track, *loop, bufferToFill);
+    }
+    else
+    {
+        readStraight(*track, bufferToFill);
+    }
+
+    playPosition = readPosition;
+
+    if (fadingTrack != nullptr)
+    {
+        //Fade the outgoing track out over this block while the new one fades in
+        if (bufferToFill.numSamples <= fadeBuffer.getNumSamples())
+        {
+            AudioSourceChannelInfo fadeInfo(&fadeBuffer, 0, bufferToFill.numSamples);
+            fadingTrack->getPlaybackSource()->getNextAudioBlock(fadeInfo);
+
+            for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+            {
+                auto fadeChannel = jmin(channel, fadeBuffer.getNumChannels() - 1);
+
+                bufferToFill.buffer->applyGainRamp(channel, bufferToFill.startSample, bufferToFill.numSamples, 0.0f, 1.0f);
+                bufferToFill.buffer->addFromWithRamp(channel, bufferToFill.startSample,
+                                                     fadeBuffer.getReadPointer(fadeChannel),
+                                                     bufferToFill.numSamples, 1.0f, 0.0f);
+            }
+        }
+
+        retiredTrack = fadingTrack;
+        fadingTrack = nullptr;
+    }
+}
+
+//Function to read a block inside a loop, splitting it wherever the loop wraps or the decoded start runs out
+void DeckTrackSlot::readLooped(const LoadedTrack& track, const LoopRegion& loop, const AudioSourceChannelInfo& bufferToFill)
+{
+    auto& source = *track.getPlaybackSource();
+    int done = 0;
+
+    while (done < bufferToFill.numSamples)
+    {
+        int numSamples = bufferToFill.numSamples - done;
+        bool insideLoop = readPosition >= loop.start && readPosition < loop.end;
+
+        //Stop this piece exactly at the loop end, or at the loop start if the playhead hasn't reached the loop yet so
+        //a short loop ahead of it isn't read straight through
+        if (insideLoop)
+            numSamples = (int) jmin((int64) numSamples, loop.end - readPosition);
+        else if (readPosition < loop.start)
+            numSamples = (int) jmin((int64) numSamples, loop.start - readPosition);
+
+        //Play from the decoded start of the loop or a cue while there is some, the read-ahead carries on after it
+        int numRead = preDecodedAudio != nullptr ? readPreDecoded(bufferToFill, done, numSamples) : 0;
+
+        if (numRead == 0)
+        {
+            AudioSourceChannelInfo piece(bufferToFill.buffer, bufferToFill.startSample + done, numSamples);
+            source.getNextAudioBlock(piece);
+            readPosition += numSamples;
+            numRead = numSamples;
+        }
+
+        done += numRead;
+
+        if (insideLoop && readPosition >= loop.end)
+            jumpTo(track, &loop, loop.start);
+    }
+}
+
+//Function to move the playhead, using the loop's decoded start when the new position is inside it
+void DeckTrackSlot::jumpTo(const LoadedTrack& track, const LoopRegion* loop, int64 position)
+{
+    readPosition = position;
+
+    if (loop != nullptr && position >= loop->start && position < loop->start + loop->getNumPreBuffered())
+    {
+        preDecodedAudio = &loop->startAudio;
+        preDecodedStart = loop->start;
+
+        //Let the read-ahead decode from where the decoded start runs out while it plays
+        auto preBufferedEnd = loop->start + loop->getNumPreBuffered();
+        if (preBufferedEnd < loop->end)
+            track.jumpPlayhead(preBufferedEnd);
+    }
+    else
+    {
+        preDecodedAudio = nullptr;
+        track.jumpPlayhead(position);
+    }
+}
+
+//Function to copy decoded audio into part of a block, stopping where it runs out
+int DeckTrackSlot::readPreDecoded(const AudioSourceChannelInfo& bufferToFill, int offset, int numSamples)
+{
+    auto position = readPosition - preDecodedStart;
+    auto numDecoded = (int64) preDecodedAudio->getNumSamples();
+
+    if (position < 0 || position >= numDecoded)
+    {
+        preDecodedAudio = nullptr;
+        return 0;
+    }
+
+    auto numToCopy = (int) jmin((int64) numSamples, numDecoded - position);
+    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+        bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample + offset, *preDecodedAudio,
+                                      jmin(channel, preDecodedAudio->getNumChannels() - 1), (int) position, numToCopy);
+
+    readPosition += numToCopy;
+
+    //Past the decoded audio, the read-ahead was sent there when the playhead jumped
+    if (position + numToCopy >= numDecoded)
+        preDecodedAudio = nullptr;
+
+    return numToCopy;
+}
+
+//Function to read a block with no loop, finishing any decoded audio the playhead is in before reading the track
+void DeckTrackSlot::readStraight(const LoadedTrack& track, const AudioSourceChannelInfo& bufferToFill)
+{
+    auto& source = *track.getPlaybackSource();
+    int done = preDecodedAudio != nullptr ? readPreDecoded(bufferToFill, 0, bufferToFill.numSamples) : 0;
+
+    if (done < bufferToFill.numSamples)
+    {
+        AudioSourceChannelInfo piece(bufferToFill.buffer, bufferToFill.startSample + done, bufferToFill.numSamples - done);
+        source.getNextAudioBlock(piece);
+        readPosition = source.getNextReadPosition();
+    }
+}
+
+//Function to jump to a hot cue before the block is read, playing from its decoded audio while the read-ahead seeks
+bool DeckTrackSlot::jumpToHotCue(int index, bool& playsFromMemory)
+{
+    auto* track = liveTrack.load();
+    if (track == nullptr || ! isPositiveAndBelow(index, HotCues::numCues))
+        return false;
+
+    swapInQueuedHotCues(*track);
+
+    auto* cue = liveCues[(size_t) index];
+    if (cue == nullptr || cue->track != track)
+        return false;
+
+    //A seek still waiting from the message thread is older than the cue
+    pendingSeek = -1;
+    readPosition = cue->position;
+    playsFromMemory = cue->getNumPreBuffered() > 0;
+
+    if (playsFromMemory)
+    {
+        preDecodedAudio = &cue->audio;
+        preDecodedStart = cue->position;
+        track->jumpPlayhead(cue->position + cue->getNumPreBuffered());
+    }
+    else
+    {
+        preDecodedAudio = nullptr;
+        track->jumpPlayhead(cue->position);
+    }
+
+    varispeedPosition = (double) cue->position;
+
+    playPosition = readPosition;
+    return true;
+}
+
+//Function to start reading at a varying rate from a position
+void DeckTrackSlot::startVarispeed(int64 position)
+{
+    varispeedPosition = (double) position;
+    varispeed = true;
+}
+
+//Function to read a block at the rate for each sample
+void DeckTrackSlot::readVarispeed(const AudioSourceChannelInfo& bufferToFill, const float* rates)
+{
+    CallbackProfiler::ScopedStage profilerStage(CallbackProfiler::decode);
+
+    auto* track = liveTrack.load();
+
+    if (track == nullptr)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    swapInQueuedLoop(*track);
+    swapInQueuedHotCues(*track);
+
+    auto seek = pendingSeek.exchange(-1);
+    if (seek >= 0)
+    {
+        jumpTo(*track, nullptr, seek);
+        varispeedPosition = (double) seek;
+    }
+
+    //The platter takes over straight away, an outgoing track is dropped rather than faded
+    if (fadingTrack != nullptr)
+    {
+        retiredTrack = fadingTrack;
+        fadingTrack = nullptr;
+    }
+
+    //Decoded audio the playhead was in, a loop start or a cue, is read from as well as the track
+    auto position = scratchReader.read(bufferToFill, rates, varispeedPosition, *track, preDecodedAudio, preDecodedStart);
+    position = jlimit(0.0, (double) totalLength.load(), position);
+
+    //The read-ahead keeps most of its window on the side the platter is heading for
+    track->followPlayhead((int64) position, position < varispeedPosition);
+
+    varispeedPosition = position;
+    readPosition = (int64) position;
+    playPosition = readPosition;
+}
+
+//Function to carry on reading straight from where varispeed got to
+void DeckTrackSlot::stopVarispeed()
+{
+    if (! varispeed.exchange(false))
+        return;
+
+    readPosition = jlimit((int64) 0, totalLength.load(), (int64) std::llround(varispeedPosition));
+    playPosition = readPosition;
+
+    auto* track = liveTrack.load();
+    if (track == nullptr)
+        return;
+
+    //Still inside decoded audio, it plays on while the source waits after it as before
+    if (preDecodedAudio != nullptr && readPosition >= preDecodedStart
+          && readPosition < preDecodedStart + preDecodedAudio->getNumSamples())
+    {
+        track->jumpPlayhead(preDecodedStart + preDecodedAudio->getNumSamples());
+        return;
+    }
+
+    //The read-ahead window followed the platter, so the playhead is already decoded
+    preDecodedAudio = nullptr;
+    track->jumpPlayhead(readPosition);
+}
+
+//Function to pick up hot cues queued by the message thread
+void DeckTrackSlot::swapInQueuedHotCues(const LoadedTrack& track)
+{
+    for (int index = 0; index < HotCues::numCues; ++index)
+    {
+        //Wait until the message thread has deleted the cue this one replaced last time
+        if (retiredCues[(size_t) index].load() != nullptr || queuedCues[(size_t) index].load() == nullptr)
+            continue;
+
+        auto* previous = liveCues[(size_t) index];
+        liveCues[(size_t) index] = queuedCues[(size_t) index].exchange(nullptr);
+        retiredCues[(size_t) index] = previous;
+
+        //The playhead can't stay in audio that is about to be deleted, the track takes over from the same point
+        if (previous != nullptr && preDecodedAudio == &previous->audio)
+            jumpTo(track, getActiveLoop(&track), readPosition);
+    }
+}
+
+//Function to pick up a loop queued by the message thread
+void DeckTrackSlot::swapInQueuedLoop(const LoadedTrack& track)
+{
+    //Wait until the message thread has deleted the loop before last
+    if (retiredLoop.load() != nullptr)
+        return;
+
+    auto* next = queuedLoop.exchange(nullptr);
+    if (next == nullptr)
+        return;
+
+    auto* previous = liveLoop;
+    liveLoop = next;
+    retiredLoop = previous;
+
+    auto* loop = getActiveLoop(&track);
+
+    if (loop != nullptr)
+    {
+        auto position = readPosition;
+
+        //Halving a loop can leave the playhead past the new end, wrap it back into the loop
+        bool wasInPreviousLoop = previous != nullptr && position >= previous->start && position < previous->end;
+        if (wasInPreviousLoop && position >= loop->end && position >= loop->start)
+            position = loop->start + (position - loop->start) % loop->getLength();
+
+        jumpTo(track, loop, position);
+
+        loopStartPosition = loop->start;
+        loopEndPosition = loop->end;
+    }
+    else
+    {
+        //Leaving a loop while playing its decoded start, carry on from the same point in the track
+        if (previous != nullptr && preDecodedAudio == &previous->startAudio)
+            jumpTo(track, nullptr, readPosition);
+
+        loopStartPosition = -1;
+        loopEndPosition = -1;
+    }
+}
+
+//Function to get the live loop if it was made for this track and has a length
+const DeckTrackSlot::LoopRegion* DeckTrackSlot::getActiveLoop(const LoadedTrack* track) const
+{
+    if (liveLoop == nullptr || track == nullptr || liveLoop->track != track || liveLoop->getLength() <= 0)
+        return nullptr;
+
+    return liveLoop;
+}
+
+//Function to hand a new loop to the audio thread
+void DeckTrackSlot::setLoop(std::unique_ptr<LoopRegion> loop)
+{
+    //An empty region tells the audio thread to stop looping
+    if (loop == nullptr)
+        loop.reset(new LoopRegion());
+
+    //A loop that was queued but never went live is still ours to delete
+    delete queuedLoop.exchange(loop.release());
+}
+
+//Function to hand a new or cleared hot cue to the audio thread
+void DeckTrackSlot::setHotCue(int index, std::unique_ptr<HotCue> cue)
+{
+    if (! isPositiveAndBelow(index, HotCues::numCues))
+        return;
+
+    //A cue with no track is never played, it just takes the pad's old cue out
+    if (cue == nullptr)
+        cue.reset(new HotCue());
+
+    //A cue that was queued but never went live is still ours to delete
+    delete queuedCues[(size_t) index].exchange(cue.release());
+}
+
+//Function to request a new play position, the audio thread applies it at the next block
+void DeckTrackSlot::setNextReadPosition(int64 newPosition)
+{
+    pendingSeek = newPosition;
+    playPosition = newPosition;
+}
+
+//Function to get the live track's play position
+int64 DeckTrackSlot::getNextReadPosition() const
+{
+    return playPosition.load();
+}
+
+//Function to get the live track's length
+int64 DeckTrackSlot::getTotalLength() const
+{
+    return totalLength.load();
+}
+
+//Looping is handled by the player, not the slot
+bool DeckTrackSlot::isLooping() const
+{
+    return false;
+}
+
+//Function to get the underruns of the live track
+int DeckTrackSlot::getNumBufferUnderruns() const
+{
+    //Tracks are only deleted on the message thread, which is where this is called from
+    auto* track = liveTrack.load();
+    return track != nullptr ? track->getNumUnderruns() : 0;
+}
+
+//Function to delete retired tracks and loops away from the audio thread
+void DeckTrackSlot::timerCallback()
+{
+    delete retiredTrack.exchange(nullptr);
+    delete retiredLoop.exchange(nullptr);
+
+    for (auto& cue : retiredCues)
+        delete cue.exchange(nullptr);
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TrackLoader.h"
+#include "ScratchReader.h"
+
+//Fixed source that a deck's transport plays from. Loaded tracks are queued from the message thread
+//and swapped in by the audio thread at the start of a block, with a one block crossfade if the deck is playing.
+//Loops are handled here too, wrapping at the exact sample of the loop end, and so are hot cues: a loop start or a
+//cue carries the audio after it decoded in advance, which plays from memory while the read-ahead seeks to where it ends.
+//For scratching the slot can read at a rate given for every sample instead, backwards too, from memory around the playhead.
+//Tracks and loops that go out of use are collected by a message thread timer, so the audio thread never frees or posts messages
+class DeckTrackSlot : public PositionableAudioSource,
+                      private Timer
+{
+public:
+    //A loop between two points of one track. The audio from the loop start is decoded in advance so that
+    //wrapping back plays from memory while the read-ahead catches up
+    struct LoopRegion
+    {
+        //Track the loop was made for, the loop is ignored while a different track is live
+        const LoadedTrack* track = nullptr;
+        //Loop points in samples at the track's sample rate, the end is exclusive
+        int64 start = 0;
+        int64 end = 0;
+        //Decoded audio from the loop start, up to the whole loop; empty if it could not be decoded
+        AudioBuffer<float> startAudio;
+
+        int64 getLength() const { return end - start; }
+        int getNumPreBuffered() const { return startAudio.getNumSamples(); }
+    };
+
+    //Constructor and destructor
+    DeckTrackSlot();
+    ~DeckTrackSlot() override;
+
+    //Message thread: queues a prepared track, replacing any queued track that has not gone live yet
+    void queueTrack(std::unique_ptr<LoadedTrack> track);
+    //Audio thread: makes the queued track live, call at the start of a block; returns true if the track changed
+    bool swapInQueuedTrack(bool crossfadeFromCurrent);
+
+    //Message thread: replaces the current loop at the next block, null stops looping
+    void setLoop(std::unique_ptr<LoopRegion> loop);
+    //Message thread: replaces one hot cue at the next block, null clears it
+    void setHotCue(int index, std::unique_ptr<HotCue> cue);
+    //Audio thread, before the block is read: moves the playhead to a hot cue of the live track. Returns false if the
+    //pad has no cue for it, and says whether the cue's audio was decoded so the jump plays from memory
+    bool jumpToHotCue(int index, bool& playsFromMemory);
+    //Message thread: the live track, for building loops; stays valid until the message thread returns
+    const LoadedTrack* getLiveTrack() const { return liveTrack.load(); }
+    //Varispeed for scratching: the block is read at a rate given for every sample, which can be negative, instead of
+    //straight on. Loops are ignored and a new track replaces the old one without a crossfade while it is on
+    //Audio thread: starts reading at a rate from a track position, normally the one being heard
+    void startVarispeed(int64 position);
+    //Audio thread: reads a block at rates[i] track samples per output sample
+    void readVarispeed(const AudioSourceChannelInfo& bufferToFill, const float* rates);
+    //Audio thread: goes back to reading straight on from where varispeed got to, without a jump in the audio
+    void stopVarispeed();
+    bool isVarispeed() const { return varispeed.load(); }
+    //Loop points the audio thread is using, -1 when not looping
+    int64 getLoopStart() const { return loopStartPosition.load(); }
+    int64 getLoopEnd() const { return loopEndPosition.load(); }
+
+    //AudioSource overrides
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    //PositionableAudioSource overrides, positions are in samples at the track's own sample rate
+    void setNextReadPosition(int64 newPosition) override;
+    int64 getNextReadPosition() const override;
+    int64 getTotalLength() const override;
+    bool isLooping() const override;
+
+    //Sample rate of the live track, 0 if nothing is loaded
+    double getTrackSampleRate() const { return trackSampleRate.load(); }
+    //Block size and sample rate new tracks should be prepared with
+    int getPreparedBlockSize() const { return preparedBlockSize.load(); }
+    double getPreparedSampleRate() const { return preparedSampleRate.load(); }
+    //Underruns of the live track's read-ahead buffer
+    int getNumBufferUnderruns() const;
+
+private:
+    //Deletes tracks and loops that went out of use on the message thread
+    void timerCallback() override;
+
+    //Audio thread: makes a newly queued loop live, moving the playhead into it if it was halved past the playhead
+    void swapInQueuedLoop(const LoadedTrack& track);
+    //Audio thread: makes newly queued hot cues live, leaving the audio of one that is being replaced
+    void swapInQueuedHotCues(const LoadedTrack& track);
+    //Audio thread: the live loop if it belongs to the given track
+    const LoopRegion* getActiveLoop(const LoadedTrack* track) const;
+    //Audio thread: moves the playhead, playing from the loop's decoded start if the position is inside it; the track's
+    //read-ahead is moved without waking its thread, which would take a lock
+    void jumpTo(const LoadedTrack& track, const LoopRegion* loop, int64 position);
+    //Audio thread: copies as much of a piece as the decoded audio covers at the playhead, returns how many samples
+    int readPreDecoded(const AudioSourceChannelInfo& bufferToFill, int offset, int numSamples);
+    //Audio thread: reads a block straight through, from decoded audio first if the playhead is in some
+    void readStraight(const LoadedTrack& track, const AudioSourceChannelInfo& bufferToFill);
+    //Audio thread: reads a block, wrapping from the loop end to the loop start at the exact sample
+    void readLooped(const LoadedTrack& track, const LoopRegion& loop, const AudioSourceChannelInfo& bufferToFill);
+
+    //Track waiting to go live, owned by whichever thread takes it out
+    std::atomic<LoadedTrack*> queuedTrack { nullptr };
+    //Track being played, only replaced by the audio thread
+    std::atomic<LoadedTrack*> liveTrack { nullptr };
+    //Track that has finished playing and is waiting to be deleted on the message thread
+    std::atomic<LoadedTrack*> retiredTrack { nullptr };
+    //Previous track that is being faded out during the first block of the new one
+    LoadedTrack* fadingTrack = nullptr;
+
+    //Loop waiting to go live, the loop being played, and the previous loop waiting to be deleted
+    std::atomic<LoopRegion*> queuedLoop { nullptr };
+    LoopRegion* liveLoop = nullptr;
+    std::atomic<LoopRegion*> retiredLoop { nullptr };
+    std::atomic<int64> loopStartPosition { -1 };
+    std::atomic<int64> loopEndPosition { -1 };
+
+    //Hot cues waiting to go live, the ones being played, and replaced ones waiting to be deleted
+    std::array<std::atomic<HotCue*>, HotCues::numCues> queuedCues {};
+    std::array<HotCue*, HotCues::numCues> liveCues {};
+    std::array<std::atomic<HotCue*>, HotCues::numCues> retiredCues {};
+
+    //Audio thread: where the next block starts, and the decoded audio it comes from, null when it comes from the track.
+    //While the playhead is in decoded audio the read-ahead is already at the sample after it
+    int64 readPosition = 0;
+    const AudioBuffer<float>* preDecodedAudio = nullptr;
+    int64 preDecodedStart = 0;
+
+    //Seek requested from the message thread, applied by the audio thread
+    std::atomic<int64> pendingSeek { -1 };
+    //Lock-free copies of the live track's state for the UI
+    std::atomic<int64> playPosition { 0 };
+    std::atomic<int64> totalLength { 0 };
+    std::atomic<double> trackSampleRate { 0.0 };
+
+    std::atomic<int> preparedBlockSize { 512 };
+    std::atomic<double> preparedSampleRate { 44100.0 };
+
+    //Reads while varispeed is on
+    ScratchReader scratchReader;
+    std::atomic<bool> varispeed { false };
+    //Audio thread: fractional track position varispeed has got to
+    double varispeedPosition = 0.0;
+
+    //Scratch buffer for the outgoing track during a crossfade, sized in prepareToPlay
+    AudioBuffer<float> fadeBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeckTrackSlot)
+};
@@ -0,0 +1,127 @@
+#include <JuceHeader.h>
+#include "FxRackPanel.h"
+
+//Constructor: A switch, move buttons and knobs for every effect, set to what the rack holds now
+FxRackPanel::FxRackPanel(DeckFxRack& rackToControl) : rack(rackToControl)
+{
+    for (int type = 0; type < DeckFxRack::numSlots; ++type)
+    {
+        auto& row = rows[type];
+        auto& effect = rack.getEffect((DeckFxRack::EffectType) type);
+
+        row.switchButton.setButtonText(DeckFxRack::getEffectName((DeckFxRack::EffectType) type));
+        row.switchButton.setClickingTogglesState(true);
+        row.switchButton.setToggleState(rack.isEnabled((DeckFxRack::EffectType) type), dontSendNotification);
+
+        for (auto* button : { &row.switchButton, &row.upButton, &row.downButton })
+        {
+            button->addListener(this);
+            addAndMakeVisible(button);
+        }
+
+        for (int index = 0; index < effect.getNumParameters(); ++index)
+        {
+            auto& info = effect.getParameterInfo(index);
+            auto& knob = row.knobs[index];
+            knob.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
+            knob.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+            knob.setRange(info.minimum, info.maximum);
+            knob.setValue(effect.getParameter(index), dontSendNotification);
+            knob.setDoubleClickReturnValue(true, info.defaultValue);
+            knob.addListener(this);
+            addAndMakeVisible(knob);
+        }
+    }
+}
+
+//Destructor
+FxRackPanel::~FxRackPanel()
+{
+}
+
+void FxRackPanel::paint (juce::Graphics& g)
+{
+    g.fillAll(Colour(20, 20, 20).withAlpha(0.92f));
+    g.setColour(Colours::grey);
+    g.drawRect(getLocalBounds());
+
+    //Each knob's name under it
+    g.setColour(Colours::lightgrey);
+    g.setFont (juce::FontOptions (10.0f));
+
+    for (int type = 0; type < DeckFxRack::numSlots; ++type)
+    {
+        auto& effect = rack.getEffect((DeckFxRack::EffectType) type);
+        for (int index = 0; index < effect.getNumParameters(); ++index)
+        {
+            auto knobBounds = rows[type].knobs[index].getBounds();
+            g.drawText(effect.getParameterInfo(index).name, knobBounds.getX() - 10, knobBounds.getBottom(),
+                       knobBounds.getWidth() + 20, 10, Justification::centred, false);
+        }
+    }
+}
+
+void FxRackPanel::resized()
+{
+    auto area = getLocalBounds().reduced(6, 4);
+
+    //Rows go down the panel in the order the rack runs them
+    for (int slot = 0; slot < DeckFxRack::numSlots; ++slot)
+    {
+        auto& row = rows[(int) rack.getSlot(slot)];
+        auto rowArea = area.removeFromTop(rowHeight);
+
+        row.switchButton.setBounds(rowArea.removeFromLeft(80).reduced(2, 8));
+        row.upButton.setBounds(rowArea.removeFromLeft(34).reduced(2, 8));
+        row.downButton.setBounds(rowArea.removeFromLeft(34).reduced(2, 8));
+        rowArea.removeFromLeft(10);
+
+        for (auto& knob : row.knobs)
+            knob.setBounds(rowArea.removeFromLeft(60).withTrimmedBottom(10).reduced(14, 0));
+    }
+}
+
+//Function to find which slot an effect is in
+int FxRackPanel::findSlot(DeckFxRack::EffectType type) const
+{
+    for (int slot = 0; slot < DeckFxRack::numSlots; ++slot)
+        if (rack.getSlot(slot) == type)
+            return slot;
+
+    return -1;
+}
+
+//Function to switch an effect or move it one slot up or down
+void FxRackPanel::buttonClicked(Button* button)
+{
+    for (int type = 0; type < DeckFxRack::numSlots; ++type)
+    {
+        auto& row = rows[type];
+        auto effectType = (DeckFxRack::EffectType) type;
+
+        if (button == &row.switchButton)
+        {
+            rack.setEnabled(effectType, row.switchButton.getToggleState());
+            std::cout << DeckFxRack::getEffectName(effectType) << (rack.isEnabled(effectType) ? " on" : " off") << std::endl;
+        }
+        else if (button == &row.upButton || button == &row.downButton)
+        {
+            int slot = findSlot(effectType);
+            rack.moveSlot(slot, slot + (button == &row.upButton ? -1 : 1));
+            resized();
+            repaint();
+        }
+    }
+}
+
+//Function to pass a knob to its effect
+void FxRackPanel::sliderValueChanged(Slider* slider)
+{
+    for (int type = 0; type < DeckFxRack::numSlots; ++type)
+    {
+        auto& effect = rack.getEffect((DeckFxRack::EffectType) type);
+        for (int index = 0; index < effect.getNumParameters(); ++index)
+            if (slider == &rows[type].knobs[index])
+                effect.setParameter(index, (float) slider->getValue());
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "DeckFxRack.h"
+
+//Panel shown over a deck to work its FX rack: one row per effect in rack order, with a switch, buttons to move it
+//up and down the rack, and a knob for each of its settings. Every change goes straight to the rack, which applies
+//it on the next block
+class FxRackPanel  : public juce::Component,
+                     public Button::Listener,
+                     public Slider::Listener
+{
+public:
+    //Constructor: Makes the controls for every effect in the rack
+    FxRackPanel(DeckFxRack& rackToControl);
+    //Destructor
+    ~FxRackPanel() override;
+
+    //Draws the background and the knob names
+    void paint (juce::Graphics&) override;
+    //Lays the rows out in rack order
+    void resized() override;
+
+    //Switches or moves an effect
+    void buttonClicked(Button* button) override;
+    //Sets an effect's knob
+    void sliderValueChanged(Slider* slider) override;
+
+    //Height of one effect's row
+    static constexpr int rowHeight = 44;
+
+private:
+    //Controls for one effect
+    struct Row
+    {
+        TextButton switchButton;
+        TextButton upButton{"UP"};
+        TextButton downButton{"DN"};
+        juce::Slider knobs[DeckEffect::maxParameters];
+    };
+
+    //Slot an effect is in
+    int findSlot(DeckFxRack::EffectType type) const;
+
+    DeckFxRack& rack;
+    Row rows[DeckFxRack::numSlots];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FxRackPanel)
+};
@@ -0,0 +1,52 @@
+#include <JuceHeader.h>
+#include "GainReductionMeter.h"
+
+//Constructor: Polls the limiter thirty times a second
+GainReductionMeter::GainReductionMeter(MasterLimiter& limiterToShow) : limiter(limiterToShow)
+{
+    startTimerHz(30);
+}
+
+//Destructor: Stops the timer
+GainReductionMeter::~GainReductionMeter()
+{
+    stopTimer();
+}
+
+void GainReductionMeter::paint (juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat();
+
+    g.fillAll(Colour(31, 31, 31));
+
+    //The bar grows leftwards from the right edge as the reduction deepens
+    float proportion = jlimit(0.0f, 1.0f, shownReduction / rangeDecibels);
+    g.setColour(limiter.isEnabled() ? Colour(216, 132, 97) : Colours::grey);
+    g.fillRect(bounds.withLeft(bounds.getRight() - bounds.getWidth() * proportion));
+
+    g.setColour(Colours::lightgrey);
+    g.setFont (juce::FontOptions (11.0f));
+    g.drawText(limiter.isEnabled() ? "LIMIT " + String(-shownReduction, 1) + " dB" : String("LIMIT OFF"),
+               getLocalBounds().reduced(4, 0), Justification::centredLeft, false);
+}
+
+//Function to switch the limiter on or off
+void GainReductionMeter::mouseDown(const MouseEvent& /*event*/)
+{
+    limiter.setEnabled(! limiter.isEnabled());
+    repaint();
+}
+
+//Function to pick up the latest reduction, jumping to new peaks and falling back at 20 dB a second
+void GainReductionMeter::timerCallback()
+{
+    float reduction = -limiter.getGainReductionDecibels();
+    float fallen = jmax(0.0f, shownReduction - 20.0f / 30.0f);
+    float next = jmax(reduction, fallen);
+
+    if (next != shownReduction)
+    {
+        shownReduction = next;
+        repaint();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MasterLimiter.h"
+
+//Small horizontal meter showing how hard the master limiter is working. It polls the limiter's lock-free reading,
+//so a short reduction between repaints still shows. Clicking it switches the limiter on and off
+class GainReductionMeter  : public juce::Component,
+                            public Timer
+{
+public:
+    //Constructor: Starts polling the limiter
+    GainReductionMeter(MasterLimiter& limiterToShow);
+    //Destructor: Stops the timer
+    ~GainReductionMeter() override;
+
+    //Draws the reduction as a bar growing from the right
+    void paint (juce::Graphics&) override;
+
+    //Toggles the limiter
+    void mouseDown(const MouseEvent& event) override;
+
+    //Timer callback function
+    void timerCallback() override;
+
+    //Deepest reduction the bar can show, in dB
+    static constexpr float rangeDecibels = 12.0f;
+
+private:
+    MasterLimiter& limiter;
+    //Reduction on screen in dB, positive, falls back slowly after a peak
+    float shownReduction = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GainReductionMeter)
+};
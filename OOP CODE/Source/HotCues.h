@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Where a track's hot cues are, in seconds from the start of the track, negative for a pad with no cue
+struct HotCues
+{
+    //Pads on each deck
+    static constexpr int numCues = 8;
+
+    HotCues() { seconds.fill(-1.0); }
+
+    bool isSet(int index) const { return isPositiveAndBelow(index, numCues) && seconds[(size_t) index] >= 0.0; }
+    double get(int index) const { return isPositiveAndBelow(index, numCues) ? seconds[(size_t) index] : -1.0; }
+    void set(int index, double newSeconds) { if (isPositiveAndBelow(index, numCues)) seconds[(size_t) index] = newSeconds; }
+    void clear(int index) { set(index, -1.0); }
+
+    std::array<double, numCues> seconds;
+};
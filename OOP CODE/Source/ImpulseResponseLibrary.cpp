@@ -0,0 +1,165 @@
+#include "ImpulseResponseLibrary.h"
+
+//Constructor: Cuts the response into partitions and transforms each one
+ImpulseResponse::ImpulseResponse(const AudioBuffer<float>& audio, double _sampleRate, const String& _name, int _partitionSize)
+    : name(_name),
+      sampleRate(_sampleRate),
+      lengthInSamples(jmax(1, audio.getNumSamples())),
+      numChannels(jlimit(1, 2, audio.getNumChannels())),
+      partitionSize(nextPowerOfTwo(jmax(16, _partitionSize))),
+      fftOrder(roundToInt(std::log2((double) partitionSize)) + 1),
+      numPartitions((lengthInSamples + partitionSize - 1) / partitionSize)
+{
+    dsp::FFT fft(fftOrder);
+    int fftSize = 1 << fftOrder;
+    int spectrumSize = getSpectrumSize();
+    spectra.resize((size_t) (numChannels * numPartitions * spectrumSize));
+
+    //The transform works in place on twice the FFT size
+    std::vector<float> work((size_t) (2 * fftSize));
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        for (int partition = 0; partition < numPartitions; ++partition)
+        {
+            std::fill(work.begin(), work.end(), 0.0f);
+
+            //Each partition fills the first half, the second half stays zero for the overlap-save
+            int start = partition * partitionSize;
+            int numSamples = jmin(partitionSize, audio.getNumSamples() - start);
+            if (numSamples > 0)
+                FloatVectorOperations::copy(work.data(), audio.getReadPointer(jmin(channel, audio.getNumChannels() - 1), start), numSamples);
+
+            fft.performRealOnlyForwardTransform(work.data(), true);
+            std::copy(work.begin(), work.begin() + spectrumSize,
+                      spectra.begin() + (channel * numPartitions + partition) * spectrumSize);
+        }
+    }
+}
+
+//Function to find one partition's spectrum
+const float* ImpulseResponse::getPartition(int channel, int partition) const
+{
+    return spectra.data() + (jmin(channel, numChannels - 1) * numPartitions + partition) * getSpectrumSize();
+}
+
+//Constructor: Registers the formats responses can be read from
+ImpulseResponseLibrary::ImpulseResponseLibrary()
+{
+    formatManager.registerBasicFormats();
+}
+
+//Destructor: Stops any response still being built
+ImpulseResponseLibrary::~ImpulseResponseLibrary()
+{
+    workerPool.removeAllJobs(true, 5000);
+}
+
+//Function to return a loaded response or load it, resampled for this rate
+ImpulseResponse::Ptr ImpulseResponseLibrary::get(const File& file, double sampleRate)
+{
+    const ScopedLock sl(lock);
+
+    for (auto& entry : entries)
+        if (entry.path == file.getFullPathName() && entry.sampleRate == sampleRate)
+            return entry.impulseResponse;
+
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0)
+    {
+        std::cout << "Impulse response: could not open " << file.getFullPathName() << std::endl;
+        return nullptr;
+    }
+
+    int length = (int) jmin(reader->lengthInSamples, (int64) (maxSeconds * reader->sampleRate));
+    int numChannels = jlimit(1, 2, (int) reader->numChannels);
+    AudioBuffer<float> audio(numChannels, length);
+    reader->read(&audio, 0, length, 0, true, numChannels > 1);
+
+    auto impulseResponse = createFromAudio(audio, reader->sampleRate, sampleRate, file.getFileNameWithoutExtension());
+    entries.push_back({ file.getFullPathName(), sampleRate, impulseResponse });
+
+    std::cout << "Impulse response: " << impulseResponse->getName() << ", "
+              << String(impulseResponse->getLengthInSamples() / sampleRate, 2) << " s, "
+              << impulseResponse->getNumPartitions() << " partitions" << std::endl;
+
+    return impulseResponse;
+}
+
+//Function to load a response on the worker and post it back to the message thread
+void ImpulseResponseLibrary::getAsync(const File& file, double sampleRate, LoadedCallback onLoaded)
+{
+    workerPool.addJob([this, file, sampleRate, onLoaded]
+    {
+        auto impulseResponse = get(file, sampleRate);
+
+        MessageManager::callAsync([onLoaded, impulseResponse]
+        {
+            if (onLoaded != nullptr)
+                onLoaded(impulseResponse);
+        });
+    });
+}
+
+//Function to forget every loaded response
+void ImpulseResponseLibrary::clear()
+{
+    const ScopedLock sl(lock);
+    entries.clear();
+}
+
+//Function to trim, resample and normalise audio into a response
+ImpulseResponse::Ptr ImpulseResponseLibrary::createFromAudio(const AudioBuffer<float>& audio, double audioSampleRate,
+                                                             double sampleRate, const String& name)
+{
+    int numChannels = audio.getNumChannels();
+
+    //Trailing silence would only add partitions that multiply by zero
+    int length = audio.getNumSamples();
+    while (length > 1)
+    {
+        bool silent = true;
+        for (int channel = 0; channel < numChannels; ++channel)
+            silent = silent && std::abs(audio.getSample(channel, length - 1)) < silenceThreshold;
+
+        if (! silent)
+            break;
+
+        --length;
+    }
+
+    AudioBuffer<float> resampled;
+    double ratio = audioSampleRate / sampleRate;
+    if (std::abs(ratio - 1.0) < 1.0e-9)
+    {
+        resampled.makeCopyOf(audio);
+        resampled.setSize(numChannels, length, true);
+    }
+    else
+    {
+        //The interpolator looks a few samples past the last one it produces
+        int outputLength = jmax(1, (int) ((double) (length - 4) / ratio));
+        resampled.setSize(numChannels, outputLength);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            LagrangeInterpolator interpolator;
+            interpolator.process(ratio, audio.getReadPointer(channel), resampled.getWritePointer(channel), outputLength);
+        }
+    }
+
+    //Unit energy per channel on average, so a loud or long response doesn't jump out of the mix
+    double energy = 0.0;
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* data = resampled.getReadPointer(channel);
+        for (int i = 0; i < resampled.getNumSamples(); ++i)
+            energy += (double) data[i] * data[i];
+    }
+    energy /= jmax(1, numChannels);
+
+    if (energy > 0.0)
+        resampled.applyGain((float) (1.0 / std::sqrt(energy)));
+
+    return new ImpulseResponse(resampled, sampleRate, name);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//An impulse response cut into equal partitions, each already transformed for the convolution reverb. It is
+//built once on the library's worker and shared by every deck that uses it, so the decks only transform their own input
+class ImpulseResponse : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<ImpulseResponse>;
+
+    //Samples per partition unless asked otherwise; bigger partitions cost less per sample but more per block boundary
+    static constexpr int defaultPartitionSize = 256;
+
+    //Constructor: Partitions and transforms one or two channels of audio at the rate it will be played at
+    ImpulseResponse(const AudioBuffer<float>& audio, double sampleRate, const String& name,
+                    int partitionSize = defaultPartitionSize);
+
+    const String& getName() const { return name; }
+    double getSampleRate() const { return sampleRate; }
+    int getLengthInSamples() const { return lengthInSamples; }
+    int getNumChannels() const { return numChannels; }
+
+    //Partition layout, the FFT is twice the partition size
+    int getPartitionSize() const { return partitionSize; }
+    int getFftOrder() const { return fftOrder; }
+    int getNumPartitions() const { return numPartitions; }
+    //Floats in one partition's spectrum: bins 0 to Nyquist as interleaved real and imaginary parts
+    int getSpectrumSize() const { return (1 << fftOrder) + 2; }
+
+    //Spectrum of one partition; a mono response answers for both channels
+    const float* getPartition(int channel, int partition) const;
+
+private:
+    String name;
+    double sampleRate;
+    int lengthInSamples;
+    int numChannels;
+    int partitionSize;
+    int fftOrder;
+    int numPartitions;
+    //Every partition's spectrum, channel by channel
+    std::vector<float> spectra;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ImpulseResponse)
+};
+
+//Impulse responses loaded from files, kept per file and sample rate so decks asking for the same one share it.
+//Files are read with the library's own format manager, trimmed of trailing silence, resampled to the device rate
+//and normalised to unit energy so a response sits at about the level of the built-in reverb. Decks load them through
+//getAsync, which does the reading, resampling and transforming on a worker thread of the library's own
+class ImpulseResponseLibrary
+{
+public:
+    //Called on the message thread with the response getAsync loaded, null if the file won't open
+    using LoadedCallback = std::function<void(ImpulseResponse::Ptr impulseResponse)>;
+
+    //Longest response kept, anything after this is cut off
+    static constexpr double maxSeconds = 10.0;
+    //Level below which the end of a response is trimmed off, -80 dB
+    static constexpr float silenceThreshold = 1.0e-4f;
+
+    //Constructor and destructor
+    ImpulseResponseLibrary();
+    ~ImpulseResponseLibrary();
+
+    //Any thread: the response in a file at a sample rate, loading it on the calling thread the first time; null if the
+    //file won't open
+    ImpulseResponse::Ptr get(const File& file, double sampleRate);
+    //Message thread: get on the worker, handing the response back on the message thread
+    void getAsync(const File& file, double sampleRate, LoadedCallback onLoaded);
+    //Forgets every response, decks keep the ones they are using
+    void clear();
+
+    //Turns audio at its own rate into a response at the playing rate
+    static ImpulseResponse::Ptr createFromAudio(const AudioBuffer<float>& audio, double audioSampleRate,
+                                                double sampleRate, const String& name);
+
+private:
+    //A response loaded for one file at one rate
+    struct Entry
+    {
+        String path;
+        double sampleRate;
+        ImpulseResponse::Ptr impulseResponse;
+    };
+
+    AudioFormatManager formatManager;
+    CriticalSection lock;
+    std::vector<Entry> entries;
+    //Reads and builds responses away from the message thread, one at a time so a file asked for twice is built once
+    ThreadPool workerPool { 1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ImpulseResponseLibrary)
+};
@@ -1,6 +1,8 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "MainComponent.h"
+#include "Benchmarks.h"
+#include "OfflineMixRenderer.h"
 
 //==============================================================================
 class OtoDecksApplication  : public JUCEApplication
@@ -15,6 +17,22 @@ public:
     //==============================================================================
     void initialise (const String& commandLine) override
     {
+        //Run the engine benchmarks instead of opening the window when asked to on the command line
+        if (commandLine.contains("--benchmark"))
+        {
+            setApplicationReturnValue(Benchmarks::run(commandLine));
+            quit();
+            return;
+        }
+
+        //Render a mix script to a WAV file without opening the window or an audio device
+        if (commandLine.contains("--render"))
+        {
+            setApplicationReturnValue(OfflineMixRenderer::run(commandLine));
+            quit();
+            return;
+        }
+
         //Method for initialising application
         mainWindow.reset (new MainWindow (getApplicationName()));
     }
@@ -1,24 +1,47 @@
 #include "MainComponent.h"
+#include "AllocationTripwire.h"
 #include <cmath>
 
 MainComponent::MainComponent() : deckGUI1(&player1, formatManager, thumbCache, true), //Initialise deck 1
 deckGUI2(&player2, formatManager, thumbCache, false), //Initialise deck 2
-playlistComponent(&deckGUI1, &deckGUI2, &player1) //Initialise playlist component
+playlistComponent(&deckGUI1, &deckGUI2, &previewPlayer) //Initialise playlist component
 {
     //Canvas size
     setSize (1000, 800);
 
+    //Let every deck share the RAM cache of decoded tracks
+    trackLoader.setTrackCache(&trackCache);
+
+    //Deck 1 on the left of the crossfader, deck 2 on the right; the volume sliders drive the channel faders
+    mixer.setSource(0, &player1);
+    mixer.setSource(1, &player2);
+    mixer.setCrossfaderAssign(0, DeckMixer::CrossfaderAssign::a);
+    mixer.setCrossfaderAssign(1, DeckMixer::CrossfaderAssign::b);
+    deckGUI1.setMixerChannel(&mixer, 0);
+    deckGUI2.setMixerChannel(&mixer, 1);
+    deckGUI1.setImpulseResponseLibrary(&impulseResponses);
+    deckGUI2.setImpulseResponseLibrary(&impulseResponses);
+    //With only two decks the pool renders them serially on the device thread
+    mixer.setRenderPool(&renderPool);
+    //Both decks sync to one clock, numbered as they are on the mixer
+    mixer.setMasterClock(&masterClock);
+    player1.setMasterClock(&masterClock, 0);
+    player2.setMasterClock(&masterClock, 1);
+
+    //Start decoding ahead of the playheads before any audio is requested
+    readAheadThread.startThread(Thread::Priority::high);
+
     //Request audio input permissions if needed
     if (RuntimePermissions::isRequired (RuntimePermissions::recordAudio)
         && ! RuntimePermissions::isGranted (RuntimePermissions::recordAudio))
     {
         RuntimePermissions::request (RuntimePermissions::recordAudio,
-                                     [&] (bool granted) { if (granted)  setAudioChannels (2, 2); });
+                                     [&] (bool granted) { if (granted)  setAudioChannels (2, 4); });
     }  
     else
     {
-        //Open 2 output channels
-        setAudioChannels (0, 2);
+        //Open the master pair, and the cue pair for the preview if the device has one
+        setAudioChannels (0, 4);
     }
     
     //Add components to the UI
@@ -39,6 +62,24 @@ playlistComponent(&deckGUI1, &deckGUI2, &player1) //Initialise playlist componen
     crossFaderLabel.setJustificationType(juce::Justification::centred);
     addAndMakeVisible(crossFaderLabel);
 
+    //Crossfader curve, record and replay
+    recordButton.setClickingTogglesState(true);
+    for (auto* button : { &curveButton, &recordButton, &replayButton })
+    {
+        button->addListener(this);
+        addAndMakeVisible(button);
+    }
+
+    addAndMakeVisible(limiterMeter);
+
+    //Callback profiler overlay, hidden until asked for
+    profilerButton.setClickingTogglesState(true);
+    profilerButton.addListener(this);
+    addAndMakeVisible(profilerButton);
+    addChildComponent(profilerOverlay);
+    profilerOverlay.addLatencyReport("Deck 1", [this] { return getLatencyReport(player1); });
+    profilerOverlay.addLatencyReport("Deck 2", [this] { return getLatencyReport(player2); });
+
     //Set different colors for each waveform
     deckGUI1.setWaveformColour(juce::Colour(97, 132, 216));
     deckGUI2.setWaveformColour(juce::Colour(80, 162, 167));
@@ -48,30 +89,88 @@ MainComponent::~MainComponent()
 {
     //This shuts down the audio device and clears the audio source
     shutdownAudio();
+    //Stop the read-ahead thread once no deck is pulling audio any more
+    readAheadThread.stopThread(1000);
+
+    //Report any heap use the tripwire caught on the audio thread
+    if (AllocationTripwire::isEnabled())
+        std::cout << "Audio thread allocations: " << AllocationTripwire::getNumViolations() << std::endl;
     crossFaderSlider.setLookAndFeel(nullptr);//Reset LookAndFeel
 }
 
 //Prepares the audio systm to play with given sample rate and block size
 void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
 {
-    mixerSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
-    //Adds both player to mixer
-    mixerSource.addInputSource(&player1, false);
-    mixerSource.addInputSource(&player2, false);
+    //Prepares the limiter, the mixer and every deck plugged into it
+    limiter.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    previewPlayer.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    deviceSampleRate = sampleRate;
+
+    //A block leaves the limiter while the one before it is still playing, then goes through the device's own buffers
+    int latency = samplesPerBlockExpected;
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        latency = device->getCurrentBufferSizeSamples() + device->getOutputLatencyInSamples();
+    deviceLatency = latency;
+
+    //Everything after the decks delays them all alike, each deck allows for it in the position it reports
+    for (auto* player : { &player1, &player2 })
+        player->setOutputLatency(mixer.getLatencyInSamples() + limiter.getLatencyInSamples() + deviceLatency.load());
+}
+
+//Function to add the stages every deck goes through after its own to the deck's latency report
+PipelineLatency MainComponent::getLatencyReport(const DJAudioplayer& player) const
+{
+    PipelineLatency report(deviceSampleRate);
+    report.append(player.getLatencyReport());
+    report.add("mixer", mixer.getLatencyInSamples());
+    report.add("limiter", limiter.getLatencyInSamples());
+    report.add("device", deviceLatency.load());
+    return report;
 }
 
 //Gets the next block of audio and mixes it for playback
 void MainComponent::getNextAudioBlock (const AudioSourceChannelInfo& bufferToFill)
 {
-    mixerSource.getNextAudioBlock(bufferToFill);
+    //The whole mixer to player path must be allocation free, Debug builds assert if it is not
+    AllocationTripwire::ScopedRealtimeSection realtimeSection;
+
+    profiler.beginCallback(bufferToFill.numSamples, deviceSampleRate);
+
+    //The decks only ever see outputs 1 and 2; the buffer refers to the device's channels, nothing is allocated
+    auto* deviceBuffer = bufferToFill.buffer;
+    int numOutputs = deviceBuffer->getNumChannels();
+    AudioBuffer<float> master(deviceBuffer->getArrayOfWritePointers(), jmin(2, numOutputs),
+                              bufferToFill.startSample, bufferToFill.numSamples);
+    AudioSourceChannelInfo masterInfo(&master, 0, bufferToFill.numSamples);
+    limiter.getNextAudioBlock(masterInfo);
+
+    //The preview goes to outputs 3 and 4 when there are any, otherwise it joins the master after the limiter
+    if (numOutputs >= 4 && previewPlayer.getRouting() == PreviewPlayer::Routing::cue)
+    {
+        AudioBuffer<float> cue(deviceBuffer->getArrayOfWritePointers() + 2, 2, bufferToFill.startSample, bufferToFill.numSamples);
+        previewPlayer.getNextAudioBlock(AudioSourceChannelInfo(&cue, 0, bufferToFill.numSamples));
+    }
+    else
+    {
+        previewPlayer.addNextAudioBlock(masterInfo);
+        if (numOutputs > 2)
+            for (int channel = 2; channel < jmin(4, numOutputs); ++channel)
+                deviceBuffer->clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+    }
+
+    //Any further outputs stay silent
+    for (int channel = 4; channel < numOutputs; ++channel)
+        deviceBuffer->clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+
+    profiler.endCallback();
 }
 
 //This will be called when the audio device stops, or when it is being
 void MainComponent::releaseResources()
 {
-    player1.releaseResources();
-    player2.releaseResources();
-    mixerSource.releaseResources();
+    //Releases the mixer and the decks as well
+    limiter.releaseResources();
+    previewPlayer.releaseResources();
 }
 
 //Draws the background
@@ -108,25 +207,67 @@ void MainComponent::resized()
     crossFaderSlider.setBounds(480, 670, sliderWidth, sliderHeight);
     crossFaderSlider.setBounds(480, 640, sliderWidth, sliderHeight);
     crossFaderLabel.setBounds(480, 620, sliderWidth, 20);
+
+    //Curve, record and replay buttons in a row under the crossfader
+    int buttonWidth = sliderWidth / 3;
+    curveButton.setBounds(480, 692, buttonWidth - 4, 22);
+    recordButton.setBounds(480 + buttonWidth, 692, buttonWidth - 4, 22);
+    replayButton.setBounds(480 + 2 * buttonWidth, 692, buttonWidth - 4, 22);
+
+    //Limiter meter under the buttons
+    limiterMeter.setBounds(480, 718, sliderWidth - 4, 14);
+    profilerButton.setBounds(480 + sliderWidth + 4, 718, 50, 14);
+
+    //Profiler overlay over the top of the first deck
+    profilerOverlay.setBounds(10, 10, 460, 340);
 }
 
-//Function to impleament equal-power crossfading
+//Function to send crossfader moves to the mixer
 void MainComponent::sliderValueChanged (Slider* slider)
 {
     if (slider == &crossFaderSlider)
     {
         //Get the current crossfade value (0: full player1, 1: full player2)
         double crossValue = crossFaderSlider.getValue();
-        //Compute gains using equal-power crossfade:
-    
-        double leftGain  = std::sin(crossValue * (juce::MathConstants<double>::pi / 2));
-        double rightGain = std::cos(crossValue * (juce::MathConstants<double>::pi / 2));
-
-        //Set the gains for each player
-        player1.setGain(leftGain);
-        player2.setGain(rightGain);
-        
-        std::cout << "Crossfader updated: Left gain = " << leftGain
-                  << ", Right gain = " << rightGain << std::endl;
+        //Stamped with when the mouse moved, the mixer applies it at the matching sample through the selected curve
+        mixer.moveCrossfader((float) crossValue, crossFaderSlider.getEventTimeMs());
+    }
+}
+
+//Function to handle the crossfader curve, record and replay buttons and the profiler toggle
+void MainComponent::buttonClicked (Button* button)
+{
+    auto& crossfader = mixer.getCrossfaderEngine();
+
+    if (button == &curveButton)
+    {
+        //Constant power, then scratch, then linear
+        const char* curveNames[] = { "POWER", "SCRATCH", "LINEAR" };
+        int next = ((int) crossfader.getCurve() + 1) % (int) CrossfaderEngine::Curve::numCurves;
+        crossfader.setCurve((CrossfaderEngine::Curve) next);
+        curveButton.setButtonText(curveNames[next]);
+    }
+    else if (button == &recordButton)
+    {
+        if (recordButton.getToggleState())
+            crossfader.startRecording();
+        else
+            crossfader.stopRecording();
+
+        replayButton.setEnabled(! recordButton.getToggleState());
+    }
+    else if (button == &profilerButton)
+    {
+        profilerOverlay.setVisible(profilerButton.getToggleState());
+        if (profilerOverlay.isVisible())
+            profilerOverlay.toFront(false);
+    }
+    else if (button == &replayButton)
+    {
+        //Starts the last recording, or stops the one playing
+        if (crossfader.isReplaying())
+            crossfader.stopReplay();
+        else
+            crossfader.startReplay(crossfader.getRecording());
     }
 }
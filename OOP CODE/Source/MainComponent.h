@@ -4,6 +4,12 @@
 #include "DJAudioplayer.h"
 #include "DeckGUI.h"
 #include "PlaylistComponent.h"
+#include "DeckMixer.h"
+#include "MasterLimiter.h"
+#include "GainReductionMeter.h"
+#include "CallbackProfiler.h"
+#include "ProfilerOverlay.h"
+#include "PreviewPlayer.h"
 
 //A custom LookAndFeel class for styling the crossfader slider
 class CrossFaderLookAndFeel : public LookAndFeel_V4
@@ -58,10 +64,47 @@ public:
     }
 };
 
+//Crossfader slider that remembers when the mouse event behind each change happened, so a move can be timestamped
+//from before it waited in the message queue
+class CrossFaderSlider : public Slider
+{
+public:
+    //Time::getMillisecondCounterHiRes time of the mouse event being handled, or now for changes made any other way
+    double getEventTimeMs() const
+    {
+        return eventTimeMs > 0.0 ? eventTimeMs : Time::getMillisecondCounterHiRes();
+    }
+
+    void mouseDown(const MouseEvent& e) override
+    {
+        stamp(e);
+        Slider::mouseDown(e);
+        eventTimeMs = 0.0;
+    }
+
+    void mouseDrag(const MouseEvent& e) override
+    {
+        stamp(e);
+        Slider::mouseDrag(e);
+        eventTimeMs = 0.0;
+    }
+
+private:
+    //Works back from now by however long the event has been waiting since the OS saw it
+    void stamp(const MouseEvent& e)
+    {
+        auto waitedMs = jlimit((int64) 0, (int64) 100, Time::getCurrentTime().toMilliseconds() - e.eventTime.toMilliseconds());
+        eventTimeMs = Time::getMillisecondCounterHiRes() - (double) waitedMs;
+    }
+
+    double eventTimeMs = 0.0;
+};
+
 
 //The main audio component containing two decks, a playlist, and a crossfader
 class MainComponent : public AudioAppComponent,
-                      public Slider::Listener //Listens for slider changes
+                      public Slider::Listener, //Listens for slider changes
+                      public Button::Listener //Listens for the crossfader buttons
 {
 public:
     //Constructor: Initializes audio components and UI elements
@@ -82,9 +125,14 @@ public:
 
     //Implement Slider::Listener
     void sliderValueChanged(Slider* slider) override;
+    //Implement Button::Listener
+    void buttonClicked(Button* button) override;
 
 
 private:
+    //Whole path of a deck to the speaker: its own stages, then the mixer, the limiter and the device
+    PipelineLatency getLatencyReport(const DJAudioplayer& player) const;
+
     //Manages audio file formats
     AudioFormatManager formatManager;
     //Caches waveforms for fast drawing
@@ -93,28 +141,69 @@ private:
     //File chooser for selecting audio files
     juce::FileChooser fChooser{"Select a file..."};
 
+    //Background thread shared by both decks for read-ahead decoding
+    TimeSliceThread readAheadThread{"Deck read-ahead"};
+
+    //Fully decoded tracks shared by both decks, 1 GB of float samples is roughly 50 minutes of stereo 44.1 kHz audio
+    TrackCache trackCache{1024 * 1024 * 1024};
+
+    //Opens and pre-decodes tracks for both decks on worker threads
+    TrackLoader trackLoader{formatManager, readAheadThread};
+
+    //Impulse responses for the decks' convolution reverb, one copy per file and sample rate whichever deck loads it
+    ImpulseResponseLibrary impulseResponses;
+
     //Two DJ audio players
-    DJAudioplayer player1{formatManager};
-    DJAudioplayer player2{formatManager};
+    DJAudioplayer player1{trackLoader};
+    DJAudioplayer player2{trackLoader};
 
     //Two deck GUIs for controlling the players
     DeckGUI deckGUI1{&player1, formatManager, thumbCache, true};
     DeckGUI deckGUI2{&player2, formatManager, thumbCache, false};
 
-    //Mixer to combine audio from both decks
-    MixerAudioSource mixerSource;
+    //Number of decks on screen, the mixer engine takes up to DeckMixer::maxDecks
+    static constexpr int numDecks = 2;
+    //Workers that render the decks side by side once there are enough of them, the device thread renders one itself
+    DeckRenderPool renderPool{numDecks - 1};
+    //Tempo and beat the SYNC buttons lock the decks to, moved on by the mixer
+    MasterClock masterClock;
+    //Mixer to combine audio from both decks through their channel strips
+    DeckMixer mixer{numDecks};
+    //True-peak limiter on the master bus after the mixer
+    MasterLimiter limiter{&mixer, false};
+
+    //Auditions library tracks on the cue outputs, or the master without them, never on a deck
+    PreviewPlayer previewPlayer;
 
     //Playlist component for managing tracks
     PlaylistComponent playlistComponent;
 
     //Horizontal slider for balancing between decks
-    Slider crossFaderSlider;
+    CrossFaderSlider crossFaderSlider;
     //Custom look for the crossfader
     CrossFaderLookAndFeel crossFaderLookAndFeel;
 
     //Label for crossfader control
     juce::Label crossFaderLabel{"crossFaderLabel", "CROSSFADER"};
 
+    //Cycles the crossfader curve, records crossfader moves and replays the last recording
+    TextButton curveButton{"POWER"};
+    TextButton recordButton{"REC"};
+    TextButton replayButton{"REPLAY"};
+
+    //Master limiter gain reduction, click to switch the limiter off and on
+    GainReductionMeter limiterMeter{limiter};
+
+    //Times every callback and its stages, always running
+    CallbackProfiler profiler;
+    //Sample rate the device was opened at, for the callback deadline
+    double deviceSampleRate = 44100.0;
+    //Samples from the limiter's output to the speaker: the block being played and the device's own output latency
+    std::atomic<int> deviceLatency { 0 };
+    //Profiler figures drawn over the decks, shown and hidden with the PERF button
+    ProfilerOverlay profilerOverlay{profiler};
+    TextButton profilerButton{"PERF"};
+
     //Prevents accidental copying of the component
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
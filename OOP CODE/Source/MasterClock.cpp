@@ -0,0 +1,63 @@
+#include "MasterClock.h"
+
+//Constructor
+MasterClock::MasterClock()
+{
+}
+
+//Destructor
+MasterClock::~MasterClock()
+{
+}
+
+//Function to set the sample rate and start counting from zero, keeping the tempo and beat
+void MasterClock::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    lastPieceSize = 0;
+    samplePosition = 0;
+}
+
+//Function to move the clock on to the piece about to be rendered
+void MasterClock::advance(int numSamples) noexcept
+{
+    //Offers made while the last piece rendered are stamped with its number and give the beat at the start of this one
+    auto lastPiece = pieceNumber.load();
+    auto isOffering = [this, lastPiece] (int deck) { return offers[(size_t) deck].piece.load() == lastPiece; };
+
+    int newLeader = isPositiveAndBelow(leader, maxDecks) && isOffering(leader) ? leader : -1;
+    for (int deck = 0; deck < maxDecks && newLeader < 0; ++deck)
+        if (isOffering(deck))
+            newLeader = deck;
+
+    if (newLeader >= 0)
+    {
+        pieceStartBeat = offers[(size_t) newLeader].beat.load();
+        pieceBpm = offers[(size_t) newLeader].bpm.load();
+    }
+    else
+    {
+        //Nobody is leading, run on at the last tempo
+        pieceStartBeat += (double) lastPieceSize * pieceBpm / (60.0 * sampleRate);
+    }
+
+    leader = newLeader;
+    lastPieceSize = numSamples;
+    pieceNumber = lastPiece + 1;
+
+    publishedBpm = pieceBpm;
+    publishedLeader = leader;
+    samplePosition += numSamples;
+}
+
+//Function to take a deck's offer to lead, the next call to advance decides whether it does
+void MasterClock::offerLead(int deck, double beatAtNextPiece, double bpm) noexcept
+{
+    if (! isPositiveAndBelow(deck, maxDecks) || bpm <= 0.0)
+        return;
+
+    auto& offer = offers[(size_t) deck];
+    offer.beat = beatAtNextPiece;
+    offer.bpm = bpm;
+    offer.piece = pieceNumber.load();
+}
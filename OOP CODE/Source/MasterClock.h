@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Tempo and beat position every deck can sync to, kept on the audio thread and counted in device samples. The mixer
+//moves it on before each piece of audio it renders. A deck that is playing a track with a beat grid and isn't synced
+//itself offers to lead by publishing its beat at the end of each block; the clock follows the deck it followed last
+//time if that one is still offering, otherwise the lowest-numbered one. With no leader it carries on at the last
+//tempo, so synced decks stay together when the leader stops. Synced decks read the clock while they render and
+//steer their own speed to it; nothing here ever moves a deck's position
+class MasterClock
+{
+public:
+    //Highest deck number that can lead, matches the mixer's deck limit
+    static constexpr int maxDecks = 8;
+
+    //Constructor
+    MasterClock();
+    //Destructor
+    ~MasterClock();
+
+    //Message thread, before the device starts: sets the rate samples are counted at
+    void prepare(double sampleRate);
+
+    //Audio thread, before the decks render each piece: takes the leader's beat or runs on from the last piece
+    void advance(int numSamples) noexcept;
+
+    //Audio thread, while the decks render: beat position at the start of this piece and the tempo through it
+    double getBeat() const noexcept { return pieceStartBeat; }
+    double getBpm() const noexcept { return pieceBpm; }
+
+    //Audio thread, from a deck at the end of its block: offers its beat at the start of the next piece and its tempo
+    void offerLead(int deck, double beatAtNextPiece, double bpm) noexcept;
+
+    //Any thread: the tempo, 0 until a deck has led, and the deck leading, -1 if none is
+    double getTempo() const { return publishedBpm.load(); }
+    int getLeader() const { return publishedLeader.load(); }
+    //Any thread: device samples counted since prepare
+    int64 getSamplePosition() const { return samplePosition.load(); }
+
+private:
+    //One deck's offer, the stamp says which piece it was made in
+    struct Offer
+    {
+        std::atomic<double> beat { 0.0 };
+        std::atomic<double> bpm { 0.0 };
+        std::atomic<uint32> piece { 0 };
+    };
+
+    std::array<Offer, maxDecks> offers;
+
+    //Audio thread state
+    double sampleRate = 44100.0;
+    double pieceStartBeat = 0.0;
+    double pieceBpm = 0.0;
+    int lastPieceSize = 0;
+    int leader = -1;
+    //Counts pieces so a stale offer isn't taken for a fresh one, starts at 1 so no slot looks fresh before an offer
+    std::atomic<uint32> pieceNumber { 1 };
+
+    //Published for the UI and the benchmarks
+    std::atomic<double> publishedBpm { 0.0 };
+    std::atomic<int> publishedLeader { -1 };
+    std::atomic<int64> samplePosition { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MasterClock)
+};
@@ -0,0 +1,416 @@
+#include "MasterLimiter.h"
+#include "CallbackProfiler.h"
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define OTODECKS_LIMITER_SSE 1
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+ #include <arm_neon.h>
+ #define OTODECKS_LIMITER_NEON 1
+#endif
+
+namespace
+{
+    //Zeroth-order modified Bessel function, for the Kaiser window
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+}
+
+//Constructor: Designs the 8x interpolator the true-peak detector uses
+MasterLimiter::MasterLimiter(AudioSource* inputSource, bool deleteInputWhenDeleted)
+    : input(inputSource, deleteInputWhenDeleted)
+{
+    //Windowed sinc through the taps either side of the point being interpolated, each phase normalised to unity at DC
+    const double beta = 5.0;
+    const double halfWidth = numTaps / 2 + 0.5;
+    interpolatorHeadroom = 1.0f;
+
+    for (int phase = 0; phase < numPhases; ++phase)
+    {
+        double fraction = phase / (double) numPhases;
+        double weights[numTaps], sum = 0.0;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            //Tap 0 is the oldest sample, the point sits between taps 5 and 6
+            double distance = fraction - (tap - (numTaps / 2 - 1));
+            double sinc = distance == 0.0 ? 1.0 : std::sin(MathConstants<double>::pi * distance) / (MathConstants<double>::pi * distance);
+            double ratio = distance / halfWidth;
+            double window = besselI0(beta * std::sqrt(jmax(0.0, 1.0 - ratio * ratio))) / besselI0(beta);
+            weights[tap] = sinc * window;
+            sum += weights[tap];
+        }
+
+        float headroom = 0.0f;
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            coefficients[tap][phase] = (float) (weights[tap] / sum);
+            headroom += std::abs(coefficients[tap][phase]);
+        }
+
+        interpolatorHeadroom = jmax(interpolatorHeadroom, headroom);
+    }
+}
+
+//Destructor
+MasterLimiter::~MasterLimiter()
+{
+}
+
+//Function to size the delay and gain computer for the sample rate and start with no gain reduction
+void MasterLimiter::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    currentSampleRate = sampleRate;
+    blockSize = jmax(1, samplesPerBlockExpected);
+    lookAhead = jmax(1, roundToInt(lookAheadMs * sampleRate / 1000.0));
+    historyLength = jmax(lookAhead + detectorDelay, numTaps - 1);
+    latency = lookAhead + detectorDelay;
+
+    history.setSize(2, historyLength + blockSize);
+    history.clear();
+    peaks.allocate((size_t) blockSize, true);
+    gains.allocate((size_t) blockSize, true);
+
+    holdCapacity = lookAhead + 2;
+    holdValues.allocate((size_t) holdCapacity, true);
+    holdTimes.allocate((size_t) holdCapacity, true);
+    averageRing.allocate((size_t) lookAhead, false);
+
+    //Settled: nothing held, unity envelope and average
+    holdStart = holdSize = 0;
+    sampleCounter = 0;
+    envelope = 1.0f;
+    FloatVectorOperations::fill(averageRing.getData(), 1.0f, lookAhead);
+    averagePosition = 0;
+    averageSum = lookAhead;
+    unityRun = lookAhead;
+    minimumGain = 1.0f;
+}
+
+//Function to release the input and the buffers
+void MasterLimiter::releaseResources()
+{
+    input->releaseResources();
+    history.setSize(2, 0);
+    blockSize = 0;
+}
+
+//Function to set the output ceiling
+void MasterLimiter::setCeilingDecibels(float decibels)
+{
+    ceilingDecibels = jlimit(-12.0f, 0.0f, decibels);
+}
+
+//Function to set the release time
+void MasterLimiter::setReleaseMs(float milliseconds)
+{
+    releaseMs = jlimit(10.0f, 1000.0f, milliseconds);
+}
+
+//Function to switch the limiting on or off
+void MasterLimiter::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+}
+
+//Function to read and reset the deepest gain reduction, so a meter never misses a short one between repaints
+float MasterLimiter::getGainReductionDecibels()
+{
+    return Decibels::gainToDecibels(minimumGain.exchange(1.0f), -60.0f);
+}
+
+//Function to report which detector this build uses
+bool MasterLimiter::isVectorised()
+{
+   #if OTODECKS_LIMITER_SSE || OTODECKS_LIMITER_NEON
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+//Function to pull the mix and limit it, in pieces no bigger than the prepared block
+void MasterLimiter::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    input->getNextAudioBlock(bufferToFill);
+
+    CallbackProfiler::ScopedStage profilerStage(CallbackProfiler::limiter);
+
+    if (blockSize == 0)
+        return;
+
+    auto* buffer = bufferToFill.buffer;
+    int numChannels = buffer->getNumChannels();
+    float* channels[8];
+    numChannels = jmin(numChannels, 8);
+
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += blockSize)
+    {
+        int numSamples = jmin(blockSize, bufferToFill.numSamples - offset);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            channels[channel] = buffer->getWritePointer(channel, bufferToFill.startSample + offset);
+
+        processBlock(channels, numChannels, numSamples);
+    }
+}
+
+//Function to delay a block and apply the gain the look-ahead worked out for it
+void MasterLimiter::processBlock(float* const* channels, int numChannels, int numSamples) noexcept
+{
+    if (numChannels == 0)
+        return;
+
+    const float ceiling = Decibels::decibelsToGain(ceilingDecibels.load());
+
+    //Append the block to the history; mono is limited as if both sides were the same
+    for (int channel = 0; channel < 2; ++channel)
+        FloatVectorOperations::copy(history.getWritePointer(channel, historyLength),
+                                    channels[jmin(channel, numChannels - 1)], numSamples);
+
+    //The detector also looks back into the last block, so include its tail in the quick check
+    float blockPeak = 0.0f;
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        auto range = FloatVectorOperations::findMinAndMax(history.getReadPointer(channel, historyLength - (numTaps - 1)),
+                                                          numSamples + numTaps - 1);
+        blockPeak = jmax(blockPeak, -range.getStart(), range.getEnd());
+    }
+
+    bool unityGain = true;
+
+    if (! enabled.load())
+    {
+        //Back to rest, so switching on again starts clean
+        holdSize = 0;
+        envelope = 1.0f;
+        FloatVectorOperations::fill(averageRing.getData(), 1.0f, lookAhead);
+        averageSum = lookAhead;
+        unityRun = lookAhead;
+        sampleCounter += numSamples;
+    }
+    else if (isSettled() && blockPeak * interpolatorHeadroom <= ceiling)
+    {
+        //Nothing in or before this block can reach the ceiling, the gain stays at unity
+        holdSize = 0;
+        averageSum = lookAhead;
+        sampleCounter += numSamples;
+    }
+    else
+    {
+        detectTruePeaks(2, numSamples);
+        computeGains(numSamples);
+        unityGain = false;
+    }
+
+    //The output is the history delayed by the latency
+    const int delay = lookAhead + detectorDelay;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const float* source = history.getReadPointer(jmin(channel, 1), historyLength - delay);
+        float* output = channels[channel];
+
+        if (unityGain)
+        {
+            FloatVectorOperations::copy(output, source, numSamples);
+            continue;
+        }
+
+        const float* gain = gains.getData();
+        int i = 0;
+
+       #if OTODECKS_LIMITER_SSE
+        const __m128 high = _mm_set1_ps(ceiling), low = _mm_set1_ps(-ceiling);
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            __m128 sample = _mm_mul_ps(_mm_loadu_ps(source + i), _mm_loadu_ps(gain + i));
+            _mm_storeu_ps(output + i, _mm_min_ps(high, _mm_max_ps(low, sample)));
+        }
+       #elif OTODECKS_LIMITER_NEON
+        const float32x4_t high = vdupq_n_f32(ceiling), low = vdupq_n_f32(-ceiling);
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            float32x4_t sample = vmulq_f32(vld1q_f32(source + i), vld1q_f32(gain + i));
+            vst1q_f32(output + i, vminq_f32(high, vmaxq_f32(low, sample)));
+        }
+       #endif
+
+        //The clamp only catches rounding in the gain average, the gain has already done the work
+        for (; i < numSamples; ++i)
+            output[i] = jlimit(-ceiling, ceiling, source[i] * gain[i]);
+    }
+
+    //Keep the newest samples as history for the next block
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        auto* data = history.getWritePointer(channel);
+        std::memmove(data, data + numSamples, sizeof(float) * (size_t) historyLength);
+    }
+}
+
+//Function to interpolate eight points per sample from the last 12 samples of each channel and keep the loudest
+void MasterLimiter::detectTruePeaks(int numChannels, int numSamples) noexcept
+{
+    float* peak = peaks.getData();
+
+   #if OTODECKS_LIMITER_SSE
+    __m128 weightsLow[numTaps], weightsHigh[numTaps];
+    for (int tap = 0; tap < numTaps; ++tap)
+    {
+        weightsLow[tap] = _mm_load_ps(coefficients[tap]);
+        weightsHigh[tap] = _mm_load_ps(coefficients[tap] + 4);
+    }
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        __m128 loudest = _mm_setzero_ps();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const float* x = history.getReadPointer(channel, historyLength + i - (numTaps - 1));
+
+            //Lanes are the eight phases between this sample and the next, four to a register
+            __m128 input = _mm_set1_ps(x[0]);
+            __m128 low = _mm_mul_ps(input, weightsLow[0]);
+            __m128 high = _mm_mul_ps(input, weightsHigh[0]);
+            for (int tap = 1; tap < numTaps; ++tap)
+            {
+                input = _mm_set1_ps(x[tap]);
+                low = _mm_add_ps(low, _mm_mul_ps(input, weightsLow[tap]));
+                high = _mm_add_ps(high, _mm_mul_ps(input, weightsHigh[tap]));
+            }
+
+            loudest = _mm_max_ps(loudest, _mm_max_ps(_mm_andnot_ps(signBit, low), _mm_andnot_ps(signBit, high)));
+        }
+
+        loudest = _mm_max_ps(loudest, _mm_shuffle_ps(loudest, loudest, _MM_SHUFFLE(1, 0, 3, 2)));
+        loudest = _mm_max_ps(loudest, _mm_shuffle_ps(loudest, loudest, _MM_SHUFFLE(2, 3, 0, 1)));
+        peak[i] = _mm_cvtss_f32(loudest);
+    }
+   #elif OTODECKS_LIMITER_NEON
+    float32x4_t weightsLow[numTaps], weightsHigh[numTaps];
+    for (int tap = 0; tap < numTaps; ++tap)
+    {
+        weightsLow[tap] = vld1q_f32(coefficients[tap]);
+        weightsHigh[tap] = vld1q_f32(coefficients[tap] + 4);
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float32x4_t loudest = vdupq_n_f32(0.0f);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const float* x = history.getReadPointer(channel, historyLength + i - (numTaps - 1));
+
+            float32x4_t low = vmulq_n_f32(weightsLow[0], x[0]);
+            float32x4_t high = vmulq_n_f32(weightsHigh[0], x[0]);
+            for (int tap = 1; tap < numTaps; ++tap)
+            {
+                low = vmlaq_n_f32(low, weightsLow[tap], x[tap]);
+                high = vmlaq_n_f32(high, weightsHigh[tap], x[tap]);
+            }
+
+            loudest = vmaxq_f32(loudest, vmaxq_f32(vabsq_f32(low), vabsq_f32(high)));
+        }
+
+        peak[i] = vmaxvq_f32(loudest);
+    }
+   #else
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float loudest = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const float* x = history.getReadPointer(channel, historyLength + i - (numTaps - 1));
+
+            for (int phase = 0; phase < numPhases; ++phase)
+            {
+                float sum = 0.0f;
+                for (int tap = 0; tap < numTaps; ++tap)
+                    sum += x[tap] * coefficients[tap][phase];
+                loudest = jmax(loudest, std::abs(sum));
+            }
+        }
+
+        peak[i] = loudest;
+    }
+   #endif
+}
+
+//Function to hold, release and average the gain each peak needs, one sample at a time
+void MasterLimiter::computeGains(int numSamples) noexcept
+{
+    const float ceiling = Decibels::decibelsToGain(ceilingDecibels.load());
+    const int holdLength = lookAhead + 1;
+    releaseCoefficient = (float) std::exp(-1.0 / (releaseMs.load() * 0.001 * currentSampleRate));
+
+    const float* peak = peaks.getData();
+    float* gain = gains.getData();
+    float lowest = 1.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float request = peak[i] > ceiling ? ceiling / peak[i] : 1.0f;
+
+        //Sliding minimum: drop held values the new request undercuts, then the ones that have expired
+        while (holdSize > 0 && holdValues[(holdStart + holdSize - 1) % holdCapacity] >= request)
+            --holdSize;
+
+        int back = (holdStart + holdSize) % holdCapacity;
+        holdValues[back] = request;
+        holdTimes[back] = sampleCounter;
+        ++holdSize;
+
+        while (holdTimes[holdStart] <= sampleCounter - holdLength)
+        {
+            holdStart = (holdStart + 1) % holdCapacity;
+            --holdSize;
+        }
+
+        float held = holdValues[holdStart];
+
+        //Attack straight away, release exponentially, snapping to unity at the end so the fast path can take over
+        if (held < envelope)
+            envelope = held;
+        else
+            envelope = held - (held - envelope) * releaseCoefficient;
+
+        if (envelope > 0.99999f && held == 1.0f)
+            envelope = 1.0f;
+
+        unityRun = envelope == 1.0f ? unityRun + 1 : 0;
+
+        //Averaging over the look-ahead turns the held steps into ramps that finish as the peak comes out
+        averageSum += envelope - averageRing[averagePosition];
+        averageRing[averagePosition] = envelope;
+        if (++averagePosition == lookAhead)
+            averagePosition = 0;
+
+        gain[i] = (float) (averageSum / lookAhead);
+        lowest = jmin(lowest, gain[i]);
+        ++sampleCounter;
+    }
+
+    //The sum drifts a little over a long reduction, it is exact again once the ring is all unity
+    if (unityRun >= lookAhead)
+        averageSum = lookAhead;
+
+    //Fold this block into the reading the UI hasn't collected yet
+    auto previous = minimumGain.load();
+    while (lowest < previous && ! minimumGain.compare_exchange_weak(previous, lowest)) {}
+}
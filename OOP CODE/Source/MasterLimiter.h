@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Look-ahead brickwall limiter for the master bus, placed after the mixer so hot decks with boosted EQ can't clip.
+//
+//Peaks are detected on an 8x oversampled copy of the signal (a 96-tap polyphase interpolator, 12 taps per phase,
+//SSE on x86 and NEON on 64-bit ARM), so peaks that fall between samples and would clip a DAC or an encoder are
+//caught as well. Each detected peak asks for the gain that brings it down to the ceiling; that request is held for
+//the look-ahead time, released exponentially and averaged over the look-ahead window, so the gain has already
+//reached it when the delayed audio gets there and never changes faster than the look-ahead allows.
+//Sample peaks never pass the ceiling. True peaks stay within the detector's accuracy: it reads a full-scale sine
+//at most 0.12 dB low up to 0.46 fs, where a 4x detector can be 0.44 dB low. Loud content right at the top of the
+//band, such as full-band white noise, can still overshoot by about half a dB
+//
+//Latency is fixed: lookAheadMs plus 5 samples for the detector, 71 samples at 44.1 kHz and 77 at 48 kHz, reported
+//by getLatencyInSamples. Switching the limiter off keeps the latency so nothing downstream jumps.
+//
+//Cost at 48 kHz stereo with 256-sample blocks on one desktop x86 core (measure on the target machine with:
+//OtoDecks --benchmark limiter): about 0.35% of a core, so it can stay on permanently. When the signal is far enough
+//below the ceiling that no interpolated peak could reach it, and nothing is being held or released, a block is
+//only peak-checked and delayed
+class MasterLimiter : public AudioSource
+{
+public:
+    //How far ahead the limiter looks, which is also its attack time
+    static constexpr double lookAheadMs = 1.5;
+    //Samples of latency the true-peak detector adds to the look-ahead
+    static constexpr int detectorDelay = 5;
+
+    //Constructor: Wraps the source to limit, usually the mixer
+    MasterLimiter(AudioSource* inputSource, bool deleteInputWhenDeleted);
+    //Destructor: Releases the input
+    ~MasterLimiter() override;
+
+    //AudioSource overrides
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    //Any thread: highest level the output reaches, from -12 to 0 dBTP
+    void setCeilingDecibels(float decibels);
+    float getCeilingDecibels() const { return ceilingDecibels.load(); }
+    //Any thread: how long the gain takes to recover, from 10 to 1000 ms
+    void setReleaseMs(float milliseconds);
+    //Any thread: turns the limiting on and off, the delay stays either way
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const { return enabled.load(); }
+
+    //Any thread: deepest gain reduction since the last call, in dB (0 or negative); for meters
+    float getGainReductionDecibels();
+
+    //Samples the output lags behind the input
+    int getLatencyInSamples() const { return latency.load(); }
+
+    //Returns true if this build uses the SIMD detector
+    static bool isVectorised();
+
+private:
+    //Audio thread: limits up to one prepared block in place
+    void processBlock(float* const* channels, int numChannels, int numSamples) noexcept;
+    //Audio thread: fills peaks with the highest 8x oversampled level of every channel at each sample
+    void detectTruePeaks(int numChannels, int numSamples) noexcept;
+    //Audio thread: turns the peaks into the gain for each delayed sample
+    void computeGains(int numSamples) noexcept;
+    //Audio thread: the gain computer is at rest with no reduction and nothing held
+    bool isSettled() const noexcept { return envelope == 1.0f && unityRun >= lookAhead; }
+
+    OptionalScopedPointer<AudioSource> input;
+
+    std::atomic<float> ceilingDecibels { -1.0f };
+    std::atomic<float> releaseMs { 80.0f };
+    std::atomic<bool> enabled { true };
+    //Lowest gain applied since the UI last read it
+    std::atomic<float> minimumGain { 1.0f };
+    std::atomic<int> latency { 0 };
+
+    //Interpolator coefficients: for each of the 12 input taps, the weights of the eight output phases
+    static constexpr int numTaps = 12;
+    static constexpr int numPhases = 8;
+    alignas(16) float coefficients[numTaps][numPhases];
+    //Largest gain the interpolator can give any phase, to rule out peaks from the sample peak alone
+    float interpolatorHeadroom = 1.0f;
+
+    int blockSize = 0;
+    int lookAhead = 0;
+    //How many past samples each channel keeps: enough for the delay and the interpolator
+    int historyLength = 0;
+    //Per channel: historyLength past samples followed by the current block
+    AudioBuffer<float> history;
+    HeapBlock<float> peaks, gains;
+
+    //Gain computer: sliding minimum of the requested gains over lookAhead + 1 samples, kept as a ring of
+    //increasing values with the sample each was requested at
+    HeapBlock<float> holdValues;
+    HeapBlock<int64> holdTimes;
+    int holdCapacity = 0, holdStart = 0, holdSize = 0;
+    int64 sampleCounter = 0;
+    //Released gain and the moving average over lookAhead samples that smooths it
+    float envelope = 1.0f;
+    float releaseCoefficient = 0.0f;
+    HeapBlock<float> averageRing;
+    int averagePosition = 0;
+    double averageSum = 0.0;
+    //Samples in a row the envelope has been at unity
+    int unityRun = 0;
+    double currentSampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MasterLimiter)
+};
@@ -0,0 +1,445 @@
+#include "OfflineMixRenderer.h"
+
+namespace
+{
+    //Names used for the targets in mix scripts
+    const char* targetNames[] = { "crossfader", "volume", "trim", "speed", "bass", "mid", "treble", "reverb", "keyLock", "play", "stop" };
+
+    //Looks up a target by its script name
+    bool parseTarget(const String& name, OfflineMixRenderer::Target& target)
+    {
+        for (int i = 0; i < (int) std::size(targetNames); ++i)
+        {
+            if (name.equalsIgnoreCase(targetNames[i]))
+            {
+                target = (OfflineMixRenderer::Target) i;
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+//Function to render the script named on the command line and print how fast it went
+int OfflineMixRenderer::run(const String& commandLine)
+{
+    StringArray args;
+    args.addTokens(commandLine, true);
+    args.trim();
+    args.removeEmptyStrings();
+
+    int renderIndex = args.indexOf("--render");
+    if (renderIndex < 0 || renderIndex + 1 >= args.size())
+    {
+        std::cout << "Usage: OtoDecks --render mix.json [--output mix.wav]" << std::endl;
+        return 1;
+    }
+
+    File scriptFile = File::getCurrentWorkingDirectory().getChildFile(args[renderIndex + 1].unquoted());
+
+    MixScript script;
+    auto result = loadScript(scriptFile, script);
+    if (result.failed())
+    {
+        std::cout << "Can't use " << scriptFile.getFullPathName() << ": " << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    //The output named on the command line wins over the one in the script
+    int outputIndex = args.indexOf("--output");
+    if (outputIndex >= 0 && outputIndex + 1 < args.size())
+        script.output = File::getCurrentWorkingDirectory().getChildFile(args[outputIndex + 1].unquoted());
+
+    OfflineMixRenderer renderer(script);
+    result = renderer.render();
+    if (result.failed())
+    {
+        std::cout << "Render failed: " << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Rendered " << renderer.getRenderedSeconds() << " s to " << script.output.getFullPathName()
+              << " at " << renderer.getRealTimeFactor() << "x real time, peak "
+              << Decibels::gainToDecibels(renderer.getPeakLevel()) << " dBFS" << std::endl;
+    return 0;
+}
+
+//Function to read a mix script into the settings and time-ordered events the renderer runs
+Result OfflineMixRenderer::loadScript(const File& scriptFile, MixScript& script)
+{
+    if (! scriptFile.existsAsFile())
+        return Result::fail("file not found");
+
+    var json;
+    auto parsed = JSON::parse(scriptFile.loadFileAsString(), json);
+    if (parsed.failed())
+        return parsed;
+
+    auto folder = scriptFile.getParentDirectory();
+
+    script.sampleRate = json.getProperty("sampleRate", script.sampleRate);
+    script.blockSize = jlimit(16, 8192, (int) json.getProperty("blockSize", script.blockSize));
+    script.bitDepth = json.getProperty("bitDepth", script.bitDepth);
+    script.length = json.getProperty("length", script.length);
+    script.cacheMegabytes = json.getProperty("cacheMegabytes", script.cacheMegabytes);
+    script.output = folder.getChildFile(json.getProperty("output", scriptFile.getFileNameWithoutExtension() + ".wav").toString());
+
+    if (script.sampleRate < 8000.0 || script.sampleRate > 384000.0)
+        return Result::fail("sampleRate must be between 8000 and 384000");
+
+    if (script.bitDepth != 16 && script.bitDepth != 24 && script.bitDepth != 32)
+        return Result::fail("bitDepth must be 16, 24 or 32");
+
+    auto curveName = json.getProperty("crossfaderCurve", "constantPower").toString();
+    auto curveIndex = StringArray { "constantPower", "scratch", "linear" }.indexOf(curveName);
+    if (curveIndex < 0)
+        return Result::fail("crossfaderCurve must be constantPower, scratch or linear");
+    script.crossfaderCurve = (CrossfaderEngine::Curve) curveIndex;
+
+    script.limiterEnabled = json.getProperty("limiter", script.limiterEnabled);
+    script.limiterCeiling = json.getProperty("limiterCeiling", script.limiterCeiling);
+
+    auto* decks = json.getProperty("decks", var()).getArray();
+    if (decks == nullptr || decks->isEmpty())
+        return Result::fail("no decks");
+
+    if (decks->size() > DeckMixer::maxDecks)
+        return Result::fail("the mixer takes at most " + String(DeckMixer::maxDecks) + " decks");
+
+    std::vector<AutomationEvent> events;
+
+    for (int deck = 0; deck < decks->size(); ++deck)
+    {
+        auto& entry = decks->getReference(deck);
+        auto trackPath = entry.getProperty("track", "").toString();
+        auto trackFile = folder.getChildFile(trackPath);
+
+        if (trackPath.isEmpty() || ! trackFile.existsAsFile())
+            return Result::fail("deck " + String(deck) + ": track not found: " + trackPath);
+
+        script.tracks.add(URL(trackFile));
+
+        //First deck on the A side, second on B, the rest thru unless the script says otherwise
+        auto assign = entry.getProperty("assign", deck == 0 ? "A" : deck == 1 ? "B" : "thru").toString();
+        if (assign.equalsIgnoreCase("A"))
+            script.assigns.add(DeckMixer::CrossfaderAssign::a);
+        else if (assign.equalsIgnoreCase("B"))
+            script.assigns.add(DeckMixer::CrossfaderAssign::b);
+        else if (assign.equalsIgnoreCase("thru"))
+            script.assigns.add(DeckMixer::CrossfaderAssign::thru);
+        else
+            return Result::fail("deck " + String(deck) + ": assign must be A, B or thru");
+
+        //The deck's own fields are its settings at time 0
+        for (auto target : { Target::volume, Target::trim, Target::speed, Target::bass, Target::mid, Target::treble, Target::reverb, Target::keyLock })
+        {
+            auto name = targetNames[(int) target];
+            if (entry.hasProperty(name))
+                events.push_back({ 0.0, deck, target, (double) entry.getProperty(name, 0.0), 0.0 });
+        }
+
+        //Start playing at "start", from "offset" into the track
+        events.push_back({ jmax(0.0, (double) entry.getProperty("start", 0.0)), deck, Target::play,
+                           jmax(0.0, (double) entry.getProperty("offset", 0.0)), 0.0 });
+    }
+
+    if (auto* automation = json.getProperty("automation", var()).getArray())
+    {
+        for (auto& entry : *automation)
+        {
+            AutomationEvent event;
+            auto name = entry.getProperty("target", "").toString();
+
+            if (! parseTarget(name, event.target))
+                return Result::fail("unknown automation target: " + name);
+
+            event.time = jmax(0.0, (double) entry.getProperty("time", 0.0));
+            event.deck = entry.getProperty("deck", 0);
+            event.value = entry.getProperty("value", 0.0);
+            event.ramp = jmax(0.0, (double) entry.getProperty("ramp", 0.0));
+
+            if (event.target != Target::crossfader && ! isPositiveAndBelow(event.deck, decks->size()))
+                return Result::fail("automation for deck " + String(event.deck) + ", which doesn't exist");
+
+            events.push_back(event);
+        }
+    }
+
+    //Events at the same time keep their script order, so a deck's settings are in place before it plays
+    std::stable_sort(events.begin(), events.end(),
+                     [] (const AutomationEvent& a, const AutomationEvent& b) { return a.time < b.time; });
+    script.events = std::move(events);
+
+    return Result::ok();
+}
+
+//Constructor: Makes a deck for each track and plugs them into the mixer
+OfflineMixRenderer::OfflineMixRenderer(const MixScript& scriptToRender)
+    : script(scriptToRender),
+      trackCache((size_t) jmax(1, scriptToRender.cacheMegabytes) * 1024 * 1024),
+      mixer(scriptToRender.tracks.size())
+{
+    formatManager.registerBasicFormats();
+    trackLoader.setTrackCache(&trackCache);
+    readAheadThread.startThread(Thread::Priority::high);
+    mixer.setRenderPool(&renderPool);
+    mixer.getCrossfaderEngine().setCurve(script.crossfaderCurve);
+    limiter.setEnabled(script.limiterEnabled);
+    limiter.setCeilingDecibels(script.limiterCeiling);
+
+    for (int deck = 0; deck < script.tracks.size(); ++deck)
+    {
+        auto* player = players.add(new DJAudioplayer(trackLoader));
+        player->setUseTrackCache(true);
+        mixer.setSource(deck, player);
+        mixer.setCrossfaderAssign(deck, script.assigns[deck]);
+    }
+
+    deckStates.resize((size_t) players.size());
+}
+
+//Destructor: Stops the read-ahead thread once nothing reads from it
+OfflineMixRenderer::~OfflineMixRenderer()
+{
+    players.clear();
+    readAheadThread.stopThread(1000);
+}
+
+//Function to load every track, then pull the mix block by block and write it out, splitting blocks at events
+Result OfflineMixRenderer::render()
+{
+    limiter.prepareToPlay(script.blockSize, script.sampleRate);
+
+    //Decode every track into RAM up front so the render never waits for the disk or drops a block
+    for (int deck = 0; deck < players.size(); ++deck)
+    {
+        players[deck]->loadURL(script.tracks[deck]);
+
+        if (players[deck]->getLengthInSeconds() <= 0.0)
+            return Result::fail("could not load " + script.tracks[deck].getLocalFile().getFullPathName());
+    }
+
+    AudioBuffer<float> buffer(2, script.blockSize);
+    AudioSourceChannelInfo info(&buffer, 0, script.blockSize);
+
+    //One silent block with every deck stopped puts the loaded tracks live; it also fills the limiter's delay with silence
+    limiter.getNextAudioBlock(info);
+
+    script.output.deleteFile();
+    std::unique_ptr<FileOutputStream> stream(script.output.createOutputStream());
+    if (stream == nullptr || stream->failedToOpen())
+        return Result::fail("can't write to " + script.output.getFullPathName());
+
+    WavAudioFormat wavFormat;
+    std::unique_ptr<AudioFormatWriter> writer(wavFormat.createWriterFor(stream.get(), script.sampleRate, 2,
+                                                                        script.bitDepth, {}, 0));
+    if (writer == nullptr)
+        return Result::fail("can't create a WAV writer");
+    //The writer owns the stream now
+    stream.release();
+
+    int64 totalSamples = script.length >= 0.0 ? (int64) std::llround(script.length * script.sampleRate)
+                                               : getAutoLengthInSamples();
+    size_t nextEvent = 0;
+    int64 position = 0;
+    peakLevel = 0.0f;
+
+    //The limiter's output lags the mix, so render that much longer and drop the start
+    const int latency = limiter.getLatencyInSamples();
+    int toSkip = latency;
+
+    auto startTime = Time::getHighResolutionTicks();
+
+    while (position < totalSamples + latency)
+    {
+        //Everything due at this sample happens before it is rendered
+        while (nextEvent < script.events.size()
+               && (int64) std::llround(script.events[nextEvent].time * script.sampleRate) <= position)
+            applyEvent(script.events[nextEvent++], position);
+
+        updateRamps(position);
+
+        //Stop the block short of the next event so it lands on its exact sample
+        int64 blockEnd = jmin(totalSamples + latency, position + script.blockSize);
+        if (nextEvent < script.events.size())
+            blockEnd = jmin(blockEnd, (int64) std::llround(script.events[nextEvent].time * script.sampleRate));
+
+        int numSamples = (int) jmax((int64) 1, blockEnd - position);
+        AudioSourceChannelInfo block(&buffer, 0, numSamples);
+        limiter.getNextAudioBlock(block);
+
+        int skipped = jmin(toSkip, numSamples);
+        toSkip -= skipped;
+
+        if (numSamples > skipped)
+        {
+            peakLevel = jmax(peakLevel, buffer.getMagnitude(skipped, numSamples - skipped));
+            writer->writeFromAudioSampleBuffer(buffer, skipped, numSamples - skipped);
+        }
+
+        position += numSamples;
+    }
+
+    renderSeconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTime);
+    renderedSeconds = (double) totalSamples / script.sampleRate;
+
+    writer.reset();
+    limiter.releaseResources();
+
+    for (int deck = 0; deck < players.size(); ++deck)
+        if (auto underruns = players[deck]->getNumBufferUnderruns())
+            std::cout << "Deck " << deck << " streamed from disk and missed " << underruns
+                      << " blocks, raise cacheMegabytes to keep it in RAM" << std::endl;
+
+    return Result::ok();
+}
+
+//Function to estimate when the last deck finishes, from where and how fast each one starts playing
+int64 OfflineMixRenderer::getAutoLengthInSamples() const
+{
+    double end = 0.0;
+
+    for (int deck = 0; deck < players.size(); ++deck)
+    {
+        double speed = 1.0;
+
+        for (auto& event : script.events)
+        {
+            if (event.deck != deck)
+                continue;
+
+            if (event.target == Target::speed && event.time <= 0.0)
+                speed = jlimit(0.5, 2.0, event.value);
+
+            if (event.target == Target::play)
+                end = jmax(end, event.time + jmax(0.0, players[deck]->getLengthInSeconds() - event.value) / speed);
+        }
+    }
+
+    //Leave a second for the reverb and EQ to ring out
+    return (int64) std::llround((end + 1.0) * script.sampleRate);
+}
+
+//Function to apply one event, ramped events only record where they are heading
+void OfflineMixRenderer::applyEvent(const AutomationEvent& event, int64 position)
+{
+    auto* player = isPositiveAndBelow(event.deck, players.size()) ? players[event.deck] : nullptr;
+
+    if (event.target == Target::play && player != nullptr)
+    {
+        player->setPosition(event.value);
+        player->start();
+        return;
+    }
+
+    if (event.target == Target::stop && player != nullptr)
+    {
+        player->stop();
+        return;
+    }
+
+    //A new event on a lane replaces any ramp still running on it
+    ramps.erase(std::remove_if(ramps.begin(), ramps.end(), [&event] (const Ramp& ramp)
+                {
+                    return ramp.target == event.target && (event.target == Target::crossfader || ramp.deck == event.deck);
+                }), ramps.end());
+
+    if (event.ramp > 0.0)
+    {
+        double startValue = getValue(event.deck, event.target);
+        ramps.push_back({ event.deck, event.target, startValue, event.value,
+                          position, position + (int64) std::llround(event.ramp * script.sampleRate) });
+    }
+    else
+    {
+        setValue(event.deck, event.target, event.value);
+    }
+}
+
+//Function to move every ramp to its value at this sample and drop the ones that have finished
+void OfflineMixRenderer::updateRamps(int64 position)
+{
+    for (auto& ramp : ramps)
+    {
+        double progress = jlimit(0.0, 1.0, (double) (position - ramp.startSample) / (double) jmax((int64) 1, ramp.endSample - ramp.startSample));
+        setValue(ramp.deck, ramp.target, ramp.startValue + (ramp.endValue - ramp.startValue) * progress, progress >= 1.0);
+    }
+
+    ramps.erase(std::remove_if(ramps.begin(), ramps.end(),
+                               [position] (const Ramp& ramp) { return position >= ramp.endSample; }), ramps.end());
+}
+
+//Function to send a value to the deck it belongs to
+void OfflineMixRenderer::setValue(int deck, Target target, double value, bool isFinal)
+{
+    if (target == Target::crossfader)
+    {
+        crossfader = jlimit(0.0, 1.0, value);
+        mixer.setCrossfader((float) crossfader);
+        return;
+    }
+
+    if (! isPositiveAndBelow(deck, players.size()))
+        return;
+
+    auto* player = players[deck];
+    auto& state = deckStates[(size_t) deck];
+    getValue(deck, target) = value;
+
+    switch (target)
+    {
+        case Target::volume: mixer.setFader(deck, (float) value); break;
+        case Target::trim:   mixer.setTrimDecibels(deck, (float) value); break;
+        case Target::bass:   player->setBass(jlimit(-1.0, 1.0, value)); break;
+        case Target::mid:    player->setMid(jlimit(-1.0, 1.0, value)); break;
+        case Target::treble: player->setTrebleGain(jlimit(-1.0, 1.0, value)); break;
+        case Target::reverb: player->setWetDry(jlimit(0.0, 1.0, value)); break;
+
+        case Target::keyLock:
+            if (player->isKeyLocked() != (value >= 0.5))
+                player->setKeyLock(value >= 0.5);
+            break;
+
+        case Target::speed:
+            //Steps below 0.1% can't be heard, skipping them keeps a long ramp from flooding the log
+            if (isFinal || std::abs(value - state.appliedSpeed) >= 0.001 * state.appliedSpeed)
+            {
+                state.appliedSpeed = jlimit(0.5, 2.0, value);
+                player->setSpeed(state.appliedSpeed);
+            }
+            break;
+
+        case Target::crossfader:
+        case Target::play:
+        case Target::stop:
+        default:
+            break;
+    }
+}
+
+//Function to get where a deck setting or the crossfader currently is
+double& OfflineMixRenderer::getValue(int deck, Target target)
+{
+    static double unused = 0.0;
+
+    if (target == Target::crossfader)
+        return crossfader;
+
+    auto& state = deckStates[(size_t) jlimit(0, players.size() - 1, deck)];
+
+    switch (target)
+    {
+        case Target::volume:  return state.volume;
+        case Target::trim:    return state.trim;
+        case Target::speed:   return state.speed;
+        case Target::bass:    return state.bass;
+        case Target::mid:     return state.mid;
+        case Target::treble:  return state.treble;
+        case Target::reverb:  return state.reverb;
+        case Target::keyLock: return state.keyLock;
+        case Target::crossfader:
+        case Target::play:
+        case Target::stop:
+        default:              return unused;
+    }
+}
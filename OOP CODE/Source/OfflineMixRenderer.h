@@ -0,0 +1,146 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DJAudioplayer.h"
+#include "DeckMixer.h"
+#include "MasterLimiter.h"
+
+//Renders a scripted mix to a WAV file without an audio device, as fast as the CPU allows, through the same
+//DJAudioplayer and mixer graph the app plays live. Started with: OtoDecks --render mix.json [--output mix.wav]
+//
+//The script is JSON, times are in seconds and relative paths are taken from the script's folder:
+//  {
+//    "output": "mix.wav", "sampleRate": 44100, "blockSize": 512, "bitDepth": 24, "length": 120, "crossfaderCurve": "scratch",
+//    "decks": [ { "track": "a.mp3", "start": 0, "offset": 30, "speed": 1.0, "volume": 1.0 },
+//               { "track": "b.wav", "start": 56, "bass": -0.5, "assign": "B" } ],
+//    "automation": [ { "time": 56, "target": "crossfader", "value": 1.0, "ramp": 8 },
+//                    { "time": 64, "deck": 1, "target": "bass", "value": 0.0, "ramp": 2 },
+//                    { "time": 90, "deck": 0, "target": "stop" } ]
+//  }
+//Targets are crossfader, volume, trim (dB), speed, bass, mid, treble, reverb, keyLock, play and stop. A deck's fields
+//are its settings at time 0, "start" is when it starts playing and "offset" is where in the track it starts.
+//Up to DeckMixer::maxDecks decks; "assign" puts a deck on crossfader side A, B or thru, by default the first deck
+//is on A, the second on B and the rest are thru. "crossfaderCurve" is constantPower (the default), scratch or linear.
+//The mix goes through the app's master limiter, "limiter": false leaves it off and "limiterCeiling" sets its ceiling
+//in dBTP (default -1); its latency is trimmed from the start of the file either way, so the output lines up with the script.
+//Without "length" the render runs until the last deck reaches the end of its track, plus a second for the tail
+class OfflineMixRenderer
+{
+public:
+    //What an automation event changes
+    enum class Target
+    {
+        crossfader,
+        volume,
+        trim,
+        speed,
+        bass,
+        mid,
+        treble,
+        reverb,
+        keyLock,
+        play,
+        stop
+    };
+
+    //One change to a deck or the crossfader, reached linearly over ramp seconds if ramp is above zero
+    struct AutomationEvent
+    {
+        double time = 0.0;
+        int deck = 0;
+        Target target = Target::volume;
+        double value = 0.0;
+        double ramp = 0.0;
+    };
+
+    //Everything read from a mix script
+    struct MixScript
+    {
+        double sampleRate = 44100.0;
+        int blockSize = 512;
+        int bitDepth = 24;
+        //Seconds to render, negative to stop when every deck has played out
+        double length = -1.0;
+        //Size of the RAM cache the tracks are decoded into before the render starts
+        int cacheMegabytes = 4096;
+        File output;
+        Array<URL> tracks;
+        //Crossfader side of each deck
+        Array<DeckMixer::CrossfaderAssign> assigns;
+        CrossfaderEngine::Curve crossfaderCurve = CrossfaderEngine::Curve::constantPower;
+        bool limiterEnabled = true;
+        float limiterCeiling = -1.0f;
+        //Events in time order, the decks' starting settings come first
+        std::vector<AutomationEvent> events;
+    };
+
+    //Runs a render from the command line and returns the exit code
+    static int run(const String& commandLine);
+
+    //Reads a mix script, returns an error message if it can't be used
+    static Result loadScript(const File& scriptFile, MixScript& script);
+
+    //Constructor: Builds a deck for every track in the script
+    OfflineMixRenderer(const MixScript& scriptToRender);
+    //Destructor: Stops the read-ahead thread once the decks are gone
+    ~OfflineMixRenderer();
+
+    //Loads the tracks and renders the whole mix into the output file
+    Result render();
+
+    //Figures from the last render
+    double getRenderedSeconds() const { return renderedSeconds; }
+    double getRealTimeFactor() const { return renderSeconds > 0.0 ? renderedSeconds / renderSeconds : 0.0; }
+    float getPeakLevel() const { return peakLevel; }
+
+private:
+    //An automation event being ramped towards its value
+    struct Ramp
+    {
+        int deck;
+        Target target;
+        double startValue, endValue;
+        int64 startSample, endSample;
+    };
+
+    //Works out how long to render when the script doesn't say
+    int64 getAutoLengthInSamples() const;
+    //Applies an event at the current sample, starting a ramp if it has one
+    void applyEvent(const AutomationEvent& event, int64 position);
+    //Moves every running ramp to its value at the current sample
+    void updateRamps(int64 position);
+    //Sends a value to a deck, or to every deck for the crossfader; isFinal is false for the steps of a ramp
+    void setValue(int deck, Target target, double value, bool isFinal = true);
+    //Current value of a deck setting or the crossfader
+    double& getValue(int deck, Target target);
+
+    MixScript script;
+
+    AudioFormatManager formatManager;
+    TimeSliceThread readAheadThread{"Render read-ahead"};
+    TrackCache trackCache;
+    TrackLoader trackLoader{formatManager, readAheadThread};
+    OwnedArray<DJAudioplayer> players;
+    //Renders the decks on every spare core, so a render with many decks finishes sooner
+    DeckRenderPool renderPool;
+    DeckMixer mixer;
+    MasterLimiter limiter{&mixer, false};
+
+    //Settings each deck was last given, so ramps know where to start from
+    struct DeckState
+    {
+        double volume = 1.0, trim = 0.0, speed = 1.0, bass = 0.0, mid = 0.0, treble = 0.0, reverb = 0.0, keyLock = 0.0;
+        //Speed last sent to the deck, ramps only send a new one when it has moved by 0.1%
+        double appliedSpeed = 1.0;
+    };
+    std::vector<DeckState> deckStates;
+    //Crossfader position, centred like the app's slider
+    double crossfader = 0.5;
+    std::vector<Ramp> ramps;
+
+    double renderedSeconds = 0.0;
+    double renderSeconds = 0.0;
+    float peakLevel = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineMixRenderer)
+};
@@ -0,0 +1,162 @@
+#include "PhaseVocoderStretcher.h"
+
+//Constructor: Stores the FFT size, buffers are made in prepare
+PhaseVocoderStretcher::PhaseVocoderStretcher(int baseFftOrder)
+    : baseOrder(baseFftOrder)
+{
+}
+
+//Function to make the FFT and every buffer for the sample rate
+void PhaseVocoderStretcher::prepare(double sampleRate, int numChannels)
+{
+    //Keep the frame about the same length in milliseconds at high sample rates
+    int order = baseOrder + (sampleRate > 70000.0 ? 1 : 0);
+
+    if (fft == nullptr || fftSize != (1 << order))
+    {
+        fft.reset(new dsp::FFT(order));
+        fftSize = 1 << order;
+    }
+
+    numBins = fftSize / 2 + 1;
+
+    window.resize((size_t) fftSize);
+    for (int i = 0; i < fftSize; ++i)
+        window[(size_t) i] = 0.5f - 0.5f * std::cos(MathConstants<float>::twoPi * (float) i / (float) fftSize);
+
+    //A squared Hann window overlapped four times sums to 1.5
+    outputScale = 1.0f / 1.5f;
+
+    fftData.assign((size_t) fftSize * 2, 0.0f);
+    magnitudes.assign((size_t) numBins, 0.0f);
+    phases.assign((size_t) numBins, 0.0f);
+    peaks.assign((size_t) numBins, 0);
+
+    previousPhases.setSize(numChannels, numBins);
+    synthesisPhases.setSize(numChannels, numBins);
+
+    reset();
+}
+
+//Function to forget the previous frame, the next one starts from its own phases
+void PhaseVocoderStretcher::reset() noexcept
+{
+    previousPhases.clear();
+    synthesisPhases.clear();
+    hasPreviousFrame = false;
+}
+
+//Function to analyse, re-phase and resynthesise one frame for every channel
+void PhaseVocoderStretcher::processFrame(const float* const* input, float* const* output, int numChannels, int analysisHop) noexcept
+{
+    numChannels = jmin(numChannels, previousPhases.getNumChannels());
+    float* data = fftData.data();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        //Window the frame and take it to the frequency domain
+        for (int i = 0; i < fftSize; ++i)
+            data[i] = input[channel][i] * window[(size_t) i];
+
+        std::fill(data + fftSize, data + fftSize * 2, 0.0f);
+        fft->performRealOnlyForwardTransform(data, true);
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            float re = data[bin * 2];
+            float im = data[bin * 2 + 1];
+            magnitudes[(size_t) bin] = std::sqrt(re * re + im * im);
+            phases[(size_t) bin] = std::atan2(im, re);
+        }
+
+        advancePhases(channel, analysisHop);
+
+        //Rebuild the spectrum with the new phases and go back to the time domain
+        const float* synthesis = synthesisPhases.getReadPointer(channel);
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            data[bin * 2] = magnitudes[(size_t) bin] * std::cos(synthesis[bin]);
+            data[bin * 2 + 1] = magnitudes[(size_t) bin] * std::sin(synthesis[bin]);
+        }
+
+        fft->performRealOnlyInverseTransform(data);
+
+        float* dest = output[channel];
+        for (int i = 0; i < fftSize; ++i)
+            dest[i] += data[i] * window[(size_t) i] * outputScale;
+    }
+
+    hasPreviousFrame = true;
+}
+
+//Function to advance the phases of the spectral peaks and lock the bins around each peak to it
+void PhaseVocoderStretcher::advancePhases(int channel, int analysisHop) noexcept
+{
+    float* previous = previousPhases.getWritePointer(channel);
+    float* synthesis = synthesisPhases.getWritePointer(channel);
+    float synthesisHop = (float) getSynthesisHop();
+
+    if (! hasPreviousFrame || analysisHop <= 0)
+    {
+        //Nothing to measure frequencies against, start from the analysis phases
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            synthesis[bin] = phases[(size_t) bin];
+            previous[bin] = phases[(size_t) bin];
+        }
+
+        return;
+    }
+
+    //Find the local maxima of the magnitude spectrum
+    int numPeaks = 0;
+    for (int bin = 2; bin < numBins - 2; ++bin)
+    {
+        float m = magnitudes[(size_t) bin];
+        if (m > magnitudes[(size_t) bin - 1] && m >= magnitudes[(size_t) bin + 1]
+            && m > magnitudes[(size_t) bin - 2] && m >= magnitudes[(size_t) bin + 2])
+            peaks[(size_t) numPeaks++] = bin;
+    }
+
+    //Advances one bin's output phase by its measured frequency over the output hop
+    auto advanceBin = [&] (int bin)
+    {
+        float binFrequency = MathConstants<float>::twoPi * (float) bin / (float) fftSize;
+        float deviation = wrapPhase(phases[(size_t) bin] - previous[bin] - binFrequency * (float) analysisHop);
+        float trueFrequency = binFrequency + deviation / (float) analysisHop;
+        synthesis[bin] = wrapPhase(synthesis[bin] + trueFrequency * synthesisHop);
+    };
+
+    if (numPeaks == 0)
+    {
+        //Silence or noise without clear peaks, advance every bin on its own
+        for (int bin = 0; bin < numBins; ++bin)
+            advanceBin(bin);
+    }
+    else
+    {
+        for (int i = 0; i < numPeaks; ++i)
+            advanceBin(peaks[(size_t) i]);
+
+        //Every other bin keeps its phase relative to the peak whose region it is in
+        int peakIndex = 0;
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            while (peakIndex + 1 < numPeaks && bin > (peaks[(size_t) peakIndex] + peaks[(size_t) peakIndex + 1]) / 2)
+                ++peakIndex;
+
+            int peak = peaks[(size_t) peakIndex];
+            if (bin != peak)
+                synthesis[bin] = wrapPhase(synthesis[peak] + phases[(size_t) bin] - phases[(size_t) peak]);
+        }
+    }
+
+    for (int bin = 0; bin < numBins; ++bin)
+        previous[bin] = phases[(size_t) bin];
+}
+
+//Function to wrap a phase into -pi to pi
+float PhaseVocoderStretcher::wrapPhase(float phase) noexcept
+{
+    return phase - MathConstants<float>::twoPi * std::round(phase / MathConstants<float>::twoPi);
+}
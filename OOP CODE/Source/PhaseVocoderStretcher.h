@@ -0,0 +1,50 @@
+#pragma once
+
+#include "TimeStretcher.h"
+
+//Phase vocoder with identity phase locking: every frame is taken to the frequency domain, the phase of each
+//spectral peak is advanced for the output hop, and the bins around a peak keep their phase relative to it.
+//Smoothest on sustained tonal material, softens transients slightly
+class PhaseVocoderStretcher : public TimeStretcher
+{
+public:
+    //Constructor: FFT size as a power of two at 44.1/48 kHz, doubled for higher sample rates
+    PhaseVocoderStretcher(int baseFftOrder = 11);
+
+    //TimeStretcher overrides
+    void prepare(double sampleRate, int numChannels) override;
+    void reset() noexcept override;
+    int getFrameSize() const noexcept override { return fftSize; }
+    int getSynthesisHop() const noexcept override { return fftSize / 4; }
+    int getSearchRange() const noexcept override { return 0; }
+    void processFrame(const float* const* input, float* const* output, int numChannels, int analysisHop) noexcept override;
+
+private:
+    //Works out the output phases of one channel from its analysis phases
+    void advancePhases(int channel, int analysisHop) noexcept;
+    //Wraps a phase into -pi to pi
+    static float wrapPhase(float phase) noexcept;
+
+    int baseOrder;
+    int fftSize = 0;
+    int numBins = 0;
+    std::unique_ptr<dsp::FFT> fft;
+
+    //Periodic Hann window used for analysis and synthesis
+    std::vector<float> window;
+    //Undoes the gain of windowing twice at 75% overlap
+    float outputScale = 1.0f;
+
+    //Scratch space for the transform and the current frame's spectrum
+    std::vector<float> fftData;
+    std::vector<float> magnitudes;
+    std::vector<float> phases;
+    std::vector<int> peaks;
+
+    //Per-channel analysis phases of the previous frame and phases of the output
+    AudioBuffer<float> previousPhases;
+    AudioBuffer<float> synthesisPhases;
+    bool hasPreviousFrame = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PhaseVocoderStretcher)
+};
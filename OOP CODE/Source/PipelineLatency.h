@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Latency of the path from a deck's transport to the speaker, stage by stage. Every processing stage declares how
+//far what it outputs lags behind what it has read with getLatencyInSamples; a report lists them in signal order,
+//each converted to samples at the device rate, so the total is how long a sample read from the track now takes to
+//be heard. Stages that add nothing (the EQ's biquads, the FX rack, the convolution reverb, the mixer) are listed too,
+//so the report covers the whole path and a stage that starts adding latency shows up in it
+class PipelineLatency
+{
+public:
+    //Most stages a report holds, later ones are dropped
+    static constexpr int maxStages = 12;
+
+    //One stage: its name and its latency in samples at the device rate
+    struct Stage
+    {
+        const char* name = "";
+        double samples = 0.0;
+    };
+
+    //Constructor: An empty report for a device running at sampleRate
+    explicit PipelineLatency(double sampleRate = 44100.0) : deviceSampleRate(sampleRate) {}
+
+    //Adds the next stage along the path
+    void add(const char* name, double samples)
+    {
+        if (numStages < maxStages)
+            stages[(size_t) numStages++] = { name, jmax(0.0, samples) };
+    }
+
+    //Adds every stage of another report, for the part of the path it covers
+    void append(const PipelineLatency& other)
+    {
+        for (int index = 0; index < other.getNumStages(); ++index)
+            add(other.getStage(index).name, other.getStage(index).samples);
+    }
+
+    int getNumStages() const { return numStages; }
+    const Stage& getStage(int index) const { return stages[(size_t) index]; }
+    double getSampleRate() const { return deviceSampleRate; }
+
+    //Sum of every stage
+    double getTotalSamples() const
+    {
+        double total = 0.0;
+        for (int index = 0; index < numStages; ++index)
+            total += stages[(size_t) index].samples;
+
+        return total;
+    }
+
+    double getTotalMs() const { return toMs(getTotalSamples()); }
+
+    //One line for the overlay and the console: the total, then every stage that adds something
+    String toString() const
+    {
+        String text = String(getTotalMs(), 1) + " ms";
+        String separator = " = ";
+
+        for (int index = 0; index < numStages; ++index)
+        {
+            if (stages[(size_t) index].samples < 0.5)
+                continue;
+
+            text << separator << stages[(size_t) index].name << " " << String(toMs(stages[(size_t) index].samples), 1);
+            separator = " + ";
+        }
+
+        return text;
+    }
+
+private:
+    double toMs(double samples) const { return deviceSampleRate > 0.0 ? samples * 1000.0 / deviceSampleRate : 0.0; }
+
+    std::array<Stage, maxStages> stages;
+    int numStages = 0;
+    double deviceSampleRate;
+};
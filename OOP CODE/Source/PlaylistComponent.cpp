@@ -1,16 +1,16 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PlaylistComponent.h"
 
-//Constructor: Initializes the playlist component with references to two deck GUIs and a DJ audio player
+//Constructor: Initializes the playlist component with references to two deck GUIs and the preview player
 PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1,
                                      DeckGUI* _deckGUI2,
-                                     DJAudioplayer* _playerForParsingMetaData)
+                                     PreviewPlayer* _previewPlayer)
       //Store reference to Deck 1
     : deckGUI1(_deckGUI1),
       //Store reference to Deck 2
       deckGUI2(_deckGUI2),
-      //Store reference to the player for metadata parsing
-      playerForParsingMetaData(_playerForParsingMetaData)
+      //Store reference to the preview player
+      previewPlayer(_previewPlayer)
 {
     //Set the height of each row in the table
     libraryTable.setRowHeight(30);
@@ -19,10 +19,23 @@ PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1,
     //Add columns to the library table
     libraryTable.getHeader().addColumn("Track title", 1, 400); //Column 1: Track title
     libraryTable.getHeader().addColumn("Length", 2, 200); //Column 2: Track length
+    libraryTable.getHeader().addColumn("BPM", 4, 100); //Column 4: Tempo
     libraryTable.getHeader().addColumn("", 3, 100);  //Column 3: Empty
     libraryTable.setModel(this);
     loadLibrary();
 
+    //Analyse any tracks the saved library has no tempo for yet
+    for (size_t index = 0; index < tracks.size(); ++index)
+        if (! tracks[index].beatGrid.isAnalysed())
+            analyseTrack(tracks[index].file);
+
+    //Cues set or cleared on a deck's pads are stored with the track and saved with the library
+    for (auto* deckGUI : { deckGUI1, deckGUI2 })
+        deckGUI->onHotCuesChanged = [this] (const juce::URL& trackURL, const HotCues& cues)
+        {
+            tracks.setHotCues(trackURL.getLocalFile().getFullPathName(), cues);
+        };
+
     //Make the search field visible
     addAndMakeVisible(searchField);
     //Set placeholder text for the search field
@@ -45,6 +58,7 @@ PlaylistComponent::PlaylistComponent(DeckGUI* _deckGUI1,
 //Destructor: Cleans up resources
 PlaylistComponent::~PlaylistComponent()
 {
+    stopTimer();
     //Remove custom look-and-feel settings before destruction to avoid dangling pointers
     for (auto* btn : { &importButton, &addToPlayer1Button, &addToPlayer2Button, &playSnippetButton })
         btn->setLookAndFeel(nullptr);
@@ -132,6 +146,13 @@ void PlaylistComponent::paintCell(juce::Graphics& g,
             g.drawText(tracks[rowNumber].length, 2, 0, width - 4, height,
                        juce::Justification::centred, true);
         }
+        else if (columnId == 4) //Column 4: Tempo, "..." while it is being analysed and "-" if none was found
+        {
+            const auto& beatGrid = tracks[rowNumber].beatGrid;
+            juce::String tempo = beatGrid.hasTempo() ? juce::String(beatGrid.bpm, 1)
+                                                     : beatGrid.isAnalysed() ? "-" : "...";
+            g.drawText(tempo, 2, 0, width - 4, height, juce::Justification::centred, true);
+        }
     }
 }
 
@@ -188,15 +209,17 @@ void PlaylistComponent::buttonClicked(juce::Button* button)
     {
         //Get selected row index
         int selectedRow = libraryTable.getSelectedRow();
-        //If track is selected, play a %-second snippet
-        if (selectedRow != -1)
+        //Clicking again on the track being previewed stops it
+        if (selectedRow != -1 && selectedRow == previewRow && previewPlayer->isPlaying())
         {
-            juce::URL audioURL = tracks[selectedRow].trackURL;
-            playerForParsingMetaData->loadURL(audioURL);
-            playerForParsingMetaData->start();
-
-            //Stop playback after 5 secons
-            juce::Timer::callAfterDelay(5000, [this] { playerForParsingMetaData->stop(); });
+            previewPlayer->stop();
+            previewRow = -1;
+        }
+        //If track is selected, play a snippet from its middle; it stops by itself at the end
+        else if (selectedRow != -1)
+        {
+            previewPlayer->play(tracks[selectedRow].trackURL);
+            previewRow = selectedRow;
             DBG("Playing snippet of: " << tracks[selectedRow].title);
         }
         else
@@ -216,6 +239,7 @@ void PlaylistComponent::buttonClicked(juce::Button* button)
         DBG(tracks[id].title + " removed from Library");
         //Remove track from library
         deleteFromTracks(id);
+        previewRow = -1;
         //Refresh table view
         libraryTable.updateContent();
     }
@@ -231,8 +255,8 @@ void PlaylistComponent::loadInPlayer(DeckGUI* deckGUI)
     if (selectedRow != -1)
     {
         DBG("Adding: " << tracks[selectedRow].title << " to Player");
-        //Load the track into the deck
-        deckGUI->loadFile(tracks[selectedRow].trackURL);
+        //Load the track into the deck, with its tempo and downbeat for SYNC and its hot cues for the pads
+        deckGUI->loadFile(tracks[selectedRow].trackURL, tracks[selectedRow].beatGrid, tracks[selectedRow].hotCues);
     }
     else
     {
@@ -267,7 +291,9 @@ void PlaylistComponent::importToLibrary()
                 //Get track length
                 newTrack.length = getLength(juce::URL(file));
                 //Add to track list
-                tracks.push_back(newTrack);
+                tracks.add(newTrack);
+                //Find its tempo in the background
+                analyseTrack(file);
 
                 DBG("Loaded file: " << newTrack.title);
             }
@@ -286,26 +312,22 @@ void PlaylistComponent::importToLibrary()
 //Checks if a track is already in the playlist.
 bool PlaylistComponent::isInTracks(const juce::String& fileNameWithoutExtension)
 {
-    return std::find(tracks.begin(), tracks.end(), fileNameWithoutExtension) != tracks.end();
+    return tracks.contains(fileNameWithoutExtension);
 }
 
 
 //Deletes a track from the library based on its index.
 void PlaylistComponent::deleteFromTracks(int id)
 {
-    //Ensure index is valid
-    if (id >= 0 && id < static_cast<int>(tracks.size()))
-        //Remove track at given index
-        tracks.erase(tracks.begin() + id);
+    //Remove track at given index, invalid indexes are ignored
+    tracks.remove(id);
 }
 
 //Returns the length of an audio file as a formatted string
 juce::String PlaylistComponent::getLength(const juce::URL& audioURL)
 {
-    //Load audio file into player
-    playerForParsingMetaData->loadURL(audioURL);
-    //Get length in seconds
-    double seconds = playerForParsingMetaData->getLengthInSeconds();
+    //Read the length from the file header with the preview player's decoder
+    double seconds = previewPlayer->getLengthInSeconds(audioURL);
     //Convert the time
     return secondsToMinutes(seconds);
 }
@@ -350,48 +372,53 @@ void PlaylistComponent::searchLibrary(const juce::String& text)
 //Finds the index of a track that matches the search text
 int PlaylistComponent::findTracksIndex(const juce::String& searchText)
 {
-    auto it = std::find_if(tracks.begin(), tracks.end(),
-                           [&searchText](const TrackPad& track) { return track.title.contains(searchText); });
-    
-    return (it != tracks.end()) ? static_cast<int>(std::distance(tracks.begin(), it)) : -1;
+    return tracks.find(searchText);
 }
 
-//Saves the current playlist to a CSV file
-void PlaylistComponent::saveLibrary()
+//Queues a track on the analyser's workers, the timer picks the result up
+void PlaylistComponent::analyseTrack(const juce::File& file)
 {
-    //Open file for writing
-    std::ofstream myLibrary("MusicLibrary.csv");
+    trackAnalyzer.analyse(file);
 
-    for (const auto& t : tracks)
-        //Write each track to file
-        myLibrary << t.file.getFullPathName() << "," << t.length << "\n";
+    if (! isTimerRunning())
+        startTimer(250);
 }
 
-//Loads tracks from a previously saved CSV file into the library
-void PlaylistComponent::loadLibrary()
+//Stores finished tempos against their tracks and redraws the BPM column, stopping once nothing is left to analyse
+void PlaylistComponent::timerCallback()
 {
-    //Open file for reading
-    std::ifstream myLibrary("MusicLibrary.csv");
-    std::string filePath, length;
+    //Jobs leave their result before they stop counting as pending, so none can be missed after this
+    bool allFinished = trackAnalyzer.getNumPending() == 0;
+    auto results = trackAnalyzer.takeResults();
 
-    //Ensure the file is open
-    if (myLibrary.is_open())
+    if (! results.empty())
     {
-        // Read file path
-        while (std::getline(myLibrary, filePath, ','))
-        {
-            juce::File file(filePath);
-            TrackPad newTrack(file);
-
-            //Read track length
-            std::getline(myLibrary, length);
-            newTrack.length = length;
-            //Add track to library
-            tracks.push_back(newTrack);
-        }
+        std::unordered_map<juce::String, BeatGrid> gridsByPath;
+        for (const auto& result : results)
+            gridsByPath[result.file.getFullPathName()] = result.beatGrid;
+
+        //Tracks deleted while they were analysed are no longer there to update
+        tracks.setBeatGrids(gridsByPath);
+        libraryTable.repaint();
+    }
+
+    if (allFinished)
+    {
+        stopTimer();
+        DBG("Tempo analysis finished");
     }
-    //Close the file after reading
-    myLibrary.close();
+}
+
+//Saves the current playlist to a CSV file
+void PlaylistComponent::saveLibrary()
+{
+    tracks.save(juce::File::getCurrentWorkingDirectory().getChildFile("MusicLibrary.csv"));
+}
+
+//Loads tracks from a previously saved CSV file into the library
+void PlaylistComponent::loadLibrary()
+{
+    tracks.load(juce::File::getCurrentWorkingDirectory().getChildFile("MusicLibrary.csv"));
 }
 
 
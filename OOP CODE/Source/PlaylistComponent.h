@@ -4,9 +4,10 @@
 #include <vector>
 #include <algorithm>
 #include <fstream>
-#include "TrackList.h"
+#include "TrackLibrary.h"
+#include "TrackAnalyzer.h"
 #include "DeckGUI.h"
-#include "DJAudioplayer.h"
+#include "PreviewPlayer.h"
 
 //Class to define a custom looks for the button
 class PlaylistButtonLookAndFeel : public juce::LookAndFeel_V4
@@ -63,13 +64,15 @@ class PlaylistComponent : public juce::Component,
                           //Handles button click events
                           public juce::Button::Listener,
                           //Handles text input events
-                          public juce::TextEditor::Listener
+                          public juce::TextEditor::Listener,
+                          //Collects tempo analysis results
+                          private juce::Timer
 {
 public:
-    //Constructor: Initializes the playlist component with references to two deck GUIs and a DJ audio player
+    //Constructor: Initializes the playlist component with references to two deck GUIs and the preview player
     PlaylistComponent(DeckGUI* _deckGUI1,
                       DeckGUI* _deckGUI2,
-                      DJAudioplayer* _playerForParsingMetaData);
+                      PreviewPlayer* _previewPlayer);
     
     //Destructor: Cleans up resources
     ~PlaylistComponent() override;
@@ -125,9 +128,16 @@ private:
     
     //Searches the library for tracks matching the given text
     void searchLibrary(const juce::String& searchText);
+
+    //Queues a track for tempo analysis and starts watching for the result
+    void analyseTrack(const juce::File& file);
+    //Puts finished tempo analysis results into the library and the BPM column
+    void timerCallback() override;
     
     //Stores the list of tracks
-    std::vector<TrackPad> tracks;
+    TrackLibrary tracks;
+    //Finds the tempo of imported tracks in the background
+    TrackAnalyzer trackAnalyzer;
     
     //Custom styling for buttons
     PlaylistButtonLookAndFeel playlistButtonLookAndFeel;
@@ -146,7 +156,10 @@ private:
     //References to the two deck players for loading tracks
     DeckGUI* deckGUI1;
     DeckGUI* deckGUI2;
-    DJAudioplayer* playerForParsingMetaData;
+    //Plays snippets and reads track lengths without touching the decks
+    PreviewPlayer* previewPlayer;
+    //Row of the last snippet started, so a second click on it stops it
+    int previewRow = -1;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PlaylistComponent)
 };
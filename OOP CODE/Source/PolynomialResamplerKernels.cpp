@@ -0,0 +1,36 @@
+#include "PolynomialResamplerKernels.h"
+
+//Function to interpolate along the line between each position's neighbours
+void LinearResamplerKernel::process(const float* input, const double* positions, float* output,
+                                    int numSamples, double) const noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto index = (int) positions[i];
+        auto frac = (float) (positions[i] - index);
+        const float* x = input + index;
+
+        output[i] = x[0] + frac * (x[1] - x[0]);
+    }
+}
+
+//Function to evaluate the cubic through the four samples around each position
+void LagrangeResamplerKernel::process(const float* input, const double* positions, float* output,
+                                      int numSamples, double) const noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto index = (int) positions[i];
+        auto t = (float) (positions[i] - index);
+        const float* x = input + index;
+
+        //Lagrange basis for the points at -1, 0, 1 and 2
+        float tm1 = t - 1.0f, tm2 = t - 2.0f, tp1 = t + 1.0f;
+        float cm1 = -t * tm1 * tm2 * (1.0f / 6.0f);
+        float c0  = tp1 * tm1 * tm2 * 0.5f;
+        float c1  = -tp1 * t * tm2 * 0.5f;
+        float c2  = tp1 * t * tm1 * (1.0f / 6.0f);
+
+        output[i] = cm1 * x[-1] + c0 * x[0] + c1 * x[1] + c2 * x[2];
+    }
+}
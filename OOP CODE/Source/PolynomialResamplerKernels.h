@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ResamplerKernel.h"
+
+//Straight line between the two nearest samples. The cheapest tier, meant for low-power machines:
+//it has no anti-aliasing filter, so speeding up folds high frequencies back down and slowing down leaves images
+class LinearResamplerKernel : public ResamplerKernel
+{
+public:
+    //ResamplerKernel overrides
+    void prepare(double) override {}
+    int getNumSamplesBefore() const noexcept override { return 0; }
+    int getNumSamplesAfter() const noexcept override { return 1; }
+    void process(const float* input, const double* positions, float* output,
+                 int numSamples, double ratio) const noexcept override;
+};
+
+//Third-order Lagrange polynomial through the four nearest samples. Much less image noise than linear
+//for a few more multiplies, but like linear it does not filter when the deck is sped up
+class LagrangeResamplerKernel : public ResamplerKernel
+{
+public:
+    //ResamplerKernel overrides
+    void prepare(double) override {}
+    int getNumSamplesBefore() const noexcept override { return 1; }
+    int getNumSamplesAfter() const noexcept override { return 2; }
+    void process(const float* input, const double* positions, float* output,
+                 int numSamples, double ratio) const noexcept override;
+};
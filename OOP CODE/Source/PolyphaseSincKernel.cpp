@@ -0,0 +1,170 @@
+#include "PolyphaseSincKernel.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define OTODECKS_SINC_SSE 1
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+ #include <arm_neon.h>
+ #define OTODECKS_SINC_NEON 1
+#endif
+
+namespace
+{
+    //Passband edge as a fraction of the Nyquist frequency at ratio 1
+    constexpr double cutoff = 0.9;
+    //Kaiser window shape, about 70 dB of stopband rejection
+    constexpr double kaiserBeta = 7.0;
+
+    //Zeroth-order modified Bessel function, for the Kaiser window
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+            if (term < sum * 1.0e-12)
+                break;
+        }
+        return sum;
+    }
+}
+
+//Constructor: Stores the filter size, tables are built in prepare
+PolyphaseSincKernel::PolyphaseSincKernel(int baseNumTaps, int numPhases)
+    : baseTaps(jmax(8, (baseNumTaps + 3) & ~3)),
+      phases(jmax(16, numPhases))
+{
+}
+
+//Function to build a table for every band up to the largest ratio the deck can ask for
+void PolyphaseSincKernel::prepare(double maxRatio)
+{
+    bands.clear();
+    maxNumTaps = 0;
+
+    for (double bandRatio = 1.0; ; bandRatio *= std::pow(2.0, 0.25))
+    {
+        Band band;
+        band.maxRatio = jmin(bandRatio, jmax(1.0, maxRatio));
+        //Lengthen the filter with the ratio so the transition band stays as sharp at the lower cutoff
+        band.numTaps = ((int) std::ceil(baseTaps * band.maxRatio) + 3) & ~3;
+        buildBand(band);
+
+        maxNumTaps = jmax(maxNumTaps, band.numTaps);
+        bands.push_back(std::move(band));
+
+        if (bandRatio >= maxRatio - 1.0e-9)
+            break;
+    }
+}
+
+//Function to fill one band's table, each phase normalised to unity gain at DC
+void PolyphaseSincKernel::buildBand(Band& band) const
+{
+    int numTaps = band.numTaps;
+    int firstTap = -(numTaps / 2 - 1);
+    double bandCutoff = cutoff / band.maxRatio;
+    double halfLength = numTaps / 2.0;
+    double windowScale = 1.0 / besselI0(kaiserBeta);
+
+    band.coefficients.assign((size_t) ((phases + 1) * numTaps), 0.0f);
+
+    for (int phase = 0; phase <= phases; ++phase)
+    {
+        double frac = (double) phase / phases;
+        float* row = band.coefficients.data() + phase * numTaps;
+        double sum = 0.0;
+
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            double distance = (firstTap + tap) - frac;
+            double x = bandCutoff * distance;
+            double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(MathConstants<double>::pi * x) / (MathConstants<double>::pi * x);
+            double w = distance / halfLength;
+            double window = std::abs(w) >= 1.0 ? 0.0 : besselI0(kaiserBeta * std::sqrt(1.0 - w * w)) * windowScale;
+
+            row[tap] = (float) (sinc * window);
+            sum += sinc * window;
+        }
+
+        for (int tap = 0; tap < numTaps; ++tap)
+            row[tap] = (float) (row[tap] / sum);
+    }
+}
+
+//Function to pick the table for a ratio
+const PolyphaseSincKernel::Band& PolyphaseSincKernel::getBand(double ratio) const noexcept
+{
+    for (auto& band : bands)
+        if (ratio <= band.maxRatio + 1.0e-9)
+            return band;
+
+    return bands.back();
+}
+
+//Function to report which kernel this build uses
+bool PolyphaseSincKernel::isVectorised()
+{
+   #if OTODECKS_SINC_SSE || OTODECKS_SINC_NEON
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+//Function to filter the input at each position, blending the two stored phases either side of it
+void PolyphaseSincKernel::process(const float* input, const double* positions, float* output,
+                                  int numSamples, double ratio) const noexcept
+{
+    jassert(! bands.empty());
+
+    const Band& band = getBand(ratio);
+    const int numTaps = band.numTaps;
+    const int firstTap = -(numTaps / 2 - 1);
+    const float* table = band.coefficients.data();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        auto index = (int) positions[i];
+        auto phasePosition = (float) ((positions[i] - index) * phases);
+        auto phase = jmin(phases - 1, (int) phasePosition);
+        float blend = phasePosition - (float) phase;
+
+        const float* x = input + index + firstTap;
+        const float* c0 = table + phase * numTaps;
+        const float* c1 = c0 + numTaps;
+
+       #if OTODECKS_SINC_SSE
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (int tap = 0; tap < numTaps; tap += 4)
+        {
+            __m128 xv = _mm_loadu_ps(x + tap);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(xv, _mm_loadu_ps(c0 + tap)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(xv, _mm_loadu_ps(c1 + tap)));
+        }
+        //Blend the phases before the horizontal sum
+        __m128 acc = _mm_add_ps(acc0, _mm_mul_ps(_mm_set1_ps(blend), _mm_sub_ps(acc1, acc0)));
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        output[i] = _mm_cvtss_f32(acc);
+       #elif OTODECKS_SINC_NEON
+        float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+        for (int tap = 0; tap < numTaps; tap += 4)
+        {
+            float32x4_t xv = vld1q_f32(x + tap);
+            acc0 = vmlaq_f32(acc0, xv, vld1q_f32(c0 + tap));
+            acc1 = vmlaq_f32(acc1, xv, vld1q_f32(c1 + tap));
+        }
+        output[i] = vaddvq_f32(vmlaq_n_f32(acc0, vsubq_f32(acc1, acc0), blend));
+       #else
+        float sum0 = 0.0f, sum1 = 0.0f;
+        for (int tap = 0; tap < numTaps; ++tap)
+        {
+            sum0 += x[tap] * c0[tap];
+            sum1 += x[tap] * c1[tap];
+        }
+        output[i] = sum0 + blend * (sum1 - sum0);
+       #endif
+    }
+}
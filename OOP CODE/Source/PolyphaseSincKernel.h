@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ResamplerKernel.h"
+
+//Kaiser-windowed sinc interpolator with the filter precomputed at a fixed number of fractional phases.
+//Each output sample is two SIMD dot products against the neighbouring phases, blended by the remaining
+//fraction (SSE on x86, NEON on 64-bit ARM, plain loop otherwise). When the deck is sped up the cutoff is
+//lowered with the ratio and the filter lengthened to match, so nothing above the output Nyquist folds back
+class PolyphaseSincKernel : public ResamplerKernel
+{
+public:
+    //Constructor: Filter length at ratios up to 1 and how many fractional phases are stored
+    PolyphaseSincKernel(int baseNumTaps = 48, int numPhases = 128);
+
+    //ResamplerKernel overrides
+    void prepare(double maxRatio) override;
+    int getNumSamplesBefore() const noexcept override { return maxNumTaps / 2 - 1; }
+    int getNumSamplesAfter() const noexcept override { return maxNumTaps / 2; }
+    void process(const float* input, const double* positions, float* output,
+                 int numSamples, double ratio) const noexcept override;
+
+    //Returns true if this build uses the SIMD dot product
+    static bool isVectorised();
+
+private:
+    //Filter table for ratios up to maxRatio, laid out as [phase][tap] with one extra phase at the end
+    struct Band
+    {
+        double maxRatio = 1.0;
+        int numTaps = 0;
+        std::vector<float> coefficients;
+    };
+
+    //Fills a band's table with the windowed sinc for its cutoff
+    void buildBand(Band& band) const;
+    //Picks the narrowest band that still filters enough for the ratio
+    const Band& getBand(double ratio) const noexcept;
+
+    int baseTaps;
+    int phases;
+    int maxNumTaps = 0;
+    //Bands a quarter of an octave apart from ratio 1 up to the largest ratio prepared for
+    std::vector<Band> bands;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseSincKernel)
+};
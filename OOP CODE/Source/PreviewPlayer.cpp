@@ -0,0 +1,290 @@
+#include "PreviewPlayer.h"
+#include "AllocationTripwire.h"
+
+//Constructor: Registers the formats and starts the decoder thread and the collector
+PreviewPlayer::PreviewPlayer() : Thread("Preview decoder")
+{
+    formatManager.registerBasicFormats();
+    startThread(Priority::normal);
+    startTimer(100);
+}
+
+//Destructor: Stops the threads and deletes every snippet
+PreviewPlayer::~PreviewPlayer()
+{
+    stopTimer();
+    signalThreadShouldExit();
+    notify();
+    stopThread(4000);
+
+    delete queuedSnippet.exchange(nullptr);
+    delete retiredSnippet.exchange(nullptr);
+    delete liveSnippet;
+}
+
+//Function to ask the decoder thread for a snippet of a track
+void PreviewPlayer::play(const URL& audioURL)
+{
+    {
+        const ScopedLock sl(requestLock);
+        requestedURL = audioURL;
+        ++requestId;
+        requestPending = true;
+    }
+
+    notify();
+}
+
+//Function to stop the preview, including one that hasn't started yet
+void PreviewPlayer::stop()
+{
+    {
+        const ScopedLock sl(requestLock);
+        ++requestId;
+        requestPending = false;
+    }
+
+    //A snippet the audio thread hasn't taken is still ours to delete
+    delete queuedSnippet.exchange(nullptr);
+    stopRequested = true;
+}
+
+//Function to set the snippet length
+void PreviewPlayer::setSnippetSeconds(double seconds)
+{
+    snippetSeconds = jlimit(1.0, 60.0, seconds);
+}
+
+//Function to set the preview level
+void PreviewPlayer::setGain(float newGain)
+{
+    gain = jlimit(0.0f, 1.0f, newGain);
+}
+
+//Function to read a track's length without decoding it
+double PreviewPlayer::getLengthInSeconds(const URL& audioURL)
+{
+    std::unique_ptr<AudioFormatReader> reader(audioURL.isLocalFile()
+                                                  ? formatManager.createReaderFor(audioURL.getLocalFile())
+                                                  : formatManager.createReaderFor(audioURL.createInputStream(false)));
+
+    if (reader == nullptr || reader->sampleRate <= 0.0)
+        return 0.0;
+
+    return (double) reader->lengthInSamples / reader->sampleRate;
+}
+
+//Function to note the device rate new snippets are resampled to
+void PreviewPlayer::prepareToPlay(int /*samplesPerBlockExpected*/, double sampleRate)
+{
+    deviceRate = sampleRate;
+    fadeSamples = jmax(1, roundToInt(fadeMs * sampleRate / 1000.0));
+}
+
+//Function to stop whatever is playing when the device stops
+void PreviewPlayer::releaseResources()
+{
+    stopFadeRemaining = liveSnippet != nullptr ? 0 : -1;
+}
+
+void PreviewPlayer::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    render(bufferToFill, false);
+}
+
+void PreviewPlayer::addNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    render(bufferToFill, true);
+}
+
+//Function to play the next part of the live snippet
+void PreviewPlayer::render(const AudioSourceChannelInfo& bufferToFill, bool addToBuffer)
+{
+    //Nothing in here may allocate, Debug builds assert if it does
+    AllocationTripwire::ScopedRealtimeSection realtimeSection;
+
+    if (! addToBuffer)
+        bufferToFill.clearActiveBufferRegion();
+
+    auto isFinished = [this]
+    {
+        return playPosition >= liveSnippet->audio.getNumSamples() || stopFadeRemaining == 0;
+    };
+
+    //Fade out on a stop, or to make way for a newer snippet
+    bool newSnippetWaiting = queuedSnippet.load() != nullptr;
+    if ((stopRequested.exchange(false) || newSnippetWaiting) && liveSnippet != nullptr && stopFadeRemaining < 0)
+        stopFadeRemaining = fadeSamples;
+
+    //A finished snippet goes to the collector once it has deleted the last one
+    if (liveSnippet != nullptr && isFinished() && retiredSnippet.load() == nullptr)
+    {
+        retiredSnippet = liveSnippet;
+        liveSnippet = nullptr;
+    }
+
+    if (liveSnippet == nullptr && newSnippetWaiting)
+    {
+        liveSnippet = queuedSnippet.exchange(nullptr);
+        playPosition = 0;
+        stopFadeRemaining = -1;
+    }
+
+    playing = liveSnippet != nullptr && ! isFinished();
+    if (! playing.load())
+        return;
+
+    auto& audio = liveSnippet->audio;
+    int numSamples = jmin(bufferToFill.numSamples, audio.getNumSamples() - playPosition);
+    if (stopFadeRemaining > 0)
+        numSamples = jmin(numSamples, stopFadeRemaining);
+
+    float level = gain.load();
+    float startGain = level, endGain = level;
+    if (stopFadeRemaining > 0)
+    {
+        startGain = level * (float) stopFadeRemaining / (float) fadeSamples;
+        endGain = level * (float) (stopFadeRemaining - numSamples) / (float) fadeSamples;
+        stopFadeRemaining -= numSamples;
+    }
+
+    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+    {
+        const float* source = audio.getReadPointer(jmin(channel, audio.getNumChannels() - 1), playPosition);
+
+        if (addToBuffer)
+            bufferToFill.buffer->addFromWithRamp(channel, bufferToFill.startSample, source, numSamples, startGain, endGain);
+        else
+            bufferToFill.buffer->copyFromWithRamp(channel, bufferToFill.startSample, source, numSamples, startGain, endGain);
+    }
+
+    playPosition += numSamples;
+    playing = ! isFinished();
+}
+
+//Function to delete retired snippets on the message thread
+void PreviewPlayer::timerCallback()
+{
+    delete retiredSnippet.exchange(nullptr);
+}
+
+//Function to decode each request as it comes in, dropping any that a newer one replaced
+void PreviewPlayer::run()
+{
+    while (! threadShouldExit())
+    {
+        if (! requestPending.load())
+        {
+            wait(-1);
+            continue;
+        }
+
+        URL audioURL;
+        int id;
+        {
+            const ScopedLock sl(requestLock);
+            audioURL = requestedURL;
+            id = requestId.load();
+        }
+
+        auto snippet = decodeSnippet(audioURL, deviceRate.load(), snippetSeconds.load());
+        bool decoded = snippet != nullptr;
+
+        {
+            //Queued under the lock, so a stop can't slip in between the check and the handover
+            const ScopedLock sl(requestLock);
+            if (requestId.load() != id)
+                continue;
+
+            requestPending = false;
+
+            //A snippet the audio thread never took is replaced here
+            if (snippet != nullptr)
+                delete queuedSnippet.exchange(snippet.release());
+        }
+
+        if (! decoded)
+            std::cout << "Preview: could not open " << audioURL.toString(false) << std::endl;
+    }
+}
+
+//Function to decode a snippet from the representative part of a track, at the device rate and faded at both ends
+std::unique_ptr<PreviewPlayer::Snippet> PreviewPlayer::decodeSnippet(const URL& audioURL, double deviceSampleRate, double seconds)
+{
+    std::unique_ptr<AudioFormatReader> reader(audioURL.isLocalFile()
+                                                  ? formatManager.createReaderFor(audioURL.getLocalFile())
+                                                  : formatManager.createReaderFor(audioURL.createInputStream(false)));
+
+    if (reader == nullptr || reader->sampleRate <= 0.0 || reader->lengthInSamples <= 0 || deviceSampleRate <= 0.0)
+        return nullptr;
+
+    int64 snippetLength = jmin(reader->lengthInSamples, (int64) (seconds * reader->sampleRate));
+    int64 start = findRepresentativeStart(*reader, snippetLength);
+    int numChannels = jlimit(1, 2, (int) reader->numChannels);
+
+    AudioBuffer<float> decoded(numChannels, (int) snippetLength);
+    reader->read(&decoded, 0, (int) snippetLength, start, true, numChannels > 1);
+
+    auto snippet = std::make_unique<Snippet>();
+
+    //Resampled here, once, so the audio thread only has to copy
+    double ratio = reader->sampleRate / deviceSampleRate;
+    if (std::abs(ratio - 1.0) < 1.0e-9)
+    {
+        snippet->audio = std::move(decoded);
+    }
+    else
+    {
+        //The interpolator looks a few samples past the last one it produces
+        int outputLength = jmax(0, (int) ((double) (snippetLength - 4) / ratio));
+        snippet->audio.setSize(numChannels, outputLength);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            LagrangeInterpolator interpolator;
+            interpolator.process(ratio, decoded.getReadPointer(channel), snippet->audio.getWritePointer(channel), outputLength);
+        }
+    }
+
+    int length = snippet->audio.getNumSamples();
+    int fade = jmin(length / 2, roundToInt(fadeMs * deviceSampleRate / 1000.0));
+    if (fade > 0)
+    {
+        snippet->audio.applyGainRamp(0, fade, 0.0f, 1.0f);
+        snippet->audio.applyGainRamp(length - fade, fade, 1.0f, 0.0f);
+    }
+
+    return snippet;
+}
+
+//Function to pick the loudest of a few short probes across the middle of the track, skipping intros and outros
+int64 PreviewPlayer::findRepresentativeStart(AudioFormatReader& reader, int64 snippetLength)
+{
+    int64 latestStart = reader.lengthInSamples - snippetLength;
+    int probeLength = (int) jmin(snippetLength, (int64) (probeSeconds * reader.sampleRate));
+
+    if (latestStart <= 0 || probeLength <= 0)
+        return 0;
+
+    AudioBuffer<float> probe((int) jlimit(1u, 2u, reader.numChannels), probeLength);
+    int64 bestStart = latestStart / 2;
+    float bestLevel = -1.0f;
+
+    for (int i = 0; i < numProbes; ++i)
+    {
+        int64 probeStart = (int64) ((double) latestStart * (0.25 + 0.5 * i / (numProbes - 1)));
+        reader.read(&probe, 0, probeLength, probeStart, true, probe.getNumChannels() > 1);
+
+        float level = 0.0f;
+        for (int channel = 0; channel < probe.getNumChannels(); ++channel)
+            level += probe.getRMSLevel(channel, 0, probeLength);
+
+        if (level > bestLevel)
+        {
+            bestLevel = level;
+            bestStart = probeStart;
+        }
+    }
+
+    return bestStart;
+}
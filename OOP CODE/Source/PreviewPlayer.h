@@ -0,0 +1,111 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Plays short snippets of library tracks for auditioning, without touching the decks. It has its own format
+//manager and decoder thread: a request opens the file there, probes the middle of the track for its loudest
+//second, decodes a snippet from that point and resamples it to the device rate, all before the audio thread
+//sees it. The audio thread then only copies the snippet out with a gain, so previewing costs the decks nothing.
+//
+//The snippet carries its own fade in and fade out and ends at its last sample, so it stops on time without a
+//timer. A new request replaces the snippet playing, a stop fades it out over a few milliseconds.
+//
+//MainComponent sends the preview to outputs 3 and 4 when the device has them and the routing is cue, so it can be
+//heard on headphones only; otherwise it is added to the master after the limiter, at the preview gain
+class PreviewPlayer : public AudioSource,
+                      private Thread,
+                      private Timer
+{
+public:
+    //Where the preview is heard
+    enum class Routing
+    {
+        master = 0,     //Added to outputs 1 and 2 with the decks
+        cue             //Outputs 3 and 4 when the device has them, otherwise the master
+    };
+
+    //Seconds of each probe when looking for a representative part of the track
+    static constexpr double probeSeconds = 1.0;
+    //Probes spread over the middle of the track
+    static constexpr int numProbes = 12;
+    //Fade at both ends of a snippet and when it is stopped early
+    static constexpr double fadeMs = 10.0;
+
+    //Constructor: Starts the decoder thread
+    PreviewPlayer();
+    //Destructor: Stops the decoder thread, the audio device must already be stopped
+    ~PreviewPlayer() override;
+
+    //Message thread: decodes a snippet of the track and plays it as soon as it is ready
+    void play(const URL& audioURL);
+    //Message thread: fades out the snippet playing and forgets any that is still being decoded
+    void stop();
+    //Any thread: true from a play request until its snippet has finished or been stopped
+    bool isPlaying() const { return requestPending.load() || queuedSnippet.load() != nullptr || playing.load(); }
+
+    //Any thread: how long snippets are, from the next request
+    void setSnippetSeconds(double seconds);
+    double getSnippetSeconds() const { return snippetSeconds.load(); }
+    //Any thread: level of the preview
+    void setGain(float newGain);
+    //Any thread: where the preview is heard
+    void setRouting(Routing newRouting) { routing = (int) newRouting; }
+    Routing getRouting() const { return (Routing) routing.load(); }
+
+    //Message thread: length of a track in seconds, read from its header with the preview's decoder; 0 if it won't open
+    double getLengthInSeconds(const URL& audioURL);
+
+    //AudioSource overrides; getNextAudioBlock replaces the buffer's contents
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+    //Audio thread: adds the preview to what is already in the buffer
+    void addNextAudioBlock(const AudioSourceChannelInfo& bufferToFill);
+
+private:
+    //A decoded snippet at the device rate, faded at both ends
+    struct Snippet
+    {
+        AudioBuffer<float> audio;
+    };
+
+    //Decoder thread: waits for requests and turns each into a snippet
+    void run() override;
+    //Decoder thread: opens the track, finds where to start and decodes a snippet; null if the file won't open
+    std::unique_ptr<Snippet> decodeSnippet(const URL& audioURL, double deviceSampleRate, double seconds);
+    //Decoder thread: start of the loudest probe in the middle of the track
+    static int64 findRepresentativeStart(AudioFormatReader& reader, int64 snippetLength);
+    //Audio thread: copies or adds the next part of the snippet
+    void render(const AudioSourceChannelInfo& bufferToFill, bool addToBuffer);
+    //Deletes retired snippets away from the audio thread
+    void timerCallback() override;
+
+    AudioFormatManager formatManager;
+
+    //Latest request, taken by the decoder thread
+    CriticalSection requestLock;
+    URL requestedURL;
+    //Bumped by every play and stop, so a snippet finished after a newer request is thrown away
+    std::atomic<int> requestId { 0 };
+    std::atomic<bool> requestPending { false };
+
+    std::atomic<double> snippetSeconds { 5.0 };
+    std::atomic<float> gain { 0.7f };
+    std::atomic<int> routing { (int) Routing::cue };
+    std::atomic<double> deviceRate { 44100.0 };
+
+    //Handover between the decoder thread, the audio thread and the message thread timer
+    std::atomic<Snippet*> queuedSnippet { nullptr };
+    std::atomic<Snippet*> retiredSnippet { nullptr };
+    std::atomic<bool> stopRequested { false };
+    std::atomic<bool> playing { false };
+
+    //Audio thread state
+    Snippet* liveSnippet = nullptr;
+    int playPosition = 0;
+    //Samples left in a fade out after a stop, negative when not stopping
+    int stopFadeRemaining = -1;
+    int fadeSamples = 441;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PreviewPlayer)
+};
@@ -0,0 +1,185 @@
+#include <JuceHeader.h>
+#include "ProfilerOverlay.h"
+
+//Constructor: Collects from the profiler ten times a second
+ProfilerOverlay::ProfilerOverlay(CallbackProfiler& profilerToShow) : profiler(profilerToShow)
+{
+    for (auto* button : { &csvButton, &resetButton })
+    {
+        button->addListener(this);
+        addAndMakeVisible(button);
+    }
+
+    startTimerHz(10);
+}
+
+//Destructor: Stops the timer
+ProfilerOverlay::~ProfilerOverlay()
+{
+    stopTimer();
+}
+
+void ProfilerOverlay::paint (juce::Graphics& g)
+{
+    g.fillAll(Colour(20, 20, 20).withAlpha(0.92f));
+    g.setColour(Colours::grey);
+    g.drawRect(getLocalBounds());
+
+    auto& history = profiler.getHistory();
+    size_t count = jmin(history.size(), (size_t) averagingWindow);
+    auto area = getLocalBounds().reduced(8).withTrimmedTop(30);
+
+    g.setColour(Colours::lightgrey);
+    g.setFont (juce::FontOptions (12.0f));
+
+    if (count == 0)
+    {
+        g.drawText("No callbacks yet", area, Justification::centred, false);
+        return;
+    }
+
+    //Averages over the most recent callbacks
+    double meanDuration = 0.0, worstDuration = 0.0, deadline = 0.0;
+    double stageMeans[CallbackProfiler::numStages] = {};
+
+    for (size_t i = history.size() - count; i < history.size(); ++i)
+    {
+        auto& record = history[i];
+        double duration = profiler.ticksToMicroseconds(record.durationTicks);
+        meanDuration += duration;
+        worstDuration = jmax(worstDuration, duration);
+        deadline = profiler.ticksToMicroseconds(record.deadlineTicks);
+
+        for (int stage = 0; stage < CallbackProfiler::numStages; ++stage)
+            stageMeans[stage] += profiler.ticksToMicroseconds(record.stageTicks[stage]);
+    }
+
+    meanDuration /= (double) count;
+    for (auto& mean : stageMeans)
+        mean /= (double) count;
+
+    auto percentOfDeadline = [deadline] (double microseconds)
+    {
+        return deadline > 0.0 ? 100.0 * microseconds / deadline : 0.0;
+    };
+
+    auto line = [&] (const String& text)
+    {
+        g.drawText(text, area.removeFromTop(16), Justification::centredLeft, false);
+    };
+
+    line("Block " + String(history.back().numSamples) + " samples, deadline " + String(deadline, 0) + " us");
+    line("Callback mean " + String(meanDuration, 1) + " us (" + String(percentOfDeadline(meanDuration), 1)
+         + "%), worst " + String(worstDuration, 1) + " us (" + String(percentOfDeadline(worstDuration), 1) + "%)");
+    line("Xruns " + String(profiler.getNumXruns()) + " in " + String(profiler.getNumCallbacks()) + " callbacks"
+         + (profiler.getNumDropped() > 0 ? ", " + String(profiler.getNumDropped()) + " records dropped" : String()));
+    if (CallbackProfiler::getNumHotCues() > 0)
+        line("Hot cues " + String(CallbackProfiler::getNumHotCues()) + ", latency last "
+             + String(CallbackProfiler::getLastHotCueLatencyMs(), 1) + " ms, worst "
+             + String(CallbackProfiler::getWorstHotCueLatencyMs(), 1) + " ms, "
+             + String(CallbackProfiler::getNumHotCuesFromDisk()) + " from disk");
+    for (auto& report : latencyReports)
+        line(report.first + " latency " + report.second().toString());
+    area.removeFromTop(6);
+
+    //One bar per stage, full width is the whole deadline
+    for (int stage = 0; stage < CallbackProfiler::numStages; ++stage)
+    {
+        auto row = area.removeFromTop(16);
+        auto label = row.removeFromLeft(70);
+        auto value = row.removeFromRight(120);
+
+        g.setColour(Colours::lightgrey);
+        g.drawText(CallbackProfiler::getStageName((CallbackProfiler::Stage) stage), label, Justification::centredLeft, false);
+        g.drawText(String(stageMeans[stage], 1) + " us " + String(percentOfDeadline(stageMeans[stage]), 1) + "%",
+                   value, Justification::centredRight, false);
+
+        auto bar = row.reduced(2, 3).toFloat();
+        g.setColour(Colour(40, 40, 40));
+        g.fillRect(bar);
+        g.setColour(Colour(97, 132, 216));
+        g.fillRect(bar.withWidth(bar.getWidth() * (float) jlimit(0.0, 1.0, percentOfDeadline(stageMeans[stage]) / 100.0)));
+    }
+
+    area.removeFromTop(8);
+
+    //Histogram of every callback's duration against its deadline since the last reset, on a log scale
+    uint32 bins[CallbackProfiler::numHistogramBins];
+    profiler.getHistogram(bins);
+    uint32 largest = 1;
+    for (auto bin : bins)
+        largest = jmax(largest, bin);
+
+    auto axis = area.removeFromBottom(14);
+    auto plot = area.toFloat();
+    float binWidth = plot.getWidth() / (float) CallbackProfiler::numHistogramBins;
+
+    for (int bin = 0; bin < CallbackProfiler::numHistogramBins; ++bin)
+    {
+        float height = bins[bin] == 0 ? 0.0f : plot.getHeight() * (float) (std::log10(1.0 + bins[bin]) / std::log10(1.0 + largest));
+        bool late = (bin + 1) * CallbackProfiler::histogramBinWidth > 1.0 + 1.0e-9;
+
+        g.setColour(late ? Colour(216, 97, 97) : Colour(80, 162, 167));
+        g.fillRect(plot.getX() + binWidth * (float) bin + 1.0f, plot.getBottom() - height, binWidth - 2.0f, height);
+    }
+
+    g.setColour(Colours::lightgrey);
+    g.setFont (juce::FontOptions (10.0f));
+    g.drawText("0%", axis, Justification::centredLeft, false);
+    g.drawText("100%", axis, Justification::centred, false);
+    g.drawText(">" + String(roundToInt((CallbackProfiler::numHistogramBins - 1) * CallbackProfiler::histogramBinWidth * 100.0)) + "%",
+               axis, Justification::centredRight, false);
+
+    if (csvStatus.isNotEmpty())
+        g.drawText(csvStatus, getLocalBounds().reduced(8, 4).removeFromTop(22).withTrimmedLeft(180),
+                   Justification::centredLeft, true);
+}
+
+void ProfilerOverlay::resized()
+{
+    auto top = getLocalBounds().reduced(8, 4).removeFromTop(22);
+    csvButton.setBounds(top.removeFromLeft(80));
+    top.removeFromLeft(6);
+    resetButton.setBounds(top.removeFromLeft(80));
+}
+
+//Function to save the history next to the user's documents, or clear it
+void ProfilerOverlay::buttonClicked(Button* button)
+{
+    if (button == &csvButton)
+    {
+        profiler.collect();
+        auto file = File::getSpecialLocation(File::userDocumentsDirectory)
+                        .getNonexistentChildFile("OtoDecks callback profile", ".csv");
+
+        if (profiler.writeCsv(file))
+        {
+            csvStatus = "Saved " + file.getFileName();
+            std::cout << "Callback profile saved to " << file.getFullPathName() << std::endl;
+        }
+        else
+        {
+            csvStatus = "Could not write the CSV";
+        }
+    }
+    else if (button == &resetButton)
+    {
+        profiler.reset();
+        csvStatus.clear();
+    }
+
+    repaint();
+}
+
+//Function to drain the profiler and redraw while the overlay is on screen
+void ProfilerOverlay::timerCallback()
+{
+    if (profiler.collect() > 0 && isShowing())
+        repaint();
+}
+
+//Function to add a path whose latency is shown
+void ProfilerOverlay::addLatencyReport(const String& name, std::function<PipelineLatency()> getReport)
+{
+    latencyReports.emplace_back(name, std::move(getReport));
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CallbackProfiler.h"
+#include "PipelineLatency.h"
+
+//Panel drawn over the decks showing what the CallbackProfiler measured: the average and worst callback against
+//its deadline, the share of the deadline each stage takes, the histogram of callback load and the xrun count,
+//and the latency of each path it is given. It drains the profiler several times a second even while hidden, so
+//the history is there for a CSV dump
+class ProfilerOverlay  : public juce::Component,
+                         public Timer,
+                         public Button::Listener
+{
+public:
+    //Constructor: Starts collecting from the profiler
+    ProfilerOverlay(CallbackProfiler& profilerToShow);
+    //Destructor: Stops the timer
+    ~ProfilerOverlay() override;
+
+    //Draws the figures, bars and histogram
+    void paint (juce::Graphics&) override;
+    //Places the buttons along the top
+    void resized() override;
+
+    //Saves the history as CSV or starts the measurements again
+    void buttonClicked(Button* button) override;
+
+    //Timer callback function
+    void timerCallback() override;
+
+    //Adds a line for a path's latency, asked for every time the overlay is drawn; call before it is shown
+    void addLatencyReport(const String& name, std::function<PipelineLatency()> getReport);
+
+    //Most recent callbacks the averages are taken over
+    static constexpr int averagingWindow = 400;
+
+private:
+    CallbackProfiler& profiler;
+
+    TextButton csvButton{"SAVE CSV"};
+    TextButton resetButton{"RESET"};
+    //Where the last CSV went, or why it failed
+    String csvStatus;
+    //Paths whose latency is shown, by name
+    std::vector<std::pair<String, std::function<PipelineLatency()>>> latencyReports;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProfilerOverlay)
+};
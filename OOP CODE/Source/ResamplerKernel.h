@@ -0,0 +1,23 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//One interpolation method for the deck resampler. The DeckResamplerSource keeps the input buffered and works out
+//where each output sample falls in it, a kernel only has to turn those fractional positions into samples
+class ResamplerKernel
+{
+public:
+    virtual ~ResamplerKernel() = default;
+
+    //Builds any tables for ratios up to maxRatio, never called on the audio thread
+    virtual void prepare(double maxRatio) = 0;
+
+    //How many input samples before and after floor(position) the kernel reads
+    virtual int getNumSamplesBefore() const noexcept = 0;
+    virtual int getNumSamplesAfter() const noexcept = 0;
+
+    //Writes one output sample per position. input may be read from floor(position) - samplesBefore up to
+    //floor(position) + samplesAfter; ratio is the largest step between positions, used to band-limit
+    virtual void process(const float* input, const double* positions, float* output,
+                         int numSamples, double ratio) const noexcept = 0;
+};
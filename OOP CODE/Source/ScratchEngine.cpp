@@ -0,0 +1,304 @@
+#include "ScratchEngine.h"
+#include <cmath>
+
+//Constructor: Allocates the FIFO's events up front
+ScratchEngine::ScratchEngine()
+    : events((size_t) fifo.getTotalSize())
+{
+}
+
+//Function to queue the hand touching the platter
+void ScratchEngine::touch(double timeMs)
+{
+    push(touched, 0.0, timeMs);
+}
+
+//Function to queue a platter speed
+void ScratchEngine::move(double newSpeed, double timeMs)
+{
+    push(moved, jlimit(-maxSpeed, maxSpeed, newSpeed), timeMs);
+}
+
+//Function to queue the hand letting go
+void ScratchEngine::release(double timeMs)
+{
+    push(released, 0.0, timeMs);
+}
+
+//Function to queue reverse being switched on or off
+void ScratchEngine::setReverse(bool shouldReverse, double timeMs)
+{
+    push(shouldReverse ? reverseOn : reverseOff, 0.0, timeMs);
+}
+
+//Function to queue a brake
+void ScratchEngine::brake(double timeMs)
+{
+    push(braked, 0.0, timeMs);
+}
+
+//Function to queue a spin-back
+void ScratchEngine::spinBack(double timeMs)
+{
+    push(spunBack, 0.0, timeMs);
+}
+
+//Function to queue the deck being started or stopped
+void ScratchEngine::resume(double timeMs)
+{
+    push(resumed, 0.0, timeMs);
+}
+
+//Function to put an event on the FIFO
+void ScratchEngine::push(int type, double newSpeed, double timeMs)
+{
+    const auto scope = fifo.write(1);
+    if (scope.blockSize1 > 0)
+        events[(size_t) scope.startIndex1] = { type, (float) newSpeed, timeMs };
+    else if (type != moved)
+        //The audio thread has stalled; a lost move is made up by the next one, nothing else is
+        overflowType = type;
+}
+
+//Function to reset the audio thread state for a new stream
+void ScratchEngine::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    stillSamples = jmax(1, roundToInt(stillMs * sampleRate / 1000.0));
+    releaseSamples = jmax(1, roundToInt(releaseMs * sampleRate / 1000.0));
+    reverseSamples = jmax(1, roundToInt(reverseMs * sampleRate / 1000.0));
+
+    //Reverse is a setting of the deck and stays, everything the hand or a brake was doing stops
+    blockClock.reset(sampleRate);
+    held = false;
+    easing = false;
+    gliding = false;
+    parked = false;
+    rampRemaining = 0;
+    active = false;
+    lastLatencyMs = 0.0;
+    worstLatencyMs = 0.0;
+}
+
+//Function to start ramping from the current speed to a new one
+void ScratchEngine::rampTo(double targetSpeed, double ms) noexcept
+{
+    rampRemaining = jmax(1, roundToInt(ms * sampleRate / 1000.0));
+    rampStep = (targetSpeed - speed) / rampRemaining;
+}
+
+//Function to start easing to the deck's own speed
+void ScratchEngine::easeBack(int numSamples) noexcept
+{
+    easing = true;
+    easeFrom = speed;
+    easeLength = numSamples;
+    easeDone = 0;
+}
+
+//Function to start running down to a standstill
+void ScratchEngine::glideToStop(double fromSpeed, double ms) noexcept
+{
+    gliding = true;
+    parked = false;
+    easing = false;
+    glideFrom = fromSpeed;
+    glideLength = jmax(1, roundToInt(ms * sampleRate / 1000.0));
+    glideDone = 0;
+}
+
+//Function to check whether the platter is left to the deck
+bool ScratchEngine::isIdle() const noexcept
+{
+    return ! held && ! easing && ! gliding && ! parked && ! reversed;
+}
+
+//Function to act on what the hand or the deck did
+void ScratchEngine::apply(int type, float newSpeed, double timeMs) noexcept
+{
+    switch (type)
+    {
+        case touched:
+            //A hand on the platter stops it, whatever the motor was doing
+            held = true;
+            easing = false;
+            gliding = false;
+            parked = false;
+            samplesSinceMove = 0;
+            lastMoveMs = timeMs;
+            rampTo(0.0, maxRampMs);
+            break;
+
+        case moved:
+            if (held)
+            {
+                //Reach the new speed as the next reading is due, so the speed follows the hand without steps
+                rampTo(newSpeed, jlimit(minRampMs, maxRampMs, timeMs - lastMoveMs));
+                lastMoveMs = timeMs;
+                samplesSinceMove = 0;
+            }
+            break;
+
+        case released:
+            if (held)
+            {
+                held = false;
+                rampRemaining = 0;
+                easeBack(releaseSamples);
+            }
+            break;
+
+        case reverseOn:
+        case reverseOff:
+            if (reversed != (type == reverseOn))
+            {
+                reversed = (type == reverseOn);
+
+                //The motor turns the platter round, unless a hand or a brake has it
+                if (! held && ! gliding && ! parked)
+                    easeBack(reverseSamples);
+            }
+            break;
+
+        case braked:
+            if (! held)
+                glideToStop(speed, brakeMs * jmin(1.0, std::abs(speed)));
+            break;
+
+        case spunBack:
+            //Flicked against the way the platter was going
+            if (! held)
+                glideToStop(speed < 0.0 ? spinBackSpeed : -spinBackSpeed, spinBackMs);
+            break;
+
+        case resumed:
+            if (gliding || parked)
+            {
+                gliding = false;
+                parked = false;
+                easeBack(releaseSamples);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+//Function to write the speed at each sample from one sample of the block up to another
+void ScratchEngine::render(float* speeds, int from, int to, double deckSpeed) noexcept
+{
+    for (int i = from; i < to; ++i)
+    {
+        //What the deck plays at by itself, and what the platter goes back to
+        double ownSpeed = reversed ? -deckSpeed : deckSpeed;
+
+        if (held)
+        {
+            if (rampRemaining > 0)
+            {
+                speed += rampStep;
+                --rampRemaining;
+            }
+
+            //The hand has stopped moving, so has the platter
+            if (++samplesSinceMove == stillSamples)
+                rampTo(0.0, maxRampMs);
+        }
+        else if (gliding)
+        {
+            //Friction slows the platter evenly
+            speed = glideFrom * (1.0 - (double) glideDone / (double) glideLength);
+
+            if (++glideDone >= glideLength)
+            {
+                gliding = false;
+                parked = true;
+                speed = 0.0;
+            }
+        }
+        else if (parked)
+        {
+            speed = 0.0;
+        }
+        else if (easing)
+        {
+            //Raised cosine to the deck's speed, which may change while it eases
+            double progress = (double) easeDone / (double) easeLength;
+            speed = ownSpeed + (easeFrom - ownSpeed) * 0.5 * (1.0 + std::cos(MathConstants<double>::pi * progress));
+
+            if (++easeDone >= easeLength)
+            {
+                easing = false;
+                speed = ownSpeed;
+            }
+        }
+        else
+        {
+            speed = ownSpeed;
+        }
+
+        speeds[i] = (float) speed;
+    }
+}
+
+//Function to place this block's events at their samples and write the speed across the block
+bool ScratchEngine::getSpeeds(int numSamples, double deckSpeed, float* speeds) noexcept
+{
+    blockClock.update(numSamples);
+
+    if (numSamples <= 0)
+        return active.load();
+
+    const auto numReady = jmin(fifo.getNumReady(), maxEventsPerBlock);
+    auto overflow = overflowType.exchange(-1);
+
+    if (numReady == 0 && overflow < 0 && isIdle())
+    {
+        //Untouched, a touch starts from whatever speed the deck is playing at
+        speed = deckSpeed;
+        active = false;
+        return false;
+    }
+
+    //An event that changes nothing, a move with no hand on the platter say, leaves the block to the deck
+    bool differs = ! isIdle();
+    int currentSample = 0;
+
+    if (overflow >= 0)
+    {
+        apply(overflow, 0.0f, lastMoveMs);
+        differs = differs || ! isIdle();
+    }
+
+    const auto scope = fifo.read(numReady);
+
+    auto applyEvent = [&] (int index)
+    {
+        auto& event = events[(size_t) index];
+
+        //An event made some time after the previous block started lands the same time into this one
+        int sample = jlimit(currentSample, numSamples - 1, blockClock.getOffset(event.timeMs));
+        render(speeds, currentSample, sample, deckSpeed);
+        currentSample = sample;
+        apply(event.type, event.speed, event.timeMs);
+        differs = differs || ! isIdle();
+
+        auto delay = blockClock.getDelayMs(event.timeMs, sample);
+        if (delay >= 0.0)
+        {
+            lastLatencyMs = delay;
+            if (delay > worstLatencyMs.load())
+                worstLatencyMs = delay;
+        }
+    };
+
+    for (int i = 0; i < scope.blockSize1; ++i)
+        applyEvent(scope.startIndex1 + i);
+    for (int i = 0; i < scope.blockSize2; ++i)
+        applyEvent(scope.startIndex2 + i);
+
+    render(speeds, currentSample, numSamples, deckSpeed);
+    active = differs;
+    return differs;
+}
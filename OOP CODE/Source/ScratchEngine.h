@@ -0,0 +1,143 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "BlockClock.h"
+
+//Turns the jog wheel into a playback speed for every sample, for scratching. The UI sends the platter being touched,
+//moved and let go, each timestamped on the Time::getMillisecondCounterHiRes clock and queued in a lock-free FIFO. The
+//audio thread places each at its own sample of the next block with a BlockClock, the way the crossfader places its
+//moves, so the jog is heard one block after it happens and a fast movement keeps its shape.
+//
+//While the platter is held the speed follows the hand: each new platter speed is reached with a straight ramp over
+//the time since the one before, so the speed moves smoothly between the controller's readings instead of stepping,
+//and it falls to zero when the hand stops. Speeds can be negative, the deck then plays backwards. Let go, the speed
+//eases back to the deck's own on a raised-cosine curve.
+//
+//The same path drives the platter's motor modes. Reverse turns the deck's own speed round, so it plays backwards
+//until reverse is switched off. Brake slows the platter to a stop like a turntable switched off, spin-back flicks it
+//backwards and lets it run down; both leave it parked at a standstill until the deck is started or stopped again,
+//and a hand on the platter takes over from any of them
+class ScratchEngine
+{
+public:
+    //Fastest the hand can move the platter either way, as a multiple of the normal speed
+    static constexpr double maxSpeed = 4.0;
+    //Shortest and longest ramp between two platter speeds
+    static constexpr double minRampMs = 0.5;
+    static constexpr double maxRampMs = 20.0;
+    //A held platter that hasn't moved for this long has stopped
+    static constexpr double stillMs = 40.0;
+    //How long a released platter takes to get back to the deck's speed
+    static constexpr double releaseMs = 200.0;
+    //How long the platter takes to turn round when reverse is switched
+    static constexpr double reverseMs = 60.0;
+    //How long a brake takes to stop the platter from full speed
+    static constexpr double brakeMs = 1200.0;
+    //Speed a spin-back flicks the platter to, and how long it takes to run down
+    static constexpr double spinBackSpeed = 3.0;
+    static constexpr double spinBackMs = 1500.0;
+    //Most events taken from the FIFO in one block, later ones wait for the next block
+    static constexpr int maxEventsPerBlock = 64;
+
+    //Constructor
+    ScratchEngine();
+
+    //Message thread: the hand touches the platter, moves it at a speed (1 is the normal speed forwards) or lets go,
+    //at timeMs on the Time::getMillisecondCounterHiRes clock
+    void touch(double timeMs);
+    void move(double speed, double timeMs);
+    void release(double timeMs);
+    //Message thread: motor modes, see above; resume is for the deck being started or stopped
+    void setReverse(bool shouldReverse, double timeMs);
+    void brake(double timeMs);
+    void spinBack(double timeMs);
+    void resume(double timeMs);
+
+    //Any thread: true while the platter's speed isn't simply the deck's own
+    bool isActive() const { return active.load(); }
+    //Any thread: how long after they were made the last and the slowest events since prepare were rendered
+    double getLastLatencyMs() const { return lastLatencyMs.load(); }
+    double getWorstLatencyMs() const { return worstLatencyMs.load(); }
+
+    //Resets the block clock and lets go of the platter, call from prepareToPlay
+    void prepare(double sampleRate);
+
+    //Audio thread: writes the speed at every sample of the block, easing back to deckSpeed after a release. Returns
+    //false if the whole block plays at deckSpeed, the deck then plays normally
+    bool getSpeeds(int numSamples, double deckSpeed, float* speeds) noexcept;
+
+private:
+    //What the hand did
+    enum EventType
+    {
+        touched = 0,
+        moved,
+        released,
+        reverseOn,
+        reverseOff,
+        braked,
+        spunBack,
+        resumed
+    };
+
+    //An event waiting in the FIFO
+    struct Event
+    {
+        int type;
+        float speed;
+        double timeMs;
+    };
+
+    //Pushes an event onto the FIFO, or keeps it as the overflow event if the FIFO is full
+    void push(int type, double speed, double timeMs);
+    //Audio thread: acts on an event at the current sample
+    void apply(int type, float speed, double timeMs) noexcept;
+    //Audio thread: starts a straight ramp to a platter speed
+    void rampTo(double speed, double ms) noexcept;
+    //Audio thread: writes speeds up to a sample of the block
+    void render(float* speeds, int from, int to, double deckSpeed) noexcept;
+    //Audio thread: starts easing from the current speed to the deck's own over a number of samples
+    void easeBack(int numSamples) noexcept;
+    //Audio thread: starts running down to a standstill from a speed over a time
+    void glideToStop(double fromSpeed, double ms) noexcept;
+    //Audio thread: true while the platter plays at the deck's own speed
+    bool isIdle() const noexcept;
+
+    AbstractFifo fifo{1024};
+    std::vector<Event> events;
+    //Only moves can be lost, the last other event that didn't fit in the FIFO waits here, -1 if none
+    std::atomic<int> overflowType { -1 };
+
+    std::atomic<bool> active { false };
+    std::atomic<double> lastLatencyMs { 0.0 };
+    std::atomic<double> worstLatencyMs { 0.0 };
+
+    //Audio thread state
+    double sampleRate = 44100.0;
+    int stillSamples = 1764;
+    int releaseSamples = 8820;
+    int reverseSamples = 2646;
+    BlockClock blockClock;
+    double speed = 1.0;
+    bool held = false;
+    //Ramp towards the hand's latest speed
+    double rampStep = 0.0;
+    int rampRemaining = 0;
+    double lastMoveMs = 0.0;
+    int samplesSinceMove = 0;
+    //Ease back to the deck's own speed after a release, a reverse switch or a restart
+    bool easing = false;
+    double easeFrom = 0.0;
+    int easeLength = 1;
+    int easeDone = 0;
+    //Run down to a standstill after a brake or spin-back, then stay parked there
+    bool gliding = false;
+    double glideFrom = 0.0;
+    int glideLength = 1;
+    int glideDone = 0;
+    bool parked = false;
+    //The deck's own speed is turned round
+    bool reversed = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScratchEngine)
+};
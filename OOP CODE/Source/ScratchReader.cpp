@@ -0,0 +1,84 @@
+#include "ScratchReader.h"
+#include <cmath>
+
+//Constructor: Allocates everything up front so the audio thread never has to
+ScratchReader::ScratchReader()
+    : window(2, windowSize),
+      positions((size_t) maxPiece),
+      gains((size_t) maxPiece)
+{
+    window.clear();
+}
+
+//Function to copy track samples into the window, from decoded audio where it has them
+void ScratchReader::fillWindow(int64 start, int numSamples, const LoadedTrack& track,
+                               const AudioBuffer<float>* decodedAudio, int64 decodedStart) noexcept
+{
+    auto end = start + numSamples;
+    auto decodedEnd = decodedAudio != nullptr ? decodedStart + decodedAudio->getNumSamples() : decodedStart;
+    auto overlapStart = jlimit(start, end, decodedStart);
+    auto overlapEnd = jlimit(overlapStart, end, decodedEnd);
+
+    if (overlapStart == overlapEnd)
+    {
+        track.readSamples(window, 0, start, numSamples);
+        return;
+    }
+
+    if (overlapStart > start)
+        track.readSamples(window, 0, start, (int) (overlapStart - start));
+
+    for (int channel = 0; channel < 2; ++channel)
+        window.copyFrom(channel, (int) (overlapStart - start), *decodedAudio, jmin(channel, decodedAudio->getNumChannels() - 1),
+                        (int) (overlapStart - decodedStart), (int) (overlapEnd - overlapStart));
+
+    if (overlapEnd < end)
+        track.readSamples(window, (int) (overlapEnd - start), overlapEnd, (int) (end - overlapEnd));
+}
+
+//Function to interpolate the block along the positions the rates lead to
+double ScratchReader::read(const AudioSourceChannelInfo& bufferToFill, const float* rates, double position,
+                           const LoadedTrack& track, const AudioBuffer<float>* decodedAudio, int64 decodedStart) noexcept
+{
+    int numChannels = jmin(2, bufferToFill.buffer->getNumChannels());
+
+    for (int done = 0; done < bufferToFill.numSamples; done += maxPiece)
+    {
+        int numToDo = jmin(maxPiece, bufferToFill.numSamples - done);
+        double lowest = position, highest = position, largestStep = 0.0;
+
+        for (int i = 0; i < numToDo; ++i)
+        {
+            positions[(size_t) i] = position;
+            lowest = jmin(lowest, position);
+            highest = jmax(highest, position);
+
+            auto rate = jlimit(-maxRate, maxRate, (double) rates[done + i]);
+            largestStep = jmax(largestStep, std::abs(rate));
+            gains[(size_t) i] = (float) jmin(1.0, std::abs(rate) / fadeBelowRate);
+            position += rate;
+        }
+
+        //The kernel reads one sample before and two after each position
+        auto windowStart = (int64) std::floor(lowest) - 1;
+        auto windowEnd = (int64) std::floor(highest) + 3;
+
+        fillWindow(windowStart, (int) (windowEnd - windowStart), track, decodedAudio, decodedStart);
+
+        for (int i = 0; i < numToDo; ++i)
+            positions[(size_t) i] -= (double) windowStart;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* output = bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample + done);
+            kernel.process(window.getReadPointer(channel), positions.data(), output, numToDo, largestStep);
+            FloatVectorOperations::multiply(output, gains.data(), numToDo);
+        }
+    }
+
+    //The window is stereo, any channels past the second are left silent
+    for (int channel = numChannels; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+        bufferToFill.buffer->clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+
+    return position;
+}
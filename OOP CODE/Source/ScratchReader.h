@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TrackLoader.h"
+#include "PolynomialResamplerKernels.h"
+
+//Reads a track at a speed that changes every sample and can go negative, for scratching, reverse play and brakes.
+//Samples come from the track's RAM cache or from its read-ahead window, which reaches both ways from the playhead,
+//and from any decoded audio the playhead is in, such as a hot cue's; the reader never seeks or decodes.
+//
+//Each sample's track position is the sum of the rates before it, and the output is interpolated between track
+//samples with the four-point Lagrange kernel the resampler uses, so the sound follows the platter without steps.
+//Near standstill the output fades out, a stopped record is silent rather than holding one sample
+class ScratchReader
+{
+public:
+    //Most track samples a single output sample can move, either way
+    static constexpr double maxRate = 8.0;
+    //Below this rate the output fades towards silence
+    static constexpr double fadeBelowRate = 0.05;
+
+    //Constructor: Allocates the read window
+    ScratchReader();
+
+    //Audio thread: fills the block reading from position at a rate in track samples per output sample for every
+    //sample, using decodedAudio from decodedStart on where it covers the track (it may be null). Returns the
+    //position after the block
+    double read(const AudioSourceChannelInfo& bufferToFill, const float* rates, double position, const LoadedTrack& track,
+                const AudioBuffer<float>* decodedAudio, int64 decodedStart) noexcept;
+
+private:
+    //Output samples interpolated at a time, and the track samples the largest of them can span
+    static constexpr int maxPiece = 256;
+    static constexpr int windowSize = (int) (maxPiece * maxRate) + 8;
+
+    //Fills the window with track samples from start on
+    void fillWindow(int64 start, int numSamples, const LoadedTrack& track,
+                    const AudioBuffer<float>* decodedAudio, int64 decodedStart) noexcept;
+
+    //Track samples around one piece, where each output sample falls in them and how loud it is
+    AudioBuffer<float> window;
+    std::vector<double> positions;
+    std::vector<float> gains;
+    LagrangeResamplerKernel kernel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ScratchReader)
+};
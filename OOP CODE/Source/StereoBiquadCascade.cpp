@@ -0,0 +1,170 @@
+#include "StereoBiquadCascade.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define OTODECKS_BIQUAD_SSE2 1
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+ #include <arm_neon.h>
+ #define OTODECKS_BIQUAD_NEON 1
+#endif
+
+//Constructor: Every stage starts as a pass-through
+StereoBiquadCascade::StereoBiquadCascade(int numStages)
+{
+    setNumStages(numStages);
+}
+
+//Function to choose how many stages are run
+void StereoBiquadCascade::setNumStages(int numStages)
+{
+    numberOfStages = jlimit(1, maxStages, numStages);
+}
+
+//Function to load one stage's coefficients, scaling the feed-forward part by the stage gain
+void StereoBiquadCascade::setCoefficients(int stage, const IIRCoefficients& coefficients, float gain) noexcept
+{
+    jassert(isPositiveAndBelow(stage, maxStages));
+
+    auto& s = stages[(size_t) stage];
+    s.b0 = coefficients.coefficients[0] * gain;
+    s.b1 = coefficients.coefficients[1] * gain;
+    s.b2 = coefficients.coefficients[2] * gain;
+    s.a1 = coefficients.coefficients[3];
+    s.a2 = coefficients.coefficients[4];
+}
+
+//Function to clear the filter history
+void StereoBiquadCascade::reset() noexcept
+{
+    for (auto& stageState : state)
+        for (auto& value : stageState)
+            value = 0.0;
+}
+
+//Function to report which kernel this build uses
+bool StereoBiquadCascade::isVectorised()
+{
+   #if OTODECKS_BIQUAD_SSE2 || OTODECKS_BIQUAD_NEON
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+//Function to run every stage over a stereo pair, each sample goes through the whole cascade before the next is read
+void StereoBiquadCascade::process(float* left, float* right, int numSamples) noexcept
+{
+   #if OTODECKS_BIQUAD_SSE2
+    //Keep coefficients and history in registers for the whole block
+    __m128d b0[maxStages], b1[maxStages], b2[maxStages], a1[maxStages], a2[maxStages], z1[maxStages], z2[maxStages];
+
+    for (int s = 0; s < numberOfStages; ++s)
+    {
+        b0[s] = _mm_set1_pd(stages[(size_t) s].b0);
+        b1[s] = _mm_set1_pd(stages[(size_t) s].b1);
+        b2[s] = _mm_set1_pd(stages[(size_t) s].b2);
+        a1[s] = _mm_set1_pd(stages[(size_t) s].a1);
+        a2[s] = _mm_set1_pd(stages[(size_t) s].a2);
+        z1[s] = _mm_load_pd(state[s]);
+        z2[s] = _mm_load_pd(state[s] + 2);
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        //Left sample in the low lane, right in the high lane
+        __m128d x = _mm_set_pd((double) right[i], (double) left[i]);
+
+        for (int s = 0; s < numberOfStages; ++s)
+        {
+            __m128d y = _mm_add_pd(_mm_mul_pd(b0[s], x), z1[s]);
+            z1[s] = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1[s], x), _mm_mul_pd(a1[s], y)), z2[s]);
+            z2[s] = _mm_sub_pd(_mm_mul_pd(b2[s], x), _mm_mul_pd(a2[s], y));
+            x = y;
+        }
+
+        left[i] = (float) _mm_cvtsd_f64(x);
+        right[i] = (float) _mm_cvtsd_f64(_mm_unpackhi_pd(x, x));
+    }
+
+    for (int s = 0; s < numberOfStages; ++s)
+    {
+        _mm_store_pd(state[s], z1[s]);
+        _mm_store_pd(state[s] + 2, z2[s]);
+    }
+   #elif OTODECKS_BIQUAD_NEON
+    //Keep coefficients and history in registers for the whole block
+    float64x2_t b0[maxStages], b1[maxStages], b2[maxStages], a1[maxStages], a2[maxStages], z1[maxStages], z2[maxStages];
+
+    for (int s = 0; s < numberOfStages; ++s)
+    {
+        b0[s] = vdupq_n_f64(stages[(size_t) s].b0);
+        b1[s] = vdupq_n_f64(stages[(size_t) s].b1);
+        b2[s] = vdupq_n_f64(stages[(size_t) s].b2);
+        a1[s] = vdupq_n_f64(stages[(size_t) s].a1);
+        a2[s] = vdupq_n_f64(stages[(size_t) s].a2);
+        z1[s] = vld1q_f64(state[s]);
+        z2[s] = vld1q_f64(state[s] + 2);
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        //Left sample in lane 0, right in lane 1
+        float64x2_t x = vsetq_lane_f64((double) right[i], vdupq_n_f64((double) left[i]), 1);
+
+        for (int s = 0; s < numberOfStages; ++s)
+        {
+            float64x2_t y = vfmaq_f64(z1[s], b0[s], x);
+            z1[s] = vfmsq_f64(vfmaq_f64(z2[s], b1[s], x), a1[s], y);
+            z2[s] = vfmsq_f64(vmulq_f64(b2[s], x), a2[s], y);
+            x = y;
+        }
+
+        left[i] = (float) vgetq_lane_f64(x, 0);
+        right[i] = (float) vgetq_lane_f64(x, 1);
+    }
+
+    for (int s = 0; s < numberOfStages; ++s)
+    {
+        vst1q_f64(state[s], z1[s]);
+        vst1q_f64(state[s] + 2, z2[s]);
+    }
+   #else
+    processScalar(left, right, numSamples);
+   #endif
+}
+
+//Function to run every stage over one channel
+void StereoBiquadCascade::processMono(float* samples, int numSamples) noexcept
+{
+    processScalar(samples, nullptr, numSamples);
+}
+
+//Function to run the cascade one lane at a time, right may be null for mono
+void StereoBiquadCascade::processScalar(float* left, float* right, int numSamples) noexcept
+{
+    float* channels[2] = { left, right };
+
+    for (int lane = 0; lane < 2; ++lane)
+    {
+        float* samples = channels[lane];
+
+        if (samples == nullptr)
+            continue;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            double x = samples[i];
+
+            for (int s = 0; s < numberOfStages; ++s)
+            {
+                auto& c = stages[(size_t) s];
+                double y = c.b0 * x + state[s][lane];
+                state[s][lane] = c.b1 * x - c.a1 * y + state[s][lane + 2];
+                state[s][lane + 2] = c.b2 * x - c.a2 * y;
+                x = y;
+            }
+
+            samples[i] = (float) x;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//Chain of biquad filters that runs the left and right channels together in one pass over the buffer,
+//with the two channels side by side in SIMD lanes (SSE2 on x86, NEON on 64-bit ARM, plain loop otherwise)
+class StereoBiquadCascade
+{
+public:
+    //Most filter stages one cascade can hold
+    static constexpr int maxStages = 4;
+
+    //Constructor: Starts with the given number of pass-through stages
+    StereoBiquadCascade(int numStages = 1);
+
+    //Sets how many stages are run, stages keep their coefficients
+    void setNumStages(int numStages);
+    int getNumStages() const { return numberOfStages; }
+
+    //Sets one stage's filter, gain is folded into its feed-forward coefficients so no separate gain pass is needed
+    void setCoefficients(int stage, const IIRCoefficients& coefficients, float gain = 1.0f) noexcept;
+    //Clears the filter history of every stage
+    void reset() noexcept;
+
+    //Filters a stereo pair in place, all stages in one pass
+    void process(float* left, float* right, int numSamples) noexcept;
+    //Filters a single channel in place using the left channel's history
+    void processMono(float* samples, int numSamples) noexcept;
+    //Each output sample is worked out from the input up to and including the same sample, so the cascade only shifts
+    //phase and adds no latency
+    int getLatencyInSamples() const noexcept { return 0; }
+
+    //Returns true if this build uses the SIMD kernel
+    static bool isVectorised();
+
+private:
+    //Coefficients of one stage: b0, b1, b2, a1, a2 normalised by a0
+    struct Stage
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+    };
+
+    //Plain loop used when no SIMD kernel is available
+    void processScalar(float* left, float* right, int numSamples) noexcept;
+
+    std::array<Stage, maxStages> stages;
+    //Transposed direct form II state, laid out as [stage][z1 left, z1 right, z2 left, z2 right]
+    alignas(16) double state[maxStages][4] = {};
+    int numberOfStages;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StereoBiquadCascade)
+};
@@ -0,0 +1,270 @@
+#include "TimeStretchSource.h"
+#include "CallbackProfiler.h"
+
+//Constructor: Makes an engine for every quality tier
+TimeStretchSource::TimeStretchSource(AudioSource* inputSource, bool deleteInputWhenDeleted, int numChannels)
+    : input(inputSource, deleteInputWhenDeleted),
+      numberOfChannels(jmax(1, numChannels))
+{
+    jassert(input != nullptr);
+
+    for (int i = 0; i < 3; ++i)
+        engines[i] = createEngine((Quality) i);
+}
+
+//Destructor: Lets the input go
+TimeStretchSource::~TimeStretchSource()
+{
+}
+
+//Function to make the engine for a quality tier
+std::unique_ptr<TimeStretcher> TimeStretchSource::createEngine(Quality quality)
+{
+    switch (quality)
+    {
+        case Quality::wsolaHigh:    return std::make_unique<WsolaStretcher>(30.0, 12.0, 2, 2);
+        case Quality::phaseVocoder: return std::make_unique<PhaseVocoderStretcher>(11);
+        case Quality::wsolaFast:
+        default:                    return std::make_unique<WsolaStretcher>(20.0, 6.0, 4, 4);
+    }
+}
+
+//Function to prepare the input and size every buffer for the largest engine
+void TimeStretchSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    inputBlockSize = jmax(1, samplesPerBlockExpected);
+
+    int maxFrame = 0, maxHop = 0, maxSearch = 0;
+    for (auto& engine : engines)
+    {
+        engine->prepare(sampleRate, numberOfChannels);
+        maxFrame = jmax(maxFrame, engine->getFrameSize());
+        maxHop = jmax(maxHop, engine->getSynthesisHop());
+        maxSearch = jmax(maxSearch, engine->getSearchRange());
+    }
+
+    //Room to look back one analysis hop plus the search range, and ahead a whole frame plus the template
+    int maxAnalysisHop = (int) std::ceil(maxHop * maxTempo) + 1;
+    historySize = maxSearch + maxAnalysisHop;
+    int lookAhead = maxFrame + maxSearch + maxHop;
+    inputBuffer.setSize(numberOfChannels, (historySize + lookAhead + maxAnalysisHop + inputBlockSize) * 2);
+
+    overlapBuffer.setSize(numberOfChannels, maxFrame);
+    outputBuffer.setSize(numberOfChannels, inputBlockSize + maxHop);
+
+    activeQuality = -1;
+    applyPendingChanges();
+    resetState();
+}
+
+//Function to release the buffers and the input
+void TimeStretchSource::releaseResources()
+{
+    input->releaseResources();
+    inputBuffer.setSize(numberOfChannels, 0);
+    overlapBuffer.setSize(numberOfChannels, 0);
+    outputBuffer.setSize(numberOfChannels, 0);
+}
+
+//Function to fill the block, straight from the input while disabled
+void TimeStretchSource::getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill)
+{
+    //Reading the input is timed as its own stage, so with key lock off this is only the pass-through
+    CallbackProfiler::ScopedStage profilerStage(CallbackProfiler::stretch);
+
+    applyPendingChanges();
+
+    if (! activeEnabled || activeEngine == nullptr || outputBuffer.getNumSamples() == 0)
+    {
+        input->getNextAudioBlock(bufferToFill);
+        bufferedAhead = 0;
+        return;
+    }
+
+    //Serve the block in pieces no bigger than the output buffer was sized for
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += inputBlockSize)
+    {
+        int numSamples = jmin(inputBlockSize, bufferToFill.numSamples - offset);
+
+        while (outputAvailable < numSamples)
+            renderNextFrame();
+
+        for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+            bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample + offset, outputBuffer,
+                                          jmin(channel, numberOfChannels - 1), 0, numSamples);
+
+        //Move what is left to the front of the output buffer
+        outputAvailable -= numSamples;
+        for (int channel = 0; channel < numberOfChannels; ++channel)
+        {
+            float* data = outputBuffer.getWritePointer(channel);
+            std::memmove(data, data + numSamples, sizeof(float) * (size_t) outputAvailable);
+        }
+    }
+
+    //The next frame starts where the output buffer ends, at the analysis position, so the next sample out came from
+    //the output buffer's length of input, at the tempo, before it
+    double nextOutputInput = analysisPosition - outputAvailable * jlimit(minTempo, maxTempo, tempo.load());
+    bufferedAhead = jmax(0, roundToInt(inputAvailable - nextOutputInput));
+}
+
+//Function to run one frame of the active engine
+void TimeStretchSource::renderNextFrame()
+{
+    int frameSize = activeEngine->getFrameSize();
+    int synthesisHop = activeEngine->getSynthesisHop();
+    int searchRange = activeEngine->getSearchRange();
+    double currentTempo = jlimit(minTempo, maxTempo, tempo.load());
+
+    //Drop input the engine will never look back at again
+    int frameStart = (int) analysisPosition;
+    int discard = frameStart - historySize;
+    if (discard > 0)
+    {
+        for (int channel = 0; channel < numberOfChannels; ++channel)
+        {
+            float* data = inputBuffer.getWritePointer(channel);
+            std::memmove(data, data + discard, sizeof(float) * (size_t) (inputAvailable - discard));
+        }
+
+        inputAvailable -= discard;
+        analysisPosition -= discard;
+        previousFrameStart -= discard;
+        frameStart -= discard;
+    }
+
+    int analysisHop = isFirstFrame ? roundToInt(synthesisHop * currentTempo) : frameStart - previousFrameStart;
+    pullInput(frameStart + frameSize + searchRange + synthesisHop);
+
+    const float* inputs[8];
+    float* overlaps[8];
+    int numChannels = jmin(numberOfChannels, 8);
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        inputs[channel] = inputBuffer.getReadPointer(channel, frameStart);
+        overlaps[channel] = overlapBuffer.getWritePointer(channel);
+    }
+
+    activeEngine->processFrame(inputs, overlaps, numChannels, analysisHop);
+
+    //The first hop of the overlap buffer has now had every frame that covers it added
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        outputBuffer.copyFrom(channel, outputAvailable, overlapBuffer, channel, 0, synthesisHop);
+
+        float* data = overlaps[channel];
+        std::memmove(data, data + synthesisHop, sizeof(float) * (size_t) (frameSize - synthesisHop));
+        FloatVectorOperations::clear(data + frameSize - synthesisHop, synthesisHop);
+    }
+
+    outputAvailable += synthesisHop;
+
+    previousFrameStart = frameStart;
+    analysisPosition += synthesisHop * currentTempo;
+    isFirstFrame = false;
+}
+
+//Function to read from the input until endIndex samples are buffered
+void TimeStretchSource::pullInput(int endIndex)
+{
+    jassert(endIndex <= inputBuffer.getNumSamples());
+
+    while (inputAvailable < endIndex)
+    {
+        int numSamples = jmin(inputBlockSize, inputBuffer.getNumSamples() - inputAvailable);
+        AudioSourceChannelInfo info(&inputBuffer, inputAvailable, numSamples);
+        input->getNextAudioBlock(info);
+        inputAvailable += numSamples;
+    }
+}
+
+//Function to pick up new settings from the message thread
+void TimeStretchSource::applyPendingChanges()
+{
+    bool wantsEnabled = enabled.load();
+    int wantsQuality = quality.load();
+
+    if (wantsQuality != activeQuality)
+    {
+        activeQuality = wantsQuality;
+        activeEngine = engines[jlimit(0, 2, activeQuality)].get();
+        resetState();
+    }
+
+    if (wantsEnabled != activeEnabled)
+    {
+        activeEnabled = wantsEnabled;
+        resetState();
+    }
+
+    if (resetRequested.exchange(false))
+        resetState();
+}
+
+//Function to empty every buffer, the stretched output starts again from the next input sample
+void TimeStretchSource::resetState()
+{
+    inputBuffer.clear();
+    overlapBuffer.clear();
+    outputBuffer.clear();
+
+    //Start with silent history so the engines can look back from the first frame
+    inputAvailable = historySize;
+    analysisPosition = historySize;
+    previousFrameStart = historySize;
+    outputAvailable = 0;
+    isFirstFrame = true;
+    bufferedAhead = 0;
+
+    if (activeEngine != nullptr)
+        activeEngine->reset();
+}
+
+//Function to turn key lock on or off
+void TimeStretchSource::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+}
+
+//Function to check if key lock is on
+bool TimeStretchSource::isEnabled() const
+{
+    return enabled.load();
+}
+
+//Function to set the tempo
+void TimeStretchSource::setTempo(double newTempo)
+{
+    tempo = jlimit(minTempo, maxTempo, newTempo);
+}
+
+//Function to get the tempo
+double TimeStretchSource::getTempo() const
+{
+    return tempo.load();
+}
+
+//Function to choose the quality tier
+void TimeStretchSource::setQuality(Quality newQuality)
+{
+    quality = (int) newQuality;
+}
+
+//Function to get the quality tier
+TimeStretchSource::Quality TimeStretchSource::getQuality() const
+{
+    return (Quality) quality.load();
+}
+
+//Function to ask the audio thread to throw away buffered input
+void TimeStretchSource::requestReset()
+{
+    resetRequested = true;
+}
+
+//Function to get how far the input has been read ahead of what is being played while enabled
+int TimeStretchSource::getLatencyInSamples() const
+{
+    return enabled.load() ? bufferedAhead.load() : 0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "WsolaStretcher.h"
+#include "PhaseVocoderStretcher.h"
+
+//Changes the tempo of its input without changing its pitch (key lock). Sits after the deck's resampler, which
+//then only corrects for the track's sample rate, and passes the input straight through while disabled.
+//
+//Rough per-deck cost at 48 kHz stereo with 256-sample blocks on one desktop x86 core, not counting the rest
+//of the deck (measure on the target machine with: OtoDecks --benchmark timestretch):
+//  wsolaFast     about 0.7% of a core, 20 ms frames, coarse search
+//  wsolaHigh     about 4% of a core, 30 ms frames, wider and finer search
+//  phaseVocoder  about 5% of a core, 2048-point FFTs at 75% overlap
+//The cost hardly changes with tempo, frames are produced at the output rate
+class TimeStretchSource : public AudioSource
+{
+public:
+    //Quality tiers, from cheapest to smoothest
+    enum class Quality
+    {
+        wsolaFast = 0,
+        wsolaHigh,
+        phaseVocoder
+    };
+
+    //Slowest and fastest tempo the deck can ask for
+    static constexpr double minTempo = 0.5;
+    static constexpr double maxTempo = 2.0;
+
+    //Constructor: Wraps the source to stretch
+    TimeStretchSource(AudioSource* inputSource, bool deleteInputWhenDeleted, int numChannels = 2);
+    //Destructor: Releases the input
+    ~TimeStretchSource() override;
+
+    //AudioSource overrides
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const AudioSourceChannelInfo& bufferToFill) override;
+
+    //Any thread: turns key lock on or off, takes effect at the next block
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const;
+    //Any thread: sets the tempo as a multiple of the input speed
+    void setTempo(double newTempo);
+    double getTempo() const;
+    //Any thread: picks the algorithm, takes effect at the next block
+    void setQuality(Quality newQuality);
+    Quality getQuality() const;
+
+    //Any thread: throws away the buffered input at the next block, call after a seek
+    void requestReset();
+
+    //Input samples read from the deck but not played yet while enabled, measured after every block: what is waiting
+    //in the input, overlap and output buffers. Multiply by the input's rate to get track samples
+    int getLatencyInSamples() const;
+
+    //Gives the benchmark direct access to an engine
+    static std::unique_ptr<TimeStretcher> createEngine(Quality quality);
+
+private:
+    //Audio thread: switches engine or resets state if the message thread asked for it
+    void applyPendingChanges();
+    //Audio thread: empties the buffers and restarts the active engine
+    void resetState();
+    //Audio thread: runs the active engine for one frame, adding its hop to the output buffer
+    void renderNextFrame();
+    //Audio thread: reads more input until at least endIndex samples are buffered
+    void pullInput(int endIndex);
+
+    OptionalScopedPointer<AudioSource> input;
+    int numberOfChannels;
+
+    //Engines for each tier, all prepared up front so switching never allocates
+    std::unique_ptr<TimeStretcher> engines[3];
+    TimeStretcher* activeEngine = nullptr;
+
+    std::atomic<bool> enabled { false };
+    std::atomic<double> tempo { 1.0 };
+    std::atomic<int> quality { (int) Quality::wsolaFast };
+    std::atomic<bool> resetRequested { false };
+    //Settings the audio thread is currently running with
+    bool activeEnabled = false;
+    int activeQuality = -1;
+
+    //Input from the source, index 0 is the oldest sample still needed
+    AudioBuffer<float> inputBuffer;
+    int inputAvailable = 0;
+    //Analysis position within inputBuffer, kept fractional so hops of any tempo add up exactly
+    double analysisPosition = 0.0;
+    int previousFrameStart = 0;
+    bool isFirstFrame = true;
+    //Samples kept before the analysis position for the engines to look back at
+    int historySize = 0;
+
+    //Frames are overlap-added here until the first hop of it is complete
+    AudioBuffer<float> overlapBuffer;
+    //Finished output waiting to be played
+    AudioBuffer<float> outputBuffer;
+    int outputAvailable = 0;
+
+    //Largest block the input source is asked for
+    int inputBlockSize = 512;
+    //How far the input read is ahead of the next output sample, in input samples, at the end of the last block
+    std::atomic<int> bufferedAhead { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TimeStretchSource)
+};
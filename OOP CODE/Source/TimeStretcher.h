@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//One time-stretch algorithm. The TimeStretchSource feeds it input and overlap-adds the frames it returns,
+//so an engine only has to turn the audio around an analysis position into one windowed output frame
+class TimeStretcher
+{
+public:
+    virtual ~TimeStretcher() = default;
+
+    //Allocates every buffer for the sample rate and channel count, never called on the audio thread
+    virtual void prepare(double sampleRate, int numChannels) = 0;
+    //Forgets the previous frame, called after a seek or when the engine is switched in
+    virtual void reset() noexcept = 0;
+
+    //Length of each output frame in samples
+    virtual int getFrameSize() const noexcept = 0;
+    //Output samples between the starts of consecutive frames
+    virtual int getSynthesisHop() const noexcept = 0;
+    //How far either side of the analysis position the engine may move its frame
+    virtual int getSearchRange() const noexcept = 0;
+
+    //Adds the next windowed frame into output[0, frameSize). input points at the analysis position and may be read
+    //from -(searchRange + analysisHop) up to frameSize + searchRange + synthesisHop; analysisHop is how far
+    //the analysis position moved since the previous frame
+    virtual void processFrame(const float* const* input, float* const* output, int numChannels, int analysisHop) noexcept = 0;
+};
@@ -0,0 +1,463 @@
+#include "TrackAnalyzer.h"
+#include <numeric>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define OTODECKS_ANALYZER_SSE 1
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+ #include <arm_neon.h>
+ #define OTODECKS_ANALYZER_NEON 1
+#endif
+
+namespace
+{
+    //Rate the track is decimated to, onsets don't need anything above about 5 kHz
+    constexpr double targetAnalysisRate = 11025.0;
+    constexpr int fftOrder = 9;
+    constexpr int fftSize = 1 << fftOrder;
+    constexpr int numBins = fftSize / 2 + 1;
+    //Bins are summed into bands spaced evenly in pitch, so a kick drum counts as much as a burst of hi-hat noise
+    constexpr int numBands = 24;
+    constexpr double lowestBandHz = 30.0;
+    //Bands up to here make the bass envelope the downbeat is found from
+    constexpr double highestBassHz = 150.0;
+    //Envelope frames a second aimed for
+    constexpr double targetFrameRate = 172.0;
+    //Scale of the log compression of each bin, so quiet parts still show onsets
+    constexpr float compression = 10.0f;
+    //Length of the running mean taken off the envelope, so only rises above the local level count
+    constexpr double meanSeconds = 0.25;
+    //Range of the rough tempo search, wider than the result range so halves and doubles can be found
+    constexpr double searchMinBpm = 50.0;
+    constexpr double searchMaxBpm = 220.0;
+    //Centre and width in octaves of the preference for common tempos, which settles half or double tempo
+    constexpr double preferredBpm = 120.0;
+    constexpr double preferenceOctaves = 1.0;
+    //Weakest autocorrelation peak, against the envelope's variance, that still counts as a steady beat
+    constexpr float minPeriodicity = 0.15f;
+    constexpr int beatsPerBar = 4;
+
+    //Function to add up how much each bin rose since the last frame
+    float sumOfRises(const float* current, const float* previous, int numValues) noexcept
+    {
+        float total = 0.0f;
+        int i = 0;
+
+       #if OTODECKS_ANALYZER_SSE
+        __m128 sum = _mm_setzero_ps();
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= numValues; i += 4)
+            sum = _mm_add_ps(sum, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(current + i), _mm_loadu_ps(previous + i)), zero));
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, sum);
+        total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+       #elif OTODECKS_ANALYZER_NEON
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        for (; i + 4 <= numValues; i += 4)
+            sum = vaddq_f32(sum, vmaxq_f32(vsubq_f32(vld1q_f32(current + i), vld1q_f32(previous + i)), zero));
+
+        total = vaddvq_f32(sum);
+       #endif
+
+        for (; i < numValues; ++i)
+            total += jmax(0.0f, current[i] - previous[i]);
+
+        return total;
+    }
+
+    //Function to multiply two arrays together and add up the products
+    float dotProduct(const float* a, const float* b, int numValues) noexcept
+    {
+        float total = 0.0f;
+        int i = 0;
+
+       #if OTODECKS_ANALYZER_SSE
+        __m128 sum = _mm_setzero_ps();
+        for (; i + 4 <= numValues; i += 4)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, sum);
+        total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+       #elif OTODECKS_ANALYZER_NEON
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (; i + 4 <= numValues; i += 4)
+            sum = vmlaq_f32(sum, vld1q_f32(a + i), vld1q_f32(b + i));
+
+        total = vaddvq_f32(sum);
+       #endif
+
+        for (; i < numValues; ++i)
+            total += a[i] * b[i];
+
+        return total;
+    }
+
+    //Function to find the band a frequency falls in, -1 below the lowest band
+    int bandOfFrequency(double frequency, double analysisRate)
+    {
+        if (frequency < lowestBandHz)
+            return -1;
+
+        double octaves = std::log2(0.5 * analysisRate / lowestBandHz);
+        return jmin(numBands - 1, (int) (numBands * std::log2(frequency / lowestBandHz) / octaves));
+    }
+
+    //Function to turn mono audio into onset envelopes for all bands and for the bass, one value each per hop
+    void makeOnsetEnvelopes(const std::vector<float>& audio, double analysisRate, int hopSize,
+                            TrackAnalyzer::OnsetEnvelope& envelope)
+    {
+        if ((int) audio.size() < fftSize)
+            return;
+
+        dsp::FFT fft(fftOrder);
+        std::vector<float> window((size_t) fftSize);
+        dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t) fftSize,
+                                                           dsp::WindowingFunction<float>::hann, false);
+
+        std::vector<float> frame((size_t) fftSize * 2);
+        std::vector<int> bandOfBin((size_t) numBins);
+        for (int bin = 0; bin < numBins; ++bin)
+            bandOfBin[(size_t) bin] = bandOfFrequency(bin * analysisRate / fftSize, analysisRate);
+
+        int numBassBands = bandOfFrequency(highestBassHz, analysisRate) + 1;
+        std::vector<float> current((size_t) numBands), previous((size_t) numBands, 0.0f);
+        int numFrames = ((int) audio.size() - fftSize) / hopSize + 1;
+        envelope.onsets.assign((size_t) numFrames, 0.0f);
+        envelope.bassOnsets.assign((size_t) numFrames, 0.0f);
+
+        for (int index = 0; index < numFrames; ++index)
+        {
+            FloatVectorOperations::multiply(frame.data(), audio.data() + (size_t) index * (size_t) hopSize,
+                                            window.data(), fftSize);
+            fft.performFrequencyOnlyForwardTransform(frame.data(), true);
+
+            std::fill(current.begin(), current.end(), 0.0f);
+            for (int bin = 0; bin < numBins; ++bin)
+                if (bandOfBin[(size_t) bin] >= 0)
+                    current[(size_t) bandOfBin[(size_t) bin]] += frame[(size_t) bin];
+
+            for (auto& band : current)
+                band = std::log1p(compression * band);
+
+            //The first frame rises from nothing, so it is left out
+            if (index > 0)
+            {
+                envelope.onsets[(size_t) index] = sumOfRises(current.data(), previous.data(), numBands);
+                envelope.bassOnsets[(size_t) index] = sumOfRises(current.data(), previous.data(), numBassBands);
+            }
+
+            std::swap(current, previous);
+        }
+    }
+
+    //Function to keep only what rises above the envelope's running mean
+    void removeRunningMean(std::vector<float>& envelope, int meanLength)
+    {
+        int numFrames = (int) envelope.size();
+        int half = jmax(1, meanLength / 2);
+        std::vector<float> original(envelope);
+        double sum = 0.0;
+        int first = 0, last = 0;
+
+        for (int index = 0; index < numFrames; ++index)
+        {
+            //Slide the window so it covers half a mean length either side of this frame
+            for (; last < jmin(numFrames, index + half + 1); ++last)
+                sum += original[(size_t) last];
+            for (; first < index - half; ++first)
+                sum -= original[(size_t) first];
+
+            float mean = (float) (sum / (last - first));
+            envelope[(size_t) index] = jmax(0.0f, original[(size_t) index] - mean);
+        }
+    }
+
+    //Function to read the envelope between frames
+    float envelopeAt(const std::vector<float>& envelope, double position) noexcept
+    {
+        auto index = (size_t) position;
+        if (position < 0.0 || index + 1 >= envelope.size())
+            return 0.0f;
+
+        float fraction = (float) (position - (double) index);
+        return envelope[index] + fraction * (envelope[index + 1] - envelope[index]);
+    }
+
+    //Function to average the envelope over a comb of beats, anchored in the middle of the envelope so a small change
+    //of period moves the beats at both ends equally
+    double combScore(const std::vector<float>& envelope, double period, double anchor)
+    {
+        double total = 0.0;
+        int count = 0;
+        int firstBeat = -(int) std::floor(anchor / period);
+        double end = (double) envelope.size() - 1.0;
+
+        for (int beat = firstBeat; anchor + beat * period < end; ++beat)
+        {
+            total += envelopeAt(envelope, anchor + beat * period);
+            ++count;
+        }
+
+        return count > 0 ? total / count : 0.0;
+    }
+
+    //Function to fold a tempo into the range tracks are shown in
+    double foldTempo(double bpm)
+    {
+        while (bpm < TrackAnalyzer::minBpm)
+            bpm *= 2.0;
+        while (bpm >= TrackAnalyzer::maxBpm)
+            bpm *= 0.5;
+        return bpm;
+    }
+}
+
+//Worker job that analyses one track and leaves the result for the message thread
+class TrackAnalyzer::AnalysisJob : public ThreadPoolJob
+{
+public:
+    AnalysisJob(TrackAnalyzer& _owner, const File& _file)
+        : ThreadPoolJob("Track analysis"),
+          owner(_owner),
+          file(_file)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        Result result;
+        result.file = file;
+        auto startTime = Time::getMillisecondCounterHiRes();
+
+        std::unique_ptr<AudioFormatReader> reader(owner.formatManager.createReaderFor(file));
+        if (reader != nullptr)
+            result.beatGrid = analyseReader(*reader, [this] { return shouldExit(); });
+        else
+            result.beatGrid.bpm = -1.0;
+
+        result.analysisMs = Time::getMillisecondCounterHiRes() - startTime;
+
+        if (! shouldExit())
+        {
+            const ScopedLock sl(owner.resultLock);
+            owner.finishedResults.push_back(result);
+        }
+
+        --owner.numPending;
+        return jobHasFinished;
+    }
+
+private:
+    TrackAnalyzer& owner;
+    File file;
+};
+
+//Constructor: Starts the worker pool at low priority, under the audio and read-ahead threads
+TrackAnalyzer::TrackAnalyzer(int numWorkerThreads)
+    : workerPool(jmax(1, numWorkerThreads), 0, Thread::Priority::low)
+{
+    formatManager.registerBasicFormats();
+}
+
+//Destructor: Stops the pool before the decoders and results go away
+TrackAnalyzer::~TrackAnalyzer()
+{
+    workerPool.removeAllJobs(true, 10000);
+}
+
+//Function to leave a core free for the audio and message threads
+int TrackAnalyzer::getDefaultNumWorkers()
+{
+    return jmax(1, SystemStats::getNumCpus() - 1);
+}
+
+//Function to queue a track on the worker pool
+void TrackAnalyzer::analyse(const File& file)
+{
+    ++numPending;
+    workerPool.addJob(new AnalysisJob(*this, file), true);
+}
+
+//Function to hand over the results finished so far
+std::vector<TrackAnalyzer::Result> TrackAnalyzer::takeResults()
+{
+    std::vector<Result> results;
+    const ScopedLock sl(resultLock);
+    results.swap(finishedResults);
+    return results;
+}
+
+//Function to decode the start of a track to mono at the analysis rate and analyse its onsets
+BeatGrid TrackAnalyzer::analyseReader(AudioFormatReader& reader, const std::function<bool()>& shouldExit)
+{
+    BeatGrid failed;
+    failed.bpm = -1.0;
+
+    if (reader.sampleRate <= 0.0 || reader.numChannels == 0)
+        return failed;
+
+    int decimation = jmax(1, roundToInt(reader.sampleRate / targetAnalysisRate));
+    double analysisRate = reader.sampleRate / decimation;
+    int64 numToRead = jmin(reader.lengthInSamples, (int64) (maxAnalysisSeconds * reader.sampleRate));
+    if (numToRead < (int64) (minAnalysisSeconds * reader.sampleRate))
+        return failed;
+
+    //Whole groups of samples per chunk, so averaging each group down to one sample never straddles chunks
+    const int chunkSize = decimation * 4096;
+    bool isStereo = reader.numChannels > 1;
+    float gain = 1.0f / (float) (decimation * (isStereo ? 2 : 1));
+    AudioBuffer<float> chunk(2, chunkSize);
+    std::vector<float> audio;
+    audio.reserve((size_t) (numToRead / decimation) + 1);
+
+    for (int64 position = 0; position < numToRead; position += chunkSize)
+    {
+        if (shouldExit != nullptr && shouldExit())
+            return {};
+
+        int numSamples = (int) jmin((int64) chunkSize, numToRead - position);
+        reader.read(&chunk, 0, numSamples, position, true, isStereo);
+
+        float* samples = chunk.getWritePointer(0);
+        if (isStereo)
+            FloatVectorOperations::add(samples, chunk.getReadPointer(1), numSamples);
+
+        //A box average is a rough anti-aliasing filter, but onsets survive it
+        for (int start = 0; start + decimation <= numSamples; start += decimation)
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < decimation; ++i)
+                sum += samples[start + i];
+            audio.push_back(sum * gain);
+        }
+    }
+
+    int hopSize = jmax(1, roundToInt(analysisRate / targetFrameRate));
+    OnsetEnvelope envelope;
+    envelope.frameRate = analysisRate / hopSize;
+    //Frames start earlier than the onsets they catch: the flux of an onset peaks once the window has slid far enough
+    //for the onset to sit about 70% of the way through it
+    envelope.firstFrameSeconds = 0.7 * fftSize / analysisRate;
+
+    makeOnsetEnvelopes(audio, analysisRate, hopSize, envelope);
+    if (shouldExit != nullptr && shouldExit())
+        return {};
+
+    removeRunningMean(envelope.onsets, roundToInt(meanSeconds * envelope.frameRate));
+    removeRunningMean(envelope.bassOnsets, roundToInt(meanSeconds * envelope.frameRate));
+    return analyseEnvelope(envelope);
+}
+
+//Function to find the tempo from the envelope's autocorrelation, then line a comb of beats up with the onsets
+BeatGrid TrackAnalyzer::analyseEnvelope(const OnsetEnvelope& onsetEnvelope)
+{
+    BeatGrid failed;
+    failed.bpm = -1.0;
+
+    const auto& envelope = onsetEnvelope.onsets;
+    double frameRate = onsetEnvelope.frameRate;
+    int numFrames = (int) envelope.size();
+    int minLag = (int) std::floor(60.0 * frameRate / searchMaxBpm);
+    int maxLag = (int) std::ceil(60.0 * frameRate / searchMinBpm);
+    if (minLag < 2 || numFrames < 4 * maxLag)
+        return failed;
+
+    //Autocorrelation of the envelope less its mean out to twice the longest lag, so each lag can be backed up by
+    //its double
+    std::vector<float> centred(envelope);
+    float mean = std::accumulate(envelope.begin(), envelope.end(), 0.0f) / (float) numFrames;
+    FloatVectorOperations::add(centred.data(), -mean, numFrames);
+
+    std::vector<float> correlation((size_t) (2 * maxLag + 2));
+    for (int lag = 0; lag < (int) correlation.size(); ++lag)
+        correlation[(size_t) lag] = dotProduct(centred.data(), centred.data() + lag, numFrames - lag)
+                                        / (float) (numFrames - lag);
+
+    if (correlation[0] <= 0.0f)
+        return failed;
+
+    int bestLag = -1;
+    double bestScore = 0.0;
+    for (int lag = minLag; lag <= maxLag; ++lag)
+    {
+        double lagBpm = 60.0 * frameRate / lag;
+        double octaves = std::log2(lagBpm / preferredBpm) / preferenceOctaves;
+        double score = (correlation[(size_t) lag] + 0.5 * correlation[(size_t) (2 * lag)]) * std::exp(-0.5 * octaves * octaves);
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestLag = lag;
+        }
+    }
+
+    if (bestLag < 0 || correlation[(size_t) bestLag] < minPeriodicity * correlation[0])
+        return failed;
+
+    //Fit a parabola through the peak and its neighbours for a period between frames
+    double period = bestLag;
+    if (bestLag > minLag && bestLag < maxLag)
+    {
+        double left = correlation[(size_t) bestLag - 1], centre = correlation[(size_t) bestLag];
+        double right = correlation[(size_t) bestLag + 1];
+        double curvature = left - 2.0 * centre + right;
+        if (curvature < 0.0)
+            period += jlimit(-0.5, 0.5, 0.5 * (left - right) / curvature);
+    }
+
+    double roughBpm = foldTempo(60.0 * frameRate / period);
+    double anchorBase = 0.5 * numFrames;
+
+    //Tempo and phase together: a coarse grid first, then a finer one around the best point
+    double bestBpm = roughBpm, bestPhase = 0.0;
+    bestScore = -1.0;
+    auto search = [&] (double fromBpm, double toBpm, double bpmStep, double fromPhase, double toPhase, double phaseStep)
+    {
+        for (double bpm = fromBpm; bpm <= toBpm; bpm += bpmStep)
+        {
+            double beatPeriod = 60.0 * frameRate / bpm;
+            for (double phase = fromPhase; phase < toPhase; phase += phaseStep)
+            {
+                double score = combScore(envelope, beatPeriod, anchorBase + phase);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestBpm = bpm;
+                    bestPhase = phase;
+                }
+            }
+        }
+    };
+
+    search(roughBpm * 0.97, roughBpm * 1.03, 0.05, 0.0, 60.0 * frameRate / roughBpm, 1.0);
+    double coarseBpm = bestBpm, coarsePhase = bestPhase;
+    search(coarseBpm - 0.05, coarseBpm + 0.05, 0.002, coarsePhase - 1.0, coarsePhase + 1.0, 0.1);
+
+    //The downbeat is the beat of the bar where the bass hits hardest, which is where the kick drum lands in most
+    //dance music; tracks without bass fall back to all the bands
+    double beatPeriod = 60.0 * frameRate / bestBpm;
+    double anchor = anchorBase + bestPhase;
+    int firstBeat = -(int) std::floor(anchor / beatPeriod);
+    double barStrength[beatsPerBar] = {};
+    bool hasBass = std::any_of(onsetEnvelope.bassOnsets.begin(), onsetEnvelope.bassOnsets.end(),
+                               [] (float value) { return value > 0.0f; });
+    const auto& accents = hasBass ? onsetEnvelope.bassOnsets : envelope;
+
+    for (int beat = firstBeat; anchor + beat * beatPeriod < numFrames - 1; ++beat)
+        barStrength[((beat % beatsPerBar) + beatsPerBar) % beatsPerBar] += envelopeAt(accents, anchor + beat * beatPeriod);
+
+    int downbeat = (int) (std::max_element(barStrength, barStrength + beatsPerBar) - barStrength);
+
+    //Earliest downbeat at or after the start of the track
+    double barSeconds = beatsPerBar * 60.0 / bestBpm;
+    double downbeatSeconds = onsetEnvelope.firstFrameSeconds + (anchor + downbeat * beatPeriod) / frameRate;
+    downbeatSeconds -= barSeconds * std::floor(downbeatSeconds / barSeconds);
+
+    BeatGrid grid;
+    grid.bpm = bestBpm;
+    grid.firstDownbeatSeconds = downbeatSeconds;
+    return grid;
+}
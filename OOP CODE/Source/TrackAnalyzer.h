@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "TrackList.h"
+
+//Finds the tempo and first downbeat of library tracks on a pool of low-priority worker threads, so a big import never
+//stalls the UI. A job decodes the start of its track, downmixed to mono at about 11 kHz, and turns it into an onset
+//envelope: the spectral flux of overlapping 512-point frames in bands about a third of an octave wide, some 170
+//frames a second. The envelope's autocorrelation gives a rough tempo, then tempo and beat phase are refined together
+//by lining a comb of beats up with the onsets. The downbeat is taken to be the beat of the bar with the strongest
+//bass onsets. Finished results wait in a list for the message thread to collect
+class TrackAnalyzer
+{
+public:
+    //What one job found
+    struct Result
+    {
+        File file;
+        BeatGrid beatGrid;
+        //Time the job took, decoding included
+        double analysisMs = 0.0;
+    };
+
+    //How much of each track is analysed, the start of a track stands for its tempo
+    static constexpr double maxAnalysisSeconds = 180.0;
+    //Shorter tracks don't have enough beats to lock onto
+    static constexpr double minAnalysisSeconds = 8.0;
+    //Tempos are halved or doubled into this range
+    static constexpr double minBpm = 70.0;
+    static constexpr double maxBpm = 180.0;
+
+    //Constructor: Starts the workers
+    TrackAnalyzer(int numWorkerThreads = getDefaultNumWorkers());
+    //Destructor: Drops queued jobs and waits for running ones
+    ~TrackAnalyzer();
+
+    //One worker per core, less one left for the audio and message threads
+    static int getDefaultNumWorkers();
+
+    //Message thread: queues a track for analysis
+    void analyse(const File& file);
+    //Tracks queued or being analysed
+    int getNumPending() const { return numPending.load(); }
+    //Message thread: results finished since the last call
+    std::vector<Result> takeResults();
+
+    //Any thread: analyses a track on the calling thread, returns an unanalysed grid if shouldExit returned true
+    static BeatGrid analyseReader(AudioFormatReader& reader, const std::function<bool()>& shouldExit = nullptr);
+
+    //How strongly onsets start in each frame, over all bands and in the bass alone
+    struct OnsetEnvelope
+    {
+        std::vector<float> onsets;
+        std::vector<float> bassOnsets;
+        //Frames a second, and the time of the middle of the first frame
+        double frameRate = 0.0;
+        double firstFrameSeconds = 0.0;
+    };
+
+    //Any thread: tempo and downbeat from onset envelopes
+    static BeatGrid analyseEnvelope(const OnsetEnvelope& envelope);
+
+private:
+    class AnalysisJob;
+
+    //Decoders for the workers, separate from the decks' so opening a file here never waits on them
+    AudioFormatManager formatManager;
+    ThreadPool workerPool;
+    std::atomic<int> numPending { 0 };
+
+    CriticalSection resultLock;
+    std::vector<Result> finishedResults;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackAnalyzer)
+};
@@ -0,0 +1,221 @@
+#include "TrackCache.h"
+
+//Function to get the memory the samples of a cached track take up
+size_t CachedTrackData::getSizeInBytes() const
+{
+    auto bytesPerSample = isCompact ? sizeof(int16) : sizeof(float);
+    return (size_t) numChannels * (size_t) lengthInSamples * bytesPerSample;
+}
+
+//Constructor: Stores the budget and sample format
+TrackCache::TrackCache(size_t memoryBudgetBytes, bool useCompactSamples)
+    : memoryBudget(memoryBudgetBytes),
+      compactSamples(useCompactSamples)
+{
+}
+
+//Destructor: Releases the cache's references to its tracks
+TrackCache::~TrackCache()
+{
+    clear();
+}
+
+//Function to change the memory budget
+void TrackCache::setMemoryBudget(size_t newBudgetBytes)
+{
+    const ScopedLock sl(lock);
+    memoryBudget = newBudgetBytes;
+    evictToFit(0);
+}
+
+//Function to get the memory budget
+size_t TrackCache::getMemoryBudget() const
+{
+    const ScopedLock sl(lock);
+    return memoryBudget;
+}
+
+//Function to get the memory charged to the budget
+size_t TrackCache::getMemoryUsed() const
+{
+    return ledger->bytesCharged.load();
+}
+
+//Function to get the number of cached tracks
+int TrackCache::getNumTracks() const
+{
+    const ScopedLock sl(lock);
+    return (int) entries.size();
+}
+
+//Function to choose the sample format for tracks decoded from now on
+void TrackCache::setUseCompactSamples(bool shouldUseCompactSamples)
+{
+    const ScopedLock sl(lock);
+    compactSamples = shouldUseCompactSamples;
+}
+
+//Function to check the sample format
+bool TrackCache::isUsingCompactSamples() const
+{
+    const ScopedLock sl(lock);
+    return compactSamples;
+}
+
+//Function to build the key a track is cached under
+String TrackCache::makeKey(const URL& audioURL)
+{
+    if (audioURL.isLocalFile())
+    {
+        auto file = audioURL.getLocalFile();
+        return file.getFullPathName() + "|" + String(file.getLastModificationTime().toMilliseconds());
+    }
+
+    return audioURL.toString(false);
+}
+
+//Function to look up a cached track
+std::shared_ptr<const CachedTrackData> TrackCache::find(const String& key)
+{
+    const ScopedLock sl(lock);
+
+    for (auto& entry : entries)
+    {
+        if (entry.data->key == key)
+        {
+            entry.lastUsed = ++useCounter;
+            return entry.data;
+        }
+    }
+
+    return nullptr;
+}
+
+//Function to decode a whole track into RAM and add it to the cache
+std::shared_ptr<const CachedTrackData> TrackCache::decode(AudioFormatReader& reader, const String& key,
+                                                          const std::function<void(float)>& onProgress,
+                                                          const std::function<bool()>& shouldExit)
+{
+    //Decoded samples are addressed with int indices by AudioBuffer
+    if (reader.lengthInSamples <= 0 || reader.lengthInSamples > std::numeric_limits<int>::max())
+        return nullptr;
+
+    auto newTrack = std::make_unique<CachedTrackData>();
+    newTrack->key = key;
+    newTrack->sampleRate = reader.sampleRate;
+    newTrack->numChannels = jlimit(1, 2, (int) reader.numChannels);
+    newTrack->lengthInSamples = reader.lengthInSamples;
+    newTrack->isCompact = isUsingCompactSamples();
+
+    //Charge the track before its samples are allocated; a track that doesn't fit is streamed from disk instead
+    auto size = newTrack->getSizeInBytes();
+    {
+        const ScopedLock sl(lock);
+        if (! evictToFit(size))
+            return nullptr;
+
+        ledger->bytesCharged += size;
+    }
+
+    //The charge goes with the last reference, whether the decode is abandoned, the track is evicted or a deck drops it
+    std::shared_ptr<CachedTrackData> track(newTrack.release(), [ledger = ledger, size] (CachedTrackData* data)
+    {
+        ledger->bytesCharged -= size;
+        delete data;
+    });
+
+    auto length = static_cast<int>(track->lengthInSamples);
+    bool useRight = track->numChannels > 1;
+
+    //Decode in chunks so progress can be reported and a cancelled load stops quickly
+    const int chunkSize = 65536;
+    AudioBuffer<float> chunk;
+
+    if (track->isCompact)
+    {
+        track->compactSamples.allocate((size_t) track->numChannels * (size_t) length, false);
+        chunk.setSize(track->numChannels, chunkSize);
+    }
+    else
+    {
+        track->floatSamples.setSize(track->numChannels, length);
+    }
+
+    for (int start = 0; start < length; start += chunkSize)
+    {
+        if (shouldExit != nullptr && shouldExit())
+            return nullptr;
+
+        auto numSamples = jmin(chunkSize, length - start);
+
+        if (track->isCompact)
+        {
+            reader.read(&chunk, 0, numSamples, start, true, useRight);
+
+            //Convert to 16-bit with rounding and clipping
+            for (int channel = 0; channel < track->numChannels; ++channel)
+            {
+                auto* source = chunk.getReadPointer(channel);
+                auto* dest = track->compactSamples.get() + (size_t) channel * (size_t) length + (size_t) start;
+
+                for (int i = 0; i < numSamples; ++i)
+                    dest[i] = (int16) jlimit(-32768, 32767, roundToInt(source[i] * 32767.0f));
+            }
+        }
+        else
+        {
+            reader.read(&track->floatSamples, start, numSamples, start, true, useRight);
+        }
+
+        if (onProgress != nullptr)
+            onProgress(static_cast<float>(start + numSamples) / static_cast<float>(length));
+    }
+
+    const ScopedLock sl(lock);
+
+    //Another deck may have cached the same track while this one was decoding
+    for (auto& entry : entries)
+    {
+        if (entry.data->key == key)
+        {
+            entry.lastUsed = ++useCounter;
+            return entry.data;
+        }
+    }
+
+    entries.push_back({ track, ++useCounter });
+
+    std::cout << "TrackCache: cached " << key << " (" << (size / (1024 * 1024)) << " MB, "
+              << (getMemoryUsed() / (1024 * 1024)) << " of " << (memoryBudget / (1024 * 1024)) << " MB used)" << std::endl;
+
+    return track;
+}
+
+//Function to drop every cached track, each stays charged until the decks holding it let go
+void TrackCache::clear()
+{
+    const ScopedLock sl(lock);
+    entries.clear();
+}
+
+//Function to evict least recently used tracks until extraBytes more fits in the budget. Only the cache's own
+//reference can be handed out again, and only under the lock, so a track with no other reference stays that way
+bool TrackCache::evictToFit(size_t extraBytes)
+{
+    while (ledger->bytesCharged.load() + extraBytes > memoryBudget)
+    {
+        auto oldest = entries.end();
+        for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+            if (entry->data.use_count() == 1 && (oldest == entries.end() || entry->lastUsed < oldest->lastUsed))
+                oldest = entry;
+
+        //Everything left is held by a deck or still decoding
+        if (oldest == entries.end())
+            return false;
+
+        //Its deleter takes the charge off
+        entries.erase(oldest);
+    }
+
+    return true;
+}
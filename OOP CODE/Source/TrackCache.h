@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+//A whole track decoded into memory, shared by every deck playing it and never changed after it is built
+struct CachedTrackData
+{
+    //Key the track is cached under
+    String key;
+    double sampleRate = 0.0;
+    int numChannels = 0;
+    int64 lengthInSamples = 0;
+
+    //Samples as 32-bit floats, used when the cache is not compact
+    AudioBuffer<float> floatSamples;
+    //Samples as 16-bit integers, channel after channel, used when the cache is compact
+    HeapBlock<int16> compactSamples;
+    bool isCompact = false;
+
+    //Memory the samples take up
+    size_t getSizeInBytes() const;
+};
+
+//Keeps fully decoded tracks in RAM so re-loading a recent track and seeking anywhere in it is instant.
+//Shared by every deck through the TrackLoader, least recently used tracks are evicted to stay within the budget.
+//
+//The budget covers all the memory the cache's tracks really take: a track is charged from the moment its decode
+//starts until the last reference to it goes, so decodes under way and tracks a deck still plays after they were
+//evicted count as well. Only tracks no deck holds are evicted, dropping the others would free nothing yet; a decode
+//that doesn't fit even then is refused and the deck streams the track from disk
+class TrackCache
+{
+public:
+    //Constructor: Takes the memory budget in bytes and whether to store samples as 16-bit
+    TrackCache(size_t memoryBudgetBytes = 512 * 1024 * 1024, bool useCompactSamples = false);
+    //Destructor: Drops every cached track, decks still playing one keep it alive
+    ~TrackCache();
+
+    //Sets how much memory the cache may use, evicting tracks straight away if it is now over budget
+    void setMemoryBudget(size_t newBudgetBytes);
+    size_t getMemoryBudget() const;
+    //Gets how much memory is charged to the budget: cached tracks, evicted ones still held and decodes under way
+    size_t getMemoryUsed() const;
+    //Gets how many tracks are cached
+    int getNumTracks() const;
+
+    //Stores tracks decoded from now on as 16-bit samples, halving their size
+    void setUseCompactSamples(bool shouldUseCompactSamples);
+    bool isUsingCompactSamples() const;
+
+    //Builds the cache key for a track, local files include their modification time so edited files are re-decoded
+    static String makeKey(const URL& audioURL);
+
+    //Looks up a cached track and marks it as recently used, returns null if it isn't cached
+    std::shared_ptr<const CachedTrackData> find(const String& key);
+
+    //Decodes a whole track into the cache on the calling thread (a loader worker), reporting the fraction done.
+    //Returns null if the track doesn't fit in what is left of the budget or shouldExit returns true part way through
+    std::shared_ptr<const CachedTrackData> decode(AudioFormatReader& reader, const String& key,
+                                                  const std::function<void(float)>& onProgress = nullptr,
+                                                  const std::function<bool()>& shouldExit = nullptr);
+
+    //Drops every cached track
+    void clear();
+
+private:
+    //A cached track and when it was last asked for
+    struct Entry
+    {
+        std::shared_ptr<const CachedTrackData> data;
+        uint64 lastUsed = 0;
+    };
+
+    //Memory charged to the budget, shared with every track's deleter so a track is charged until its last reference
+    //goes, even one that outlives the cache
+    struct Ledger
+    {
+        std::atomic<size_t> bytesCharged { 0 };
+    };
+
+    //Evicts least recently used tracks no deck holds until extraBytes more fits in the budget, call with lock held;
+    //false if it still doesn't fit
+    bool evictToFit(size_t extraBytes);
+
+    //Guards the entries, only taken by the message thread and loader workers, never the audio thread
+    CriticalSection lock;
+    std::vector<Entry> entries;
+    size_t memoryBudget;
+    std::shared_ptr<Ledger> ledger { std::make_shared<Ledger>() };
+    bool compactSamples;
+    //Counter used to order entries by last use
+    uint64 useCounter = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackCache)
+};
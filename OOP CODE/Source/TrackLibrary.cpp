@@ -0,0 +1,129 @@
+#include "TrackLibrary.h"
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+//Function to add a track and count its title
+void TrackLibrary::add(const TrackPad& track)
+{
+    tracks.push_back(track);
+    ++titleCounts[track.title];
+}
+
+//Function to check for a title without scanning the list
+bool TrackLibrary::contains(const juce::String& title) const
+{
+    return titleCounts.find(title) != titleCounts.end();
+}
+
+//Function to find the first track whose title contains the search text
+int TrackLibrary::find(const juce::String& searchText) const
+{
+    auto it = std::find_if(tracks.begin(), tracks.end(),
+                           [&searchText](const TrackPad& track) { return track.title.contains(searchText); });
+
+    return (it != tracks.end()) ? static_cast<int>(std::distance(tracks.begin(), it)) : -1;
+}
+
+//Function to remove a track and uncount its title
+void TrackLibrary::remove(int index)
+{
+    //Ensure index is valid
+    if (index < 0 || index >= static_cast<int>(tracks.size()))
+        return;
+
+    auto count = titleCounts.find(tracks[(size_t) index].title);
+    if (count != titleCounts.end() && --count->second == 0)
+        titleCounts.erase(count);
+
+    tracks.erase(tracks.begin() + index);
+}
+
+//Function to empty the library
+void TrackLibrary::clear()
+{
+    tracks.clear();
+    titleCounts.clear();
+}
+
+//Function to store analysis results against the tracks they belong to
+int TrackLibrary::setBeatGrids(const std::unordered_map<juce::String, BeatGrid>& gridsByPath)
+{
+    int numSet = 0;
+
+    for (auto& track : tracks)
+    {
+        auto grid = gridsByPath.find(track.file.getFullPathName());
+        if (grid != gridsByPath.end())
+        {
+            track.beatGrid = grid->second;
+            ++numSet;
+        }
+    }
+
+    return numSet;
+}
+
+//Function to store a track's hot cues
+bool TrackLibrary::setHotCues(const juce::String& path, const HotCues& cues)
+{
+    for (auto& track : tracks)
+    {
+        if (track.file.getFullPathName() == path)
+        {
+            track.hotCues = cues;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//Function to save the library as CSV
+void TrackLibrary::save(const juce::File& file) const
+{
+    //Open file for writing
+    std::ofstream myLibrary(file.getFullPathName().toStdString());
+    //Enough digits for every double to read back exactly, the default 6 moves a cue past 1000 s by milliseconds
+    myLibrary << std::setprecision(17);
+
+    for (const auto& t : tracks)
+    {
+        //Write each track to file
+        myLibrary << t.file.getFullPathName() << "," << t.length << "," << t.beatGrid.bpm << ","
+                  << t.beatGrid.firstDownbeatSeconds;
+        for (int index = 0; index < HotCues::numCues; ++index)
+            myLibrary << "," << t.hotCues.get(index);
+        myLibrary << "\n";
+    }
+}
+
+//Function to load tracks from a CSV file written by save
+void TrackLibrary::load(const juce::File& file)
+{
+    //Open file for reading
+    std::ifstream myLibrary(file.getFullPathName().toStdString());
+    std::string filePath, rest;
+
+    //Ensure the file is open
+    if (myLibrary.is_open())
+    {
+        // Read file path
+        while (std::getline(myLibrary, filePath, ','))
+        {
+            juce::File trackFile(filePath);
+            TrackPad newTrack(trackFile);
+
+            //Read track length, then the tempo, downbeat and hot cues if the file has them
+            std::getline(myLibrary, rest);
+            auto fields = juce::StringArray::fromTokens(juce::String(rest).trim(), ",", "");
+            newTrack.length = fields[0];
+            newTrack.beatGrid.bpm = fields[1].getDoubleValue();
+            newTrack.beatGrid.firstDownbeatSeconds = fields[2].getDoubleValue();
+            for (int index = 0; index < HotCues::numCues && 3 + index < fields.size(); ++index)
+                newTrack.hotCues.set(index, fields[3 + index].getDoubleValue());
+            //Add track to library
+            add(newTrack);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+#include <unordered_map>
+#include "TrackList.h"
+
+//The tracks in the library, kept in the order they were added. Titles are also counted in a hash map, so checking
+//for a duplicate on import doesn't scan the whole list; searching still looks at every title
+class TrackLibrary
+{
+public:
+    //Number of tracks in the library
+    size_t size() const { return tracks.size(); }
+    //Track at an index
+    const TrackPad& operator[](size_t index) const { return tracks[index]; }
+
+    //Adds a track to the end of the library
+    void add(const TrackPad& track);
+    //Checks if a track with this title is already in the library
+    bool contains(const juce::String& title) const;
+    //Index of the first track whose title contains the search text, -1 if there isn't one
+    int find(const juce::String& searchText) const;
+    //Removes the track at an index, ignoring invalid indexes
+    void remove(int index);
+    //Removes every track
+    void clear();
+
+    //Sets the beat grids of the tracks with these full paths, in one pass over the library; returns how many were set
+    int setBeatGrids(const std::unordered_map<juce::String, BeatGrid>& gridsByPath);
+
+    //Sets the hot cues of the track with this full path; returns false if it isn't in the library
+    bool setHotCues(const juce::String& path, const HotCues& cues);
+
+    //Writes one "path,length,bpm,downbeat,cue1,...,cue8" line per track, unset cues as -1; numbers are written at
+    //full precision so they load back exactly
+    void save(const juce::File& file) const;
+    //Adds every track listed in a file written by save, older files without a tempo leave the tracks unanalysed
+    //and older files without cues leave the pads empty
+    void load(const juce::File& file);
+
+private:
+    //Stores the list of tracks
+    std::vector<TrackPad> tracks;
+    //How many tracks have each title
+    std::unordered_map<juce::String, int> titleCounts;
+};
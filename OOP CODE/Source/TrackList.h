@@ -1,5 +1,7 @@
 #pragma once
 #include <JuceHeader.h>
+#include "BeatGrid.h"
+#include "HotCues.h"
 
 class TrackPad
 {
@@ -15,6 +17,10 @@ public:
     juce::String title;
     //Length of the track (as a string)
     juce::String length;
+    //Tempo and downbeat, filled in once the track has been analysed
+    BeatGrid beatGrid;
+    //Hot cue points set on the decks' pads
+    HotCues hotCues;
 
     /** Compare object's title for searching */
     bool operator==(const juce::String& other) const;
@@ -0,0 +1,384 @@
+#include "TrackLoader.h"
+
+//Worker job that loads one track and posts the result back to the message thread
+class TrackLoader::LoadJob : public ThreadPoolJob
+{
+public:
+    LoadJob(TrackLoader& _owner, const URL& _audioURL, const LoadSettings& _settings,
+            ProgressCallback _onProgress, CompletionCallback _onComplete)
+        : ThreadPoolJob("Track load"),
+          owner(_owner),
+          audioURL(_audioURL),
+          settings(_settings),
+          onProgress(std::move(_onProgress)),
+          onComplete(std::move(_onComplete))
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        //Only post a handful of progress updates to the message thread
+        float lastReported = 0.0f;
+        auto reportProgress = [this, &lastReported] (float progress)
+        {
+            if (onProgress == nullptr || progress - lastReported < 0.1f)
+                return;
+
+            lastReported = progress;
+            auto callback = onProgress;
+            MessageManager::callAsync([callback, progress] { callback(progress); });
+        };
+
+        auto track = owner.loadNow(audioURL, settings, reportProgress, [this] { return shouldExit(); });
+
+        std::unique_ptr<AudioFormatReader> thumbnailReader;
+        if (track != nullptr && settings.wantsThumbnailReader)
+            thumbnailReader = owner.createReaderFor(audioURL);
+
+        if (shouldExit())
+            return jobHasFinished;
+
+        //std::function needs a copyable lambda, so ownership travels in shared pointers
+        auto trackHolder = std::make_shared<std::unique_ptr<LoadedTrack>>(std::move(track));
+        auto readerHolder = std::make_shared<std::unique_ptr<AudioFormatReader>>(std::move(thumbnailReader));
+        auto callback = onComplete;
+
+        MessageManager::callAsync([callback, trackHolder, readerHolder]
+        {
+            if (callback != nullptr)
+                callback(std::move(*trackHolder), std::move(*readerHolder));
+        });
+
+        return jobHasFinished;
+    }
+
+private:
+    TrackLoader& owner;
+    URL audioURL;
+    LoadSettings settings;
+    ProgressCallback onProgress;
+    CompletionCallback onComplete;
+};
+
+//Worker job that decodes part of a track and posts the audio back to the message thread
+class TrackLoader::RangeJob : public ThreadPoolJob
+{
+public:
+    RangeJob(TrackLoader& _owner, const LoadedTrack& track, int64 _start, int _numSamples, RangeCallback _onDecoded)
+        : ThreadPoolJob("Range decode"),
+          owner(_owner),
+          start(_start),
+          numSamples(_numSamples),
+          onDecoded(std::move(_onDecoded))
+    {
+        //A copy of the track without its playback sources, sharing the cached samples if it has them
+        source.url = track.url;
+        source.sampleRate = track.sampleRate;
+        source.lengthInSamples = track.lengthInSamples;
+
+        if (track.cachedSource != nullptr)
+            source.cachedSource.reset(new CachedTrackSource(track.cachedSource->getData()));
+    }
+
+    JobStatus runJob() override
+    {
+        auto audio = std::make_shared<AudioBuffer<float>>();
+        if (! owner.decodeRange(source, *audio, start, numSamples))
+            audio->setSize(2, 0);
+
+        if (shouldExit())
+            return jobHasFinished;
+
+        auto callback = onDecoded;
+        MessageManager::callAsync([callback, audio]
+        {
+            if (callback != nullptr)
+                callback(*audio);
+        });
+
+        return jobHasFinished;
+    }
+
+private:
+    TrackLoader& owner;
+    LoadedTrack source;
+    int64 start;
+    int numSamples;
+    RangeCallback onDecoded;
+};
+
+//Constructor: Starts the worker pool
+TrackLoader::TrackLoader(AudioFormatManager& _formatManager, TimeSliceThread& _readAheadThread, int numWorkerThreads)
+    : formatManager(_formatManager),
+      readAheadThread(_readAheadThread),
+      workerPool(numWorkerThreads)
+{
+}
+
+//Destructor: Stops all pending loads before the pool goes away
+TrackLoader::~TrackLoader()
+{
+    workerPool.removeAllJobs(true, 5000);
+}
+
+//Function to queue a track load on the worker pool
+void TrackLoader::loadAsync(const URL& audioURL, const LoadSettings& settings,
+                            ProgressCallback onProgress, CompletionCallback onComplete)
+{
+    workerPool.addJob(new LoadJob(*this, audioURL, settings, std::move(onProgress), std::move(onComplete)), true);
+}
+
+//Function to open, probe and pre-decode a track on the calling thread
+std::unique_ptr<LoadedTrack> TrackLoader::loadNow(const URL& audioURL, const LoadSettings& settings,
+                                                  const std::function<void(float)>& onProgress,
+                                                  const std::function<bool()>& shouldExit)
+{
+    auto startTime = Time::getMillisecondCounterHiRes();
+
+    //Play from RAM when the track is cached or fits in the cache
+    if (trackCache != nullptr && settings.useCache)
+    {
+        if (auto track = loadFromCache(audioURL, onProgress, shouldExit))
+        {
+            decodeHotCues(*track, settings);
+            track->loadTimeMs = Time::getMillisecondCounterHiRes() - startTime;
+            return track;
+        }
+
+        if (shouldExit != nullptr && shouldExit())
+            return nullptr;
+    }
+
+    //Open the file and read its header
+    auto reader = createReaderFor(audioURL);
+    if (reader == nullptr)
+        return nullptr;
+
+    if (onProgress != nullptr)
+        onProgress(0.1f);
+
+    auto track = std::make_unique<LoadedTrack>();
+    track->url = audioURL;
+    track->sampleRate = reader->sampleRate;
+    track->lengthInSamples = reader->lengthInSamples;
+
+    auto numChannels = static_cast<int>(reader->numChannels);
+    auto preDecodeSamples = roundToInt(settings.preDecodeSeconds * reader->sampleRate);
+
+    //Build the read-ahead chain big enough to hold the pre-decoded start of the track
+    track->readerSource.reset(new AudioFormatReaderSource(reader.release(), true));
+    track->bufferedSource.reset(new DeckReadAheadSource(track->readerSource.get(), readAheadThread, false,
+                                                        jmax(settings.readAheadSamples, preDecodeSamples),
+                                                        numChannels));
+    track->bufferedSource->prepareToPlay(settings.blockSize, settings.deviceSampleRate);
+
+    //Decode the first few seconds here so the deck never waits for the disk when it starts
+    track->bufferedSource->prime(preDecodeSamples, [&onProgress] (float fraction)
+    {
+        if (onProgress != nullptr)
+            onProgress(0.1f + 0.9f * fraction);
+    });
+
+    //The audio after each hot cue is decoded too, so a cue can be played before the read-ahead gets there
+    decodeHotCues(*track, settings);
+
+    if (onProgress != nullptr)
+        onProgress(1.0f);
+
+    track->loadTimeMs = Time::getMillisecondCounterHiRes() - startTime;
+    return track;
+}
+
+//Function to decode the audio after each hot cue of a track that was just loaded
+void TrackLoader::decodeHotCues(LoadedTrack& track, const LoadSettings& settings)
+{
+    std::unique_ptr<AudioFormatReader> reader;
+
+    for (int index = 0; index < HotCues::numCues; ++index)
+    {
+        if (! settings.hotCues.isSet(index))
+            continue;
+
+        //Streamed tracks need a reader of their own, the read-ahead thread is using the track's
+        if (track.cachedSource == nullptr && reader == nullptr)
+            reader = createReaderFor(track.url);
+
+        track.hotCues[(size_t) index] = decodeHotCue(track, settings.hotCues.get(index), settings.hotCuePreDecodeSeconds,
+                                                     reader.get());
+    }
+}
+
+//Function to turn a cue time into a sample position inside the track
+int64 TrackLoader::getCuePosition(const LoadedTrack& track, double seconds)
+{
+    return jlimit((int64) 0, jmax((int64) 0, track.lengthInSamples - 1), (int64) (seconds * track.sampleRate));
+}
+
+//Function to make a hot cue for a loaded track and decode the audio after it
+std::unique_ptr<HotCue> TrackLoader::decodeHotCue(const LoadedTrack& track, double seconds, double preDecodeSeconds,
+                                                  AudioFormatReader* reader)
+{
+    auto cue = std::make_unique<HotCue>();
+    cue->track = &track;
+    cue->position = getCuePosition(track, seconds);
+
+    auto numSamples = (int) jmin(track.lengthInSamples - cue->position, (int64) (preDecodeSeconds * track.sampleRate));
+    decodeRange(track, cue->audio, cue->position, numSamples, reader);
+    return cue;
+}
+
+//Function to queue a decode of part of a loaded track on the worker pool
+void TrackLoader::decodeRangeAsync(const LoadedTrack& track, int64 start, int numSamples, RangeCallback onDecoded)
+{
+    workerPool.addJob(new RangeJob(*this, track, start, numSamples, std::move(onDecoded)), true);
+}
+
+//Function to make a hot cue now and decode the audio after it on the worker pool
+void TrackLoader::decodeHotCueAsync(const LoadedTrack& track, double seconds, double preDecodeSeconds,
+                                    HotCueCallback onDecoded)
+{
+    auto position = getCuePosition(track, seconds);
+    auto numSamples = (int) jmin(track.lengthInSamples - position, (int64) (preDecodeSeconds * track.sampleRate));
+    const LoadedTrack* cueTrack = &track;
+
+    decodeRangeAsync(track, position, numSamples, [cueTrack, position, onDecoded] (AudioBuffer<float>& audio)
+    {
+        auto cue = std::make_unique<HotCue>();
+        cue->track = cueTrack;
+        cue->position = position;
+        cue->audio = std::move(audio);
+
+        if (onDecoded != nullptr)
+            onDecoded(std::move(cue));
+    });
+}
+
+//Function to decode part of a track from the RAM cache if it is cached, otherwise through a reader
+bool TrackLoader::decodeRange(const LoadedTrack& track, AudioBuffer<float>& destination, int64 start, int numSamples,
+                              AudioFormatReader* reader)
+{
+    if (numSamples <= 0)
+    {
+        destination.setSize(2, 0);
+        return false;
+    }
+
+    if (track.cachedSource != nullptr)
+    {
+        destination.setSize(2, numSamples);
+        track.cachedSource->readSamples(destination, 0, start, numSamples);
+        return true;
+    }
+
+    std::unique_ptr<AudioFormatReader> ownReader;
+    if (reader == nullptr)
+    {
+        ownReader = createReaderFor(track.url);
+        reader = ownReader.get();
+    }
+
+    if (reader == nullptr)
+    {
+        destination.setSize(2, 0);
+        return false;
+    }
+
+    destination.setSize(2, numSamples);
+    return reader->read(&destination, 0, numSamples, start, true, true);
+}
+
+//Function to play a track from the RAM cache, decoding it into the cache first if needed
+std::unique_ptr<LoadedTrack> TrackLoader::loadFromCache(const URL& audioURL, const std::function<void(float)>& onProgress,
+                                                        const std::function<bool()>& shouldExit)
+{
+    auto key = TrackCache::makeKey(audioURL);
+    auto cached = trackCache->find(key);
+
+    if (cached == nullptr)
+    {
+        auto reader = createReaderFor(audioURL);
+        if (reader == nullptr)
+            return nullptr;
+
+        if (onProgress != nullptr)
+            onProgress(0.1f);
+
+        cached = trackCache->decode(*reader, key, [&onProgress] (float fraction)
+        {
+            if (onProgress != nullptr)
+                onProgress(0.1f + 0.9f * fraction);
+        }, shouldExit);
+
+        if (cached == nullptr)
+            return nullptr;
+    }
+
+    auto track = std::make_unique<LoadedTrack>();
+    track->url = audioURL;
+    track->sampleRate = cached->sampleRate;
+    track->lengthInSamples = cached->lengthInSamples;
+    track->cachedSource.reset(new CachedTrackSource(cached));
+
+    if (onProgress != nullptr)
+        onProgress(1.0f);
+
+    return track;
+}
+
+//Function to set the RAM cache tracks are decoded into
+void TrackLoader::setTrackCache(TrackCache* cacheToUse)
+{
+    trackCache = cacheToUse;
+}
+
+//Function to open a reader for a local file or a URL stream
+std::unique_ptr<AudioFormatReader> TrackLoader::createReaderFor(const URL& audioURL)
+{
+    //Local files are opened directly so the reader gets a buffered file stream
+    if (audioURL.isLocalFile())
+        return std::unique_ptr<AudioFormatReader>(formatManager.createReaderFor(audioURL.getLocalFile()));
+
+    return std::unique_ptr<AudioFormatReader>(formatManager.createReaderFor(audioURL.createInputStream(false)));
+}
+
+//Function to get the source the deck plays this track from
+PositionableAudioSource* LoadedTrack::getPlaybackSource() const
+{
+    if (cachedSource != nullptr)
+        return cachedSource.get();
+
+    return bufferedSource.get();
+}
+
+//Function to get the read-ahead underruns for this track
+int LoadedTrack::getNumUnderruns() const
+{
+    return bufferedSource != nullptr ? bufferedSource->getNumUnderruns() : 0;
+}
+
+//Function to read samples at any position from whichever source the track plays from
+void LoadedTrack::readSamples(AudioBuffer<float>& dest, int destStartSample, int64 start, int numSamples) const
+{
+    if (cachedSource != nullptr)
+        cachedSource->readSamples(dest, destStartSample, start, numSamples);
+    else
+        bufferedSource->readSamples(dest, destStartSample, start, numSamples);
+}
+
+//Function to keep the read-ahead window around a playhead that can move either way
+void LoadedTrack::followPlayhead(int64 position, bool backwards) const
+{
+    if (cachedSource != nullptr)
+        cachedSource->setNextReadPosition(position);
+    else
+        bufferedSource->movePlayhead(position, backwards);
+}
+
+//Function to move the playhead of whichever source the track plays from, from the audio thread
+void LoadedTrack::jumpPlayhead(int64 position) const noexcept
+{
+    if (cachedSource != nullptr)
+        cachedSource->setNextReadPosition(position);
+    else
+        bufferedSource->jumpPlayhead(position);
+}
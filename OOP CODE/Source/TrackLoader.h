@@ -0,0 +1,149 @@
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "DeckReadAheadSource.h"
+#include "TrackCache.h"
+#include "CachedTrackSource.h"
+#include "BeatGrid.h"
+#include "HotCues.h"
+
+struct LoadedTrack;
+
+//Audio from a hot cue on, decoded in advance so jumping to the cue plays from memory while the read-ahead catches up
+struct HotCue
+{
+    //Track the cue was decoded from, the cue is ignored while a different track is live
+    const LoadedTrack* track = nullptr;
+    //Cue position in samples at the track's sample rate
+    int64 position = 0;
+    //Decoded audio from the cue on; empty if it could not be decoded
+    AudioBuffer<float> audio;
+
+    int getNumPreBuffered() const { return audio.getNumSamples(); }
+};
+
+//Everything a deck needs to play one track, built and pre-decoded away from the audio thread
+struct LoadedTrack
+{
+    //Where the track was loaded from
+    URL url;
+    //Sample rate of the file itself
+    double sampleRate = 0.0;
+    //Length of the track in samples at its own sample rate
+    int64 lengthInSamples = 0;
+    //How long opening, probing and pre-decoding took
+    double loadTimeMs = 0.0;
+    //Tempo and downbeat the deck was given with the track, unanalysed if it had none
+    BeatGrid beatGrid;
+    //Hot cues decoded with the track, null for pads with no cue; the deck hands them on to its slot
+    std::array<std::unique_ptr<HotCue>, HotCues::numCues> hotCues;
+
+    //Decoder for the file
+    std::unique_ptr<AudioFormatReaderSource> readerSource;
+    //Read-ahead buffer around the decoder, declared last so it is deleted before the decoder
+    std::unique_ptr<DeckReadAheadSource> bufferedSource;
+    //Set instead of the two above when the whole track is decoded in the RAM cache
+    std::unique_ptr<CachedTrackSource> cachedSource;
+
+    //Source the deck plays from: the RAM cache if the track is cached, the read-ahead buffer otherwise
+    PositionableAudioSource* getPlaybackSource() const;
+    //Blocks that found the read-ahead buffer empty, always 0 for cached tracks
+    int getNumUnderruns() const;
+    //Audio thread, for reading at a varying speed: copies samples from anywhere around the playhead without moving it,
+    //from the RAM cache or the read-ahead window; silence where nothing is decoded
+    void readSamples(AudioBuffer<float>& dest, int destStartSample, int64 start, int numSamples) const;
+    //Audio thread: tells the read-ahead where reading at a varying speed has got to and which way it is going
+    void followPlayhead(int64 position, bool backwards) const;
+    //Audio thread: moves the playhead for a jump, without waking the read-ahead thread
+    void jumpPlayhead(int64 position) const noexcept;
+};
+
+//Opens, probes and pre-decodes tracks on a small worker pool so loading never blocks the UI or the audio callback
+class TrackLoader
+{
+public:
+    //How a track should be prepared for the deck that asked for it
+    struct LoadSettings
+    {
+        //Size of the deck's read-ahead buffer in samples
+        int readAheadSamples = 32768;
+        //How much of the start of the track is decoded before it is handed over
+        double preDecodeSeconds = 3.0;
+        //Block size and device sample rate the deck is currently running at
+        int blockSize = 512;
+        double deviceSampleRate = 44100.0;
+        //Also open a second reader that the waveform display can take over
+        bool wantsThumbnailReader = false;
+        //Decode the whole track into the RAM cache, if the loader has one
+        bool useCache = true;
+        //Hot cues to decode the audio after, and how much of it
+        HotCues hotCues;
+        double hotCuePreDecodeSeconds = 1.0;
+    };
+
+    //Called on the message thread with the fraction of the load done so far
+    using ProgressCallback = std::function<void(float progress)>;
+    //Called on the message thread when the load finishes, track is null if the file could not be opened
+    using CompletionCallback = std::function<void(std::unique_ptr<LoadedTrack> track,
+                                                  std::unique_ptr<AudioFormatReader> thumbnailReader)>;
+    //Called on the message thread with the audio decodeRangeAsync decoded, empty if the track could not be read
+    using RangeCallback = std::function<void(AudioBuffer<float>& audio)>;
+    //Called on the message thread with the cue decodeHotCueAsync made, its audio empty if the track could not be read
+    using HotCueCallback = std::function<void(std::unique_ptr<HotCue> cue)>;
+
+    //Constructor: Takes the formats to decode with and the thread that will do read-ahead for loaded tracks
+    TrackLoader(AudioFormatManager& _formatManager, TimeSliceThread& _readAheadThread, int numWorkerThreads = 2);
+    //Destructor: Cancels any loads that are still running
+    ~TrackLoader();
+
+    //Loads a track on a worker thread and reports back on the message thread
+    void loadAsync(const URL& audioURL, const LoadSettings& settings,
+                   ProgressCallback onProgress, CompletionCallback onComplete);
+
+    //Loads a track on the calling thread, returns null if the file could not be opened or shouldExit returned true
+    std::unique_ptr<LoadedTrack> loadNow(const URL& audioURL, const LoadSettings& settings,
+                                         const std::function<void(float)>& onProgress = nullptr,
+                                         const std::function<bool()>& shouldExit = nullptr);
+
+    //Shares a RAM cache between everything that loads through this loader, call before the first load
+    void setTrackCache(TrackCache* cacheToUse);
+    TrackCache* getTrackCache() const { return trackCache; }
+
+    //Opens a reader for a track, used for waveforms and metadata
+    std::unique_ptr<AudioFormatReader> createReaderFor(const URL& audioURL);
+
+    //Any thread: decodes part of a loaded track into a buffer from the RAM cache, or from a reader of its own;
+    //returns false and leaves the buffer empty if the track can't be read
+    bool decodeRange(const LoadedTrack& track, AudioBuffer<float>& destination, int64 start, int numSamples,
+                     AudioFormatReader* reader = nullptr);
+    //Sample position of a cue time in a loaded track, kept inside the track
+    static int64 getCuePosition(const LoadedTrack& track, double seconds);
+    //Any thread: a hot cue at a time in a loaded track, with the audio after it decoded
+    std::unique_ptr<HotCue> decodeHotCue(const LoadedTrack& track, double seconds, double preDecodeSeconds,
+                                         AudioFormatReader* reader = nullptr);
+
+    //Message thread: decodeRange on the worker pool, so a streamed track never reads the disk on the UI. Everything
+    //the decode needs is copied out of the track first, so the track may be unloaded while it runs
+    void decodeRangeAsync(const LoadedTrack& track, int64 start, int numSamples, RangeCallback onDecoded);
+    //Message thread: decodeHotCue the same way; the cue still points at the track, check it is live before using it
+    void decodeHotCueAsync(const LoadedTrack& track, double seconds, double preDecodeSeconds, HotCueCallback onDecoded);
+
+private:
+    class LoadJob;
+    class RangeJob;
+
+    //Finds the track in the RAM cache or decodes it there, returns null if it isn't cacheable
+    std::unique_ptr<LoadedTrack> loadFromCache(const URL& audioURL, const std::function<void(float)>& onProgress,
+                                               const std::function<bool()>& shouldExit);
+    //Decodes the audio after every hot cue in the settings, sharing one reader between them
+    void decodeHotCues(LoadedTrack& track, const LoadSettings& settings);
+
+    AudioFormatManager& formatManager;
+    TimeSliceThread& readAheadThread;
+    //Optional RAM cache of fully decoded tracks
+    TrackCache* trackCache = nullptr;
+    //Worker threads that do the opening and pre-decoding
+    ThreadPool workerPool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackLoader)
+};
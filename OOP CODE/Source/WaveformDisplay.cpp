@@ -28,8 +28,15 @@ void WaveformDisplay::paint (juce::Graphics& g)
     //Use the configurable waveform colour here:
     g.setColour(waveformColour);
     
+    //While a track is loading, show how far it has got
+    if (loadProgress >= 0.0)
+    {
+        g.setFont (juce::FontOptions (20.0f));
+        g.drawText ("Loading... " + juce::String (juce::roundToInt (loadProgress * 100.0)) + "%",
+                    getLocalBounds(), juce::Justification::centred, true);
+    }
     //If an audio file is loaded, draw the waveform
-    if(fileLoaded){
+    else if(fileLoaded){
         audioThumb.drawChannel(g, //Graphics context
                                getLocalBounds(), //Area to draw within
                                0, //Start time in seconds
@@ -74,6 +81,33 @@ void WaveformDisplay::loadURL(URL audioURL) {
     }
 }
 
+//Function to show the waveform of a reader that was opened off the message thread
+void WaveformDisplay::loadReader(std::unique_ptr<AudioFormatReader> reader, const URL& audioURL) {
+    
+    //Clear any existing waveform data
+    audioThumb.clear();
+    loadProgress = -1.0;
+    
+    fileLoaded = reader != nullptr;
+    
+    //The thumbnail takes ownership of the reader and scans it on the cache's thread
+    if (fileLoaded)
+        audioThumb.setReader(reader.release(), audioURL.toString(false).hashCode64());
+    
+    repaint();
+}
+
+//Function to update the load progress shown in place of the waveform
+void WaveformDisplay::setLoadProgress(double progress){
+    
+    //Only repaint when the progress actually changes
+    if (progress != loadProgress)
+    {
+        loadProgress = progress;
+        repaint();
+    }
+}
+
 //Called when the waveform data changes
 void WaveformDisplay::changeListenerCallback (ChangeBroadcaster *source){
     std::cout << "wtd:change received" <<std::endl;
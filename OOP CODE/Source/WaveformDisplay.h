@@ -28,6 +28,12 @@ public:
     //Function to loads an audio file from a given URL and updates the waveform display accordingl
     void loadURL(URL audioURL);
     
+    //Function to take over a reader that was opened on a worker thread, so the UI never waits for the disk
+    void loadReader(std::unique_ptr<AudioFormatReader> reader, const URL& audioURL);
+    
+    //Function to show how far a track load has got, negative hides the progress
+    void setLoadProgress(double progress);
+    
     //Function to set the color of the waveform and repaints it when a new track is added
     void setWaveformColour(juce::Colour newColour)
         {
@@ -47,6 +53,9 @@ public:
     //Stores the current playback position relative to the waveform
     double position;
     
+    //Progress of a track that is still loading, negative when nothing is loading
+    double loadProgress = -1.0;
+    
     //Color used to render the waveform.
     juce::Colour waveformColour { juce::Colours::orange };
     
@@ -0,0 +1,115 @@
+#include "WsolaStretcher.h"
+
+//Constructor: Stores the frame and search settings, buffers are made in prepare
+WsolaStretcher::WsolaStretcher(double frameMs, double searchMs, int searchStep, int _correlationStep)
+    : frameLengthMs(frameMs),
+      searchLengthMs(searchMs),
+      coarseSearchStep(jmax(1, searchStep)),
+      correlationStep(jmax(1, _correlationStep))
+{
+}
+
+//Function to size the frame and window for the sample rate
+void WsolaStretcher::prepare(double sampleRate, int)
+{
+    //Even frame length so the two halves overlap exactly
+    frameSize = jmax(64, roundToInt(sampleRate * frameLengthMs / 1000.0) & ~1);
+    searchRange = jmax(1, roundToInt(sampleRate * searchLengthMs / 1000.0));
+
+    window.resize((size_t) frameSize);
+    for (int i = 0; i < frameSize; ++i)
+        window[(size_t) i] = 0.5f - 0.5f * std::cos(MathConstants<float>::twoPi * (float) i / (float) frameSize);
+
+    reset();
+}
+
+//Function to forget the previous frame
+void WsolaStretcher::reset() noexcept
+{
+    previousOffset = 0;
+    hasPreviousFrame = false;
+}
+
+//Function to add the best aligned windowed slice around the analysis position into the output
+void WsolaStretcher::processFrame(const float* const* input, float* const* output, int numChannels, int analysisHop) noexcept
+{
+    int offset = 0;
+
+    if (hasPreviousFrame)
+    {
+        //The waveform that would have followed the previous slice if it had carried on playing
+        int templateOffset = previousOffset - analysisHop + getSynthesisHop();
+        offset = findBestOffset(input, numChannels, templateOffset);
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const float* source = input[channel] + offset;
+        float* dest = output[channel];
+
+        for (int i = 0; i < frameSize; ++i)
+            dest[i] += source[i] * window[(size_t) i];
+    }
+
+    previousOffset = offset;
+    hasPreviousFrame = true;
+}
+
+//Function to search the offsets around the analysis position, coarse first and then around the best one
+int WsolaStretcher::findBestOffset(const float* const* input, int numChannels, int templateOffset) const noexcept
+{
+    int bestOffset = 0;
+    float bestScore = -std::numeric_limits<float>::max();
+
+    for (int offset = -searchRange; offset <= searchRange; offset += coarseSearchStep)
+    {
+        auto score = getSimilarity(input, numChannels, offset, templateOffset);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestOffset = offset;
+        }
+    }
+
+    //Refine between the coarse steps either side of the best match
+    int coarseBest = bestOffset;
+    int fineStart = jmax(-searchRange, coarseBest - coarseSearchStep + 1);
+    int fineEnd = jmin(searchRange, coarseBest + coarseSearchStep - 1);
+
+    for (int offset = fineStart; offset <= fineEnd; ++offset)
+    {
+        if (offset == coarseBest)
+            continue;
+
+        auto score = getSimilarity(input, numChannels, offset, templateOffset);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestOffset = offset;
+        }
+    }
+
+    return bestOffset;
+}
+
+//Function to get the normalised cross-correlation over the half of the frame that overlaps the previous one
+float WsolaStretcher::getSimilarity(const float* const* input, int numChannels, int offset, int templateOffset) const noexcept
+{
+    int overlapLength = getSynthesisHop();
+    float correlation = 0.0f;
+    float energy = 0.0f;
+
+    for (int channel = 0; channel < jmin(numChannels, 2); ++channel)
+    {
+        const float* candidate = input[channel] + offset;
+        const float* target = input[channel] + templateOffset;
+
+        for (int i = 0; i < overlapLength; i += correlationStep)
+        {
+            correlation += candidate[i] * target[i];
+            energy += candidate[i] * candidate[i];
+        }
+    }
+
+    return correlation / std::sqrt(energy + 1.0e-9f);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "TimeStretcher.h"
+
+//Waveform-similarity overlap-add: takes plain windowed slices of the input, each one shifted within a small
+//search range so it lines up with the waveform of the previous slice. Cheap and good on drums and vocals,
+//but can double or drop transients at large tempo changes
+class WsolaStretcher : public TimeStretcher
+{
+public:
+    //Constructor: Frame length and search range in milliseconds, the step between offsets tried in the coarse
+    //search, and the step between samples compared when scoring an offset
+    WsolaStretcher(double frameMs, double searchMs, int searchStep, int correlationStep);
+
+    //TimeStretcher overrides
+    void prepare(double sampleRate, int numChannels) override;
+    void reset() noexcept override;
+    int getFrameSize() const noexcept override { return frameSize; }
+    int getSynthesisHop() const noexcept override { return frameSize / 2; }
+    int getSearchRange() const noexcept override { return searchRange; }
+    void processFrame(const float* const* input, float* const* output, int numChannels, int analysisHop) noexcept override;
+
+private:
+    //Finds the offset from the analysis position that best continues the waveform at templateOffset
+    int findBestOffset(const float* const* input, int numChannels, int templateOffset) const noexcept;
+    //Scores how well the slice at offset matches the one at templateOffset
+    float getSimilarity(const float* const* input, int numChannels, int offset, int templateOffset) const noexcept;
+
+    double frameLengthMs;
+    double searchLengthMs;
+    int coarseSearchStep;
+    int correlationStep;
+
+    int frameSize = 0;
+    int searchRange = 0;
+    //Periodic Hann window, overlapping halves sum to exactly one
+    std::vector<float> window;
+
+    //Offset chosen for the previous frame
+    int previousOffset = 0;
+    bool hasPreviousFrame = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WsolaStretcher)
+};